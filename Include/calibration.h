@@ -0,0 +1,91 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		calibration.h
+
+	Abstract:
+
+		Contains calibration mesh defines and types
+
+	Environment:
+
+		Kernel mode
+
+	Revision History:
+
+--*/
+
+#pragma once
+
+#include <wdm.h>
+
+//
+// Largest mesh accepted, in nodes per axis. Nodes are spread evenly over
+// the display, the first and last ones sitting on its edges.
+//
+#define CALIBRATION_MIN_NODES      2
+#define CALIBRATION_MAX_NODES      17
+
+//
+// Node offsets are kept in Q4 display pixels
+//
+#define CALIBRATION_OFFSET_BITS    4
+
+//
+// Layout of the mesh as stored in the registry: the header is followed by
+// Columns * Rows nodes in row major order
+//
+#include <pshpack1.h>
+
+typedef struct _CALIBRATION_MESH_HEADER
+{
+	USHORT Columns;
+	USHORT Rows;
+} CALIBRATION_MESH_HEADER;
+
+typedef struct _CALIBRATION_NODE
+{
+	SHORT X;
+	SHORT Y;
+} CALIBRATION_NODE;
+
+#include <poppack.h>
+
+#define CALIBRATION_MESH_MAX_SIZE \
+	(sizeof(CALIBRATION_MESH_HEADER) + \
+	 CALIBRATION_MAX_NODES * CALIBRATION_MAX_NODES * sizeof(CALIBRATION_NODE))
+
+typedef struct _CALIBRATION_CONTEXT
+{
+	BOOLEAN Enabled;
+	ULONG Columns;
+	ULONG Rows;
+
+	//
+	// Display size and the Q16 mesh cells per display pixel
+	//
+	ULONG Width;
+	ULONG Height;
+	ULONG StepX;
+	ULONG StepY;
+
+	CALIBRATION_NODE Node[CALIBRATION_MAX_NODES * CALIBRATION_MAX_NODES];
+} CALIBRATION_CONTEXT, * PCALIBRATION_CONTEXT;
+
+BOOLEAN
+CalibrationConfigure(
+	IN PCALIBRATION_CONTEXT Context,
+	IN const UCHAR* Mesh,
+	IN ULONG Length,
+	IN ULONG Width,
+	IN ULONG Height
+);
+
+VOID
+CalibrationApply(
+	IN const CALIBRATION_CONTEXT* Context,
+	IN OUT PUSHORT X,
+	IN OUT PUSHORT Y
+);
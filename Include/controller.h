@@ -29,6 +29,48 @@
 //
 // Structures
 //
+//
+// Settings are kept for up to four panel vendors. Per vendor values are
+// named Vendor<nn>..., Revision<nn> and ReprogramFw<nn> in the registry.
+//
+#define TOUCH_SETTINGS_VENDORS          4
+#define TOUCH_SETTINGS_PRODUCT_IDS      10
+#define TOUCH_SETTINGS_BUTTONS          3
+
+typedef struct _TOUCH_VENDOR_SETTINGS
+{
+	UINT32 Vendor;
+	UINT32 Revision;
+	UINT32 ReprogramFw;
+	UINT32 ProductId[TOUCH_SETTINGS_PRODUCT_IDS];
+
+	//
+	// Selftest limits
+	//
+	UINT32 IncludeHighResTest;
+	UINT32 HighResMaxRxLimit;
+	UINT32 HighResMaxTxLimit;
+	UINT32 HighResMinImageLimit;
+	UINT32 IncludeBaselineMinMaxTest;
+	UINT32 BaselineMinMaxMinPixelLimit;
+	UINT32 BaselineMinMaxMaxPixelLimit;
+	UINT32 IncludeFullBaselineTest;
+	UINT32 RxAmount;
+	UINT32 TxAmount;
+	UINT32 RxElectrodeMaskTouch2D;
+	UINT32 TxElectrodeMaskTouch2D;
+	UINT32 RxElectrodeMaskButtons;
+	UINT32 TxElectrodeMaskButtons;
+	UINT32 FullBaselineButtonMin[TOUCH_SETTINGS_BUTTONS];
+	UINT32 FullBaselineButtonMax[TOUCH_SETTINGS_BUTTONS];
+	UINT32 IncludeAbsSenseRawCapTest;
+	UINT32 AbsSenseRawCapTxRxStart;
+	UINT32 AbsSenseRawCapTxRxEnd;
+	UINT32 AbsSenseRawCapMinLimit;
+	UINT32 AbsSenseRawCapMaxLimit;
+	UINT32 IncludeShortTest;
+} TOUCH_VENDOR_SETTINGS, * PTOUCH_VENDOR_SETTINGS;
+
 typedef struct _TOUCH_SCREEN_SETTINGS
 {
 	UINT32 DeviceId;
@@ -47,165 +89,55 @@ typedef struct _TOUCH_SCREEN_SETTINGS
 	UINT32 ControllerType;
 	UINT32 VendorCount;
 	UINT32 ResetControllerInWakeUp;
-	UINT32 Vendor00;
-	UINT32 Vendor01;
-	UINT32 Vendor02;
-	UINT32 Vendor03;
-	UINT32 Revision00;
-	UINT32 Revision01;
-	UINT32 Revision02;
-	UINT32 Revision03;
-	UINT32 ReprogramFw00;
-	UINT32 ReprogramFw01;
-	UINT32 ReprogramFw02;
-	UINT32 ReprogramFw03;
 	UINT32 ForceFlash;
-	UINT32 Vendor00ProductId0;
-	UINT32 Vendor00ProductId1;
-	UINT32 Vendor00ProductId2;
-	UINT32 Vendor00ProductId3;
-	UINT32 Vendor00ProductId4;
-	UINT32 Vendor00ProductId5;
-	UINT32 Vendor00ProductId6;
-	UINT32 Vendor00ProductId7;
-	UINT32 Vendor00ProductId8;
-	UINT32 Vendor00ProductId9;
-	UINT32 Vendor01ProductId0;
-	UINT32 Vendor01ProductId1;
-	UINT32 Vendor01ProductId2;
-	UINT32 Vendor01ProductId3;
-	UINT32 Vendor01ProductId4;
-	UINT32 Vendor01ProductId5;
-	UINT32 Vendor01ProductId6;
-	UINT32 Vendor01ProductId7;
-	UINT32 Vendor01ProductId8;
-	UINT32 Vendor01ProductId9;
-	UINT32 Vendor02ProductId0;
-	UINT32 Vendor02ProductId1;
-	UINT32 Vendor02ProductId2;
-	UINT32 Vendor02ProductId3;
-	UINT32 Vendor02ProductId4;
-	UINT32 Vendor02ProductId5;
-	UINT32 Vendor02ProductId6;
-	UINT32 Vendor02ProductId7;
-	UINT32 Vendor02ProductId8;
-	UINT32 Vendor02ProductId9;
-	UINT32 Vendor03ProductId0;
-	UINT32 Vendor03ProductId1;
-	UINT32 Vendor03ProductId2;
-	UINT32 Vendor03ProductId3;
-	UINT32 Vendor03ProductId4;
-	UINT32 Vendor03ProductId5;
-	UINT32 Vendor03ProductId6;
-	UINT32 Vendor03ProductId7;
-	UINT32 Vendor03ProductId8;
-	UINT32 Vendor03ProductId9;
-	UINT32 Vendor00IncludeHighResTest;
-	UINT32 Vendor00HighResMaxRxLimit;
-	UINT32 Vendor00HighResMaxTxLimit;
-	UINT32 Vendor00HighResMinImageLimit;
-	UINT32 Vendor00IncludeBaselineMinMaxTest;
-	UINT32 Vendor00BaselineMinMaxMinPixelLimit;
-	UINT32 Vendor00BaselineMinMaxMaxPixelLimit;
-	UINT32 Vendor00IncludeFullBaselineTest;
-	UINT32 Vendor00RxAmount;
-	UINT32 Vendor00TxAmount;
-	UINT32 Vendor00RxElectrodeMaskTouch2D;
-	UINT32 Vendor00TxElectrodeMaskTouch2D;
-	UINT32 Vendor00RxElectrodeMaskButtons;
-	UINT32 Vendor00TxElectrodeMaskButtons;
-	UINT32 Vendor00FullBaselineButton0Min;
-	UINT32 Vendor00FullBaselineButton1Min;
-	UINT32 Vendor00FullBaselineButton2Min;
-	UINT32 Vendor00FullBaselineButton0Max;
-	UINT32 Vendor00FullBaselineButton1Max;
-	UINT32 Vendor00FullBaselineButton2Max;
-	UINT32 Vendor00IncludeAbsSenseRawCapTest;
-	UINT32 Vendor00AbsSenseRawCapTxRxStart;
-	UINT32 Vendor00AbsSenseRawCapTxRxEnd;
-	UINT32 Vendor00AbsSenseRawCapMinLimit;
-	UINT32 Vendor00AbsSenseRawCapMaxLimit;
-	UINT32 Vendor00IncludeShortTest;
-	UINT32 Vendor01IncludeHighResTest;
-	UINT32 Vendor01HighResMaxRxLimit;
-	UINT32 Vendor01HighResMaxTxLimit;
-	UINT32 Vendor01HighResMinImageLimit;
-	UINT32 Vendor01IncludeBaselineMinMaxTest;
-	UINT32 Vendor01BaselineMinMaxMinPixelLimit;
-	UINT32 Vendor01BaselineMinMaxMaxPixelLimit;
-	UINT32 Vendor01IncludeFullBaselineTest;
-	UINT32 Vendor01RxAmount;
-	UINT32 Vendor01TxAmount;
-	UINT32 Vendor01RxElectrodeMaskTouch2D;
-	UINT32 Vendor01TxElectrodeMaskTouch2D;
-	UINT32 Vendor01RxElectrodeMaskButtons;
-	UINT32 Vendor01TxElectrodeMaskButtons;
-	UINT32 Vendor01FullBaselineButton0Min;
-	UINT32 Vendor01FullBaselineButton1Min;
-	UINT32 Vendor01FullBaselineButton2Min;
-	UINT32 Vendor01FullBaselineButton0Max;
-	UINT32 Vendor01FullBaselineButton1Max;
-	UINT32 Vendor01FullBaselineButton2Max;
-	UINT32 Vendor01IncludeAbsSenseRawCapTest;
-	UINT32 Vendor01AbsSenseRawCapTxRxStart;
-	UINT32 Vendor01AbsSenseRawCapTxRxEnd;
-	UINT32 Vendor01AbsSenseRawCapMinLimit;
-	UINT32 Vendor01AbsSenseRawCapMaxLimit;
-	UINT32 Vendor01IncludeShortTest;
-	UINT32 Vendor02IncludeHighResTest;
-	UINT32 Vendor02HighResMaxRxLimit;
-	UINT32 Vendor02HighResMaxTxLimit;
-	UINT32 Vendor02HighResMinImageLimit;
-	UINT32 Vendor02IncludeBaselineMinMaxTest;
-	UINT32 Vendor02BaselineMinMaxMinPixelLimit;
-	UINT32 Vendor02BaselineMinMaxMaxPixelLimit;
-	UINT32 Vendor02IncludeFullBaselineTest;
-	UINT32 Vendor02RxAmount;
-	UINT32 Vendor02TxAmount;
-	UINT32 Vendor02RxElectrodeMaskTouch2D;
-	UINT32 Vendor02TxElectrodeMaskTouch2D;
-	UINT32 Vendor02RxElectrodeMaskButtons;
-	UINT32 Vendor02TxElectrodeMaskButtons;
-	UINT32 Vendor02FullBaselineButton0Min;
-	UINT32 Vendor02FullBaselineButton1Min;
-	UINT32 Vendor02FullBaselineButton2Min;
-	UINT32 Vendor02FullBaselineButton0Max;
-	UINT32 Vendor02FullBaselineButton1Max;
-	UINT32 Vendor02FullBaselineButton2Max;
-	UINT32 Vendor02IncludeAbsSenseRawCapTest;
-	UINT32 Vendor02AbsSenseRawCapTxRxStart;
-	UINT32 Vendor02AbsSenseRawCapTxRxEnd;
-	UINT32 Vendor02AbsSenseRawCapMinLimit;
-	UINT32 Vendor02AbsSenseRawCapMaxLimit;
-	UINT32 Vendor02IncludeShortTest;
-	UINT32 Vendor03IncludeHighResTest;
-	UINT32 Vendor03HighResMaxRxLimit;
-	UINT32 Vendor03HighResMaxTxLimit;
-	UINT32 Vendor03HighResMinImageLimit;
-	UINT32 Vendor03IncludeBaselineMinMaxTest;
-	UINT32 Vendor03BaselineMinMaxMinPixelLimit;
-	UINT32 Vendor03BaselineMinMaxMaxPixelLimit;
-	UINT32 Vendor03IncludeFullBaselineTest;
-	UINT32 Vendor03RxAmount;
-	UINT32 Vendor03TxAmount;
-	UINT32 Vendor03RxElectrodeMaskTouch2D;
-	UINT32 Vendor03TxElectrodeMaskTouch2D;
-	UINT32 Vendor03RxElectrodeMaskButtons;
-	UINT32 Vendor03TxElectrodeMaskButtons;
-	UINT32 Vendor03FullBaselineButton0Min;
-	UINT32 Vendor03FullBaselineButton1Min;
-	UINT32 Vendor03FullBaselineButton2Min;
-	UINT32 Vendor03FullBaselineButton0Max;
-	UINT32 Vendor03FullBaselineButton1Max;
-	UINT32 Vendor03FullBaselineButton2Max;
-	UINT32 Vendor03IncludeAbsSenseRawCapTest;
-	UINT32 Vendor03AbsSenseRawCapTxRxStart;
-	UINT32 Vendor03AbsSenseRawCapTxRxEnd;
-	UINT32 Vendor03AbsSenseRawCapMinLimit;
-	UINT32 Vendor03AbsSenseRawCapMaxLimit;
-	UINT32 Vendor03IncludeShortTest;
+	TOUCH_VENDOR_SETTINGS Vendor[TOUCH_SETTINGS_VENDORS];
 } TOUCH_SCREEN_SETTINGS, * PTOUCH_SCREEN_SETTINGS;
 
+//
+// Settings consulted while the device runs. They are cached here and
+// refreshed on registry change notification, so power transitions do no
+// registry I/O. The whole key is watched, so WakeupGesture may be
+// created after the device started.
+//
+#define TOUCH_RUNTIME_SETTINGS_REG_KEY  L"\\Registry\\Machine\\SOFTWARE\\OEM\\Nokia\\Touch"
+#define TOUCH_WAKEUP_GESTURE_REG_KEY    TOUCH_RUNTIME_SETTINGS_REG_KEY L"\\WakeupGesture"
+
+//
+// Watch on a registry key. Routine is called on a system worker thread
+// after every change, calls are serialized. See TchStartKeyWatch.
+//
+typedef VOID TOUCH_KEY_WATCH_ROUTINE(
+	IN PVOID Context
+);
+
+typedef TOUCH_KEY_WATCH_ROUTINE* PTOUCH_KEY_WATCH_ROUTINE;
+
+typedef struct _TOUCH_KEY_WATCH
+{
+	PCWSTR KeyPath;
+	ULONG Filter;
+	BOOLEAN WatchTree;
+	PTOUCH_KEY_WATCH_ROUTINE Routine;
+	PVOID Context;
+
+	HANDLE Key;
+	WORK_QUEUE_ITEM Item;
+	IO_STATUS_BLOCK Status;
+	KEVENT Idle;
+	KMUTEX Lock;
+	BOOLEAN Stopping;
+} TOUCH_KEY_WATCH, * PTOUCH_KEY_WATCH;
+
+typedef struct _TOUCH_RUNTIME_SETTINGS
+{
+	volatile LONG WakeupGestureEnabled;
+
+	//
+	// Watch on TOUCH_RUNTIME_SETTINGS_REG_KEY
+	//
+	TOUCH_KEY_WATCH Watch;
+} TOUCH_RUNTIME_SETTINGS, * PTOUCH_RUNTIME_SETTINGS;
+
 NTSTATUS 
 TchAllocateContext(
     OUT VOID **ControllerContext,
@@ -223,6 +155,12 @@ TchStartDevice(
 	IN SPB_CONTEXT* SpbContext
 );
 
+NTSTATUS
+TchWaitForDevice(
+	IN SPB_CONTEXT* SpbContext,
+	IN ULONG Timeout
+);
+
 NTSTATUS 
 TchStopDevice(
     IN VOID *ControllerContext,
@@ -258,8 +196,38 @@ TchRegistryGetControllerSettings(
     );
 
 VOID
-TchGetTouchSettings(
-	IN PTOUCH_SCREEN_SETTINGS TouchSettings
+TchInitializeKeyWatch(
+	OUT PTOUCH_KEY_WATCH Watch,
+	IN PCWSTR KeyPath,
+	IN ULONG Filter,
+	IN BOOLEAN WatchTree,
+	IN PTOUCH_KEY_WATCH_ROUTINE Routine,
+	IN PVOID Context
+);
+
+NTSTATUS
+TchStartKeyWatch(
+	IN PTOUCH_KEY_WATCH Watch
+);
+
+VOID
+TchStopKeyWatch(
+	IN PTOUCH_KEY_WATCH Watch
+);
+
+VOID
+TchInitializeRuntimeSettings(
+	IN PTOUCH_RUNTIME_SETTINGS Settings
+);
+
+NTSTATUS
+TchStartRuntimeSettingsNotification(
+	IN PTOUCH_RUNTIME_SETTINGS Settings
+);
+
+VOID
+TchStopRuntimeSettingsNotification(
+	IN PTOUCH_RUNTIME_SETTINGS Settings
 );
 
 NTSTATUS
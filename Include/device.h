@@ -29,4 +29,37 @@ EVT_WDF_INTERRUPT_ISR OnInterruptIsr;
 
 EVT_WDF_DEVICE_PREPARE_HARDWARE OnPrepareHardware;
 
-EVT_WDF_DEVICE_RELEASE_HARDWARE OnReleaseHardware;
\ No newline at end of file
+EVT_WDF_DEVICE_RELEASE_HARDWARE OnReleaseHardware;
+
+EVT_WDF_WORKITEM OnD0EntryWorkItem;
+
+EVT_WDF_TIMER OnDozeTimer;
+
+VOID
+TchArmDozeTimer(
+    IN PDEVICE_EXTENSION DevContext
+);
+
+VOID
+TchServiceAfterD0Entry(
+    IN PDEVICE_EXTENSION DevContext
+);
+
+EVT_WDF_WORKITEM OnDisplayStateWorkItem;
+
+EVT_WDF_TIMER OnDisplayOffTimer;
+
+VOID
+TchStartDisplayStateTransitions(
+    IN PDEVICE_EXTENSION DevContext
+);
+
+VOID
+TchStopDisplayStateTransitions(
+    IN PDEVICE_EXTENSION DevContext
+);
+
+VOID
+TchRestoreReportingMode(
+    IN PDEVICE_EXTENSION DevContext
+);
\ No newline at end of file
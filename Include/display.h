@@ -0,0 +1,145 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		display.h
+
+	Abstract:
+
+		Contains the display state machine defines and types
+
+	Environment:
+
+		Kernel mode
+
+	Revision History:
+
+--*/
+
+#pragma once
+
+#include <wdm.h>
+#include <wdf.h>
+
+//
+// Display states as reported by GUID_CONSOLE_DISPLAY_STATE
+//
+#define TOUCH_DISPLAY_OFF           0
+#define TOUCH_DISPLAY_ON            1
+#define TOUCH_DISPLAY_DIMMED        2
+#define TOUCH_DISPLAY_UNKNOWN       (-1)
+
+//
+// Time given a display transition to finish when the device stops, in
+// milliseconds, before the rail toggle is cancelled
+//
+#define TOUCH_DISPLAY_STOP_TIMEOUT  500
+
+//
+// Time the display must stay off before touch is powered down, in
+// milliseconds. Turning on is never delayed.
+//
+#define TOUCH_DISPLAY_OFF_DEBOUNCE  300
+
+//
+// What the caller of TchDisplayRequest does next. The off timer is
+// started and stopped with Lock still held.
+//
+#define TOUCH_DISPLAY_STOP_OFF_TIMER    0x1
+#define TOUCH_DISPLAY_START_OFF_TIMER   0x2
+#define TOUCH_DISPLAY_TRANSITION        0x4
+
+//
+// Display state transitions. The power setting callback only records the
+// requested state; a transition toggles the touch power rail
+// asynchronously, and its completion queues WorkItem to configure the
+// controller. A state requested meanwhile is picked up once the
+// transition ends, so states in between are skipped.
+//
+// Display off is only requested once OffTimer expires. The display
+// coming back on or dimmed before then cancels it, so the hardware is
+// not touched at all.
+//
+// The routines of display.c only keep the state, the device owns the
+// timer, the work item and the rail.
+//
+typedef struct _TOUCH_DISPLAY_CONTEXT
+{
+	WDFWORKITEM WorkItem;
+	WDFTIMER OffTimer;
+	KSPIN_LOCK Lock;
+	BOOLEAN OffPending;
+	volatile LONG Requested;
+	LONG Applied;
+	LONG Target;
+	volatile LONG Busy;
+	volatile LONG Stopping;
+	KEVENT Idle;
+
+	//
+	// Interrupt time the running transition started at, and the rail
+	// toggle status it got
+	//
+	ULONG64 StartTime;
+	NTSTATUS RailStatus;
+
+	//
+	// Latencies in microseconds are those of the last transition
+	//
+	ULONG Transitions;
+	ULONG Failures;
+
+	//
+	// Transitions avoided, display off cancelled within the debounce time
+	// and requests found applied already
+	//
+	ULONG Cancelled;
+	volatile LONG Skipped;
+
+	ULONG RailLatency;
+	ULONG Latency;
+	ULONG MaxLatency;
+} TOUCH_DISPLAY_CONTEXT, * PTOUCH_DISPLAY_CONTEXT;
+
+VOID
+TchDisplayReset(
+	IN OUT PTOUCH_DISPLAY_CONTEXT Display
+);
+
+ULONG
+TchDisplayRequest(
+	IN OUT PTOUCH_DISPLAY_CONTEXT Display,
+	IN LONG State
+);
+
+BOOLEAN
+TchDisplayOffTimer(
+	IN OUT PTOUCH_DISPLAY_CONTEXT Display
+);
+
+VOID
+TchDisplayStop(
+	IN OUT PTOUCH_DISPLAY_CONTEXT Display
+);
+
+BOOLEAN
+TchDisplayAcquire(
+	IN OUT PTOUCH_DISPLAY_CONTEXT Display
+);
+
+BOOLEAN
+TchDisplayRelease(
+	IN OUT PTOUCH_DISPLAY_CONTEXT Display
+);
+
+BOOLEAN
+TchDisplayBeginTransition(
+	IN OUT PTOUCH_DISPLAY_CONTEXT Display
+);
+
+VOID
+TchDisplayEndTransition(
+	IN OUT PTOUCH_DISPLAY_CONTEXT Display,
+	IN NTSTATUS Status
+);
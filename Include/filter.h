@@ -0,0 +1,89 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		filter.h
+
+	Abstract:
+
+		Contains adaptive position filter defines and types
+
+	Environment:
+
+		Kernel mode
+
+	Revision History:
+
+--*/
+
+#pragma once
+
+#include <wdm.h>
+
+//
+// One filter slot per controller slot, see MAX_TOUCHES
+//
+#define FILTER_MAX_SLOTS           32
+
+//
+// Filtered positions are kept in Q8 controller pixels
+//
+#define FILTER_POSITION_BITS       8
+
+//
+// Default tuning, cutoffs in mHz and the speed coefficient in mHz per
+// pixel per second. AbsPosFilt divides the resting cutoff, so larger
+// values smooth harder at rest.
+//
+#define FILTER_MIN_CUTOFF_MHZ      1000
+#define FILTER_BETA                7
+#define FILTER_DERIVATIVE_CUTOFF   1000
+
+//
+// Samples further apart than this (100us units) restart the filter
+//
+#define FILTER_MAX_SAMPLE_GAP      200
+
+typedef struct _FILTER_SLOT
+{
+	BOOLEAN Valid;
+	ULONG Time;
+	LONG X;
+	LONG Y;
+	LONG Speed;
+} FILTER_SLOT, * PFILTER_SLOT;
+
+typedef struct _FILTER_CONTEXT
+{
+	BOOLEAN Enabled;
+	ULONG MinCutoff;
+	ULONG Beta;
+	ULONG DerivativeCutoff;
+	FILTER_SLOT Slot[FILTER_MAX_SLOTS];
+} FILTER_CONTEXT, * PFILTER_CONTEXT;
+
+VOID
+FilterConfigure(
+	IN PFILTER_CONTEXT Context,
+	IN ULONG Strength
+);
+
+VOID
+FilterReset(
+	IN PFILTER_CONTEXT Context
+);
+
+VOID
+FilterResetSlot(
+	IN PFILTER_SLOT Slot
+);
+
+VOID
+FilterPosition(
+	IN PFILTER_CONTEXT Context,
+	IN PFILTER_SLOT Slot,
+	IN ULONG Time,
+	IN OUT PLONG X,
+	IN OUT PLONG Y
+);
@@ -58,8 +58,14 @@ typedef struct _HID_TOUCH_FINGER {
 } HID_TOUCH_FINGER, * PHID_TOUCH_FINGER;
 #pragma pack(pop)
 
+//
+// Number of finger contacts carried by a single touch report
+//
+#define HID_TOUCH_REPORT_CONTACTS 2
+
 typedef struct _HID_TOUCH_REPORT {
-	HID_TOUCH_FINGER Contacts[2];
+	HID_TOUCH_FINGER Contacts[HID_TOUCH_REPORT_CONTACTS];
+	USHORT           ScanTime;
 	UCHAR            ContactCount;
 } HID_TOUCH_REPORT, * PHID_TOUCH_REPORT;
 
@@ -103,17 +109,68 @@ typedef struct _HID_INPUT_REPORT
 		HID_KEY_REPORT   KeyReport;
 	};
 #ifdef _TIMESTAMP_
-	LARGE_INTEGER TimeStamp;
+	LARGE_INTEGER TimeStamp; // Interrupt time of the frame, 100ns units
 #endif
 } HID_INPUT_REPORT, * PHID_INPUT_REPORT;
 
 #include <poppack.h>
 #pragma warning(pop)
 
+//
+// Upper bound of a generated report descriptor, the default layout with
+// two contacts is a little over 600 bytes
+//
+#define HID_REPORT_DESCRIPTOR_MAX_SIZE 2048
+
+//
+// Report descriptor items whose value is only known once the screen
+// properties have been read
+//
+typedef enum _HID_DESCRIPTOR_VALUE {
+	HidDescriptorBytes = 0,
+	HidDescriptorLogicalMaximumX,
+	HidDescriptorLogicalMaximumY,
+	HidDescriptorPhysicalMaximumX,
+	HidDescriptorPhysicalMaximumY,
+	HidDescriptorMaximumContacts,
+	HidDescriptorFingerContacts
+} HID_DESCRIPTOR_VALUE;
+
+typedef struct _HID_DESCRIPTOR_SEGMENT {
+	HID_DESCRIPTOR_VALUE Value;
+	const UCHAR*         Bytes;
+	ULONG                Length;
+} HID_DESCRIPTOR_SEGMENT, * PHID_DESCRIPTOR_SEGMENT;
+
+#define HID_SEGMENT_BYTES(_Bytes_) { HidDescriptorBytes, (_Bytes_), sizeof(_Bytes_) }
+#define HID_SEGMENT_VALUE(_Value_) { (_Value_), NULL, 0 }
+
+typedef struct _HID_REPORT_DESCRIPTOR_PARAMETERS {
+	ULONG  ContactsPerReport;
+	ULONG  MaximumContacts;
+	USHORT LogicalMaximumX;
+	USHORT LogicalMaximumY;
+	USHORT PhysicalMaximumX;
+	USHORT PhysicalMaximumY;
+} HID_REPORT_DESCRIPTOR_PARAMETERS, * PHID_REPORT_DESCRIPTOR_PARAMETERS;
+
 //
 // Function prototypes
 //
 
+NTSTATUS
+TchBuildHidReportDescriptor(
+	IN  PHID_REPORT_DESCRIPTOR_PARAMETERS Parameters,
+	OUT PUCHAR Buffer,
+	IN  ULONG BufferLength,
+	OUT PULONG DescriptorLength
+);
+
+NTSTATUS
+TchGenerateHidReportDescriptor(
+	IN WDFDEVICE Device
+);
+
 NTSTATUS
 TchSendReport(
 	IN WDFQUEUE PingPongQueue,
@@ -174,10 +231,14 @@ TchReadReport(
 // 
 #include "HidCommon.h"
 
-#define X_MASK 0xFE, 0xFE
-#define Y_MASK 0xFD, 0xFD
+//
+// The report descriptor is split into literal byte runs around every item
+// whose value depends on the panel (axis ranges) or on the number of
+// contacts reported. hid.c stitches the runs together with the value items
+// once at prepare hardware time, see gReportDescriptorSegments.
+//
 
-#define HIMAX_HX85X_DIGITIZER_FINGER_CONTACT_1 \
+#define HIMAX_HX85X_DIGITIZER_FINGER_CONTACT_1_HEAD \
 	BEGIN_COLLECTION, 0x02, /* Collection (Logical) */ \
 		USAGE, 0x42, /* Usage (Tip Switch) */ \
 		LOGICAL_MINIMUM, 0x00, /* Logical Minimum (0) */ \
@@ -201,23 +262,28 @@ TchReadReport(
 		REPORT_COUNT, 0x01, /* Report Count (1) */ \
 		INPUT, 0x02, /* Input: (Data, Var, Abs) */ \
 		USAGE_PAGE, 0x01, /* Usage Page (Generic Desktop Ctrls) */ \
-		USAGE, 0x30, /* Usage (X) */ \
-		LOGICAL_MAXIMUM_2, X_MASK, /* Logical Maximum (1440) */ \
-		PHYSICAL_MAXIMUM_2, X_MASK, /* Physical Maximum: 7.056 */ \
+		USAGE, 0x30 /* Usage (X) */ \
+		/* Logical Maximum (X) */ \
+		/* Physical Maximum (X) */
+
+#define HIMAX_HX85X_DIGITIZER_FINGER_CONTACT_1_Y \
 		UNIT, 0x11, /* Unit (System: SI Linear, Length: Centimeter) */ \
 		UNIT_EXPONENT, 0x0d, /* Unit Exponent: -3 */ \
 		REPORT_SIZE, 0x10, /* Report Size (16) */ \
 		INPUT, 0x02, /* Input: (Data, Var, Abs) */ \
-		USAGE, 0x31, /* Usage (Y) */ \
-		LOGICAL_MAXIMUM_2, Y_MASK, /* Logical Maximum (2560) */ \
-		PHYSICAL_MAXIMUM_2, Y_MASK, /* Physical Maximum: 12.544 */ \
+		USAGE, 0x31 /* Usage (Y) */ \
+		/* Logical Maximum (Y) */ \
+		/* Physical Maximum (Y) */
+
+#define HIMAX_HX85X_DIGITIZER_FINGER_CONTACT_TAIL \
 		INPUT, 0x02, /* Input: (Data, Var, Abs) */ \
 		PHYSICAL_MAXIMUM, 0x00, /* Physical Maximum: 0 */ \
 		UNIT_EXPONENT, 0x00, /* Unit exponent: 0 */ \
 		UNIT, 0x00, /* Unit: None */ \
 	END_COLLECTION /* End Collection */
 
-#define HIMAX_HX85X_DIGITIZER_FINGER_CONTACT_2 \
+#define HIMAX_HX85X_DIGITIZER_FINGER_CONTACT_2_HEAD \
+	USAGE, 0x00, /* Usage (Undefined) */ \
 	BEGIN_COLLECTION, 0x02, /* Collection (Logical) */ \
 		USAGE_PAGE, 0x0D, /* Usage Page (Digitizer) */ \
 		USAGE, 0x42, /* Usage (Tip Switch) */ \
@@ -233,29 +299,28 @@ TchReadReport(
 		INPUT, 0x02, /* Input: (Data, Var, Abs) */ \
 		REPORT_COUNT, 0x05, /* Report Count (5) */ \
 		INPUT, 0x03, /* Input (Const,Var,Abs,No Wrap,Linear,Preferred State,No Null Position) */ \
-		USAGE, 0x51, /* Usage (Contract Identifier) */ \
-		PHYSICAL_MAXIMUM_2, Y_MASK, /* Physical Maximum: 12.544 */ \
+		USAGE, 0x51 /* Usage (Contract Identifier) */ \
+		/* Physical Maximum (Y) */
+
+#define HIMAX_HX85X_DIGITIZER_FINGER_CONTACT_2_X \
 		UNIT, 0x11, /* Unit (System: SI Linear, Length: Centimeter) */ \
 		UNIT_EXPONENT, 0x0d, /* Unit Exponent: -3 */ \
 		REPORT_SIZE, 0x08, /* Report Size (8) */ \
 		REPORT_COUNT, 0x01, /* Report Count (1) */ \
 		INPUT, 0x02, /* Input: (Data, Var, Abs) */ \
 		USAGE_PAGE, 0x01, /* Usage Page (Generic Desktop Ctrls) */ \
-		USAGE, 0x30, /* Usage (X) */ \
-		LOGICAL_MAXIMUM_2, X_MASK, /* Logical Maximum (1440) */ \
-		PHYSICAL_MAXIMUM_2, X_MASK, /* Physical Maximum: 7.056 */ \
+		USAGE, 0x30 /* Usage (X) */ \
+		/* Logical Maximum (X) */ \
+		/* Physical Maximum (X) */
+
+#define HIMAX_HX85X_DIGITIZER_FINGER_CONTACT_2_Y \
 		REPORT_SIZE, 0x10, /* Report Size (16) */ \
 		INPUT, 0x02, /* Input: (Data, Var, Abs) */ \
-		USAGE, 0x31, /* Usage (Y) */ \
-		LOGICAL_MAXIMUM_2, Y_MASK, /* Logical Maximum (2560) */ \
-		PHYSICAL_MAXIMUM_2, Y_MASK, /* Physical Maximum: 12.544 */ \
-		INPUT, 0x02, /* Input: (Data, Var, Abs) */ \
-		PHYSICAL_MAXIMUM, 0x00, /* Physical Maximum: 0 */ \
-		UNIT_EXPONENT, 0x00, /* Unit exponent: 0 */ \
-		UNIT, 0x00, /* Unit: None */ \
-	END_COLLECTION /* End Collection */
+		USAGE, 0x31 /* Usage (Y) */ \
+		/* Logical Maximum (Y) */ \
+		/* Physical Maximum (Y) */
 
-#define HIMAX_HX85X_DIGITIZER_STYLUS_CONTACT_1 \
+#define HIMAX_HX85X_DIGITIZER_STYLUS_CONTACT_1_HEAD \
 	BEGIN_COLLECTION, 0x00, /* Collection (Physical) */ \
 		USAGE, 0x42, /* Usage (Tip Switch) */ \
 		LOGICAL_MINIMUM, 0x00, /* Logical Minimum (0) */ \
@@ -279,17 +344,21 @@ TchReadReport(
 		REPORT_COUNT, 0x02, /* Report Count (2) */ \
 		INPUT, 0x03, /* Input (Const,Var,Abs,No Wrap,Linear,Preferred State,No Null Position) */ \
 		USAGE_PAGE, 0x01, /* Usage Page (Generic Desktop Ctrls) */ \
-		USAGE, 0x30, /* Usage (X) */ \
-		LOGICAL_MAXIMUM_2, X_MASK, /* Logical Maximum (1440) */ \
-		PHYSICAL_MAXIMUM_2, X_MASK, /* Physical Maximum: 7.056 */ \
+		USAGE, 0x30 /* Usage (X) */ \
+		/* Logical Maximum (X) */ \
+		/* Physical Maximum (X) */
+
+#define HIMAX_HX85X_DIGITIZER_STYLUS_CONTACT_1_Y \
 		UNIT, 0x11, /* Unit (System: SI Linear, Length: Centimeter) */ \
 		UNIT_EXPONENT, 0x0D, /* Unit Exponent: -3 */ \
 		REPORT_SIZE, 0x10, /* Report Size (16) */ \
 		REPORT_COUNT, 0x01, /* Report Count (1) */ \
 		INPUT, 0x02, /* Input: (Data, Var, Abs) */ \
-		USAGE, 0x31, /* Usage (Y) */ \
-		LOGICAL_MAXIMUM_2, Y_MASK, /* Logical Maximum (2560) */ \
-		PHYSICAL_MAXIMUM_2, Y_MASK, /* Physical Maximum: 12.544 */ \
+		USAGE, 0x31 /* Usage (Y) */ \
+		/* Logical Maximum (Y) */ \
+		/* Physical Maximum (Y) */
+
+#define HIMAX_HX85X_DIGITIZER_STYLUS_CONTACT_1_TAIL \
 		INPUT, 0x02, /* Input: (Data, Var, Abs) */ \
 		USAGE_PAGE, 0x0D, /* Usage Page (Digitizer) */ \
 		USAGE, 0x30, /* Usage (Tip Pressure) */ \
@@ -378,22 +447,34 @@ TchReadReport(
 		FEATURE, 0x02, /* Feature: (Data, Var, Abs) */ \
 	END_COLLECTION /* End Collection */
 
-#define HIMAX_HX85X_DIGITIZER_FINGER \
+#define HIMAX_HX85X_DIGITIZER_FINGER_HEAD \
 	USAGE_PAGE, 0x0D, /* Usage Page (Digitizer) */ \
 	USAGE, 0x04, /* Usage (Touch Screen) */ \
 	BEGIN_COLLECTION, 0x01, /* Collection (Application) */ \
 		REPORT_ID, REPORTID_FINGER, /* Report ID (1) */ \
-		USAGE, 0x22, /* Usage (Finger) */ \
-		HIMAX_HX85X_DIGITIZER_FINGER_CONTACT_1, /* Finger Contact (1) */ \
-		USAGE, 0x00, /* Usage (Undefined) */ \
-		HIMAX_HX85X_DIGITIZER_FINGER_CONTACT_2, /* Finger Contact (2) */ \
+		USAGE, 0x22 /* Usage (Finger) */ \
+		/* Finger Contacts (1..n) */
+
+#define HIMAX_HX85X_DIGITIZER_FINGER_CONTACT_COUNT \
 		USAGE_PAGE, 0x0D, /* Usage Page (Digitizer) */ \
+		USAGE, 0x56, /* Usage (Scan Time) */ \
+		UNIT_EXPONENT, 0x0C, /* Unit Exponent: -4 */ \
+		UNIT_2, 0x01, 0x10, /* Unit (System: SI Linear, Time: Seconds) */ \
+		LOGICAL_MAXIMUM_3, 0xFF, 0xFF, 0x00, 0x00, /* Logical Maximum (65535) */ \
+		REPORT_SIZE, 0x10, /* Report Size (16) */ \
+		REPORT_COUNT, 0x01, /* Report Count (1) */ \
+		INPUT, 0x02, /* Input: (Data, Var, Abs) */ \
+		UNIT_EXPONENT, 0x00, /* Unit exponent: 0 */ \
+		UNIT, 0x00, /* Unit: None */ \
+		LOGICAL_MAXIMUM, 0x7F, /* Logical Maximum (127) */ \
 		USAGE, 0x54, /* Usage (Contact Count) */ \
 		REPORT_SIZE, 0x08, /* Report Size (8) */ \
 		INPUT, 0x02, /* Input: (Data, Var, Abs) */ \
 		REPORT_ID, REPORTID_DEVICE_CAPS, /* Report ID (8) */ \
-		USAGE, 0x55, /* Usage (Maximum Contacts) */ \
-		LOGICAL_MAXIMUM, 0x02, /* Logical Maximum (2) */ \
+		USAGE, 0x55 /* Usage (Maximum Contacts) */ \
+		/* Logical Maximum (Maximum Contacts) */
+
+#define HIMAX_HX85X_DIGITIZER_FINGER_TAIL \
 		FEATURE, 0x02, /* Feature: (Data, Var, Abs) */ \
 		USAGE_PAGE_1, 0x00, 0xff, \
 		REPORT_ID, REPORTID_PTPHQA, \
@@ -405,7 +486,7 @@ TchReadReport(
 		FEATURE, 0x02, \
 	END_COLLECTION /* End Collection */
 
-#define HIMAX_HX85X_DIGITIZER_REPORTMODE \
+#define HIMAX_HX85X_DIGITIZER_REPORTMODE_HEAD \
 	USAGE_PAGE, 0x0D, /* Usage Page (Digitizer) */ \
 	USAGE, 0x0E, /* Usage (Configuration) */ \
 	BEGIN_COLLECTION, 0x01, /* Collection (Application) */ \
@@ -415,8 +496,10 @@ TchReadReport(
 			USAGE, 0x52, /* Usage (Input Mode) */ \
 			LOGICAL_MINIMUM, 0x00, /* Logical Minimum (0) */ \
 			LOGICAL_MAXIMUM, 0x0A, /* Logical Maximum (10) */ \
-			PHYSICAL_MINIMUM, 0x00, /* Physical Minimum (0) */ \
-			PHYSICAL_MAXIMUM_2, Y_MASK, /* Physical Maximum: 12.544 */ \
+			PHYSICAL_MINIMUM, 0x00 /* Physical Minimum (0) */ \
+			/* Physical Maximum (Y) */
+
+#define HIMAX_HX85X_DIGITIZER_REPORTMODE_TAIL \
 			UNIT, 0x11, /* Unit (System: SI Linear, Length: Centimeter) */ \
 			UNIT_EXPONENT, 0x0d, /* Unit Exponent: -3 */ \
 			REPORT_SIZE, 0x08, /* Report Size (8) */ \
@@ -485,13 +568,15 @@ TchReadReport(
 		INPUT, 0x03, /* Input (Const,Var,Abs,No Wrap,Linear,Preferred State,No Null Position) */ \
 	END_COLLECTION /* End Collection */
 
-#define HIMAX_HX85X_DIGITIZER_STYLUS \
+#define HIMAX_HX85X_DIGITIZER_STYLUS_HEAD \
 	USAGE_PAGE, 0x0D, /* Usage Page (Digitizer) */ \
 	USAGE, 0x02, /* Usage (Pen) */ \
 	BEGIN_COLLECTION, 0x01, /* Collection (Application) */ \
 		REPORT_ID, REPORTID_STYLUS, /* Report ID (11) */ \
-		USAGE, 0x20, /* Usage (Stylus) */ \
-		HIMAX_HX85X_DIGITIZER_STYLUS_CONTACT_1, /* Stylus (1) */ \
+		USAGE, 0x20 /* Usage (Stylus) */ \
+		/* Stylus (1) */
+
+#define HIMAX_HX85X_DIGITIZER_STYLUS_TAIL \
 		USAGE_PAGE_1, 0x00, 0xff, \
 		REPORT_ID, REPORTID_PENHQA, \
 		USAGE, 0xc5, \
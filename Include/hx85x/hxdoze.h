@@ -0,0 +1,148 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		hxdoze.h
+
+	Abstract:
+
+		Contains doze governor defines and types
+
+	Environment:
+
+		Kernel mode
+
+	Revision History:
+
+--*/
+
+#pragma once
+
+#include <wdm.h>
+#include <wdf.h>
+#include <spb.h>
+#include <report.h>
+#include <hx85x/hxsequence.h>
+
+//
+// DozeHoldoff is given in half seconds, DozeInterval in 10 ms and
+// DozeThreshold in milliseconds
+//
+#define HX85X_DOZE_HOLDOFF_UNIT_MS    500
+#define HX85X_DOZE_INTERVAL_UNIT_MS   10
+
+//
+// The controller dozes once no contact was down for the holdoff time, and
+// the first frame with a contact brings it back to full rate.
+//
+// With doze enter and exit sequences, what dozing means to the controller,
+// e.g. a lower scan rate, is up to those. Without them the governor polls:
+// dozing turns sensing off with the sleep sequence, and every doze interval
+// sensing is turned back on with the wake sequence for a scan window of
+// the doze threshold. A contact seen in the window ends the doze, else
+// sensing is turned off again, unless a wake gesture is in progress.
+//
+// The governor is off when the holdoff is 0, the default unless DozeHoldoff
+// is set under the device key, or without doze sequences when the interval
+// is.
+//
+typedef struct _HX85X_DOZE
+{
+	//
+	// Time without contact before dozing, time between scan windows and
+	// length of a scan window when polling, in milliseconds
+	//
+	ULONG Holdoff;
+	ULONG Interval;
+	ULONG Window;
+
+	//
+	// Set when there are no doze sequences to run
+	//
+	BOOLEAN Polled;
+
+	BOOLEAN Dozing;
+	BOOLEAN Contact;
+
+	//
+	// Cleared while polling with sensing turned off
+	//
+	BOOLEAN Sensing;
+
+	//
+	// Time to arm the doze timer with once the caller gets to it, in
+	// milliseconds, 0 when it need not be armed
+	//
+	ULONG Pending;
+
+	//
+	// Interrupt times the last contact lifted at and dozing started at
+	//
+	ULONG64 LiftTime;
+	ULONG64 EnterTime;
+
+	//
+	// Times in microseconds, the exit time is that of the last exit and
+	// includes the exit sequence. Scans are the scan windows opened while
+	// polling.
+	//
+	ULONG Entries;
+	ULONG Exits;
+	ULONG Scans;
+	ULONG64 DozeTime;
+	ULONG ExitTime;
+} HX85X_DOZE, * PHX85X_DOZE;
+
+VOID
+Hx85xDozeConfigure(
+	IN OUT HX85X_DOZE* Doze,
+	IN ULONG Holdoff,
+	IN ULONG Interval,
+	IN ULONG Threshold,
+	IN HX85X_SEQUENCE* Sequences
+);
+
+VOID
+Hx85xDozeStart(
+	IN OUT HX85X_DOZE* Doze,
+	IN ULONG64 Now
+);
+
+ULONG
+Hx85xDozeArm(
+	IN OUT HX85X_DOZE* Doze
+);
+
+NTSTATUS
+Hx85xDozeTrackFrame(
+	IN OUT HX85X_DOZE* Doze,
+	IN HX85X_SEQUENCE* Sequences,
+	IN SPB_CONTEXT* SpbContext,
+	IN const DETECTED_OBJECTS* Data
+);
+
+NTSTATUS
+Hx85xDozeTimer(
+	IN OUT HX85X_DOZE* Doze,
+	IN HX85X_SEQUENCE* Sequences,
+	IN SPB_CONTEXT* SpbContext,
+	IN ULONG64 Now,
+	IN BOOLEAN Busy
+);
+
+NTSTATUS
+Hx85xDozeLowPower(
+	IN OUT HX85X_DOZE* Doze,
+	IN HX85X_SEQUENCE* Sequences,
+	IN SPB_CONTEXT* SpbContext,
+	IN ULONG64 Now
+);
+
+NTSTATUS
+Hx85xDozeExit(
+	IN OUT HX85X_DOZE* Doze,
+	IN HX85X_SEQUENCE* Sequences,
+	IN SPB_CONTEXT* SpbContext,
+	IN ULONG64 Now
+);
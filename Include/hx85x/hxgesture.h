@@ -0,0 +1,132 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		hxgesture.h
+
+	Abstract:
+
+		Contains double tap to wake detector defines and types
+
+	Environment:
+
+		Kernel mode
+
+	Revision History:
+
+--*/
+
+#pragma once
+
+#include <wdm.h>
+#include <wdf.h>
+#include <spb.h>
+#include <controller.h>
+#include <resolutions.h>
+#include <report.h>
+#include <hx85x/hxsequence.h>
+#include <hx85x/hxdoze.h>
+
+//
+// Used when DoubleTapMaxTapTime10ms is 0
+//
+#define HX85X_GESTURE_DEFAULT_TAP_TIME_10MS    40
+
+//
+// Physical touch area assumed when SCREENPROPERTIES do not give the
+// display size, in 10 um units
+//
+#define HX85X_GESTURE_DEFAULT_WIDTH_10UM       6200
+#define HX85X_GESTURE_DEFAULT_HEIGHT_10UM      11000
+
+typedef enum _HX85X_GESTURE_STATE
+{
+	HX85X_GESTURE_IDLE = 0,
+	HX85X_GESTURE_FIRST_DOWN,
+	HX85X_GESTURE_FIRST_UP,
+	HX85X_GESTURE_SECOND_DOWN,
+
+	//
+	// The contacts down do not make a tap, waiting for all to lift
+	//
+	HX85X_GESTURE_REJECTED
+} HX85X_GESTURE_STATE;
+
+//
+// While the display is off with the wake gesture enabled, the controller
+// runs at the doze scan rate, or is polled in doze scan windows, and its
+// frames are fed to a double tap state machine instead of being reported. Both taps must be shorter than the
+// maximum tap time, start within the maximum tap time of the previous
+// lift, stay within the maximum tap distance of the first tap and lie
+// outside the dead zones along the edges of the touch area.
+//
+typedef struct _HX85X_GESTURE
+{
+	//
+	// Limits from TOUCH_SCREEN_SETTINGS, the tap time in interrupt time
+	// units, distances in micrometers
+	//
+	ULONG64 MaxTapTime;
+	ULONG MaxTapDistance;
+	ULONG DeadZoneWidth;
+	ULONG DeadZoneHeight;
+
+	BOOLEAN Armed;
+	HX85X_GESTURE_STATE State;
+
+	//
+	// Interrupt time the current state was entered at, where the first
+	// tap went down and where the current tap went down, in touch units
+	//
+	ULONG64 StateTime;
+	DETECTED_OBJECT_POSITION FirstTap;
+	DETECTED_OBJECT_POSITION Down;
+
+	//
+	// Interrupt time the detector was armed at. Times in microseconds,
+	// frames are those processed while armed.
+	//
+	ULONG64 ArmTime;
+	ULONG64 ArmedTime;
+	ULONG64 Frames;
+	ULONG Matches;
+	ULONG Rejects;
+} HX85X_GESTURE, * PHX85X_GESTURE;
+
+VOID
+Hx85xGestureConfigure(
+	IN OUT HX85X_GESTURE* Gesture,
+	IN const TOUCH_SCREEN_SETTINGS* Settings
+);
+
+NTSTATUS
+Hx85xGestureStart(
+	IN OUT HX85X_GESTURE* Gesture,
+	IN OUT HX85X_DOZE* Doze,
+	IN HX85X_SEQUENCE* Sequences,
+	IN SPB_CONTEXT* SpbContext,
+	IN ULONG64 Now
+);
+
+NTSTATUS
+Hx85xGestureStop(
+	IN OUT HX85X_GESTURE* Gesture,
+	IN OUT HX85X_DOZE* Doze,
+	IN HX85X_SEQUENCE* Sequences,
+	IN SPB_CONTEXT* SpbContext,
+	IN ULONG64 Now
+);
+
+BOOLEAN
+Hx85xGestureTrackFrame(
+	IN OUT HX85X_GESTURE* Gesture,
+	IN const TOUCH_SCREEN_PROPERTIES* Props,
+	IN const DETECTED_OBJECTS* Data
+);
+
+BOOLEAN
+Hx85xGestureHoldScan(
+	IN OUT HX85X_GESTURE* Gesture,
+	IN ULONG64 Now
+);
@@ -28,6 +28,9 @@
 #include <Cross Platform Shim/bitops.h>
 #include <Cross Platform Shim/hweight.h>
 #include <report.h>
+#include <hx85x/hxsequence.h>
+#include <hx85x/hxdoze.h>
+#include <hx85x/hxgesture.h>
 
 // Ignore warning C4152: nonstandard extension, function/data pointer conversion in expression
 #pragma warning (disable : 4152)
@@ -41,19 +44,14 @@
 // Ignore warning C4324: 'xxx' : structure was padded due to __declspec(align())
 #pragma warning (disable : 4324)
 
-static BYTE HX85X_IC_POWER_ON_COMMAND[1]     = { 0x81 };
-static BYTE HX85X_MCU_POWER_ON_COMMAND[2]    = { 0x35, 0x02 };
-static BYTE HX85X_SENSE_ON_COMMAND[1]        = { 0x83 };
-static BYTE HX85X_SENSE_OFF_COMMAND[1]       = { 0x82 };
 static BYTE HX85X_GET_ID_COMMAND[1]          = { 0x31 };
 static BYTE HX85X_GET_EVENT_COMMAND[1]       = { 0x85 };
 static BYTE HX85X_GET_SLEEP_COMMAND[1]       = { 0x63 };
 
-static BYTE HX8520_FLASH_POWER_ON_COMMAND[2] = { 0x36, 0x01 };
-static BYTE HX8520_SPEED_MODE_COMMAND[2]     = { 0x9D, 0x80 };
-
-static BYTE HX8526_FLASH_POWER_ON_COMMAND[3] = { 0x36, 0x0F, 0x53 };
-static BYTE HX8526_FETCH_FLASH_COMMAND[3]    = { 0xDD, 0x04, 0x02 };
+//
+// Power on, init and sense commands are sent through the sequences in
+// hxsequence.c
+//
 
 typedef struct _HIMAX_TOUCH_DATA
 {
@@ -194,6 +192,32 @@ typedef struct _HX85X_CONTROLLER_CONTEXT
 	int ChipModel;
 
 	int HidQueueCount;
+
+	//
+	// Init, wake and sleep command sequences
+	//
+	HX85X_SEQUENCE Sequences[HX85X_SEQUENCE_COUNT];
+
+	//
+	// Controller state remembered across D3. ConfigGeneration counts
+	// configuration loads, AppliedGeneration is the one the controller
+	// was last configured with.
+	//
+	BOOLEAN Sensing;
+	ULONG ConfigGeneration;
+	ULONG AppliedGeneration;
+
+	//
+	// Doze governor state
+	//
+	HX85X_DOZE Doze;
+
+	//
+	// Reporting mode last set, and the double tap detector armed in
+	// HX85X_REPORTING_WAKEUP_GESTURE_MODE
+	//
+	UCHAR ReportingMode;
+	HX85X_GESTURE Gesture;
 } HX85X_CONTROLLER_CONTEXT;
 
 NTSTATUS
@@ -219,7 +243,8 @@ NTSTATUS
 Hx85xServiceInterrupts(
 	IN HX85X_CONTROLLER_CONTEXT* ControllerContext,
 	IN SPB_CONTEXT* SpbContext,
-	IN PREPORT_CONTEXT ReportContext
+	IN PREPORT_CONTEXT ReportContext,
+	IN ULONG64 InterruptTime
 );
 
 #define HX85X_F01_DEVICE_CONTROL_SLEEP_MODE_OPERATING  0
@@ -257,6 +282,12 @@ Hx85xChangeSleepState(
     IN UCHAR SleepState
 );
 
+NTSTATUS
+Hx85xResumeController(
+    IN HX85X_CONTROLLER_CONTEXT* ControllerContext,
+    IN SPB_CONTEXT* SpbContext
+);
+
 NTSTATUS
 Hx85xGetFirmwareVersion(
     IN HX85X_CONTROLLER_CONTEXT* ControllerContext,
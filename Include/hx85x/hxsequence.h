@@ -0,0 +1,161 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		hxsequence.h
+
+	Abstract:
+
+		Contains controller command sequence defines and types
+
+	Environment:
+
+		Kernel mode
+
+	Revision History:
+
+--*/
+
+#pragma once
+
+#include <wdm.h>
+#include <wdf.h>
+#include <spb.h>
+
+//
+// Operations of a sequence step
+//
+//   WRITE  writes Data
+//   READ   writes Data, reads one byte and compares it
+//   POLL   like READ, repeated until the comparison holds or Time passed
+//   DELAY  waits Time
+//
+// A read byte matches when (byte & Mask) == Expected, or when it differs
+// with HX85X_STEP_NOT_EQUAL set. Times are in microseconds.
+//
+#define HX85X_STEP_WRITE              1
+#define HX85X_STEP_READ               2
+#define HX85X_STEP_POLL               3
+#define HX85X_STEP_DELAY              4
+
+//
+// Step flags
+//
+#define HX85X_STEP_NOT_EQUAL          0x01
+#define HX85X_STEP_OPTIONAL           0x02
+
+#define HX85X_STEP_MAX_DATA           4
+
+//
+// Limits on sequences read from configuration
+//
+#define HX85X_SEQUENCE_MAX_STEPS      32
+#define HX85X_SEQUENCE_MAX_TIME       1000000
+
+//
+// Bring-up waits. The fixed delays these replace were 120, 10 and 100 us
+// sleeps, which the kernel rounds up to at least one clock tick, 15.6 ms
+// at the default resolution. Power on and sense on are polled for with
+// that as the bound. The command settle has nothing to poll for and
+// stays a wait of the shortest tick.
+//
+#define HX85X_IC_POWER_ON_TIME        15625
+#define HX85X_COMMAND_SETTLE_TIME     1000
+#define HX85X_SENSE_ON_TIME           15625
+
+//
+// First byte of the chip ID of all supported models, read back once the
+// controller has powered on
+//
+#define HX85X_CHIP_ID_HIGH            0x85
+
+//
+// First poll interval, and the longest interval that is busy waited
+// instead of slept
+//
+#define HX85X_READY_POLL_INTERVAL     10
+#define HX85X_READY_STALL_LIMIT       50
+
+//
+// A step as stored in configuration, see Hx85xLoadSequences. The layout
+// is part of the registry format.
+//
+typedef struct _HX85X_SEQUENCE_STEP
+{
+	UCHAR Operation;
+	UCHAR Flags;
+	UCHAR Length;
+	UCHAR Mask;
+	UCHAR Data[HX85X_STEP_MAX_DATA];
+	UCHAR Expected;
+	UCHAR Reserved[3];
+	ULONG Time;
+} HX85X_SEQUENCE_STEP, * PHX85X_SEQUENCE_STEP;
+
+C_ASSERT(sizeof(HX85X_SEQUENCE_STEP) == 16);
+
+typedef enum _HX85X_SEQUENCE_ID
+{
+	HX85X_SEQUENCE_INIT_8526 = 0,
+	HX85X_SEQUENCE_INIT_8520,
+	HX85X_SEQUENCE_WAKE,
+	HX85X_SEQUENCE_SLEEP,
+	HX85X_SEQUENCE_DOZE_ENTER,
+	HX85X_SEQUENCE_DOZE_EXIT,
+	HX85X_SEQUENCE_COUNT
+} HX85X_SEQUENCE_ID;
+
+typedef struct _HX85X_SEQUENCE
+{
+	const HX85X_SEQUENCE_STEP* Steps;
+	ULONG Count;
+
+	//
+	// Steps read from configuration, NULL when the defaults are used
+	//
+	PHX85X_SEQUENCE_STEP Override;
+
+	//
+	// Duration of the last run in microseconds
+	//
+	ULONG Time;
+} HX85X_SEQUENCE, * PHX85X_SEQUENCE;
+
+VOID
+Hx85xInitializeSequences(
+	OUT HX85X_SEQUENCE* Sequences
+);
+
+VOID
+Hx85xLoadSequences(
+	IN OUT HX85X_SEQUENCE* Sequences,
+	IN WDFDEVICE FxDevice
+);
+
+VOID
+Hx85xFreeSequences(
+	IN OUT HX85X_SEQUENCE* Sequences
+);
+
+NTSTATUS
+Hx85xRunSteps(
+	IN SPB_CONTEXT* SpbContext,
+	IN const HX85X_SEQUENCE_STEP* Steps,
+	IN ULONG Count,
+	OUT PULONG Time
+);
+
+NTSTATUS
+Hx85xRunSequence(
+	IN HX85X_SEQUENCE* Sequences,
+	IN HX85X_SEQUENCE_ID Id,
+	IN SPB_CONTEXT* SpbContext
+);
+
+NTSTATUS
+Hx85xWaitForReady(
+	IN SPB_CONTEXT* SpbContext,
+	IN ULONG Timeout,
+	IN BOOLEAN Sensing
+);
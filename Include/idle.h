@@ -37,6 +37,11 @@ typedef struct _IDLE_WORKITEM_CONTEXT
 
 WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(IDLE_WORKITEM_CONTEXT, GetWorkItemContext)
 
+NTSTATUS
+TchIdleInitialize(
+    IN WDFDEVICE FxDevice
+    );
+
 NTSTATUS
 TchProcessIdleRequest(
     IN WDFDEVICE Device,
@@ -49,6 +54,11 @@ TchCompleteIdleIrp(
     IN PDEVICE_EXTENSION FxDeviceContext
     );
 
+VOID
+TchIdleTrackD3Entry(
+    IN PDEVICE_EXTENSION FxDeviceContext
+    );
+
 EVT_WDF_WORKITEM TchIdleIrpWorkitem;
 
 
@@ -5,6 +5,8 @@
 
 #include "controller.h"
 #include <report.h>
+#include <powerstats.h>
+#include <display.h>
 
 #define DEFINE_GUID2(name, l, w1, w2, b1, b2, b3, b4, b5, b6, b7, b8) \
         EXTERN_C const GUID DECLSPEC_SELECTANY name \
@@ -38,13 +40,69 @@ DEFINE_GUID2(GUID_CONSOLE_DISPLAY_STATE, 0x6fe69556, 0x704a, 0x47a0, 0x8f, 0x24,
 #define TOUCH_DELAY_TO_COMMUNICATE 200000
 #define TOUCH_POWER_RAIL_STABLE_TIME 2000
 
+//
+// Called once a toggle PowerToggle returned STATUS_PENDING for completed
+//
+typedef
+VOID
+TOUCH_POWER_TOGGLE_COMPLETE(
+    IN PVOID Context,
+    IN NTSTATUS Status
+);
+
+typedef TOUCH_POWER_TOGGLE_COMPLETE* PTOUCH_POWER_TOGGLE_COMPLETE;
+
 typedef struct _TOUCH_POWER_CONTEXT
 {
     WDFIOTARGET TouchPowerIOTarget;
     BOOLEAN TouchPowerOpen;
     PVOID TouchPowerNotify;
+
+    //
+    // Held by a toggle from its open check until the request was sent.
+    // The target and its request are only torn down once it ran down.
+    //
+    EX_RUNDOWN_REF TargetRundown;
+
+    //
+    // Toggle request and its payload, allocated once and reused for every
+    // toggle. At most one toggle is in flight at a time.
+    //
+    WDFREQUEST ToggleRequest;
+    WDFMEMORY ToggleMemory;
+    PDWORD ToggleBuffer;
+    volatile LONG ToggleBusy;
+    PTOUCH_POWER_TOGGLE_COMPLETE ToggleComplete;
+    PVOID ToggleContext;
+
+    //
+    // Interrupt time the last toggle was sent at, and its latency in
+    // microseconds
+    //
+    ULONG64 ToggleTime;
+    ULONG ToggleLatency;
 } TOUCH_POWER_CONTEXT;
 
+//
+// Idle notification counters, times in microseconds are those of the
+// last idle transition
+//
+typedef struct _TOUCH_IDLE_STATISTICS
+{
+    volatile LONG Requests;
+    volatile LONG Rejected;
+    ULONG RequestToCallback;
+    ULONG CallbackToD3;
+
+    //
+    // Interrupt times the last request arrived and its callback was
+    // invoked at, the latter cleared on the D3 transition it caused or
+    // on the next D0 entry
+    //
+    ULONG64 RequestTime;
+    ULONG64 CallbackTime;
+} TOUCH_IDLE_STATISTICS, * PTOUCH_IDLE_STATISTICS;
+
 //
 // Device context
 //
@@ -66,7 +124,20 @@ typedef struct _DEVICE_EXTENSION
     // Interrupt servicing
     //
     WDFINTERRUPT InterruptObject;
-    BOOLEAN ServiceInterruptsAfterD0Entry;
+    volatile LONG ServiceInterruptsAfterD0Entry;
+
+    //
+    // Services the controller right after D0 entry, in case an edge was
+    // missed while interrupts were disabled
+    //
+    WDFWORKITEM D0EntryWorkItem;
+
+    //
+    // Puts the controller into doze after the doze holdoff, see hxdoze.c.
+    // Only armed while DozeTimerEnabled is set, from D0 entry to D0 exit.
+    //
+    WDFTIMER DozeTimer;
+    volatile LONG DozeTimerEnabled;
     
     //
     // Spb (I2C) related members used for the lifetime of the device
@@ -92,21 +163,41 @@ typedef struct _DEVICE_EXTENSION
     //
     WDFQUEUE IdleQueue;
 
+    //
+    // Idle callbacks are made from this work item, at most one idle
+    // notification is in it at a time
+    //
+    WDFWORKITEM IdleWorkItem;
+    volatile LONG IdleWorkItemBusy;
+    TOUCH_IDLE_STATISTICS IdleStatistics;
+
+    //
+    // Power state residency and transition latencies, read through the
+    // self-test interfaces
+    //
+    TOUCH_POWER_TELEMETRY PowerStats;
+
     //
     // Touch related members used for the lifetime of the device
     //
     VOID *TouchContext;
 
     //
-    // Settings
+    // Settings read at runtime, e.g. on display state changes
     //
-    TOUCH_SCREEN_SETTINGS TouchSettings;
+    TOUCH_RUNTIME_SETTINGS RuntimeSettings;
 
     //
     // Report
     //
     REPORT_CONTEXT ReportContext;
 
+    //
+    // HID report descriptor, built once at prepare hardware time
+    //
+    UCHAR ReportDescriptor[HID_REPORT_DESCRIPTOR_MAX_SIZE];
+    ULONG ReportDescriptorLength;
+
 	//
 	// PTP New
 	//
@@ -122,6 +213,11 @@ typedef struct _DEVICE_EXTENSION
     // Touch Power
     //
     TOUCH_POWER_CONTEXT TouchPowerContext;
+
+    //
+    // Display state handling
+    //
+    TOUCH_DISPLAY_CONTEXT Display;
 } DEVICE_EXTENSION, *PDEVICE_EXTENSION;
 
 WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(DEVICE_EXTENSION, GetDeviceContext)
@@ -0,0 +1,69 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		powerstats.h
+
+	Abstract:
+
+		Contains the power state residency and transition telemetry kept
+		by the driver. What diagnostics tools get back is defined in
+		selftest\powerstatistics.h.
+
+	Environment:
+
+		Kernel mode
+
+	Revision History:
+
+--*/
+
+#pragma once
+
+#include <wdm.h>
+#include <selftest\powerstatistics.h>
+#include <display.h>
+
+typedef struct _TOUCH_POWER_TELEMETRY
+{
+	KSPIN_LOCK Lock;
+	TOUCH_POWER_STATISTICS Statistics;
+
+	//
+	// Interrupt times tracking started at and the current state of each
+	// group was entered at. The current state is TOUCH_POWER_STATE_COUNT
+	// until one is entered.
+	//
+	ULONG64 StartTime;
+	TOUCH_POWER_STATE DeviceState;
+	ULONG64 DeviceStateTime;
+	TOUCH_POWER_STATE DisplayState;
+	ULONG64 DisplayStateTime;
+} TOUCH_POWER_TELEMETRY, * PTOUCH_POWER_TELEMETRY;
+
+VOID
+PowerStatsInitialize(
+	OUT PTOUCH_POWER_TELEMETRY Telemetry
+);
+
+VOID
+PowerStatsEnterState(
+	IN PTOUCH_POWER_TELEMETRY Telemetry,
+	IN TOUCH_POWER_STATE State
+);
+
+VOID
+PowerStatsRecordTransition(
+	IN PTOUCH_POWER_TELEMETRY Telemetry,
+	IN TOUCH_POWER_TRANSITION Transition,
+	IN ULONG Latency,
+	IN BOOLEAN Succeeded
+);
+
+VOID
+PowerStatsSnapshot(
+	IN PTOUCH_POWER_TELEMETRY Telemetry,
+	IN PTOUCH_DISPLAY_CONTEXT Display,
+	OUT PTOUCH_POWER_STATISTICS Statistics
+);
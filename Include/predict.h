@@ -0,0 +1,98 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		predict.h
+
+	Abstract:
+
+		Contains motion prediction defines and types
+
+	Environment:
+
+		Kernel mode
+
+	Revision History:
+
+--*/
+
+#pragma once
+
+#include <wdm.h>
+
+//
+// One prediction slot per controller slot, see MAX_TOUCHES
+//
+#define PREDICT_MAX_SLOTS          32
+
+//
+// Number of samples kept per slot, enough for velocity and acceleration
+//
+#define PREDICT_HISTORY_SIZE       3
+
+//
+// Largest horizon honored, in milliseconds
+//
+#define PREDICT_MAX_HORIZON_MS     50
+
+//
+// Samples further apart than this (100us units) start a new history
+//
+#define PREDICT_MAX_SAMPLE_GAP     200
+
+//
+// Velocity and acceleration are kept in Q16 pixels per 100us (squared)
+//
+#define PREDICT_FRACTION_BITS      16
+
+typedef struct _PREDICT_SAMPLE
+{
+	LONG X;
+	LONG Y;
+	ULONG Time;
+} PREDICT_SAMPLE;
+
+typedef struct _PREDICT_SLOT
+{
+	//
+	// History[0] is the newest sample
+	//
+	PREDICT_SAMPLE History[PREDICT_HISTORY_SIZE];
+	ULONG Count;
+	LONG VelocityX;
+	LONG VelocityY;
+	LONG AccelerationX;
+	LONG AccelerationY;
+} PREDICT_SLOT, * PPREDICT_SLOT;
+
+typedef struct _PREDICT_CONTEXT
+{
+	PREDICT_SLOT Slot[PREDICT_MAX_SLOTS];
+} PREDICT_CONTEXT, * PPREDICT_CONTEXT;
+
+VOID
+PredictReset(
+	IN PPREDICT_CONTEXT Context
+);
+
+VOID
+PredictResetSlot(
+	IN PPREDICT_SLOT Slot
+);
+
+VOID
+PredictAddSample(
+	IN PPREDICT_SLOT Slot,
+	IN LONG X,
+	IN LONG Y,
+	IN ULONG Time
+);
+
+VOID
+PredictPosition(
+	IN PPREDICT_SLOT Slot,
+	IN ULONG Horizon,
+	IN OUT PLONG X,
+	IN OUT PLONG Y
+);
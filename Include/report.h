@@ -27,6 +27,9 @@
 #include <hid.h>
 #include <HidCommon.h>
 #include <spb.h>
+#include <predict.h>
+#include <filter.h>
+#include <tracker.h>
 
 #define MAX_TOUCHES                32
 #define MAX_BUTTONS                3
@@ -68,6 +71,7 @@ typedef struct _DETECTED_OBJECTS
 {
 	OBJECT_STATE States[MAX_TOUCHES];
 	DETECTED_OBJECT_POSITION Positions[MAX_TOUCHES];
+	ULONG64 Timestamp; // Interrupt time the frame was signaled at, 100ns units
 } DETECTED_OBJECTS;
 
 typedef struct _BUTTON_CACHE
@@ -80,8 +84,17 @@ typedef struct _REPORT_CONTEXT
 	BUTTON_CACHE ButtonCache;
 	BOOLEAN PenPresent;
 	OBJECT_CACHE Cache;
-	TOUCH_SCREEN_PROPERTIES Props;
+	TOUCH_SCREEN_CONTEXT Screen;
 	WDFQUEUE PingPongQueue;
+	TRACKER_CONTEXT Tracker;
+	FILTER_CONTEXT Filter;
+	PREDICT_CONTEXT Predict;
+
+	//
+	// Interrupt time bring-up started at, cleared once the controller
+	// is sensing
+	//
+	ULONG64 BringUpTime;
 } REPORT_CONTEXT, * PREPORT_CONTEXT;
 
 NTSTATUS
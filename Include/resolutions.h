@@ -20,7 +20,10 @@
 
 #pragma once
 
+#include <calibration.h>
+
 #define TOUCH_SCREEN_PROPERTIES_REG_KEY L"\\Registry\\Machine\\System\\TOUCH\\SCREENPROPERTIES"
+#define TOUCH_CALIBRATION_MESH_VALUE L"TouchCalibrationMesh"
 #define TOUCH_DEFAULT_RESOLUTION_X  480
 #define TOUCH_DEFAULT_RESOLUTION_Y  800
 #define TOUCH_DEVICE_RESOLUTION_X   1440
@@ -49,11 +52,109 @@ typedef struct _TOUCH_SCREEN_PROPERTIES
     UINT32 DisplayHeight10um;
     UINT32 DisplayWidth10um;
     UINT32 TouchHardwareLacksContinuousReporting;
+    UINT32 TouchPredictionHorizon;
 } TOUCH_SCREEN_PROPERTIES, * PTOUCH_SCREEN_PROPERTIES;
 
+//
+// Per axis constants of a compiled transform, see TchCompileTransform
+//
+typedef struct _TOUCH_TRANSFORM_AXIS
+{
+    ULONG TouchClip;
+    ULONG TouchOffset;
+    ULONG TouchLimit;
+    ULONG64 ScaleMultiplier;
+    ULONG ScaleShift;
+    ULONG DisplayClip;
+    ULONG DisplayOffset;
+    ULONG DisplayLimit;
+} TOUCH_TRANSFORM_AXIS;
+
+struct _TOUCH_TRANSFORM;
+
+typedef VOID (*PTOUCH_TRANSFORM_KERNEL)(
+    IN OUT PUSHORT X,
+    IN OUT PUSHORT Y,
+    IN const struct _TOUCH_TRANSFORM* Transform
+    );
+
+//
+// Screen properties compiled into a branch free transform. Kernel is one
+// of eight swap/invert specializations, or the reference translation when
+// the properties do not allow folding.
+//
+typedef struct _TOUCH_TRANSFORM
+{
+    TOUCH_TRANSFORM_AXIS X;
+    TOUCH_TRANSFORM_AXIS Y;
+    PTOUCH_TRANSFORM_KERNEL Kernel;
+    TOUCH_SCREEN_PROPERTIES Props;
+} TOUCH_TRANSFORM, * PTOUCH_TRANSFORM;
+
+//
+// Everything derived from SCREENPROPERTIES, rebuilt as a whole on reload
+//
+typedef struct _TOUCH_SCREEN
+{
+    TOUCH_SCREEN_PROPERTIES Props;
+    TOUCH_TRANSFORM Transform;
+    CALIBRATION_CONTEXT Calibration;
+} TOUCH_SCREEN, * PTOUCH_SCREEN;
+
+//
+// Published screen state. Readers never block: they count themselves in
+// for the current epoch and use whatever Current points to. A reload is
+// built in the buffer Current does not point to, swapped in, and the
+// previous buffer is only reused once the readers of both epochs that
+// might still see it have drained.
+//
+typedef struct _TOUCH_SCREEN_CONTEXT
+{
+    PTOUCH_SCREEN volatile Current;
+    TOUCH_SCREEN Buffer[2];
+    volatile LONG Epoch;
+    volatile LONG Readers[2];
+
+    //
+    // Watch on TOUCH_SCREEN_PROPERTIES_REG_KEY
+    //
+    TOUCH_KEY_WATCH Watch;
+} TOUCH_SCREEN_CONTEXT, * PTOUCH_SCREEN_CONTEXT;
+
 VOID
-TchGetScreenProperties(
-	IN PTOUCH_SCREEN_PROPERTIES Props
+TchLoadTouchRegistry(
+	OUT PTOUCH_SCREEN_SETTINGS Settings OPTIONAL,
+	OUT PTOUCH_SCREEN_PROPERTIES Props OPTIONAL,
+	OUT PCALIBRATION_CONTEXT Calibration OPTIONAL
+);
+
+VOID
+TchLoadTouchConfiguration(
+	IN WDFDEVICE FxDevice,
+	OUT PTOUCH_SCREEN_SETTINGS Settings,
+	OUT PTOUCH_SCREEN_PROPERTIES Props,
+	OUT PCALIBRATION_CONTEXT Calibration
+);
+
+VOID
+TchCompileTransform(
+	IN PTOUCH_SCREEN_PROPERTIES Props,
+	OUT PTOUCH_TRANSFORM Transform
+);
+
+VOID
+TchTransformToDisplayCoordinates(
+	IN OUT PUSHORT X,
+	IN OUT PUSHORT Y,
+	IN const TOUCH_TRANSFORM* Transform
+);
+
+VOID
+TchTransformFrameToDisplayCoordinates(
+	IN OUT PUSHORT X,
+	IN OUT PUSHORT Y,
+	IN ULONG Count,
+	IN const TOUCH_TRANSFORM* Transform
 );
 
 VOID
@@ -62,3 +163,37 @@ TchTranslateToDisplayCoordinates(
 	IN PUSHORT Y,
 	IN PTOUCH_SCREEN_PROPERTIES Props
 );
+
+VOID
+TchInitializeScreen(
+	IN PTOUCH_SCREEN_CONTEXT Context,
+	IN WDFDEVICE FxDevice,
+	OUT PTOUCH_SCREEN_SETTINGS Settings
+);
+
+VOID
+TchReloadScreen(
+	IN PTOUCH_SCREEN_CONTEXT Context
+);
+
+const TOUCH_SCREEN*
+TchAcquireScreen(
+	IN PTOUCH_SCREEN_CONTEXT Context,
+	OUT PLONG Ticket
+);
+
+VOID
+TchReleaseScreen(
+	IN PTOUCH_SCREEN_CONTEXT Context,
+	IN LONG Ticket
+);
+
+NTSTATUS
+TchStartScreenNotification(
+	IN PTOUCH_SCREEN_CONTEXT Context
+);
+
+VOID
+TchStopScreenNotification(
+	IN PTOUCH_SCREEN_CONTEXT Context
+);
@@ -0,0 +1,102 @@
+/*++
+    Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+    Module Name:
+
+        powerstatistics.h
+
+    Abstract:
+
+        Contains the power statistics returned by
+        IOCTL_TOUCH_SELFTEST_POWER_STATISTICS. Only needs the basic
+        Windows types, so diagnostics tools include it as well.
+
+    Environment:
+
+        Kernel and user mode
+
+    Revision History:
+
+--*/
+
+#pragma once
+
+//
+// Device power states and display states are tracked independently, a
+// state only ends when another one of its group is entered
+//
+typedef enum _TOUCH_POWER_STATE
+{
+    TOUCH_POWER_STATE_D0 = 0,
+    TOUCH_POWER_STATE_D3,
+    TOUCH_POWER_STATE_DISPLAY_ON,
+    TOUCH_POWER_STATE_DISPLAY_OFF,
+    TOUCH_POWER_STATE_WAKE_GESTURE,
+    TOUCH_POWER_STATE_COUNT
+} TOUCH_POWER_STATE;
+
+#define TOUCH_POWER_FIRST_DISPLAY_STATE    TOUCH_POWER_STATE_DISPLAY_ON
+
+//
+// The latency of a wake runs from D0 entry to the controller sensing, a
+// wake that leaves it not sensing is a failure
+//
+typedef enum _TOUCH_POWER_TRANSITION
+{
+    TOUCH_POWER_TRANSITION_WAKE = 0,
+    TOUCH_POWER_TRANSITION_STANDBY,
+    TOUCH_POWER_TRANSITION_DISPLAY_ON,
+    TOUCH_POWER_TRANSITION_DISPLAY_OFF,
+    TOUCH_POWER_TRANSITION_COUNT
+} TOUCH_POWER_TRANSITION;
+
+//
+// Bucket 0 counts latencies below 128 us, bucket i those below
+// 2^(i + 7) us, the last bucket everything above
+//
+#define TOUCH_POWER_HISTOGRAM_BUCKETS      16
+#define TOUCH_POWER_HISTOGRAM_SHIFT        7
+
+#define TOUCH_POWER_STATISTICS_VERSION     2
+
+//
+// Times are in microseconds
+//
+typedef struct _TOUCH_POWER_STATE_STATISTICS
+{
+    ULONG Entries;
+    ULONG Reserved;
+    ULONG64 Residency;
+} TOUCH_POWER_STATE_STATISTICS;
+
+typedef struct _TOUCH_POWER_TRANSITION_STATISTICS
+{
+    ULONG Count;
+    ULONG Failures;
+    ULONG LastLatency;
+    ULONG MaxLatency;
+    ULONG64 TotalLatency;
+    ULONG Histogram[TOUCH_POWER_HISTOGRAM_BUCKETS];
+} TOUCH_POWER_TRANSITION_STATISTICS;
+
+typedef struct _TOUCH_POWER_STATISTICS
+{
+    ULONG Version;
+    ULONG Size;
+
+    //
+    // Time covered, since the device was added
+    //
+    ULONG64 Time;
+
+    TOUCH_POWER_STATE_STATISTICS States[TOUCH_POWER_STATE_COUNT];
+    TOUCH_POWER_TRANSITION_STATISTICS Transitions[TOUCH_POWER_TRANSITION_COUNT];
+
+    //
+    // Display transitions avoided: display off cancelled within the
+    // debounce time, and display states found applied already. Added in
+    // version 2.
+    //
+    ULONG DisplayOffCancelled;
+    ULONG DisplaySkipped;
+} TOUCH_POWER_STATISTICS, * PTOUCH_POWER_STATISTICS;
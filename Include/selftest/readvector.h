@@ -0,0 +1,82 @@
+/*++
+    Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+    Module Name:
+
+        readvector.h
+
+    Abstract:
+
+        Contains the vectored register read shared by the self-test
+        interfaces, which runs several reads under one bus arbitration
+
+    Environment:
+
+        Kernel mode
+
+    Revision History:
+
+--*/
+
+#pragma once
+
+#include <wdm.h>
+#include <wdf.h>
+#include <spb.h>
+
+#define TOUCH_TEST_READ_VECTOR_MAX_ENTRIES  64
+
+//
+// Once an entry with this flag fails, the entries after it are not read
+// and report STATUS_REQUEST_ABORTED
+//
+#define TOUCH_TEST_READ_FLAG_STOP_ON_ERROR  0x0001
+#define TOUCH_TEST_READ_VALID_FLAGS         TOUCH_TEST_READ_FLAG_STOP_ON_ERROR
+
+//
+// Laid out like TOUCH_TEST_I2C_HEADER, with flags in what is padding
+// there, so a single read converts to a one entry vector as is
+//
+typedef struct _TOUCH_TEST_READ_ENTRY
+{
+    UCHAR AddressLength;
+    UCHAR Address;
+    USHORT Flags;
+    ULONG RequestedTransferLength;
+} TOUCH_TEST_READ_ENTRY;
+
+typedef struct _TOUCH_TEST_READ_VECTOR
+{
+    ULONG Count;
+    TOUCH_TEST_READ_ENTRY Entries[ANYSIZE_ARRAY];
+} TOUCH_TEST_READ_VECTOR;
+
+//
+// Status is an NTSTATUS. The data of entry i is TransferLength bytes at
+// Offset from the start of the output, zeroed when the read failed.
+//
+typedef struct _TOUCH_TEST_READ_RESULT
+{
+    LONG Status;
+    ULONG TransferLength;
+    ULONG Offset;
+} TOUCH_TEST_READ_RESULT;
+
+//
+// Output of a vectored read: Count results, followed by the data of all
+// entries packed back to back in entry order. Size is the whole output.
+//
+typedef struct _TOUCH_TEST_READ_VECTOR_RESULT
+{
+    ULONG Count;
+    ULONG Size;
+    TOUCH_TEST_READ_RESULT Results[ANYSIZE_ARRAY];
+} TOUCH_TEST_READ_VECTOR_RESULT;
+
+NTSTATUS
+TchSelfTestReadVector(
+    IN SPB_CONTEXT* SpbContext,
+    IN WDFREQUEST Request,
+    IN size_t OutputBufferLength,
+    IN size_t InputBufferLength
+    );
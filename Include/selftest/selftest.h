@@ -38,6 +38,17 @@ DEFINE_GUID(GUID_TOUCH_SELFTEST_INTERFACE,
 #define IOCTL_TOUCH_SELFTEST_MODE           TOUCH_TEST_BUFFER_CTL_CODE(102)
 #define IOCTL_TOUCH_SELFTEST_CHANGE_PAGE    TOUCH_TEST_BUFFER_CTL_CODE(103)
 
+//
+// Returns TOUCH_POWER_STATISTICS, see powerstatistics.h
+//
+#define IOCTL_TOUCH_SELFTEST_POWER_STATISTICS TOUCH_TEST_BUFFER_CTL_CODE(104)
+
+//
+// Takes TOUCH_TEST_READ_VECTOR and returns TOUCH_TEST_READ_VECTOR_RESULT,
+// see readvector.h
+//
+#define IOCTL_TOUCH_SELFTEST_READ_VECTOR    TOUCH_TEST_BUFFER_CTL_CODE(105)
+
 typedef struct _TOUCH_TEST_I2C_HEADER
 {
     UCHAR AddressLength;
@@ -0,0 +1,104 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		snapshot.h
+
+	Abstract:
+
+		Contains the layout of the validated configuration snapshot kept
+		under the device key, and the routines building and checking it
+
+	Environment:
+
+		Kernel mode
+
+	Revision History:
+
+--*/
+
+#pragma once
+
+#include <controller.h>
+#include <resolutions.h>
+
+//
+// Bump the version whenever the layout of any member changes
+//
+#define TOUCH_SNAPSHOT_SIGNATURE        (ULONG)'snhT'
+#define TOUCH_SNAPSHOT_VERSION          2
+
+//
+// Number of touch registry keys whose last write time is recorded
+//
+#define TOUCH_SNAPSHOT_SOURCES          7
+
+typedef struct _TOUCH_SNAPSHOT
+{
+	ULONG Signature;
+	ULONG Version;
+	ULONG Size;
+
+	//
+	// CRC-32 of everything following this member
+	//
+	ULONG Checksum;
+
+	//
+	// Identifies the build and its default tables. The layout of the
+	// members may stay the same while their defaults or meaning change,
+	// a snapshot taken by another build is not used.
+	//
+	ULONG Schema;
+
+	LARGE_INTEGER SourceWriteTime[TOUCH_SNAPSHOT_SOURCES];
+	TOUCH_SCREEN_SETTINGS Settings;
+	TOUCH_SCREEN_PROPERTIES Props;
+	CALIBRATION_CONTEXT Calibration;
+} TOUCH_SNAPSHOT, * PTOUCH_SNAPSHOT;
+
+typedef enum _TOUCH_SNAPSHOT_CHECK
+{
+	TOUCH_SNAPSHOT_VALID = 0,
+
+	//
+	// Wrong size, signature, version or checksum
+	//
+	TOUCH_SNAPSHOT_CORRUPT,
+
+	//
+	// Taken by another build
+	//
+	TOUCH_SNAPSHOT_OTHER_SCHEMA,
+
+	//
+	// The touch registry changed since it was taken
+	//
+	TOUCH_SNAPSHOT_STALE
+} TOUCH_SNAPSHOT_CHECK;
+
+ULONG
+TchSnapshotCrc(
+	IN ULONG Crc,
+	IN const VOID* Data,
+	IN ULONG Length
+);
+
+VOID
+TchBuildSnapshot(
+	OUT PTOUCH_SNAPSHOT Snapshot,
+	IN ULONG Schema,
+	IN const LARGE_INTEGER* SourceWriteTime,
+	IN const TOUCH_SCREEN_SETTINGS* Settings,
+	IN const TOUCH_SCREEN_PROPERTIES* Props,
+	IN const CALIBRATION_CONTEXT* Calibration
+);
+
+TOUCH_SNAPSHOT_CHECK
+TchCheckSnapshot(
+	IN const TOUCH_SNAPSHOT* Snapshot,
+	IN ULONG Length,
+	IN ULONG Schema,
+	IN const LARGE_INTEGER* SourceWriteTime
+);
@@ -38,6 +38,20 @@ typedef struct _SPB_CONTEXT
     WDFWAITLOCK SpbLock;
 } SPB_CONTEXT;
 
+//
+// One read of SpbReadVectorSynchronously
+//
+
+typedef struct _SPB_READ_ENTRY
+{
+    PUCHAR Command;
+    ULONG CommandLength;
+    PVOID Data;
+    ULONG Length;
+    BOOLEAN StopOnError;
+    NTSTATUS Status;
+} SPB_READ_ENTRY;
+
 NTSTATUS 
 SpbReadDataSynchronously(
     _In_ SPB_CONTEXT *SpbContext,
@@ -47,6 +61,13 @@ SpbReadDataSynchronously(
     _In_ ULONG Length
     );
 
+NTSTATUS
+SpbReadVectorSynchronously(
+    IN SPB_CONTEXT *SpbContext,
+    IN OUT SPB_READ_ENTRY *Entries,
+    IN ULONG Count
+    );
+
 VOID
 SpbTargetDeinitialize(
     IN WDFDEVICE FxDevice,
@@ -42,7 +42,16 @@ PowerDeInitialize(
 NTSTATUS
 PowerToggle(
     TOUCH_POWER_CONTEXT* deviceContext,
-    DWORD State
+    DWORD State,
+    PTOUCH_POWER_TOGGLE_COMPLETE Complete,
+    PVOID Context
 );
 
+VOID
+PowerCancelToggle(
+    TOUCH_POWER_CONTEXT* deviceContext
+);
+
+EVT_WDF_REQUEST_COMPLETION_ROUTINE PowerToggleCompletion;
+
 DRIVER_NOTIFICATION_CALLBACK_ROUTINE PowerIoRegPnPNotification;
\ No newline at end of file
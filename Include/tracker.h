@@ -0,0 +1,76 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		tracker.h
+
+	Abstract:
+
+		Contains contact tracker defines and types
+
+	Environment:
+
+		Kernel mode
+
+	Revision History:
+
+--*/
+
+#pragma once
+
+#include <wdm.h>
+
+//
+// Controller slots the tracker takes points from, see MAX_TOUCHES.
+// Contact IDs handed out are below this value as well.
+//
+#define TRACKER_MAX_SLOTS          32
+
+//
+// Largest frame (tracked contacts, or present plus lifted points) that is
+// matched by position. Larger frames fall back to the controller slots.
+//
+#define TRACKER_MAX_CONTACTS       10
+
+typedef struct _TRACKER_POINT
+{
+	LONG X;
+	LONG Y;
+} TRACKER_POINT;
+
+typedef struct _TRACKER_CONTACT
+{
+	LONG X;
+	LONG Y;
+	UCHAR Id;
+	UCHAR Slot;
+} TRACKER_CONTACT;
+
+typedef struct _TRACKER_CONTEXT
+{
+	//
+	// Contacts that were down in the previous frame
+	//
+	TRACKER_CONTACT Contacts[TRACKER_MAX_SLOTS];
+	ULONG Count;
+
+	//
+	// Contact IDs held by those contacts
+	//
+	ULONG IdMask;
+} TRACKER_CONTEXT, * PTRACKER_CONTEXT;
+
+VOID
+TrackerReset(
+	IN PTRACKER_CONTEXT Context
+);
+
+VOID
+TrackerUpdate(
+	IN PTRACKER_CONTEXT Context,
+	IN ULONG PresentMask,
+	IN ULONG LiftedMask,
+	IN const TRACKER_POINT* Points,
+	OUT PUCHAR Ids
+);
@@ -0,0 +1,203 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		calibration.c
+
+	Abstract:
+
+		Corrects panel non linearity left after the linear coordinate
+		transform. A mesh of display pixel offsets is interpolated
+		bilinearly at each contact, in fixed point and at a constant cost.
+
+	Environment:
+
+		Kernel mode
+
+	Revision History:
+
+--*/
+
+#include <calibration.h>
+
+BOOLEAN
+CalibrationConfigure(
+	IN PCALIBRATION_CONTEXT Context,
+	IN const UCHAR* Mesh,
+	IN ULONG Length,
+	IN ULONG Width,
+	IN ULONG Height
+)
+/*++
+
+Routine Description:
+
+	Validates a mesh in its registry layout and loads it. The correction
+	stays off unless the mesh is well formed.
+
+Arguments:
+
+	Context - The calibration context to configure
+
+	Mesh - Mesh in registry layout, may be NULL
+
+	Length - Size of the mesh in bytes
+
+	Width - Display width in pixels
+
+	Height - Display height in pixels
+
+Return Value:
+
+	TRUE if the mesh was loaded.
+
+--*/
+{
+	CALIBRATION_MESH_HEADER header;
+	ULONG nodes;
+
+	RtlZeroMemory(Context, sizeof(CALIBRATION_CONTEXT));
+
+	if (Mesh == NULL || Length < sizeof(CALIBRATION_MESH_HEADER) ||
+		Width == 0 || Width > MAXUSHORT || Height == 0 || Height > MAXUSHORT)
+	{
+		return FALSE;
+	}
+
+	RtlCopyMemory(&header, Mesh, sizeof(CALIBRATION_MESH_HEADER));
+
+	if (header.Columns < CALIBRATION_MIN_NODES || header.Columns > CALIBRATION_MAX_NODES ||
+		header.Rows < CALIBRATION_MIN_NODES || header.Rows > CALIBRATION_MAX_NODES)
+	{
+		return FALSE;
+	}
+
+	nodes = (ULONG)header.Columns * header.Rows;
+
+	if (Length != sizeof(CALIBRATION_MESH_HEADER) + nodes * sizeof(CALIBRATION_NODE))
+	{
+		return FALSE;
+	}
+
+	RtlCopyMemory(
+		Context->Node,
+		Mesh + sizeof(CALIBRATION_MESH_HEADER),
+		nodes * sizeof(CALIBRATION_NODE));
+
+	Context->Columns = header.Columns;
+	Context->Rows = header.Rows;
+	Context->Width = Width;
+	Context->Height = Height;
+	Context->StepX = ((header.Columns - 1) << 16) / Width;
+	Context->StepY = ((header.Rows - 1) << 16) / Height;
+	Context->Enabled = TRUE;
+
+	return TRUE;
+}
+
+static
+VOID
+CalibrationLocate(
+	IN ULONG Value,
+	IN ULONG Step,
+	IN ULONG Nodes,
+	OUT PULONG Cell,
+	OUT PLONG Weight
+)
+{
+	ULONG position = Value * Step;
+
+	//
+	// The far edge belongs to the last cell, weights are Q8
+	//
+	*Cell = min(position >> 16, Nodes - 2);
+	*Weight = (LONG)min((position - (*Cell << 16)) >> 8, 256);
+}
+
+static
+LONG
+CalibrationInterpolate(
+	IN LONG TopLeft,
+	IN LONG TopRight,
+	IN LONG BottomLeft,
+	IN LONG BottomRight,
+	IN LONG U,
+	IN LONG V
+)
+{
+	LONG top = TopLeft * (256 - U) + TopRight * U;
+	LONG bottom = BottomLeft * (256 - U) + BottomRight * U;
+	LONG64 value = (LONG64)top * (256 - V) + (LONG64)bottom * V;
+
+	//
+	// Q16 weights and Q4 offsets down to pixels, rounded to nearest
+	//
+	return (LONG)((value + ((LONG64)1 << (15 + CALIBRATION_OFFSET_BITS))) >>
+		(16 + CALIBRATION_OFFSET_BITS));
+}
+
+VOID
+CalibrationApply(
+	IN const CALIBRATION_CONTEXT* Context,
+	IN OUT PUSHORT X,
+	IN OUT PUSHORT Y
+)
+/*++
+
+Routine Description:
+
+	Moves a display coordinate by the mesh offset interpolated at it. The
+	result is kept inside the display.
+
+Arguments:
+
+	Context - The calibration context holding the mesh
+
+	X - In the display X coordinate, out the corrected one
+
+	Y - In the display Y coordinate, out the corrected one
+
+Return Value:
+
+	None.
+
+--*/
+{
+	const CALIBRATION_NODE* row;
+	ULONG x, y;
+	ULONG column, line;
+	LONG u, v;
+	LONG dx, dy;
+
+	if (!Context->Enabled)
+	{
+		return;
+	}
+
+	x = min((ULONG)*X, Context->Width);
+	y = min((ULONG)*Y, Context->Height);
+
+	CalibrationLocate(x, Context->StepX, Context->Columns, &column, &u);
+	CalibrationLocate(y, Context->StepY, Context->Rows, &line, &v);
+
+	row = &Context->Node[line * Context->Columns + column];
+
+	dx = CalibrationInterpolate(
+		row[0].X,
+		row[1].X,
+		row[Context->Columns].X,
+		row[Context->Columns + 1].X,
+		u,
+		v);
+	dy = CalibrationInterpolate(
+		row[0].Y,
+		row[1].Y,
+		row[Context->Columns].Y,
+		row[Context->Columns + 1].Y,
+		u,
+		v);
+
+	*X = (USHORT)max(0, min((LONG)x + dx, (LONG)Context->Width));
+	*Y = (USHORT)max(0, min((LONG)y + dy, (LONG)Context->Height));
+}
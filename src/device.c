@@ -37,6 +37,40 @@
 #pragma alloc_text(PAGE, OnD0Exit)
 #endif
 
+VOID
+TchArmDozeTimer(
+    IN PDEVICE_EXTENSION DevContext
+)
+/*++
+
+  Routine Description:
+
+    Arms the doze timer when the doze state asks for it, for the holdoff
+    when the last contact lifted in the frame just serviced, and for the
+    scan windows while the doze is polled. Called with the passive
+    interrupt lock held. Outside D0 the request is dropped, D0 entry
+    starts the holdoff over.
+
+  Arguments:
+
+    DevContext - The device context
+
+  Return Value:
+
+    None.
+
+--*/
+{
+    ULONG timeout;
+
+    timeout = Hx85xDozeArm(&((HX85X_CONTROLLER_CONTEXT*)DevContext->TouchContext)->Doze);
+
+    if (timeout != 0 && DevContext->DozeTimerEnabled)
+    {
+        WdfTimerStart(DevContext->DozeTimer, WDF_REL_TIMEOUT_IN_MS(timeout));
+    }
+}
+
 BOOLEAN
 OnInterruptIsr(
     IN WDFINTERRUPT Interrupt,
@@ -67,9 +101,17 @@ OnInterruptIsr(
 {
     PDEVICE_EXTENSION devContext;
     NTSTATUS status;
+    ULONG64 interruptTime;
+    ULONG64 qpcTimeStamp;
 
     UNREFERENCED_PARAMETER(MessageID);
 
+    //
+    // Timestamp the frame before anything else, the SPB read that follows
+    // can take several milliseconds
+    //
+    interruptTime = KeQueryInterruptTimePrecise(&qpcTimeStamp);
+
     Trace(
         TRACE_LEVEL_ERROR,
         TRACE_REPORTING,
@@ -98,7 +140,8 @@ OnInterruptIsr(
     status = Hx85xServiceInterrupts(
         devContext->TouchContext,
         &devContext->I2CContext,
-        &devContext->ReportContext);
+        &devContext->ReportContext,
+        interruptTime);
 
     if (!NT_SUCCESS(status))
     {
@@ -110,10 +153,146 @@ OnInterruptIsr(
         goto exit;
     }
 
+    TchArmDozeTimer(devContext);
+
 exit:
     return TRUE;
 }
 
+VOID
+TchServiceAfterD0Entry(
+    IN PDEVICE_EXTENSION DevContext
+)
+/*++
+
+  Routine Description:
+
+    Services the controller once after D0 entry. Called from the D0 entry
+    work item and from HID reads, whichever comes first does the work.
+
+  Arguments:
+
+    DevContext - The device context
+
+  Return Value:
+
+    None.
+
+--*/
+{
+    ULONG64 qpcTimeStamp;
+
+    if (InterlockedExchange(&DevContext->ServiceInterruptsAfterD0Entry, FALSE) == FALSE)
+    {
+        return;
+    }
+
+    if (DevContext->DiagnosticMode != FALSE)
+    {
+        return;
+    }
+
+    //
+    // Serialized with the ISR, which runs with the passive interrupt
+    // lock held
+    //
+    WdfInterruptAcquireLock(DevContext->InterruptObject);
+
+    Hx85xServiceInterrupts(
+        DevContext->TouchContext,
+        &DevContext->I2CContext,
+        &DevContext->ReportContext,
+        KeQueryInterruptTimePrecise(&qpcTimeStamp));
+
+    TchArmDozeTimer(DevContext);
+
+    WdfInterruptReleaseLock(DevContext->InterruptObject);
+
+    Trace(
+        TRACE_LEVEL_VERBOSE,
+        TRACE_POWER,
+        "Serviced controller after D0 entry");
+}
+
+VOID
+OnDozeTimer(
+    IN WDFTIMER Timer
+)
+/*++
+
+  Routine Description:
+
+    Puts the controller into doze once no contact was down for the doze
+    holdoff, and opens and closes the scan windows while the doze is
+    polled. Runs at passive level.
+
+  Arguments:
+
+    Timer - The doze timer, parented to the device
+
+  Return Value:
+
+    None.
+
+--*/
+{
+    PDEVICE_EXTENSION devContext = GetDeviceContext(WdfTimerGetParentObject(Timer));
+    HX85X_CONTROLLER_CONTEXT* controller = (HX85X_CONTROLLER_CONTEXT*)devContext->TouchContext;
+    ULONG64 now;
+
+    if (devContext->DiagnosticMode != FALSE)
+    {
+        return;
+    }
+
+    //
+    // Serialized with the ISR, which wakes the controller from doze
+    //
+    WdfInterruptAcquireLock(devContext->InterruptObject);
+
+    if (!devContext->DozeTimerEnabled)
+    {
+        WdfInterruptReleaseLock(devContext->InterruptObject);
+        return;
+    }
+
+    now = KeQueryInterruptTime();
+
+    (VOID)Hx85xDozeTimer(
+        &controller->Doze,
+        controller->Sequences,
+        &devContext->I2CContext,
+        now,
+        Hx85xGestureHoldScan(&controller->Gesture, now));
+
+    TchArmDozeTimer(devContext);
+
+    WdfInterruptReleaseLock(devContext->InterruptObject);
+}
+
+VOID
+OnD0EntryWorkItem(
+    IN WDFWORKITEM WorkItem
+)
+/*++
+
+  Routine Description:
+
+    Work item queued on D0 entry, see TchServiceAfterD0Entry
+
+  Arguments:
+
+    WorkItem - The D0 entry work item, parented to the device
+
+  Return Value:
+
+    None.
+
+--*/
+{
+    TchServiceAfterD0Entry(GetDeviceContext(WdfWorkItemGetParentObject(WorkItem)));
+}
+
 NTSTATUS
 OnD0Entry(
     IN WDFDEVICE Device,
@@ -138,6 +317,9 @@ Return Value:
 {
     NTSTATUS status;
     PDEVICE_EXTENSION devContext;
+    ULONG64 transitionTime;
+    ULONG wakeLatency;
+    BOOLEAN sensing;
 
     Trace(
         TRACE_LEVEL_INFORMATION,
@@ -148,8 +330,33 @@ Return Value:
 
     UNREFERENCED_PARAMETER(PreviousState);
 
+    transitionTime = KeQueryInterruptTime();
+
     status = TchWakeDevice(devContext->TouchContext, &devContext->I2CContext);
 
+    //
+    // The wake sequence polls until the controller reports sensing, so
+    // this is the resume to sensing latency. Waking without sensing
+    // counts as a failure.
+    //
+    sensing = ((HX85X_CONTROLLER_CONTEXT*)devContext->TouchContext)->Sensing;
+    wakeLatency = (ULONG)((KeQueryInterruptTime() - transitionTime) / 10);
+
+    PowerStatsRecordTransition(
+        &devContext->PowerStats,
+        TOUCH_POWER_TRANSITION_WAKE,
+        wakeLatency,
+        NT_SUCCESS(status) && sensing);
+
+    Trace(
+        TRACE_LEVEL_INFORMATION,
+        TRACE_POWER,
+        "Controller %s %lu us after resume",
+        sensing ? "sensing" : "not sensing",
+        wakeLatency);
+
+    PowerStatsEnterState(&devContext->PowerStats, TOUCH_POWER_STATE_D0);
+
     if (!NT_SUCCESS(status))
     {
         Trace(
@@ -159,12 +366,51 @@ Return Value:
             status);
     }
 
+    //
+    // Bring-up ends with the controller sensing, the wake sequence has
+    // polled for it
+    //
+    if (devContext->ReportContext.BringUpTime != 0 && sensing)
+    {
+        Trace(
+            TRACE_LEVEL_INFORMATION,
+            TRACE_POWER,
+            "Controller sensing %I64u ms after bring-up started",
+            (KeQueryInterruptTime() - devContext->ReportContext.BringUpTime) / 10000);
+
+        devContext->ReportContext.BringUpTime = 0;
+    }
+
+    //
+    // The doze holdoff starts with the controller sensing again. The
+    // doze state is reset before the work item may service a frame.
+    //
+    WdfInterruptAcquireLock(devContext->InterruptObject);
+
+    InterlockedExchange(&devContext->DozeTimerEnabled, TRUE);
+
+    Hx85xDozeStart(
+        &((HX85X_CONTROLLER_CONTEXT*)devContext->TouchContext)->Doze,
+        KeQueryInterruptTime());
+
+    TchArmDozeTimer(devContext);
+
+    WdfInterruptReleaseLock(devContext->InterruptObject);
+
+    //
+    // The controller left wake gesture mode when put to sleep
+    //
+    TchRestoreReportingMode(devContext);
+
     //
     // N.B. This HX85X chip's IRQ is level-triggered, but cannot be enabled in
     //      ACPI until passive-level interrupt handling is added to the driver.
-    //      Service chip in case we missed an edge during D3 or boot-up.
+    //      Service chip in case we missed an edge during D3 or boot-up, right
+    //      away rather than on the next HID read, so a touch in progress at
+    //      wake is not held back.
     //
-    devContext->ServiceInterruptsAfterD0Entry = TRUE;
+    InterlockedExchange(&devContext->ServiceInterruptsAfterD0Entry, TRUE);
+    WdfWorkItemEnqueue(devContext->D0EntryWorkItem);
 
     //
     // Complete any pending Idle IRPs
@@ -204,6 +450,7 @@ Return Value:
 {
     NTSTATUS status;
     PDEVICE_EXTENSION devContext;
+    ULONG64 transitionTime;
 
     PAGED_CODE();
 
@@ -216,8 +463,37 @@ Return Value:
 
     UNREFERENCED_PARAMETER(TargetState);
 
+    //
+    // Servicing pending from D0 entry must not touch the controller once
+    // it is put to sleep
+    //
+    InterlockedExchange(&devContext->ServiceInterruptsAfterD0Entry, FALSE);
+    WdfWorkItemFlush(devContext->D0EntryWorkItem);
+
+    //
+    // Nothing arms the doze timer again once it is disabled under the
+    // interrupt lock, e.g. a display transition re-arming the gesture
+    //
+    WdfInterruptAcquireLock(devContext->InterruptObject);
+    InterlockedExchange(&devContext->DozeTimerEnabled, FALSE);
+    WdfInterruptReleaseLock(devContext->InterruptObject);
+
+    WdfTimerStop(devContext->DozeTimer, TRUE);
+
+    TchIdleTrackD3Entry(devContext);
+
+    transitionTime = KeQueryInterruptTime();
+
     status = TchStandbyDevice(devContext->TouchContext, &devContext->I2CContext, &devContext->ReportContext);
 
+    PowerStatsRecordTransition(
+        &devContext->PowerStats,
+        TOUCH_POWER_TRANSITION_STANDBY,
+        (ULONG)((KeQueryInterruptTime() - transitionTime) / 10),
+        NT_SUCCESS(status));
+
+    PowerStatsEnterState(&devContext->PowerStats, TOUCH_POWER_STATE_D3);
+
     if (!NT_SUCCESS(status))
     {
         Trace(
@@ -303,6 +579,26 @@ Exit:
     return status;
 }
 
+static
+VOID
+TchTraceBringUpStep(
+    IN PCSTR Step,
+    IN LARGE_INTEGER Frequency,
+    IN OUT PLARGE_INTEGER Last
+)
+{
+    LARGE_INTEGER now = KeQueryPerformanceCounter(NULL);
+
+    Trace(
+        TRACE_LEVEL_INFORMATION,
+        TRACE_INIT,
+        "Bring-up step %s took %I64u us",
+        Step,
+        (ULONG64)(now.QuadPart - Last->QuadPart) * 1000000 / (ULONG64)Frequency.QuadPart);
+
+    *Last = now;
+}
+
 NTSTATUS
 OnPrepareHardware(
     IN WDFDEVICE FxDevice,
@@ -338,6 +634,13 @@ OnPrepareHardware(
     ULONG i;
     LARGE_INTEGER delay;
     unsigned char value;
+    BOOLEAN waitForController = FALSE;
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER start;
+    LARGE_INTEGER step;
+    LARGE_INTEGER resetReleased = { 0 };
+    ULONG64 sinceReset;
+    ULONG64 waitTime = 0;
 
     UNREFERENCED_PARAMETER(FxResourcesRaw);
 
@@ -346,6 +649,14 @@ OnPrepareHardware(
     status = STATUS_INSUFFICIENT_RESOURCES;
     devContext = GetDeviceContext(FxDevice);
 
+    //
+    // Time to sensing is measured from here
+    //
+    devContext->ReportContext.BringUpTime = KeQueryInterruptTime();
+
+    start = KeQueryPerformanceCounter(&frequency);
+    step = start;
+
     //
     // Get the resouce hub connection ID for our I2C driver
     //
@@ -391,6 +702,27 @@ OnPrepareHardware(
         goto exit;
     }
 
+    TchTraceBringUpStep("resources", frequency, &step);
+
+    //
+    // Bring-up steps and the steps each of them depends on:
+    //
+    //   reset       resources
+    //   spb         resources
+    //   power       -
+    //   context     -
+    //   screen      context
+    //   descriptor  screen
+    //   settings    context
+    //   timer       -
+    //   wait        reset, spb
+    //   start       wait, screen, settings, timer
+    //   callbacks   start
+    //
+    // Only wait and start need the controller out of reset. The
+    // controller settles on its own, so its settle window is covered by
+    // running every other step between releasing reset and polling.
+    //
     if (devContext->HasResetGpio)
     {
         status = OpenIOTarget(devContext, devContext->ResetGpioId, GENERIC_READ | GENERIC_WRITE, &devContext->ResetGpio);
@@ -416,14 +748,17 @@ OnPrepareHardware(
         value = 1;
         SetGPIO(devContext->ResetGpio, &value);
 
-        Trace(TRACE_LEVEL_INFORMATION, TRACE_DRIVER, "Waiting...");
-
-        delay.QuadPart = -10 * TOUCH_DELAY_TO_COMMUNICATE;
-        KeDelayExecutionThread(KernelMode, TRUE, &delay);
+        resetReleased = KeQueryPerformanceCounter(NULL);
 
-        Trace(TRACE_LEVEL_INFORMATION, TRACE_DRIVER, "Done");
+        //
+        // Rather than sleeping through the reset window here, the
+        // controller is polled for once the bus is up
+        //
+        waitForController = TRUE;
     }
 
+    TchTraceBringUpStep("reset", frequency, &step);
+
 continueinit:
     //
     // Initialize Spb so the driver can issue reads/writes
@@ -441,6 +776,8 @@ continueinit:
         goto exit;
     }
 
+    TchTraceBringUpStep("spb", frequency, &step);
+
     //
     // Initialize Touch Power so the driver can issue power state changes
     //
@@ -457,10 +794,7 @@ continueinit:
         goto exit;
     }
 
-    //
-    // Get screen properties and populate context
-    //
-    TchGetScreenProperties(&devContext->ReportContext.Props);
+    TchTraceBringUpStep("power", frequency, &step);
 
     //
     // Prepare the hardware for touch scanning
@@ -478,6 +812,51 @@ continueinit:
         goto exit;
     }
 
+    TchTraceBringUpStep("context", frequency, &step);
+
+    //
+    // Get screen properties and touch settings, from the configuration
+    // snapshot when it is current, and populate the contexts
+    //
+    TchInitializeScreen(
+        &devContext->ReportContext.Screen,
+        FxDevice,
+        &((HX85X_CONTROLLER_CONTEXT*)devContext->TouchContext)->TouchSettings);
+
+    //
+    // Reload them whenever they change, so panel bring-up does not
+    // need a device restart. Failure only costs the live reload.
+    //
+    (VOID) TchStartScreenNotification(&devContext->ReportContext.Screen);
+
+    //
+    // Settings consulted on power transitions are cached and kept
+    // current the same way
+    //
+    TchInitializeRuntimeSettings(&devContext->RuntimeSettings);
+    (VOID) TchStartRuntimeSettingsNotification(&devContext->RuntimeSettings);
+
+    TchTraceBringUpStep("screen", frequency, &step);
+
+    //
+    // Build the HID report descriptor for these properties, requests
+    // for it are then served from the device context
+    //
+    status = TchGenerateHidReportDescriptor(FxDevice);
+
+    if (!NT_SUCCESS(status))
+    {
+        Trace(
+            TRACE_LEVEL_ERROR,
+            TRACE_INIT,
+            "Error building HID report descriptor - 0x%08lX",
+            status);
+
+        goto exit;
+    }
+
+    TchTraceBringUpStep("descriptor", frequency, &step);
+
     //
     // Fetch controller settings from registry
     //
@@ -496,6 +875,15 @@ continueinit:
         goto exit;
     }
 
+    //
+    // Position filtering follows the controller AbsPosFilt setting
+    //
+    FilterConfigure(
+        &devContext->ReportContext.Filter,
+        ((HX85X_CONTROLLER_CONTEXT*)devContext->TouchContext)->Config.TouchSettings.AbsPosFilt);
+
+    TchTraceBringUpStep("settings", frequency, &step);
+
     //
     // Configure the timer for continuous simulation on synaptics hardware that doesn't support it
     //
@@ -512,6 +900,37 @@ continueinit:
         goto exit;
     }
 
+    TchTraceBringUpStep("timer", frequency, &step);
+
+    //
+    // Out of reset the controller takes up to TOUCH_DELAY_TO_COMMUNICATE
+    // to answer. What is left of that window after the steps above is
+    // the part of it on the critical path.
+    //
+    if (waitForController)
+    {
+        sinceReset = (ULONG64)(KeQueryPerformanceCounter(NULL).QuadPart - resetReleased.QuadPart) *
+            1000000 / (ULONG64)frequency.QuadPart;
+
+        Trace(TRACE_LEVEL_INFORMATION, TRACE_DRIVER, "Waiting...");
+
+        //
+        // The window started at reset release, the bound is what is left
+        // of it. With none left the controller is still polled once.
+        //
+        (VOID) TchWaitForDevice(
+            &devContext->I2CContext,
+            sinceReset < TOUCH_DELAY_TO_COMMUNICATE ?
+                (ULONG)(TOUCH_DELAY_TO_COMMUNICATE - sinceReset) : 0);
+
+        Trace(TRACE_LEVEL_INFORMATION, TRACE_DRIVER, "Done");
+
+        waitTime = (ULONG64)(KeQueryPerformanceCounter(NULL).QuadPart - step.QuadPart) *
+            1000000 / (ULONG64)frequency.QuadPart;
+
+        TchTraceBringUpStep("wait", frequency, &step);
+    }
+
     //
     // Start the controller
     //
@@ -528,6 +947,10 @@ continueinit:
         goto exit;
     }
 
+    TchTraceBringUpStep("start", frequency, &step);
+
+    TchStartDisplayStateTransitions(devContext);
+
     status = PoRegisterPowerSettingCallback(
         NULL,
         &GUID_ACDC_POWER_SOURCE,
@@ -566,6 +989,15 @@ continueinit:
         goto exit;
     }
 
+    TchTraceBringUpStep("callbacks", frequency, &step);
+
+    Trace(
+        TRACE_LEVEL_INFORMATION,
+        TRACE_INIT,
+        "Bring-up took %I64u us, %I64u us of it waiting for the controller",
+        (ULONG64)(step.QuadPart - start.QuadPart) * 1000000 / (ULONG64)frequency.QuadPart,
+        waitTime);
+
 exit:
 
     return status;
@@ -629,6 +1061,14 @@ OnReleaseHardware(
             status);
     }
 
+    //
+    // No display transition may touch the controller once it is stopped
+    //
+    TchStopDisplayStateTransitions(devContext);
+
+    TchStopScreenNotification(&devContext->ReportContext.Screen);
+    TchStopRuntimeSettingsNotification(&devContext->RuntimeSettings);
+
     status = TchStopDevice(devContext->TouchContext, &devContext->I2CContext);
 
     if (!NT_SUCCESS(status))
@@ -0,0 +1,341 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		display.c
+
+	Abstract:
+
+		Display state machine. Display off is debounced by a timer and
+		cancelled by the display coming back, a state requested while a
+		transition runs is picked up once it ends, and a request found
+		applied already is skipped. The device owns the off timer, the
+		touch power rail and the work item that configures the
+		controller; these routines tell it when to use them.
+
+	Environment:
+
+		Kernel mode
+
+	Revision History:
+
+--*/
+
+#include <display.h>
+
+VOID
+TchDisplayReset(
+	IN OUT PTOUCH_DISPLAY_CONTEXT Display
+)
+/*++
+
+Routine Description:
+
+	Prepares display state handling before the display state callback is
+	registered. The first notification always causes a transition.
+
+Arguments:
+
+	Display - The display state
+
+Return Value:
+
+	None.
+
+--*/
+{
+	Display->Requested = TOUCH_DISPLAY_UNKNOWN;
+	Display->Applied = TOUCH_DISPLAY_UNKNOWN;
+	Display->OffPending = FALSE;
+	InterlockedExchange(&Display->Stopping, FALSE);
+}
+
+ULONG
+TchDisplayRequest(
+	IN OUT PTOUCH_DISPLAY_CONTEXT Display,
+	IN LONG State
+)
+/*++
+
+Routine Description:
+
+	Feeds a display state change to the state machine, with Lock held:
+
+	  On       cancels a pending display off and transitions right away
+	  Dimmed   cancels a pending display off, the applied state is kept
+	  Off      transitions once OffTimer expires, unless already pending
+	           or requested
+
+Arguments:
+
+	Display - The display state
+
+	State - TOUCH_DISPLAY_OFF, TOUCH_DISPLAY_ON or TOUCH_DISPLAY_DIMMED
+
+Return Value:
+
+	TOUCH_DISPLAY_STOP_OFF_TIMER and TOUCH_DISPLAY_START_OFF_TIMER for
+	what to do with OffTimer before Lock is released, and
+	TOUCH_DISPLAY_TRANSITION when a transition is to be started after
+
+--*/
+{
+	ULONG actions = 0;
+
+	if (State != TOUCH_DISPLAY_OFF && Display->OffPending)
+	{
+		//
+		// The timer routine checks OffPending, so a timer already firing
+		// does nothing either
+		//
+		Display->OffPending = FALSE;
+		Display->Cancelled++;
+		actions |= TOUCH_DISPLAY_STOP_OFF_TIMER;
+	}
+
+	switch (State)
+	{
+	case TOUCH_DISPLAY_ON:
+		InterlockedExchange(&Display->Requested, TOUCH_DISPLAY_ON);
+		actions |= TOUCH_DISPLAY_TRANSITION;
+		break;
+	case TOUCH_DISPLAY_OFF:
+		if (!Display->OffPending && Display->Requested != TOUCH_DISPLAY_OFF)
+		{
+			Display->OffPending = TRUE;
+			actions |= TOUCH_DISPLAY_START_OFF_TIMER;
+		}
+		break;
+	default:
+		break;
+	}
+
+	return actions;
+}
+
+BOOLEAN
+TchDisplayOffTimer(
+	IN OUT PTOUCH_DISPLAY_CONTEXT Display
+)
+/*++
+
+Routine Description:
+
+	Requests display off once OffTimer expired, with Lock held. A display
+	off cancelled while the timer was firing is not requested.
+
+Arguments:
+
+	Display - The display state
+
+Return Value:
+
+	TRUE when a transition is to be started
+
+--*/
+{
+	if (!Display->OffPending)
+	{
+		return FALSE;
+	}
+
+	Display->OffPending = FALSE;
+	InterlockedExchange(&Display->Requested, TOUCH_DISPLAY_OFF);
+
+	return TRUE;
+}
+
+VOID
+TchDisplayStop(
+	IN OUT PTOUCH_DISPLAY_CONTEXT Display
+)
+/*++
+
+Routine Description:
+
+	Stops starting transitions once the display state callback is
+	unregistered, with Lock held. A display off still debouncing is
+	dropped.
+
+Arguments:
+
+	Display - The display state
+
+Return Value:
+
+	None.
+
+--*/
+{
+	InterlockedExchange(&Display->Stopping, TRUE);
+
+	Display->OffPending = FALSE;
+}
+
+BOOLEAN
+TchDisplayAcquire(
+	IN OUT PTOUCH_DISPLAY_CONTEXT Display
+)
+/*++
+
+Routine Description:
+
+	Takes the display state for a transition, or for anything else that
+	must not run alongside one. Idle is cleared until the release.
+
+Arguments:
+
+	Display - The display state
+
+Return Value:
+
+	TRUE when taken, FALSE while a transition runs
+
+--*/
+{
+	if (InterlockedCompareExchange(&Display->Busy, TRUE, FALSE) != FALSE)
+	{
+		return FALSE;
+	}
+
+	KeClearEvent(&Display->Idle);
+
+	return TRUE;
+}
+
+BOOLEAN
+TchDisplayRelease(
+	IN OUT PTOUCH_DISPLAY_CONTEXT Display
+)
+/*++
+
+Routine Description:
+
+	Releases the display state taken by TchDisplayAcquire
+
+Arguments:
+
+	Display - The display state
+
+Return Value:
+
+	TRUE when a state was requested meanwhile that is not applied, the
+	caller then starts another transition
+
+--*/
+{
+	//
+	// Idle is set first, so a transition started right after the release
+	// clears it again
+	//
+	KeSetEvent(&Display->Idle, IO_NO_INCREMENT, FALSE);
+	InterlockedExchange(&Display->Busy, FALSE);
+
+	//
+	// A request made before the release was not seen by its caller as
+	// startable, so check again
+	//
+	return !Display->Stopping && Display->Requested != Display->Applied;
+}
+
+BOOLEAN
+TchDisplayBeginTransition(
+	IN OUT PTOUCH_DISPLAY_CONTEXT Display
+)
+/*++
+
+Routine Description:
+
+	Begins a transition to the requested display state, unless one is
+	running already or the requested state is applied. On success the
+	caller toggles the rail to Target and ends the transition with
+	TchDisplayEndTransition.
+
+Arguments:
+
+	Display - The display state
+
+Return Value:
+
+	TRUE when a transition to Target began
+
+--*/
+{
+	LONG state;
+
+	for (;;)
+	{
+		if (!TchDisplayAcquire(Display))
+		{
+			//
+			// The running transition picks the request up when it ends
+			//
+			return FALSE;
+		}
+
+		state = Display->Requested;
+
+		if (!Display->Stopping && state != Display->Applied)
+		{
+			break;
+		}
+
+		if (!Display->Stopping)
+		{
+			InterlockedIncrement(&Display->Skipped);
+		}
+
+		if (!TchDisplayRelease(Display))
+		{
+			return FALSE;
+		}
+	}
+
+	Display->Target = state;
+	Display->StartTime = KeQueryInterruptTime();
+	Display->RailStatus = STATUS_SUCCESS;
+	Display->RailLatency = 0;
+
+	return TRUE;
+}
+
+VOID
+TchDisplayEndTransition(
+	IN OUT PTOUCH_DISPLAY_CONTEXT Display,
+	IN NTSTATUS Status
+)
+/*++
+
+Routine Description:
+
+	Accounts a transition once the controller is configured for Target.
+	The display state is still held, TchDisplayRelease tells whether to
+	begin the next.
+
+Arguments:
+
+	Display - The display state
+
+	Status - Status of the transition
+
+Return Value:
+
+	None.
+
+--*/
+{
+	//
+	// A failed transition is not retried, the next display state change
+	// gets another go
+	//
+	Display->Applied = Display->Target;
+	Display->Latency = (ULONG)((KeQueryInterruptTime() - Display->StartTime) / 10);
+	Display->MaxLatency = max(Display->MaxLatency, Display->Latency);
+	Display->Transitions++;
+
+	if (!NT_SUCCESS(Status))
+	{
+		Display->Failures++;
+	}
+}
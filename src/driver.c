@@ -25,6 +25,7 @@
 #include <device.h>
 #include <hid.h>
 #include <queue.h>
+#include <idle.h>
 #include <selftest\selftest.h>
 #include <selftest\enoselftest.h>
 #include <driver.h>
@@ -132,6 +133,8 @@ Return Value:
     PDEVICE_EXTENSION devContext;
     WDFDEVICE fxDevice;
     WDF_INTERRUPT_CONFIG interruptConfig;
+    WDF_WORKITEM_CONFIG workItemConfig;
+    WDF_TIMER_CONFIG timerConfig;
     WDF_PNPPOWER_EVENT_CALLBACKS pnpPowerCallbacks;
     WDF_IO_QUEUE_CONFIG queueConfig;
     NTSTATUS status;
@@ -265,6 +268,22 @@ Return Value:
         goto exit;
     }
 
+    //
+    // Create the work item idle callbacks are made from
+    //
+    status = TchIdleInitialize(fxDevice);
+
+    if (!NT_SUCCESS(status))
+    {
+        Trace(
+            TRACE_LEVEL_ERROR,
+            TRACE_INIT,
+            "Error initializing idle work item - 0x%08lX",
+            status);
+
+        goto exit;
+    }
+
     //
     // Create an interrupt object for hardware notifications
     //
@@ -291,6 +310,107 @@ Return Value:
         goto exit;
     }
 
+    //
+    // Create the work item servicing the controller after D0 entry
+    //
+    WDF_WORKITEM_CONFIG_INIT(&workItemConfig, OnD0EntryWorkItem);
+    WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+    attributes.ParentObject = fxDevice;
+
+    status = WdfWorkItemCreate(
+        &workItemConfig,
+        &attributes,
+        &devContext->D0EntryWorkItem);
+
+    if (!NT_SUCCESS(status))
+    {
+        Trace(
+            TRACE_LEVEL_ERROR,
+            TRACE_INIT,
+            "Error creating D0 entry work item - 0x%08lX",
+            status);
+
+        goto exit;
+    }
+
+    //
+    // Create the doze timer. It takes the passive interrupt lock, so it
+    // runs at passive level.
+    //
+    WDF_TIMER_CONFIG_INIT(&timerConfig, OnDozeTimer);
+    timerConfig.AutomaticSerialization = FALSE;
+    WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+    attributes.ParentObject = fxDevice;
+    attributes.ExecutionLevel = WdfExecutionLevelPassive;
+
+    status = WdfTimerCreate(
+        &timerConfig,
+        &attributes,
+        &devContext->DozeTimer);
+
+    if (!NT_SUCCESS(status))
+    {
+        Trace(
+            TRACE_LEVEL_ERROR,
+            TRACE_INIT,
+            "Error creating doze timer - 0x%08lX",
+            status);
+
+        goto exit;
+    }
+
+    //
+    // Create the work item finishing display state transitions
+    //
+    WDF_WORKITEM_CONFIG_INIT(&workItemConfig, OnDisplayStateWorkItem);
+    WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+    attributes.ParentObject = fxDevice;
+
+    status = WdfWorkItemCreate(
+        &workItemConfig,
+        &attributes,
+        &devContext->Display.WorkItem);
+
+    if (!NT_SUCCESS(status))
+    {
+        Trace(
+            TRACE_LEVEL_ERROR,
+            TRACE_INIT,
+            "Error creating display state work item - 0x%08lX",
+            status);
+
+        goto exit;
+    }
+
+    //
+    // Create the timer debouncing display off
+    //
+    WDF_TIMER_CONFIG_INIT(&timerConfig, OnDisplayOffTimer);
+    WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+    attributes.ParentObject = fxDevice;
+
+    status = WdfTimerCreate(
+        &timerConfig,
+        &attributes,
+        &devContext->Display.OffTimer);
+
+    if (!NT_SUCCESS(status))
+    {
+        Trace(
+            TRACE_LEVEL_ERROR,
+            TRACE_INIT,
+            "Error creating display off timer - 0x%08lX",
+            status);
+
+        goto exit;
+    }
+
+    KeInitializeEvent(&devContext->Display.Idle, NotificationEvent, TRUE);
+
+    PowerStatsInitialize(&devContext->PowerStats);
+    KeInitializeSpinLock(&devContext->Display.Lock);
+    ExInitializeRundownProtection(&devContext->TouchPowerContext.TargetRundown);
+
     //
     // Initialize driver path for self-test
     //
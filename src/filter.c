@@ -0,0 +1,227 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		filter.c
+
+	Abstract:
+
+		Adaptive low pass filter for contact positions, of the one euro
+		kind: the cutoff frequency rises with the contact speed, so resting
+		contacts are smoothed heavily and moving ones lag very little.
+		All math is fixed point and state is kept per slot.
+
+	Environment:
+
+		Kernel mode
+
+	Revision History:
+
+--*/
+
+#include <filter.h>
+
+//
+// 10000 ticks of 100us per second, 1000 mHz per Hz, over 2 pi
+//
+#define FILTER_TAU_NUMERATOR       1591549
+
+//
+// Keeps the speed term from overflowing the cutoff
+//
+#define FILTER_MAX_CUTOFF_MHZ      1000000
+
+VOID
+FilterConfigure(
+	IN PFILTER_CONTEXT Context,
+	IN ULONG Strength
+)
+/*++
+
+Routine Description:
+
+	Sets the filter up from the AbsPosFilt controller setting. Zero turns
+	filtering off, otherwise the resting cutoff is divided by the value.
+
+Arguments:
+
+	Context - The filter context to configure
+
+	Strength - AbsPosFilt value
+
+Return Value:
+
+	None.
+
+--*/
+{
+	FilterReset(Context);
+
+	Context->Enabled = (Strength != 0);
+	Context->MinCutoff = Strength != 0 ? max(FILTER_MIN_CUTOFF_MHZ / Strength, 1) : 0;
+	Context->Beta = FILTER_BETA;
+	Context->DerivativeCutoff = FILTER_DERIVATIVE_CUTOFF;
+}
+
+VOID
+FilterResetSlot(
+	IN PFILTER_SLOT Slot
+)
+/*++
+
+Routine Description:
+
+	Forgets the state of a slot, e.g. once its contact lifted
+
+Arguments:
+
+	Slot - The slot to reset
+
+Return Value:
+
+	None.
+
+--*/
+{
+	RtlZeroMemory(Slot, sizeof(FILTER_SLOT));
+}
+
+VOID
+FilterReset(
+	IN PFILTER_CONTEXT Context
+)
+/*++
+
+Routine Description:
+
+	Forgets the state of all slots, the configuration is kept
+
+Arguments:
+
+	Context - The filter context to reset
+
+Return Value:
+
+	None.
+
+--*/
+{
+	RtlZeroMemory(Context->Slot, sizeof(Context->Slot));
+}
+
+static
+LONG
+FilterAlpha(
+	IN ULONG Cutoff,
+	IN ULONG Elapsed
+)
+{
+	//
+	// alpha = 1 / (1 + tau / dt), in Q16
+	//
+	ULONG tau = FILTER_TAU_NUMERATOR / Cutoff;
+
+	return (LONG)(((LONG64)Elapsed << 16) / ((LONG64)Elapsed + tau));
+}
+
+static
+LONG
+FilterSmooth(
+	IN LONG Previous,
+	IN LONG Value,
+	IN LONG Alpha
+)
+{
+	return Previous + (LONG)(((LONG64)(Value - Previous) * Alpha) / 65536);
+}
+
+VOID
+FilterPosition(
+	IN PFILTER_CONTEXT Context,
+	IN PFILTER_SLOT Slot,
+	IN ULONG Time,
+	IN OUT PLONG X,
+	IN OUT PLONG Y
+)
+/*++
+
+Routine Description:
+
+	Filters the position of a contact in a new frame. The first sample of a
+	contact passes through unchanged.
+
+Arguments:
+
+	Context - The filter context holding the tuning
+
+	Slot - The slot the contact is tracked in
+
+	Time - Scan time of the frame in 100us units
+
+	X - In the measured X coordinate, out the filtered one
+
+	Y - In the measured Y coordinate, out the filtered one
+
+Return Value:
+
+	None.
+
+--*/
+{
+	LONG x = *X << FILTER_POSITION_BITS;
+	LONG y = *Y << FILTER_POSITION_BITS;
+	LONG64 distance;
+	ULONG elapsed;
+	ULONG cutoff;
+	LONG speed;
+	LONG alpha;
+
+	if (!Context->Enabled)
+	{
+		return;
+	}
+
+	elapsed = Time - Slot->Time;
+
+	if (!Slot->Valid || elapsed > FILTER_MAX_SAMPLE_GAP)
+	{
+		Slot->Valid = TRUE;
+		Slot->Time = Time;
+		Slot->X = x;
+		Slot->Y = y;
+		Slot->Speed = 0;
+		return;
+	}
+
+	//
+	// When the same frame is reported again the filtered position is kept
+	//
+	if (elapsed != 0)
+	{
+		//
+		// Speed in pixels per second, taken against the filtered position
+		// and smoothed with a fixed cutoff
+		//
+		distance = (LONG64)(x > Slot->X ? x - Slot->X : Slot->X - x) +
+			(LONG64)(y > Slot->Y ? y - Slot->Y : Slot->Y - y);
+		speed = (LONG)((distance * 10000 / elapsed) >> FILTER_POSITION_BITS);
+
+		Slot->Speed = FilterSmooth(
+			Slot->Speed,
+			speed,
+			FilterAlpha(Context->DerivativeCutoff, elapsed));
+
+		cutoff = (ULONG)min((ULONG64)Context->MinCutoff + (ULONG64)Context->Beta * (ULONG)Slot->Speed,
+			FILTER_MAX_CUTOFF_MHZ);
+
+		alpha = FilterAlpha(cutoff, elapsed);
+
+		Slot->X = FilterSmooth(Slot->X, x, alpha);
+		Slot->Y = FilterSmooth(Slot->Y, y, alpha);
+		Slot->Time = Time;
+	}
+
+	*X = (Slot->X + (1 << (FILTER_POSITION_BITS - 1))) >> FILTER_POSITION_BITS;
+	*Y = (Slot->Y + (1 << (FILTER_POSITION_BITS - 1))) >> FILTER_POSITION_BITS;
+}
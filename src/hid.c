@@ -25,6 +25,7 @@
 #include <controller.h>
 #include <hx85x\hxinternal.h>
 #include <hid.h>
+#include <device.h>
 #include <hid.tmh>
 
 const USHORT gOEMVendorID = 0x6674;    // "ft"
@@ -36,20 +37,83 @@ const PWSTR gpwstrProductID = L"8526";
 const PWSTR gpwstrSerialNumber = L"8526";
 
 //
-// HID Report Descriptor for a touch device
+// HID Report Descriptor for a touch device, as literal byte runs
 //
 
-const UCHAR gReportDescriptor[] = {
+static const UCHAR gDiagnosticCollections[] = {
 	HIMAX_HX85X_DIGITIZER_DIAGNOSTIC1,
 	HIMAX_HX85X_DIGITIZER_DIAGNOSTIC2,
 	HIMAX_HX85X_DIGITIZER_DIAGNOSTIC3,
-	HIMAX_HX85X_DIGITIZER_DIAGNOSTIC4,
-	HIMAX_HX85X_DIGITIZER_FINGER,
-	HIMAX_HX85X_DIGITIZER_REPORTMODE,
-	HIMAX_HX85X_DIGITIZER_KEYPAD,
-	HIMAX_HX85X_DIGITIZER_STYLUS
+	HIMAX_HX85X_DIGITIZER_DIAGNOSTIC4
+};
+
+static const UCHAR gFingerHead[] = { HIMAX_HX85X_DIGITIZER_FINGER_HEAD };
+static const UCHAR gFingerContact1Head[] = { HIMAX_HX85X_DIGITIZER_FINGER_CONTACT_1_HEAD };
+static const UCHAR gFingerContact1Y[] = { HIMAX_HX85X_DIGITIZER_FINGER_CONTACT_1_Y };
+static const UCHAR gFingerContact2Head[] = { HIMAX_HX85X_DIGITIZER_FINGER_CONTACT_2_HEAD };
+static const UCHAR gFingerContact2X[] = { HIMAX_HX85X_DIGITIZER_FINGER_CONTACT_2_X };
+static const UCHAR gFingerContact2Y[] = { HIMAX_HX85X_DIGITIZER_FINGER_CONTACT_2_Y };
+static const UCHAR gFingerContactTail[] = { HIMAX_HX85X_DIGITIZER_FINGER_CONTACT_TAIL };
+static const UCHAR gFingerContactCount[] = { HIMAX_HX85X_DIGITIZER_FINGER_CONTACT_COUNT };
+static const UCHAR gFingerTail[] = { HIMAX_HX85X_DIGITIZER_FINGER_TAIL };
+static const UCHAR gReportModeHead[] = { HIMAX_HX85X_DIGITIZER_REPORTMODE_HEAD };
+static const UCHAR gReportModeTail[] = { HIMAX_HX85X_DIGITIZER_REPORTMODE_TAIL };
+static const UCHAR gKeypadCollection[] = { HIMAX_HX85X_DIGITIZER_KEYPAD };
+static const UCHAR gStylusHead[] = { HIMAX_HX85X_DIGITIZER_STYLUS_HEAD };
+static const UCHAR gStylusContact1Head[] = { HIMAX_HX85X_DIGITIZER_STYLUS_CONTACT_1_HEAD };
+static const UCHAR gStylusContact1Y[] = { HIMAX_HX85X_DIGITIZER_STYLUS_CONTACT_1_Y };
+static const UCHAR gStylusContact1Tail[] = { HIMAX_HX85X_DIGITIZER_STYLUS_CONTACT_1_TAIL };
+static const UCHAR gStylusTail[] = { HIMAX_HX85X_DIGITIZER_STYLUS_TAIL };
+
+//
+// First finger contact, carries the unit globals for the following ones
+//
+static const HID_DESCRIPTOR_SEGMENT gFingerContact1Segments[] = {
+	HID_SEGMENT_BYTES(gFingerContact1Head),
+	HID_SEGMENT_VALUE(HidDescriptorLogicalMaximumX),
+	HID_SEGMENT_VALUE(HidDescriptorPhysicalMaximumX),
+	HID_SEGMENT_BYTES(gFingerContact1Y),
+	HID_SEGMENT_VALUE(HidDescriptorLogicalMaximumY),
+	HID_SEGMENT_VALUE(HidDescriptorPhysicalMaximumY),
+	HID_SEGMENT_BYTES(gFingerContactTail)
+};
+
+//
+// Every further finger contact
+//
+static const HID_DESCRIPTOR_SEGMENT gFingerContactNSegments[] = {
+	HID_SEGMENT_BYTES(gFingerContact2Head),
+	HID_SEGMENT_VALUE(HidDescriptorPhysicalMaximumY),
+	HID_SEGMENT_BYTES(gFingerContact2X),
+	HID_SEGMENT_VALUE(HidDescriptorLogicalMaximumX),
+	HID_SEGMENT_VALUE(HidDescriptorPhysicalMaximumX),
+	HID_SEGMENT_BYTES(gFingerContact2Y),
+	HID_SEGMENT_VALUE(HidDescriptorLogicalMaximumY),
+	HID_SEGMENT_VALUE(HidDescriptorPhysicalMaximumY),
+	HID_SEGMENT_BYTES(gFingerContactTail)
+};
+
+static const HID_DESCRIPTOR_SEGMENT gReportDescriptorSegments[] = {
+	HID_SEGMENT_BYTES(gDiagnosticCollections),
+	HID_SEGMENT_BYTES(gFingerHead),
+	HID_SEGMENT_VALUE(HidDescriptorFingerContacts),
+	HID_SEGMENT_BYTES(gFingerContactCount),
+	HID_SEGMENT_VALUE(HidDescriptorMaximumContacts),
+	HID_SEGMENT_BYTES(gFingerTail),
+	HID_SEGMENT_BYTES(gReportModeHead),
+	HID_SEGMENT_VALUE(HidDescriptorPhysicalMaximumY),
+	HID_SEGMENT_BYTES(gReportModeTail),
+	HID_SEGMENT_BYTES(gKeypadCollection),
+	HID_SEGMENT_BYTES(gStylusHead),
+	HID_SEGMENT_BYTES(gStylusContact1Head),
+	HID_SEGMENT_VALUE(HidDescriptorLogicalMaximumX),
+	HID_SEGMENT_VALUE(HidDescriptorPhysicalMaximumX),
+	HID_SEGMENT_BYTES(gStylusContact1Y),
+	HID_SEGMENT_VALUE(HidDescriptorLogicalMaximumY),
+	HID_SEGMENT_VALUE(HidDescriptorPhysicalMaximumY),
+	HID_SEGMENT_BYTES(gStylusContact1Tail),
+	HID_SEGMENT_BYTES(gStylusTail)
 };
-const ULONG gdwcbReportDescriptor = sizeof(gReportDescriptor);
 
 //
 // HID Descriptor for a touch device
@@ -63,7 +127,7 @@ const HID_DESCRIPTOR gHidDescriptor =
 	1,                                  //bNumDescriptors
 	{                                   //DescriptorList[0]
 		HID_REPORT_DESCRIPTOR_TYPE,     //bReportType
-		sizeof(gReportDescriptor)       //wReportLength
+		0                               //wReportLength, see TchGetHidDescriptor
 	}
 };
 
@@ -162,6 +226,17 @@ TchSendReport(
 	}
 	}
 
+#ifdef _TIMESTAMP_
+	//
+	// Reports not tied to a controller frame (pen, keypad, wake) are
+	// stamped when they are sent
+	//
+	if (hidReportFromDriver->TimeStamp.QuadPart == 0)
+	{
+		hidReportFromDriver->TimeStamp.QuadPart = (LONGLONG)KeQueryInterruptTime();
+	}
+#endif
+
 	//
 	// Complete a HIDClass request if one is available
 	//
@@ -284,17 +359,10 @@ Return Value:
 
 	//
 	// Service any interrupt that may have asserted while the framework had
-	// interrupts disabled, or occurred before a read request was queued.
+	// interrupts disabled, or occurred before a read request was queued,
+	// unless the D0 entry work item got to it first.
 	//
-	if (devContext->ServiceInterruptsAfterD0Entry == TRUE)
-	{
-		Hx85xServiceInterrupts(
-			devContext->TouchContext,
-			&devContext->I2CContext,
-			&devContext->ReportContext);
-
-		devContext->ServiceInterruptsAfterD0Entry = FALSE;
-	}
+	TchServiceAfterD0Entry(devContext);
 
 exit:
 
@@ -383,98 +451,277 @@ Return Value:
 	return status;
 }
 
+static
 NTSTATUS
-TchGenerateHidReportDescriptor(
-	IN WDFDEVICE Device,
-	IN WDFMEMORY Memory
+TchAppendHidDescriptorSegments(
+	IN     PHID_REPORT_DESCRIPTOR_PARAMETERS Parameters,
+	IN     const HID_DESCRIPTOR_SEGMENT* Segments,
+	IN     ULONG SegmentCount,
+	OUT    PUCHAR Buffer,
+	IN     ULONG BufferLength,
+	IN OUT PULONG Offset
 )
-{
-	PDEVICE_EXTENSION devContext;
-	HX85X_CONTROLLER_CONTEXT* touchContext;
-	NTSTATUS status;
+/*++
 
-	devContext = GetDeviceContext(Device);
+Routine Description:
 
-	touchContext = (HX85X_CONTROLLER_CONTEXT*)devContext->TouchContext;
+	Appends a list of descriptor segments to the buffer, emitting the value
+	items from the supplied parameters.
 
-	PUCHAR hidReportDescBuffer = (PUCHAR)ExAllocatePoolWithTag(
-		NonPagedPool,
-		gdwcbReportDescriptor,
-		TOUCH_POOL_TAG
-	);
+Arguments:
 
-	if (hidReportDescBuffer == NULL)
-	{
-		Trace(
-			TRACE_LEVEL_INFORMATION,
-			TRACE_HID,
-			"Failed to create hidReportDescBuffer on %p",
-			hidReportDescBuffer);
+	Parameters - Panel and contact layout the descriptor is built for
 
-		return STATUS_FATAL_MEMORY_EXHAUSTION;
-	}
+	Segments - Segment table to emit
+
+	SegmentCount - Number of entries in the segment table
+
+	Buffer - Destination buffer
+
+	BufferLength - Size of the destination buffer in bytes
 
-	RtlCopyBytes(
-		hidReportDescBuffer,
-		gReportDescriptor,
-		gdwcbReportDescriptor
-	);
+	Offset - Current write position, updated on return
 
-	for (unsigned int i = 0; i < gdwcbReportDescriptor - 2; i++)
+Return Value:
+
+	NTSTATUS indicating success or failure
+
+--*/
+{
+	UCHAR item[3];
+	ULONG itemLength;
+	ULONG contact;
+	ULONG i;
+	NTSTATUS status = STATUS_SUCCESS;
+
+	for (i = 0; i < SegmentCount; i++)
 	{
-		if (*(hidReportDescBuffer + i) == LOGICAL_MAXIMUM_2)
+		itemLength = 0;
+
+		switch (Segments[i].Value)
 		{
-			if (*(hidReportDescBuffer + i + 1) == 0xFE &&
-				*(hidReportDescBuffer + i + 2) == 0xFE)
+		case HidDescriptorBytes:
+			if (Segments[i].Length > BufferLength - *Offset)
 			{
-				*(hidReportDescBuffer + i + 1) = devContext->ReportContext.Props.DisplayPhysicalWidth & 0xFF;
-				*(hidReportDescBuffer + i + 2) = (devContext->ReportContext.Props.DisplayPhysicalWidth >> 8) & 0xFF;
+				status = STATUS_BUFFER_TOO_SMALL;
+				goto exit;
 			}
-			if (*(hidReportDescBuffer + i + 1) == 0xFD &&
-				*(hidReportDescBuffer + i + 2) == 0xFD)
+
+			RtlCopyMemory(Buffer + *Offset, Segments[i].Bytes, Segments[i].Length);
+			*Offset += Segments[i].Length;
+			break;
+
+		case HidDescriptorLogicalMaximumX:
+			item[0] = LOGICAL_MAXIMUM_2;
+			item[1] = Parameters->LogicalMaximumX & 0xFF;
+			item[2] = (Parameters->LogicalMaximumX >> 8) & 0xFF;
+			itemLength = 3;
+			break;
+
+		case HidDescriptorLogicalMaximumY:
+			item[0] = LOGICAL_MAXIMUM_2;
+			item[1] = Parameters->LogicalMaximumY & 0xFF;
+			item[2] = (Parameters->LogicalMaximumY >> 8) & 0xFF;
+			itemLength = 3;
+			break;
+
+		case HidDescriptorPhysicalMaximumX:
+			item[0] = PHYSICAL_MAXIMUM_2;
+			item[1] = Parameters->PhysicalMaximumX & 0xFF;
+			item[2] = (Parameters->PhysicalMaximumX >> 8) & 0xFF;
+			itemLength = 3;
+			break;
+
+		case HidDescriptorPhysicalMaximumY:
+			item[0] = PHYSICAL_MAXIMUM_2;
+			item[1] = Parameters->PhysicalMaximumY & 0xFF;
+			item[2] = (Parameters->PhysicalMaximumY >> 8) & 0xFF;
+			itemLength = 3;
+			break;
+
+		case HidDescriptorMaximumContacts:
+			item[0] = LOGICAL_MAXIMUM;
+			item[1] = (UCHAR)Parameters->MaximumContacts;
+			itemLength = 2;
+			break;
+
+		case HidDescriptorFingerContacts:
+			//
+			// The first contact declares the unit globals, every following
+			// one is preceded by an undefined usage and reuses them
+			//
+			status = TchAppendHidDescriptorSegments(
+				Parameters,
+				gFingerContact1Segments,
+				ARRAYSIZE(gFingerContact1Segments),
+				Buffer,
+				BufferLength,
+				Offset);
+
+			for (contact = 1; NT_SUCCESS(status) && contact < Parameters->ContactsPerReport; contact++)
 			{
-				*(hidReportDescBuffer + i + 1) = devContext->ReportContext.Props.DisplayPhysicalHeight & 0xFF;
-				*(hidReportDescBuffer + i + 2) = (devContext->ReportContext.Props.DisplayPhysicalHeight >> 8) & 0xFF;
+				status = TchAppendHidDescriptorSegments(
+					Parameters,
+					gFingerContactNSegments,
+					ARRAYSIZE(gFingerContactNSegments),
+					Buffer,
+					BufferLength,
+					Offset);
 			}
-		}
-		else if (*(hidReportDescBuffer + i) == PHYSICAL_MAXIMUM_2)
-		{
-			if (*(hidReportDescBuffer + i + 1) == 0xFE &&
-				*(hidReportDescBuffer + i + 2) == 0xFE)
+
+			if (!NT_SUCCESS(status))
 			{
-				*(hidReportDescBuffer + i + 1) = devContext->ReportContext.Props.DisplayWidth10um & 0xFF;
-				*(hidReportDescBuffer + i + 2) = (devContext->ReportContext.Props.DisplayWidth10um >> 8) & 0xFF;
+				goto exit;
 			}
-			if (*(hidReportDescBuffer + i + 1) == 0xFD &&
-				*(hidReportDescBuffer + i + 2) == 0xFD)
+			break;
+
+		default:
+			status = STATUS_INVALID_PARAMETER;
+			goto exit;
+		}
+
+		if (itemLength != 0)
+		{
+			if (itemLength > BufferLength - *Offset)
 			{
-				*(hidReportDescBuffer + i + 1) = devContext->ReportContext.Props.DisplayHeight10um & 0xFF;
-				*(hidReportDescBuffer + i + 2) = (devContext->ReportContext.Props.DisplayHeight10um >> 8) & 0xFF;
+				status = STATUS_BUFFER_TOO_SMALL;
+				goto exit;
 			}
+
+			RtlCopyMemory(Buffer + *Offset, item, itemLength);
+			*Offset += itemLength;
 		}
 	}
 
-	//
-	// Use hardcoded Report descriptor
-	//
-	status = WdfMemoryCopyFromBuffer(
-		Memory,
-		0,
-		(PVOID)hidReportDescBuffer,
-		gdwcbReportDescriptor);
+exit:
+	return status;
+}
+
+NTSTATUS
+TchBuildHidReportDescriptor(
+	IN  PHID_REPORT_DESCRIPTOR_PARAMETERS Parameters,
+	OUT PUCHAR Buffer,
+	IN  ULONG BufferLength,
+	OUT PULONG DescriptorLength
+)
+/*++
+
+Routine Description:
+
+	Builds the HID report descriptor for the given panel and contact layout
+	from the segment table. No byte of the literal runs is inspected, so the
+	axis and contact values may take any value.
+
+Arguments:
+
+	Parameters - Panel and contact layout the descriptor is built for
+
+	Buffer - Destination buffer
+
+	BufferLength - Size of the destination buffer in bytes
+
+	DescriptorLength - Receives the size of the generated descriptor
+
+Return Value:
+
+	NTSTATUS indicating success or failure
+
+--*/
+{
+	ULONG offset = 0;
+	NTSTATUS status;
+
+	*DescriptorLength = 0;
+
+	if (Parameters->ContactsPerReport == 0 ||
+		Parameters->MaximumContacts == 0 ||
+		Parameters->MaximumContacts > 0x7F)
+	{
+		status = STATUS_INVALID_PARAMETER;
+		goto exit;
+	}
+
+	status = TchAppendHidDescriptorSegments(
+		Parameters,
+		gReportDescriptorSegments,
+		ARRAYSIZE(gReportDescriptorSegments),
+		Buffer,
+		BufferLength,
+		&offset);
+
+	if (NT_SUCCESS(status))
+	{
+		*DescriptorLength = offset;
+	}
+
+exit:
+	return status;
+}
+
+NTSTATUS
+TchGenerateHidReportDescriptor(
+	IN WDFDEVICE Device
+)
+/*++
+
+Routine Description:
+
+	Builds the report descriptor for the current screen properties and
+	caches it in the device context. Called once from prepare hardware,
+	after the screen properties have been read.
+
+Arguments:
+
+	Device - Handle to WDF Device Object
+
+Return Value:
+
+	NTSTATUS indicating success or failure
+
+--*/
+{
+	PDEVICE_EXTENSION devContext;
+	HID_REPORT_DESCRIPTOR_PARAMETERS parameters;
+	const TOUCH_SCREEN* screen;
+	LONG ticket;
+	NTSTATUS status;
+
+	devContext = GetDeviceContext(Device);
+
+	screen = TchAcquireScreen(&devContext->ReportContext.Screen, &ticket);
+
+	parameters.ContactsPerReport = HID_TOUCH_REPORT_CONTACTS;
+	parameters.MaximumContacts = HID_TOUCH_REPORT_CONTACTS;
+	parameters.LogicalMaximumX = (USHORT)screen->Props.DisplayPhysicalWidth;
+	parameters.LogicalMaximumY = (USHORT)screen->Props.DisplayPhysicalHeight;
+	parameters.PhysicalMaximumX = (USHORT)screen->Props.DisplayWidth10um;
+	parameters.PhysicalMaximumY = (USHORT)screen->Props.DisplayHeight10um;
+
+	TchReleaseScreen(&devContext->ReportContext.Screen, ticket);
+
+	status = TchBuildHidReportDescriptor(
+		&parameters,
+		devContext->ReportDescriptor,
+		sizeof(devContext->ReportDescriptor),
+		&devContext->ReportDescriptorLength);
 
 	if (!NT_SUCCESS(status))
 	{
 		Trace(
 			TRACE_LEVEL_ERROR,
 			TRACE_HID,
-			"Error copying HID report descriptor to request memory - STATUS:%X",
+			"Error building HID report descriptor - 0x%08lX",
 			status);
 		goto exit;
 	}
 
+	Trace(
+		TRACE_LEVEL_INFORMATION,
+		TRACE_HID,
+		"Built HID report descriptor of %d bytes",
+		devContext->ReportDescriptorLength);
+
 exit:
-	ExFreePoolWithTag((PVOID)hidReportDescBuffer, TOUCH_POOL_TAG);
 	return status;
 }
 
@@ -502,10 +749,18 @@ Return Value:
 
 --*/
 {
+	PDEVICE_EXTENSION devContext;
+	HID_DESCRIPTOR hidDescriptor;
 	WDFMEMORY memory;
 	NTSTATUS status;
 
-	UNREFERENCED_PARAMETER(Device);
+	devContext = GetDeviceContext(Device);
+
+	if (devContext->ReportDescriptorLength == 0)
+	{
+		status = STATUS_DEVICE_NOT_READY;
+		goto exit;
+	}
 
 	//
 	// This IOCTL is METHOD_NEITHER so WdfRequestRetrieveOutputMemory
@@ -529,13 +784,17 @@ Return Value:
 	}
 
 	//
-	// Use hardcoded global HID Descriptor
+	// Use the global HID Descriptor with the length of the cached
+	// report descriptor
 	//
+	hidDescriptor = gHidDescriptor;
+	hidDescriptor.DescriptorList[0].wReportLength = (USHORT)devContext->ReportDescriptorLength;
+
 	status = WdfMemoryCopyFromBuffer(
 		memory,
 		0,
-		(PUCHAR) &gHidDescriptor,
-		sizeof(gHidDescriptor));
+		(PUCHAR) &hidDescriptor,
+		sizeof(hidDescriptor));
 
 	if (!NT_SUCCESS(status))
 	{
@@ -550,7 +809,7 @@ Return Value:
 	//
 	// Report how many bytes were copied
 	//
-	WdfRequestSetInformation(Request, sizeof(gHidDescriptor));
+	WdfRequestSetInformation(Request, sizeof(hidDescriptor));
 
 exit:
 
@@ -566,8 +825,8 @@ TchGetReportDescriptor(
 
 Routine Description:
 
-	Finds the report descriptor and copies it into the buffer provided by the
-	Request.
+	Copies the report descriptor cached at prepare hardware time into the
+	buffer provided by the Request.
 
 Arguments:
 
@@ -581,12 +840,22 @@ Return Value:
 	 success - STATUS_SUCCESS
 	 failure:
 	 STATUS_INVALID_PARAMETER - An invalid parameter was detected.
+	 STATUS_DEVICE_NOT_READY - The descriptor has not been built yet.
 
 --*/
 {
+	PDEVICE_EXTENSION devContext;
 	WDFMEMORY memory;
 	NTSTATUS status;
 
+	devContext = GetDeviceContext(Device);
+
+	if (devContext->ReportDescriptorLength == 0)
+	{
+		status = STATUS_DEVICE_NOT_READY;
+		goto exit;
+	}
+
 	//
 	// This IOCTL is METHOD_NEITHER so WdfRequestRetrieveOutputMemory
 	// will correctly retrieve buffer from Irp->UserBuffer. 
@@ -608,13 +877,11 @@ Return Value:
 		goto exit;
 	}
 
-	//
-	// Use hardcoded Report descriptor
-	//
-	status = TchGenerateHidReportDescriptor(
-		Device,
-		memory
-	);
+	status = WdfMemoryCopyFromBuffer(
+		memory,
+		0,
+		devContext->ReportDescriptor,
+		devContext->ReportDescriptorLength);
 
 	if (!NT_SUCCESS(status))
 	{
@@ -629,7 +896,7 @@ Return Value:
 	//
 	// Report how many bytes were copied
 	//
-	WdfRequestSetInformation(Request, gdwcbReportDescriptor);
+	WdfRequestSetInformation(Request, devContext->ReportDescriptorLength);
 
 exit:
 
@@ -0,0 +1,539 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		hxdoze.c
+
+	Abstract:
+
+		Doze governor. Once no contact was down for DozeHoldoff the
+		controller is put into a low power sensing mode, by the doze enter
+		sequence or else by polling it every DozeInterval, and the first
+		frame with a contact brings it back to full rate. Entry and the
+		scan windows are driven by a timer owned by the device, exit by
+		the interrupt path.
+
+	Environment:
+
+		Kernel mode
+
+	Revision History:
+
+--*/
+
+#include <Cross Platform Shim\compat.h>
+#include <spb.h>
+#include <hx85x\hxinternal.h>
+#include <hxdoze.tmh>
+
+VOID
+Hx85xDozeConfigure(
+	IN OUT HX85X_DOZE* Doze,
+	IN ULONG Holdoff,
+	IN ULONG Interval,
+	IN ULONG Threshold,
+	IN HX85X_SEQUENCE* Sequences
+)
+/*++
+
+Routine Description:
+
+	Sets the governor up from the doze settings. It polls when there is
+	no doze enter sequence, and stays off when the holdoff is 0 or when
+	polling with an interval of 0.
+
+Arguments:
+
+	Doze - The doze state
+
+	Holdoff - DozeHoldoff value, in half seconds
+
+	Interval - DozeInterval value, in 10 ms
+
+	Threshold - DozeThreshold value, in milliseconds
+
+	Sequences - HX85X_SEQUENCE_COUNT sequences, loaded
+
+Return Value:
+
+	None.
+
+--*/
+{
+	RtlZeroMemory(Doze, sizeof(HX85X_DOZE));
+
+	Doze->Polled = Sequences[HX85X_SEQUENCE_DOZE_ENTER].Count == 0;
+	Doze->Interval = Interval * HX85X_DOZE_INTERVAL_UNIT_MS;
+	Doze->Window = max(Threshold, 1);
+	Doze->Sensing = TRUE;
+
+	if (!Doze->Polled || Doze->Interval != 0)
+	{
+		Doze->Holdoff = Holdoff * HX85X_DOZE_HOLDOFF_UNIT_MS;
+	}
+
+	Trace(
+		TRACE_LEVEL_INFORMATION,
+		TRACE_POWER,
+		"Doze governor %s, holdoff %lu ms, %s",
+		Doze->Holdoff != 0 ? "on" : "off",
+		Doze->Holdoff,
+		Doze->Polled ? "polled" : "doze sequences");
+
+	if (Doze->Polled)
+	{
+		Trace(
+			TRACE_LEVEL_INFORMATION,
+			TRACE_POWER,
+			"Doze scan windows of %lu ms every %lu ms",
+			Doze->Window,
+			Doze->Interval);
+	}
+}
+
+VOID
+Hx85xDozeStart(
+	IN OUT HX85X_DOZE* Doze,
+	IN ULONG64 Now
+)
+/*++
+
+Routine Description:
+
+	Starts the holdoff over once the controller is sensing again, e.g.
+	after D0 entry, as if a contact lifted just now. Hx85xDozeArm then
+	tells the holdoff to arm the doze timer with.
+
+Arguments:
+
+	Doze - The doze state
+
+	Now - Current interrupt time
+
+Return Value:
+
+	None.
+
+--*/
+{
+	Doze->Dozing = FALSE;
+	Doze->Contact = FALSE;
+	Doze->Sensing = TRUE;
+	Doze->Pending = Doze->Holdoff;
+	Doze->LiftTime = Now;
+}
+
+ULONG
+Hx85xDozeArm(
+	IN OUT HX85X_DOZE* Doze
+)
+/*++
+
+Routine Description:
+
+	Tells whether the doze timer needs arming after the doze state was
+	changed, e.g. when the last contact lifted in the frame serviced or
+	a scan window opened. Called with the same serialization as the
+	change.
+
+Arguments:
+
+	Doze - The doze state
+
+Return Value:
+
+	Time to arm the doze timer with in milliseconds, 0 when there is no
+	need to
+
+--*/
+{
+	ULONG pending = Doze->Pending;
+
+	Doze->Pending = 0;
+
+	return pending;
+}
+
+NTSTATUS
+Hx85xDozeTrackFrame(
+	IN OUT HX85X_DOZE* Doze,
+	IN HX85X_SEQUENCE* Sequences,
+	IN SPB_CONTEXT* SpbContext,
+	IN const DETECTED_OBJECTS* Data
+)
+/*++
+
+Routine Description:
+
+	Follows contacts across frames. A contact while dozing wakes the
+	controller up, the last contact lifting starts the holdoff. Called
+	from the interrupt path.
+
+Arguments:
+
+	Doze - The doze state
+
+	Sequences - HX85X_SEQUENCE_COUNT sequences
+
+	SpbContext - A pointer to the current i2c context
+
+	Data - The frame read from the controller
+
+Return Value:
+
+	NTSTATUS of the doze exit, STATUS_SUCCESS when there was none
+
+--*/
+{
+	NTSTATUS status = STATUS_SUCCESS;
+	BOOLEAN contact = FALSE;
+	ULONG i;
+
+	if (Doze->Holdoff == 0)
+	{
+		return STATUS_SUCCESS;
+	}
+
+	for (i = 0; i < MAX_TOUCHES; i++)
+	{
+		if (Data->States[i] != OBJECT_STATE_NOT_PRESENT)
+		{
+			contact = TRUE;
+			break;
+		}
+	}
+
+	if (contact && Doze->Dozing)
+	{
+		status = Hx85xDozeExit(Doze, Sequences, SpbContext, Data->Timestamp);
+	}
+
+	if (!contact && Doze->Contact)
+	{
+		Doze->Pending = Doze->Holdoff;
+		Doze->LiftTime = Data->Timestamp;
+	}
+
+	Doze->Contact = contact;
+
+	return status;
+}
+
+static
+NTSTATUS
+Hx85xDozeRunEnter(
+	IN OUT HX85X_DOZE* Doze,
+	IN HX85X_SEQUENCE* Sequences,
+	IN SPB_CONTEXT* SpbContext,
+	IN ULONG64 Now
+)
+{
+	NTSTATUS status;
+
+	//
+	// Polling starts with sensing off until the first scan window
+	//
+	status = Hx85xRunSequence(
+		Sequences,
+		Doze->Polled ? HX85X_SEQUENCE_SLEEP : HX85X_SEQUENCE_DOZE_ENTER,
+		SpbContext);
+
+	if (!NT_SUCCESS(status))
+	{
+		Trace(
+			TRACE_LEVEL_ERROR,
+			TRACE_POWER,
+			"Could not enter doze - 0x%08lX",
+			status);
+
+		return status;
+	}
+
+	if (Doze->Polled)
+	{
+		Doze->Sensing = FALSE;
+		Doze->Pending = Doze->Interval;
+	}
+
+	Doze->Dozing = TRUE;
+	Doze->EnterTime = Now;
+	Doze->Entries++;
+
+	return STATUS_SUCCESS;
+}
+
+static
+NTSTATUS
+Hx85xDozeScan(
+	IN OUT HX85X_DOZE* Doze,
+	IN HX85X_SEQUENCE* Sequences,
+	IN SPB_CONTEXT* SpbContext,
+	IN BOOLEAN Busy
+)
+{
+	NTSTATUS status;
+
+	//
+	// Opens a scan window while sensing is off, closes it otherwise. A
+	// contact in the window ends the doze before the window does, a wake
+	// gesture in progress keeps it open.
+	//
+	if (Doze->Sensing && Busy)
+	{
+		Doze->Pending = Doze->Window;
+
+		return STATUS_SUCCESS;
+	}
+
+	if (!Doze->Sensing)
+	{
+		status = Hx85xRunSequence(
+			Sequences,
+			HX85X_SEQUENCE_WAKE,
+			SpbContext);
+
+		if (NT_SUCCESS(status))
+		{
+			Doze->Sensing = TRUE;
+			Doze->Scans++;
+			Doze->Pending = Doze->Window;
+
+			return STATUS_SUCCESS;
+		}
+	}
+	else
+	{
+		status = Hx85xRunSequence(
+			Sequences,
+			HX85X_SEQUENCE_SLEEP,
+			SpbContext);
+
+		if (NT_SUCCESS(status))
+		{
+			Doze->Sensing = FALSE;
+		}
+	}
+
+	if (!NT_SUCCESS(status))
+	{
+		Trace(
+			TRACE_LEVEL_ERROR,
+			TRACE_POWER,
+			"Could not %s doze scan window - 0x%08lX",
+			Doze->Sensing ? "close" : "open",
+			status);
+	}
+
+	Doze->Pending = Doze->Interval;
+
+	return status;
+}
+
+NTSTATUS
+Hx85xDozeTimer(
+	IN OUT HX85X_DOZE* Doze,
+	IN HX85X_SEQUENCE* Sequences,
+	IN SPB_CONTEXT* SpbContext,
+	IN ULONG64 Now,
+	IN BOOLEAN Busy
+)
+/*++
+
+Routine Description:
+
+	Puts the controller into doze once the holdoff expired, and while
+	dozing polled opens and closes the scan windows. Called from the
+	doze timer, serialized with the interrupt path. Hx85xDozeArm then
+	tells when to call again.
+
+Arguments:
+
+	Doze - The doze state
+
+	Sequences - HX85X_SEQUENCE_COUNT sequences
+
+	SpbContext - A pointer to the current i2c context
+
+	Now - Current interrupt time
+
+	Busy - Set while a wake gesture is in progress, see
+		Hx85xGestureHoldScan
+
+Return Value:
+
+	NTSTATUS indicating success or failure
+
+--*/
+{
+	NTSTATUS status;
+
+	if (Doze->Dozing)
+	{
+		return Doze->Polled ? Hx85xDozeScan(Doze, Sequences, SpbContext, Busy) : STATUS_SUCCESS;
+	}
+
+	//
+	// A contact may have come and gone while the timer was firing
+	//
+	if (Doze->Holdoff == 0 ||
+		Doze->Contact ||
+		Now - Doze->LiftTime < (ULONG64)Doze->Holdoff * 10000)
+	{
+		return STATUS_SUCCESS;
+	}
+
+	status = Hx85xDozeRunEnter(Doze, Sequences, SpbContext, Now);
+
+	if (!NT_SUCCESS(status))
+	{
+		return status;
+	}
+
+	Trace(
+		TRACE_LEVEL_INFORMATION,
+		TRACE_POWER,
+		"Controller dozing, %lu ms after the last contact",
+		(ULONG)((Now - Doze->LiftTime) / 10000));
+
+	return STATUS_SUCCESS;
+}
+
+NTSTATUS
+Hx85xDozeLowPower(
+	IN OUT HX85X_DOZE* Doze,
+	IN HX85X_SEQUENCE* Sequences,
+	IN SPB_CONTEXT* SpbContext,
+	IN ULONG64 Now
+)
+/*++
+
+Routine Description:
+
+	Puts the controller into doze right away, whatever the holdoff, for
+	modes that only watch for a gesture. Hx85xDozeExit brings it back.
+	When polling, Hx85xDozeArm then tells the time to the first scan
+	window.
+
+Arguments:
+
+	Doze - The doze state
+
+	Sequences - HX85X_SEQUENCE_COUNT sequences
+
+	SpbContext - A pointer to the current i2c context
+
+	Now - Current interrupt time
+
+Return Value:
+
+	NTSTATUS indicating success or failure, STATUS_NOT_SUPPORTED when
+	there is no doze enter sequence and the doze interval is 0
+
+--*/
+{
+	if (Doze->Dozing)
+	{
+		return STATUS_SUCCESS;
+	}
+
+	if (Doze->Polled && Doze->Interval == 0)
+	{
+		return STATUS_NOT_SUPPORTED;
+	}
+
+	return Hx85xDozeRunEnter(Doze, Sequences, SpbContext, Now);
+}
+
+NTSTATUS
+Hx85xDozeExit(
+	IN OUT HX85X_DOZE* Doze,
+	IN HX85X_SEQUENCE* Sequences,
+	IN SPB_CONTEXT* SpbContext,
+	IN ULONG64 Now
+)
+/*++
+
+Routine Description:
+
+	Brings the controller back to full rate. Called on the first contact
+	while dozing, and before the controller is put to sleep.
+
+Arguments:
+
+	Doze - The doze state
+
+	Sequences - HX85X_SEQUENCE_COUNT sequences
+
+	SpbContext - A pointer to the current i2c context
+
+	Now - Interrupt time the exit was triggered at
+
+Return Value:
+
+	NTSTATUS indicating success or failure
+
+--*/
+{
+	NTSTATUS status;
+
+	if (!Doze->Dozing)
+	{
+		return STATUS_SUCCESS;
+	}
+
+	//
+	// The controller is treated as awake even if the sequence failed,
+	// the next holdoff tries dozing again
+	//
+	Doze->Dozing = FALSE;
+	Doze->Exits++;
+	Doze->DozeTime += (Now - Doze->EnterTime) / 10;
+
+	//
+	// When polling, sensing only needs turning on between scan windows
+	//
+	if (!Doze->Polled)
+	{
+		status = Hx85xRunSequence(
+			Sequences,
+			HX85X_SEQUENCE_DOZE_EXIT,
+			SpbContext);
+	}
+	else if (!Doze->Sensing)
+	{
+		status = Hx85xRunSequence(
+			Sequences,
+			HX85X_SEQUENCE_WAKE,
+			SpbContext);
+
+		Doze->Sensing = TRUE;
+	}
+	else
+	{
+		status = STATUS_SUCCESS;
+	}
+
+	Doze->ExitTime = (ULONG)((KeQueryInterruptTime() - Now) / 10);
+
+	if (!NT_SUCCESS(status))
+	{
+		Trace(
+			TRACE_LEVEL_ERROR,
+			TRACE_POWER,
+			"Could not exit doze - 0x%08lX",
+			status);
+	}
+
+	Trace(
+		TRACE_LEVEL_INFORMATION,
+		TRACE_POWER,
+		"Controller awake after dozing %I64u ms, exit took %lu us (%lu entries, %lu scan windows, %I64u ms dozing in total)",
+		(Now - Doze->EnterTime) / 10000,
+		Doze->ExitTime,
+		Doze->Entries,
+		Doze->Scans,
+		Doze->DozeTime / 1000);
+
+	return status;
+}
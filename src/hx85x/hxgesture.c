@@ -0,0 +1,504 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		hxgesture.c
+
+	Abstract:
+
+		Double tap to wake detector. While the display is off with the
+		wake gesture enabled the controller is kept at the doze scan rate
+		and every frame it reports advances a small state machine, which
+		tells the interrupt path when a double tap was seen.
+
+	Environment:
+
+		Kernel mode
+
+	Revision History:
+
+--*/
+
+#include <Cross Platform Shim\compat.h>
+#include <spb.h>
+#include <hx85x\hxinternal.h>
+#include <hxgesture.tmh>
+
+VOID
+Hx85xGestureConfigure(
+	IN OUT HX85X_GESTURE* Gesture,
+	IN const TOUCH_SCREEN_SETTINGS* Settings
+)
+/*++
+
+Routine Description:
+
+	Sets the detector limits up from the DoubleTap touch settings
+
+Arguments:
+
+	Gesture - The detector state
+
+	Settings - The touch settings
+
+Return Value:
+
+	None.
+
+--*/
+{
+	ULONG tapTime = Settings->DoubleTapMaxTapTime10ms;
+
+	RtlZeroMemory(Gesture, sizeof(HX85X_GESTURE));
+
+	if (tapTime == 0)
+	{
+		tapTime = HX85X_GESTURE_DEFAULT_TAP_TIME_10MS;
+	}
+
+	Gesture->MaxTapTime = (ULONG64)tapTime * 100000;
+	Gesture->MaxTapDistance = Settings->DoubleTapMaxTapDistance100um * 100;
+	Gesture->DeadZoneWidth = Settings->DoubleTapDeadZoneWidth100um * 100;
+	Gesture->DeadZoneHeight = Settings->DoubleTapDeadZoneHeight100um * 100;
+
+	Trace(
+		TRACE_LEVEL_INFORMATION,
+		TRACE_POWER,
+		"Double tap limits: %lu ms per tap, %lu um apart, %lux%lu um dead zones",
+		tapTime * 10,
+		Gesture->MaxTapDistance,
+		Gesture->DeadZoneWidth,
+		Gesture->DeadZoneHeight);
+}
+
+NTSTATUS
+Hx85xGestureStart(
+	IN OUT HX85X_GESTURE* Gesture,
+	IN OUT HX85X_DOZE* Doze,
+	IN HX85X_SEQUENCE* Sequences,
+	IN SPB_CONTEXT* SpbContext,
+	IN ULONG64 Now
+)
+/*++
+
+Routine Description:
+
+	Arms the detector and lowers the controller scan rate. The detector is
+	armed even if the scan rate could not be lowered, it then watches at
+	full rate. When armed already, e.g. across D0 entry, only the scan
+	rate is lowered again.
+
+Arguments:
+
+	Gesture - The detector state
+
+	Doze - The doze state
+
+	Sequences - HX85X_SEQUENCE_COUNT sequences
+
+	SpbContext - A pointer to the current i2c context
+
+	Now - Current interrupt time
+
+Return Value:
+
+	NTSTATUS of lowering the scan rate
+
+--*/
+{
+	NTSTATUS status;
+
+	status = Hx85xDozeLowPower(Doze, Sequences, SpbContext, Now);
+
+	if (status == STATUS_NOT_SUPPORTED)
+	{
+		Trace(
+			TRACE_LEVEL_INFORMATION,
+			TRACE_POWER,
+			"Doze off, watching for the wake gesture at full rate");
+
+		status = STATUS_SUCCESS;
+	}
+
+	if (Gesture->Armed)
+	{
+		return status;
+	}
+
+	Gesture->Armed = TRUE;
+	Gesture->State = HX85X_GESTURE_IDLE;
+	Gesture->StateTime = Now;
+	Gesture->ArmTime = Now;
+
+	return status;
+}
+
+NTSTATUS
+Hx85xGestureStop(
+	IN OUT HX85X_GESTURE* Gesture,
+	IN OUT HX85X_DOZE* Doze,
+	IN HX85X_SEQUENCE* Sequences,
+	IN SPB_CONTEXT* SpbContext,
+	IN ULONG64 Now
+)
+/*++
+
+Routine Description:
+
+	Disarms the detector and brings the controller back to full rate, the
+	doze holdoff starts over
+
+Arguments:
+
+	Gesture - The detector state
+
+	Doze - The doze state
+
+	Sequences - HX85X_SEQUENCE_COUNT sequences
+
+	SpbContext - A pointer to the current i2c context
+
+	Now - Current interrupt time
+
+Return Value:
+
+	NTSTATUS of the doze exit
+
+--*/
+{
+	NTSTATUS status;
+	ULONG64 armed;
+
+	if (!Gesture->Armed)
+	{
+		return STATUS_SUCCESS;
+	}
+
+	armed = (Now - Gesture->ArmTime) / 10;
+
+	Gesture->Armed = FALSE;
+	Gesture->ArmedTime += armed;
+
+	//
+	// The frame rate while armed tells how well the doze scan rate keeps
+	// the interrupt path quiet with the display off
+	//
+	Trace(
+		TRACE_LEVEL_INFORMATION,
+		TRACE_POWER,
+		"Wake gesture disarmed after %I64u ms, %I64u frames processed in %I64u ms armed (%I64u per hour), %lu matches, %lu rejected",
+		armed / 1000,
+		Gesture->Frames,
+		Gesture->ArmedTime / 1000,
+		Gesture->ArmedTime != 0 ? Gesture->Frames * 3600000000 / Gesture->ArmedTime : 0,
+		Gesture->Matches,
+		Gesture->Rejects);
+
+	status = Hx85xDozeExit(Doze, Sequences, SpbContext, Now);
+
+	Hx85xDozeStart(Doze, Now);
+
+	return status;
+}
+
+static
+VOID
+Hx85xGestureGetSize(
+	IN const TOUCH_SCREEN_PROPERTIES* Props,
+	OUT PULONG Width,
+	OUT PULONG Height
+)
+{
+	//
+	// Physical size along the touch axes in micrometers
+	//
+	ULONG width = Props->DisplayWidth10um != 0 ? Props->DisplayWidth10um : HX85X_GESTURE_DEFAULT_WIDTH_10UM;
+	ULONG height = Props->DisplayHeight10um != 0 ? Props->DisplayHeight10um : HX85X_GESTURE_DEFAULT_HEIGHT_10UM;
+
+	if (Props->TouchSwapAxes)
+	{
+		*Width = height * 10;
+		*Height = width * 10;
+	}
+	else
+	{
+		*Width = width * 10;
+		*Height = height * 10;
+	}
+}
+
+static
+VOID
+Hx85xGestureToMicrometers(
+	IN const TOUCH_SCREEN_PROPERTIES* Props,
+	IN const DETECTED_OBJECT_POSITION* Position,
+	OUT PULONG X,
+	OUT PULONG Y
+)
+{
+	ULONG width;
+	ULONG height;
+
+	Hx85xGestureGetSize(Props, &width, &height);
+
+	*X = (ULONG)((ULONG64)(ULONG)max(Position->X, 0) * width / max(Props->TouchPhysicalWidth, 1));
+	*Y = (ULONG)((ULONG64)(ULONG)max(Position->Y, 0) * height / max(Props->TouchPhysicalHeight, 1));
+}
+
+static
+BOOLEAN
+Hx85xGestureInDeadZone(
+	IN const HX85X_GESTURE* Gesture,
+	IN const TOUCH_SCREEN_PROPERTIES* Props,
+	IN const DETECTED_OBJECT_POSITION* Position
+)
+{
+	ULONG width;
+	ULONG height;
+	ULONG x;
+	ULONG y;
+
+	Hx85xGestureGetSize(Props, &width, &height);
+	Hx85xGestureToMicrometers(Props, Position, &x, &y);
+
+	return x < Gesture->DeadZoneWidth ||
+		x + Gesture->DeadZoneWidth > width ||
+		y < Gesture->DeadZoneHeight ||
+		y + Gesture->DeadZoneHeight > height;
+}
+
+static
+BOOLEAN
+Hx85xGestureWithinTapDistance(
+	IN const HX85X_GESTURE* Gesture,
+	IN const TOUCH_SCREEN_PROPERTIES* Props,
+	IN const DETECTED_OBJECT_POSITION* A,
+	IN const DETECTED_OBJECT_POSITION* B
+)
+{
+	ULONG ax, ay, bx, by;
+	LONG64 dx, dy;
+
+	Hx85xGestureToMicrometers(Props, A, &ax, &ay);
+	Hx85xGestureToMicrometers(Props, B, &bx, &by);
+
+	dx = (LONG64)ax - bx;
+	dy = (LONG64)ay - by;
+
+	return (ULONG64)(dx * dx + dy * dy) <=
+		(ULONG64)Gesture->MaxTapDistance * Gesture->MaxTapDistance;
+}
+
+static
+VOID
+Hx85xGestureSetState(
+	IN OUT HX85X_GESTURE* Gesture,
+	IN HX85X_GESTURE_STATE State,
+	IN ULONG64 Now
+)
+{
+	if (State == HX85X_GESTURE_REJECTED)
+	{
+		Gesture->Rejects++;
+	}
+
+	Gesture->State = State;
+	Gesture->StateTime = Now;
+}
+
+static
+VOID
+Hx85xGestureFirstTapDown(
+	IN OUT HX85X_GESTURE* Gesture,
+	IN const TOUCH_SCREEN_PROPERTIES* Props,
+	IN ULONG Contacts,
+	IN const DETECTED_OBJECT_POSITION* Position,
+	IN ULONG64 Now
+)
+{
+	if (Contacts != 1 || Hx85xGestureInDeadZone(Gesture, Props, Position))
+	{
+		Hx85xGestureSetState(Gesture, HX85X_GESTURE_REJECTED, Now);
+		return;
+	}
+
+	Gesture->FirstTap = *Position;
+	Gesture->Down = *Position;
+
+	Hx85xGestureSetState(Gesture, HX85X_GESTURE_FIRST_DOWN, Now);
+}
+
+BOOLEAN
+Hx85xGestureTrackFrame(
+	IN OUT HX85X_GESTURE* Gesture,
+	IN const TOUCH_SCREEN_PROPERTIES* Props,
+	IN const DETECTED_OBJECTS* Data
+)
+/*++
+
+Routine Description:
+
+	Advances the double tap state machine by one frame. Called from the
+	interrupt path while the detector is armed.
+
+Arguments:
+
+	Gesture - The detector state
+
+	Props - Screen properties, for the physical size of the touch area
+
+	Data - The frame read from the controller
+
+Return Value:
+
+	TRUE when the frame completed a double tap
+
+--*/
+{
+	DETECTED_OBJECT_POSITION position = { 0 };
+	ULONG64 now = Data->Timestamp;
+	ULONG64 elapsed;
+	ULONG contacts = 0;
+	ULONG i;
+
+	if (!Gesture->Armed)
+	{
+		return FALSE;
+	}
+
+	Gesture->Frames++;
+
+	for (i = 0; i < MAX_TOUCHES; i++)
+	{
+		if (Data->States[i] != OBJECT_STATE_NOT_PRESENT)
+		{
+			if (contacts == 0)
+			{
+				position = Data->Positions[i];
+			}
+
+			contacts++;
+		}
+	}
+
+	elapsed = now - Gesture->StateTime;
+
+	switch (Gesture->State)
+	{
+	case HX85X_GESTURE_IDLE:
+		if (contacts != 0)
+		{
+			Hx85xGestureFirstTapDown(Gesture, Props, contacts, &position, now);
+		}
+		break;
+
+	case HX85X_GESTURE_FIRST_DOWN:
+	case HX85X_GESTURE_SECOND_DOWN:
+		if (contacts == 0)
+		{
+			//
+			// A contact held longer than a tap is not one
+			//
+			if (elapsed > Gesture->MaxTapTime)
+			{
+				Gesture->Rejects++;
+				Hx85xGestureSetState(Gesture, HX85X_GESTURE_IDLE, now);
+			}
+			else if (Gesture->State == HX85X_GESTURE_FIRST_DOWN)
+			{
+				Hx85xGestureSetState(Gesture, HX85X_GESTURE_FIRST_UP, now);
+			}
+			else
+			{
+				Gesture->Matches++;
+				Hx85xGestureSetState(Gesture, HX85X_GESTURE_IDLE, now);
+
+				return TRUE;
+			}
+		}
+		else if (contacts != 1 ||
+			elapsed > Gesture->MaxTapTime ||
+			!Hx85xGestureWithinTapDistance(Gesture, Props, &Gesture->Down, &position))
+		{
+			Hx85xGestureSetState(Gesture, HX85X_GESTURE_REJECTED, now);
+		}
+		break;
+
+	case HX85X_GESTURE_FIRST_UP:
+		if (contacts == 0)
+		{
+			if (elapsed > Gesture->MaxTapTime)
+			{
+				Hx85xGestureSetState(Gesture, HX85X_GESTURE_IDLE, now);
+			}
+		}
+		else if (contacts == 1 &&
+			elapsed <= Gesture->MaxTapTime &&
+			!Hx85xGestureInDeadZone(Gesture, Props, &position) &&
+			Hx85xGestureWithinTapDistance(Gesture, Props, &Gesture->FirstTap, &position))
+		{
+			Gesture->Down = position;
+			Hx85xGestureSetState(Gesture, HX85X_GESTURE_SECOND_DOWN, now);
+		}
+		else
+		{
+			//
+			// Too late or too far for a second tap, it may be the first
+			// one of the next double tap
+			//
+			Hx85xGestureFirstTapDown(Gesture, Props, contacts, &position, now);
+		}
+		break;
+
+	case HX85X_GESTURE_REJECTED:
+		if (contacts == 0)
+		{
+			Hx85xGestureSetState(Gesture, HX85X_GESTURE_IDLE, now);
+		}
+		break;
+	}
+
+	return FALSE;
+}
+
+BOOLEAN
+Hx85xGestureHoldScan(
+	IN OUT HX85X_GESTURE* Gesture,
+	IN ULONG64 Now
+)
+/*++
+
+Routine Description:
+
+	Tells whether a polled doze scan window must stay open for a double
+	tap in progress. One that can no longer complete is dropped, as with
+	sensing off the lift ending it may never be seen. Serialized with the
+	interrupt path.
+
+Arguments:
+
+	Gesture - The detector state
+
+	Now - Current interrupt time
+
+Return Value:
+
+	TRUE to keep sensing
+
+--*/
+{
+	if (!Gesture->Armed || Gesture->State == HX85X_GESTURE_IDLE)
+	{
+		return FALSE;
+	}
+
+	if (Now - Gesture->StateTime <= Gesture->MaxTapTime)
+	{
+		return TRUE;
+	}
+
+	Hx85xGestureSetState(Gesture, HX85X_GESTURE_IDLE, Now);
+
+	return FALSE;
+}
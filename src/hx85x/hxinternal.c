@@ -50,252 +50,6 @@ Hx85xChangePage(
       return STATUS_SUCCESS;
 }
 
-NTSTATUS Hx8526ConfigureController(
-      IN SPB_CONTEXT* SpbContext
-)
-{
-      NTSTATUS status = STATUS_SUCCESS;
-      LARGE_INTEGER delay;
-
-      Trace(
-            TRACE_LEVEL_INFORMATION,
-            TRACE_INIT,
-            "Power On IC");
-      
-      //
-      // Power On IC
-      //
-      status = SpbWriteDataSynchronously(
-            SpbContext, 
-            HX85X_IC_POWER_ON_COMMAND, 
-            sizeof(HX85X_IC_POWER_ON_COMMAND), 
-            NULL, 
-            0);
-
-      if (!NT_SUCCESS(status))
-      {
-            Trace(
-                TRACE_LEVEL_ERROR,
-                TRACE_INIT,
-                "Could not power on IC - 0x%08lX",
-                status);
-            goto exit;
-      }
-
-      delay.QuadPart = -10 * 120;
-      KeDelayExecutionThread(KernelMode, TRUE, &delay);
-
-      Trace(
-            TRACE_LEVEL_INFORMATION,
-            TRACE_INIT,
-            "Power On MCU");
-      
-      //
-      // Power On MCU
-      //
-      status = SpbWriteDataSynchronously(
-            SpbContext, 
-            HX85X_MCU_POWER_ON_COMMAND, 
-            sizeof(HX85X_MCU_POWER_ON_COMMAND), 
-            NULL, 
-            0);
-
-      if (!NT_SUCCESS(status))
-      {
-            Trace(
-                TRACE_LEVEL_ERROR,
-                TRACE_INIT,
-                "Could not power on MCU - 0x%08lX",
-                status);
-            goto exit;
-      }
-
-      delay.QuadPart = -10 * 10;
-      KeDelayExecutionThread(KernelMode, TRUE, &delay);
-
-      Trace(
-            TRACE_LEVEL_INFORMATION,
-            TRACE_INIT,
-            "Power On Flash");
-      
-      //
-      // Power On Flash
-      //
-      status = SpbWriteDataSynchronously(
-            SpbContext, 
-            HX8526_FLASH_POWER_ON_COMMAND, 
-            sizeof(HX8526_FLASH_POWER_ON_COMMAND), 
-            NULL, 
-            0);
-
-      if (!NT_SUCCESS(status))
-      {
-            Trace(
-                TRACE_LEVEL_ERROR,
-                TRACE_INIT,
-                "Could not power on Flash - 0x%08lX",
-                status);
-            goto exit;
-      }
-
-      delay.QuadPart = -10 * 10;
-      KeDelayExecutionThread(KernelMode, TRUE, &delay);
-
-      Trace(
-            TRACE_LEVEL_INFORMATION,
-            TRACE_INIT,
-            "Fetch Flash");
-      
-      //
-      // Fetch Flash
-      //
-      status = SpbWriteDataSynchronously(
-            SpbContext, 
-            HX8526_FETCH_FLASH_COMMAND, 
-            sizeof(HX8526_FETCH_FLASH_COMMAND), 
-            NULL, 
-            0);
-
-      if (!NT_SUCCESS(status))
-      {
-            Trace(
-                TRACE_LEVEL_ERROR,
-                TRACE_INIT,
-                "Could not fetch Flash - 0x%08lX",
-                status);
-            goto exit;
-      }
-
-      delay.QuadPart = -10 * 10;
-      KeDelayExecutionThread(KernelMode, TRUE, &delay);
-
-exit:
-      return status;
-}
-
-NTSTATUS Hx8520ConfigureController(
-      IN SPB_CONTEXT* SpbContext
-)
-{
-      NTSTATUS status = STATUS_SUCCESS;
-      LARGE_INTEGER delay;
-
-      Trace(
-            TRACE_LEVEL_INFORMATION,
-            TRACE_INIT,
-            "Power On IC");
-      
-      //
-      // Power On IC
-      //
-      status = SpbWriteDataSynchronously(
-            SpbContext, 
-            HX85X_IC_POWER_ON_COMMAND, 
-            sizeof(HX85X_IC_POWER_ON_COMMAND), 
-            NULL, 
-            0);
-
-      if (!NT_SUCCESS(status))
-      {
-            Trace(
-                TRACE_LEVEL_ERROR,
-                TRACE_INIT,
-                "Could not power on IC - 0x%08lX",
-                status);
-            goto exit;
-      }
-
-      delay.QuadPart = -10 * 120;
-      KeDelayExecutionThread(KernelMode, TRUE, &delay);
-
-      Trace(
-            TRACE_LEVEL_INFORMATION,
-            TRACE_INIT,
-            "Speed Mode");
-      
-      //
-      // Speed Mode
-      //
-      status = SpbWriteDataSynchronously(
-            SpbContext, 
-            HX8520_SPEED_MODE_COMMAND, 
-            sizeof(HX8520_SPEED_MODE_COMMAND), 
-            NULL, 
-            0);
-
-      if (!NT_SUCCESS(status))
-      {
-            Trace(
-                TRACE_LEVEL_ERROR,
-                TRACE_INIT,
-                "Could not fetch Flash - 0x%08lX",
-                status);
-            goto exit;
-      }
-
-      delay.QuadPart = -10 * 10;
-      KeDelayExecutionThread(KernelMode, TRUE, &delay);
-
-      Trace(
-            TRACE_LEVEL_INFORMATION,
-            TRACE_INIT,
-            "Power On MCU");
-      
-      //
-      // Power On MCU
-      //
-      status = SpbWriteDataSynchronously(
-            SpbContext, 
-            HX85X_MCU_POWER_ON_COMMAND, 
-            sizeof(HX85X_MCU_POWER_ON_COMMAND), 
-            NULL, 
-            0);
-
-      if (!NT_SUCCESS(status))
-      {
-            Trace(
-                TRACE_LEVEL_ERROR,
-                TRACE_INIT,
-                "Could not power on MCU - 0x%08lX",
-                status);
-            goto exit;
-      }
-
-      delay.QuadPart = -10 * 10;
-      KeDelayExecutionThread(KernelMode, TRUE, &delay);
-
-      Trace(
-            TRACE_LEVEL_INFORMATION,
-            TRACE_INIT,
-            "Power On Flash");
-      
-      //
-      // Power On Flash
-      //
-      status = SpbWriteDataSynchronously(
-            SpbContext, 
-            HX8520_FLASH_POWER_ON_COMMAND, 
-            sizeof(HX8520_FLASH_POWER_ON_COMMAND), 
-            NULL, 
-            0);
-
-      if (!NT_SUCCESS(status))
-      {
-            Trace(
-                TRACE_LEVEL_ERROR,
-                TRACE_INIT,
-                "Could not power on Flash - 0x%08lX",
-                status);
-            goto exit;
-      }
-
-      delay.QuadPart = -10 * 10;
-      KeDelayExecutionThread(KernelMode, TRUE, &delay);
-
-exit:
-      return status;
-}
-
 NTSTATUS
 Hx85xConfigureFunctions(
       IN HX85X_CONTROLLER_CONTEXT* ControllerContext,
@@ -379,6 +133,9 @@ Hx85xConfigureFunctions(
                 TRACE_INIT,
                 "Device is already initialized!");
 
+            ControllerContext->Sensing = TRUE;
+            ControllerContext->AppliedGeneration = ControllerContext->ConfigGeneration;
+
             return STATUS_SUCCESS;
       }
 
@@ -389,11 +146,17 @@ Hx85xConfigureFunctions(
 
       if (ControllerContext->ChipModel == 0x8526 || ControllerContext->ChipModel == 0x8528)
       {
-            status = Hx8526ConfigureController(SpbContext);
+            status = Hx85xRunSequence(
+                  ControllerContext->Sequences,
+                  HX85X_SEQUENCE_INIT_8526,
+                  SpbContext);
       }
       else
       {
-            status = Hx8520ConfigureController(SpbContext);
+            status = Hx85xRunSequence(
+                  ControllerContext->Sequences,
+                  HX85X_SEQUENCE_INIT_8520,
+                  SpbContext);
       }
 
       if (!NT_SUCCESS(status))
@@ -411,6 +174,9 @@ Hx85xConfigureFunctions(
           TRACE_INIT,
           "Chip fully configured!");
 
+      ControllerContext->Sensing = FALSE;
+      ControllerContext->AppliedGeneration = ControllerContext->ConfigGeneration;
+
 exit:
       return status;
 }
@@ -729,7 +495,8 @@ NTSTATUS
 TchServiceObjectInterrupts(
       IN HX85X_CONTROLLER_CONTEXT* ControllerContext,
       IN SPB_CONTEXT* SpbContext,
-      IN PREPORT_CONTEXT ReportContext
+      IN PREPORT_CONTEXT ReportContext,
+      IN ULONG64 InterruptTime
 )
 {
       NTSTATUS status = STATUS_SUCCESS;
@@ -742,6 +509,11 @@ TchServiceObjectInterrupts(
       
       RtlZeroMemory(&data, sizeof(data));
 
+      //
+      // The frame is stamped with the time the controller signaled it
+      //
+      data.Timestamp = InterruptTime;
+
       //
       // See if new touch data is available
       //
@@ -771,6 +543,48 @@ TchServiceObjectInterrupts(
             goto exit;
       }
 
+      //
+      // With the display off only a double tap is looked for, nothing is
+      // reported until it wakes the system
+      //
+      if (ControllerContext->Gesture.Armed)
+      {
+            const TOUCH_SCREEN* screen;
+            LONG ticket;
+            BOOLEAN wake;
+
+            screen = TchAcquireScreen(&ReportContext->Screen, &ticket);
+
+            wake = Hx85xGestureTrackFrame(
+                  &ControllerContext->Gesture,
+                  &screen->Props,
+                  &data);
+
+            TchReleaseScreen(&ReportContext->Screen, ticket);
+
+            if (wake)
+            {
+                  Trace(
+                      TRACE_LEVEL_INFORMATION,
+                      TRACE_REPORTING,
+                      "Double tap detected, waking up");
+
+                  status = ReportWakeup(ReportContext);
+            }
+
+            goto exit;
+      }
+
+      //
+      // A contact while dozing brings the controller back to full rate
+      // before the frame is reported
+      //
+      (VOID)Hx85xDozeTrackFrame(
+          &ControllerContext->Doze,
+          ControllerContext->Sequences,
+          SpbContext,
+          &data);
+
       status = ReportObjects(
           ReportContext,
           data);
@@ -794,12 +608,13 @@ NTSTATUS
 Hx85xServiceInterrupts(
       IN HX85X_CONTROLLER_CONTEXT* ControllerContext,
       IN SPB_CONTEXT* SpbContext,
-      IN PREPORT_CONTEXT ReportContext
+      IN PREPORT_CONTEXT ReportContext,
+      IN ULONG64 InterruptTime
 )
 {
       NTSTATUS status = STATUS_SUCCESS;
 
-      TchServiceObjectInterrupts(ControllerContext, SpbContext, ReportContext);
+      TchServiceObjectInterrupts(ControllerContext, SpbContext, ReportContext, InterruptTime);
 
       return status;
 }
@@ -811,13 +626,56 @@ Hx85xSetReportingFlags(
       IN UCHAR NewMode,
     OUT UCHAR* OldMode
 )
+/*++
+
+Routine Description:
+
+      Switches the reporting mode. The wake gesture mode arms the double
+      tap detector at the doze scan rate, the other modes disarm it. Must
+      be serialized with the interrupt path.
+
+Arguments:
+
+      ControllerContext - Touch controller context
+      SpbContext - A pointer to the current i2c context
+      NewMode - One of HX85X_REPORTING_FLAGS
+      OldMode - Optionally receives the previous mode
+
+Return Value:
+
+      NTSTATUS indicating success or failure
+
+--*/
 {
-      UNREFERENCED_PARAMETER(SpbContext);
-      UNREFERENCED_PARAMETER(ControllerContext);
-      UNREFERENCED_PARAMETER(NewMode);
-      UNREFERENCED_PARAMETER(OldMode);
+      NTSTATUS status;
 
-      return STATUS_SUCCESS;
+      if (OldMode != NULL)
+      {
+            *OldMode = ControllerContext->ReportingMode;
+      }
+
+      if (NewMode == HX85X_REPORTING_WAKEUP_GESTURE_MODE)
+      {
+            status = Hx85xGestureStart(
+                  &ControllerContext->Gesture,
+                  &ControllerContext->Doze,
+                  ControllerContext->Sequences,
+                  SpbContext,
+                  KeQueryInterruptTime());
+      }
+      else
+      {
+            status = Hx85xGestureStop(
+                  &ControllerContext->Gesture,
+                  &ControllerContext->Doze,
+                  ControllerContext->Sequences,
+                  SpbContext,
+                  KeQueryInterruptTime());
+      }
+
+      ControllerContext->ReportingMode = NewMode;
+
+      return status;
 }
 
 NTSTATUS
@@ -842,9 +700,6 @@ Hx85xChangeSleepState(
 )
 {
       NTSTATUS status = STATUS_SUCCESS;
-      LARGE_INTEGER delay;
-
-      UNREFERENCED_PARAMETER(ControllerContext);
 
       if (SleepState == HX85X_F01_DEVICE_CONTROL_SLEEP_MODE_SLEEPING)
       {
@@ -854,14 +709,31 @@ Hx85xChangeSleepState(
                   "Turning off Sense");
 
             //
-            // Sense ON
+            // The controller leaves doze and wake gesture mode first, so
+            // it wakes at full rate
             //
-            status = SpbWriteDataSynchronously(
-                  SpbContext, 
-                  HX85X_SENSE_OFF_COMMAND, 
-                  sizeof(HX85X_SENSE_OFF_COMMAND), 
-                  NULL, 
-                  0);
+            (VOID)Hx85xGestureStop(
+                  &ControllerContext->Gesture,
+                  &ControllerContext->Doze,
+                  ControllerContext->Sequences,
+                  SpbContext,
+                  KeQueryInterruptTime());
+
+            ControllerContext->ReportingMode = HX85X_REPORTING_CONTINUOUS_MODE;
+
+            (VOID)Hx85xDozeExit(
+                  &ControllerContext->Doze,
+                  ControllerContext->Sequences,
+                  SpbContext,
+                  KeQueryInterruptTime());
+
+            //
+            // Sense OFF
+            //
+            status = Hx85xRunSequence(
+                  ControllerContext->Sequences,
+                  HX85X_SEQUENCE_SLEEP,
+                  SpbContext);
 
             if (!NT_SUCCESS(status))
             {
@@ -872,6 +744,8 @@ Hx85xChangeSleepState(
                       status);
                   goto exit;
             }
+
+            ControllerContext->Sensing = FALSE;
       }
       else
       {
@@ -881,14 +755,12 @@ Hx85xChangeSleepState(
                   "Turning on Sense");
 
             //
-            // Sense ON
+            // Sense ON, then wait for the controller to report sensing
             //
-            status = SpbWriteDataSynchronously(
-                  SpbContext, 
-                  HX85X_SENSE_ON_COMMAND, 
-                  sizeof(HX85X_SENSE_ON_COMMAND), 
-                  NULL, 
-                  0);
+            status = Hx85xRunSequence(
+                  ControllerContext->Sequences,
+                  HX85X_SEQUENCE_WAKE,
+                  SpbContext);
 
             if (!NT_SUCCESS(status))
             {
@@ -900,14 +772,86 @@ Hx85xChangeSleepState(
                   goto exit;
             }
 
-            delay.QuadPart = -10 * 100;
-            KeDelayExecutionThread(KernelMode, TRUE, &delay);
+            ControllerContext->Sensing = TRUE;
       }
 
 exit:
       return status;
 }
 
+NTSTATUS
+Hx85xResumeController(
+      IN HX85X_CONTROLLER_CONTEXT* ControllerContext,
+      IN SPB_CONTEXT* SpbContext
+)
+/*++
+
+Routine Description:
+
+      Brings the controller back to operating mode after D3. When it kept
+      its power and the configuration it was last given, only what is
+      missing is sent: nothing if it is still sensing, sense on otherwise.
+      When it lost them, it is configured again first.
+
+Arguments:
+
+      ControllerContext - Touch controller context
+      SpbContext - A pointer to the current i2c context
+
+Return Value:
+
+      NTSTATUS indicating success or failure
+
+--*/
+{
+      NTSTATUS status;
+      BYTE SleepStatus = 0;
+
+      if (ControllerContext->Config.PepRemovesVoltageInD3 == 0 &&
+          ControllerContext->ChipModel != 0 &&
+          ControllerContext->AppliedGeneration == ControllerContext->ConfigGeneration)
+      {
+            status = SpbReadDataSynchronously(
+                  SpbContext, 
+                  HX85X_GET_SLEEP_COMMAND, 
+                  sizeof(HX85X_GET_SLEEP_COMMAND), 
+                  &SleepStatus, 
+                  sizeof(SleepStatus));
+
+            if (NT_SUCCESS(status) && SleepStatus != 0)
+            {
+                  Trace(
+                      TRACE_LEVEL_INFORMATION,
+                      TRACE_POWER,
+                      "Controller still sensing, nothing to resume");
+
+                  ControllerContext->Sensing = TRUE;
+                  return STATUS_SUCCESS;
+            }
+      }
+      else
+      {
+            Trace(
+                TRACE_LEVEL_INFORMATION,
+                TRACE_POWER,
+                "Controller lost its configuration, configuring it again");
+
+            ControllerContext->Sensing = FALSE;
+
+            status = Hx85xConfigureFunctions(ControllerContext, SpbContext);
+
+            if (!NT_SUCCESS(status) || ControllerContext->Sensing)
+            {
+                  return status;
+            }
+      }
+
+      return Hx85xChangeSleepState(
+            ControllerContext,
+            SpbContext,
+            HX85X_F01_DEVICE_CONTROL_SLEEP_MODE_OPERATING);
+}
+
 NTSTATUS
 Hx85xGetFirmwareVersion(
       IN HX85X_CONTROLLER_CONTEXT* ControllerContext,
@@ -0,0 +1,675 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		hxsequence.c
+
+	Abstract:
+
+		Runs controller init, wake and sleep as declarative sequences of
+		writes, reads, polls and delays. The defaults below can be
+		replaced per device from configuration, so bring-up of a new panel
+		can be tuned without a driver change.
+
+	Environment:
+
+		Kernel mode
+
+	Revision History:
+
+--*/
+
+#include <Cross Platform Shim\compat.h>
+#include <spb.h>
+#include <hx85x\hxinternal.h>
+#include <hxsequence.tmh>
+
+#define HX85X_WRITE(length, ...) \
+	{ HX85X_STEP_WRITE, 0, length, 0, { __VA_ARGS__ }, 0, { 0 }, 0 }
+
+//
+// Polls the sleep status register
+//
+#define HX85X_POLL_STATUS(flags, mask, expected, time) \
+	{ HX85X_STEP_POLL, flags, 1, mask, { 0x63 }, expected, { 0 }, time }
+
+//
+// Waits until the controller reads back its chip ID after power on. A
+// successful read alone does not tell, the bus may answer before the
+// controller has booted.
+//
+#define HX85X_POLL_POWERED(time) \
+	{ HX85X_STEP_POLL, HX85X_STEP_OPTIONAL, 1, 0xFF, { 0x31 }, HX85X_CHIP_ID_HIGH, { 0 }, time }
+
+//
+// The controller reports no completion of the other commands
+//
+#define HX85X_SETTLE(time) \
+	{ HX85X_STEP_DELAY, 0, 0, 0, { 0 }, 0, { 0 }, time }
+
+static const HX85X_SEQUENCE_STEP gHx8526InitSequence[] =
+{
+	HX85X_WRITE(1, 0x81),                       // IC power on
+	HX85X_POLL_POWERED(HX85X_IC_POWER_ON_TIME),
+	HX85X_WRITE(2, 0x35, 0x02),                 // MCU power on
+	HX85X_SETTLE(HX85X_COMMAND_SETTLE_TIME),
+	HX85X_WRITE(3, 0x36, 0x0F, 0x53),           // Flash power on
+	HX85X_SETTLE(HX85X_COMMAND_SETTLE_TIME),
+	HX85X_WRITE(3, 0xDD, 0x04, 0x02),           // Fetch flash
+	HX85X_SETTLE(HX85X_COMMAND_SETTLE_TIME),
+};
+
+static const HX85X_SEQUENCE_STEP gHx8520InitSequence[] =
+{
+	HX85X_WRITE(1, 0x81),                       // IC power on
+	HX85X_POLL_POWERED(HX85X_IC_POWER_ON_TIME),
+	HX85X_WRITE(2, 0x9D, 0x80),                 // Speed mode
+	HX85X_SETTLE(HX85X_COMMAND_SETTLE_TIME),
+	HX85X_WRITE(2, 0x35, 0x02),                 // MCU power on
+	HX85X_SETTLE(HX85X_COMMAND_SETTLE_TIME),
+	HX85X_WRITE(2, 0x36, 0x01),                 // Flash power on
+	HX85X_SETTLE(HX85X_COMMAND_SETTLE_TIME),
+};
+
+//
+// Sensing is reported by a non zero sleep status
+//
+static const HX85X_SEQUENCE_STEP gHx85xWakeSequence[] =
+{
+	HX85X_WRITE(1, 0x83),                       // Sense on
+	HX85X_POLL_STATUS(HX85X_STEP_OPTIONAL | HX85X_STEP_NOT_EQUAL, 0xFF, 0x00, HX85X_SENSE_ON_TIME),
+};
+
+static const HX85X_SEQUENCE_STEP gHx85xSleepSequence[] =
+{
+	HX85X_WRITE(1, 0x82),                       // Sense off
+};
+
+//
+// Doze has no default sequence, the scan rate commands differ between
+// firmwares. Panels that support it supply both from configuration.
+//
+
+//
+// Defaults and the device key values replacing them, by HX85X_SEQUENCE_ID
+//
+static const struct
+{
+	const HX85X_SEQUENCE_STEP* Steps;
+	ULONG Count;
+	PCWSTR ValueName;
+} gSequences[HX85X_SEQUENCE_COUNT] =
+{
+	{ gHx8526InitSequence, ARRAYSIZE(gHx8526InitSequence), L"Hx8526InitSequence" },
+	{ gHx8520InitSequence, ARRAYSIZE(gHx8520InitSequence), L"Hx8520InitSequence" },
+	{ gHx85xWakeSequence, ARRAYSIZE(gHx85xWakeSequence), L"WakeSequence" },
+	{ gHx85xSleepSequence, ARRAYSIZE(gHx85xSleepSequence), L"SleepSequence" },
+	{ NULL, 0, L"DozeEnterSequence" },
+	{ NULL, 0, L"DozeExitSequence" },
+};
+
+VOID
+Hx85xInitializeSequences(
+	OUT HX85X_SEQUENCE* Sequences
+)
+/*++
+
+Routine Description:
+
+	Sets all sequences to their defaults
+
+Arguments:
+
+	Sequences - HX85X_SEQUENCE_COUNT sequences to initialize
+
+Return Value:
+
+	None.
+
+--*/
+{
+	ULONG i;
+
+	for (i = 0; i < HX85X_SEQUENCE_COUNT; i++)
+	{
+		Sequences[i].Steps = gSequences[i].Steps;
+		Sequences[i].Count = gSequences[i].Count;
+		Sequences[i].Override = NULL;
+		Sequences[i].Time = 0;
+	}
+}
+
+static
+BOOLEAN
+Hx85xValidateSteps(
+	IN const HX85X_SEQUENCE_STEP* Steps,
+	IN ULONG Count
+)
+{
+	ULONG i;
+
+	for (i = 0; i < Count; i++)
+	{
+		switch (Steps[i].Operation)
+		{
+		case HX85X_STEP_WRITE:
+		case HX85X_STEP_READ:
+		case HX85X_STEP_POLL:
+			if (Steps[i].Length == 0 || Steps[i].Length > HX85X_STEP_MAX_DATA)
+			{
+				return FALSE;
+			}
+			break;
+
+		case HX85X_STEP_DELAY:
+			break;
+
+		default:
+			return FALSE;
+		}
+
+		if (Steps[i].Time > HX85X_SEQUENCE_MAX_TIME)
+		{
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+VOID
+Hx85xLoadSequences(
+	IN OUT HX85X_SEQUENCE* Sequences,
+	IN WDFDEVICE FxDevice
+)
+/*++
+
+Routine Description:
+
+	Replaces default sequences by REG_BINARY arrays of HX85X_SEQUENCE_STEP
+	found under the device key. Values that are malformed are ignored and
+	the default is kept.
+
+Arguments:
+
+	Sequences - HX85X_SEQUENCE_COUNT sequences, initialized
+
+	FxDevice - Framework device object
+
+Return Value:
+
+	None.
+
+--*/
+{
+	PHX85X_SEQUENCE_STEP steps;
+	UNICODE_STRING valueName;
+	WDFKEY deviceKey;
+	ULONG length;
+	ULONG type;
+	NTSTATUS status;
+	ULONG i;
+
+	status = WdfDeviceOpenRegistryKey(
+		FxDevice,
+		PLUGPLAY_REGKEY_DEVICE,
+		KEY_READ,
+		WDF_NO_OBJECT_ATTRIBUTES,
+		&deviceKey);
+
+	if (!NT_SUCCESS(status))
+	{
+		return;
+	}
+
+	for (i = 0; i < HX85X_SEQUENCE_COUNT; i++)
+	{
+		RtlInitUnicodeString(&valueName, gSequences[i].ValueName);
+
+		length = 0;
+		type = REG_NONE;
+
+		status = WdfRegistryQueryValue(
+			deviceKey,
+			&valueName,
+			0,
+			NULL,
+			&length,
+			&type);
+
+		if (status == STATUS_OBJECT_NAME_NOT_FOUND)
+		{
+			continue;
+		}
+
+		if (type != REG_BINARY ||
+			length == 0 ||
+			length % sizeof(HX85X_SEQUENCE_STEP) != 0 ||
+			length / sizeof(HX85X_SEQUENCE_STEP) > HX85X_SEQUENCE_MAX_STEPS)
+		{
+			Trace(
+				TRACE_LEVEL_WARNING,
+				TRACE_INIT,
+				"Ignoring %ws (type %d, %d bytes)",
+				gSequences[i].ValueName,
+				type,
+				length);
+
+			continue;
+		}
+
+		steps = ExAllocatePoolWithTag(
+			NonPagedPoolNx,
+			length,
+			TOUCH_POOL_TAG_HX);
+
+		if (steps == NULL)
+		{
+			continue;
+		}
+
+		status = WdfRegistryQueryValue(
+			deviceKey,
+			&valueName,
+			length,
+			steps,
+			&length,
+			&type);
+
+		if (!NT_SUCCESS(status) ||
+			!Hx85xValidateSteps(steps, length / sizeof(HX85X_SEQUENCE_STEP)))
+		{
+			Trace(
+				TRACE_LEVEL_WARNING,
+				TRACE_INIT,
+				"Ignoring %ws - 0x%08lX",
+				gSequences[i].ValueName,
+				status);
+
+			ExFreePoolWithTag(steps, TOUCH_POOL_TAG_HX);
+			continue;
+		}
+
+		if (Sequences[i].Override != NULL)
+		{
+			ExFreePoolWithTag(Sequences[i].Override, TOUCH_POOL_TAG_HX);
+		}
+
+		Sequences[i].Override = steps;
+		Sequences[i].Steps = steps;
+		Sequences[i].Count = length / sizeof(HX85X_SEQUENCE_STEP);
+
+		Trace(
+			TRACE_LEVEL_INFORMATION,
+			TRACE_INIT,
+			"Using %ws from configuration, %d steps",
+			gSequences[i].ValueName,
+			Sequences[i].Count);
+	}
+
+	WdfRegistryClose(deviceKey);
+}
+
+VOID
+Hx85xFreeSequences(
+	IN OUT HX85X_SEQUENCE* Sequences
+)
+/*++
+
+Routine Description:
+
+	Frees sequences read from configuration and restores the defaults
+
+Arguments:
+
+	Sequences - HX85X_SEQUENCE_COUNT sequences
+
+Return Value:
+
+	None.
+
+--*/
+{
+	ULONG i;
+
+	for (i = 0; i < HX85X_SEQUENCE_COUNT; i++)
+	{
+		if (Sequences[i].Override != NULL)
+		{
+			ExFreePoolWithTag(Sequences[i].Override, TOUCH_POOL_TAG_HX);
+		}
+	}
+
+	Hx85xInitializeSequences(Sequences);
+}
+
+static
+ULONG
+Hx85xElapsed(
+	IN LARGE_INTEGER Start,
+	IN LARGE_INTEGER Frequency
+)
+{
+	return (ULONG)((ULONG64)(KeQueryPerformanceCounter(NULL).QuadPart - Start.QuadPart) *
+		1000000 / (ULONG64)Frequency.QuadPart);
+}
+
+static
+VOID
+Hx85xWait(
+	IN ULONG Time
+)
+{
+	LARGE_INTEGER delay;
+
+	//
+	// Short waits are below the timer resolution, sleeping would take
+	// a whole tick instead
+	//
+	if (Time <= HX85X_READY_STALL_LIMIT)
+	{
+		KeStallExecutionProcessor(Time);
+	}
+	else
+	{
+		delay.QuadPart = -10 * (LONGLONG)Time;
+		KeDelayExecutionThread(KernelMode, TRUE, &delay);
+	}
+}
+
+static
+NTSTATUS
+Hx85xReadStep(
+	IN SPB_CONTEXT* SpbContext,
+	IN const HX85X_SEQUENCE_STEP* Step,
+	OUT PUCHAR Value
+)
+{
+	NTSTATUS status;
+	UCHAR match;
+
+	*Value = 0;
+
+	status = SpbReadDataSynchronously(
+		SpbContext,
+		(PUCHAR)Step->Data,
+		Step->Length,
+		Value,
+		sizeof(UCHAR));
+
+	if (!NT_SUCCESS(status))
+	{
+		return status;
+	}
+
+	match = (UCHAR)((*Value & Step->Mask) == Step->Expected);
+
+	if ((Step->Flags & HX85X_STEP_NOT_EQUAL) != 0)
+	{
+		match = !match;
+	}
+
+	return match ? STATUS_SUCCESS : STATUS_DEVICE_DATA_ERROR;
+}
+
+static
+NTSTATUS
+Hx85xPollStep(
+	IN SPB_CONTEXT* SpbContext,
+	IN const HX85X_SEQUENCE_STEP* Step
+)
+{
+	NTSTATUS status;
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER start;
+	ULONG interval = HX85X_READY_POLL_INTERVAL;
+	ULONG elapsed;
+	ULONG polls = 0;
+	UCHAR value;
+
+	start = KeQueryPerformanceCounter(&frequency);
+
+	//
+	// The first poll is issued right away, the interval then doubles
+	// until Time has passed
+	//
+	for (;;)
+	{
+		polls++;
+
+		status = Hx85xReadStep(SpbContext, Step, &value);
+		elapsed = Hx85xElapsed(start, frequency);
+
+		if (NT_SUCCESS(status))
+		{
+			Trace(
+				TRACE_LEVEL_VERBOSE,
+				TRACE_INIT,
+				"Controller ready after %d us, %d polls",
+				elapsed,
+				polls);
+
+			return STATUS_SUCCESS;
+		}
+
+		if (elapsed >= Step->Time)
+		{
+			break;
+		}
+
+		interval = min(interval, Step->Time - elapsed);
+		Hx85xWait(interval);
+		interval *= 2;
+	}
+
+	Trace(
+		TRACE_LEVEL_ERROR,
+		TRACE_INIT,
+		"Controller not ready after %d us, %d polls - 0x%08lX, status %02X",
+		elapsed,
+		polls,
+		status,
+		value);
+
+	return STATUS_IO_TIMEOUT;
+}
+
+NTSTATUS
+Hx85xRunSteps(
+	IN SPB_CONTEXT* SpbContext,
+	IN const HX85X_SEQUENCE_STEP* Steps,
+	IN ULONG Count,
+	OUT PULONG Time
+)
+/*++
+
+Routine Description:
+
+	Runs sequence steps in order. A failing step ends the run unless it
+	is flagged optional.
+
+Arguments:
+
+	SpbContext - A pointer to the current i2c context
+
+	Steps - The steps to run
+
+	Count - Number of steps
+
+	Time - Receives the duration of the run in microseconds
+
+Return Value:
+
+	NTSTATUS of the step that ended the run, or STATUS_SUCCESS
+
+--*/
+{
+	NTSTATUS status = STATUS_SUCCESS;
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER start;
+	LARGE_INTEGER step;
+	UCHAR value;
+	ULONG i;
+
+	start = KeQueryPerformanceCounter(&frequency);
+
+	for (i = 0; i < Count; i++)
+	{
+		step = KeQueryPerformanceCounter(NULL);
+
+		switch (Steps[i].Operation)
+		{
+		case HX85X_STEP_WRITE:
+			status = SpbWriteDataSynchronously(
+				SpbContext,
+				(PUCHAR)Steps[i].Data,
+				Steps[i].Length,
+				NULL,
+				0);
+			break;
+
+		case HX85X_STEP_READ:
+			status = Hx85xReadStep(SpbContext, &Steps[i], &value);
+			break;
+
+		case HX85X_STEP_POLL:
+			status = Hx85xPollStep(SpbContext, &Steps[i]);
+			break;
+
+		case HX85X_STEP_DELAY:
+			Hx85xWait(Steps[i].Time);
+			status = STATUS_SUCCESS;
+			break;
+
+		default:
+			status = STATUS_INVALID_PARAMETER;
+			break;
+		}
+
+		Trace(
+			TRACE_LEVEL_VERBOSE,
+			TRACE_INIT,
+			"Step %d (operation %d, %02X) took %d us - 0x%08lX",
+			i,
+			Steps[i].Operation,
+			Steps[i].Data[0],
+			Hx85xElapsed(step, frequency),
+			status);
+
+		if (!NT_SUCCESS(status))
+		{
+			if ((Steps[i].Flags & HX85X_STEP_OPTIONAL) == 0)
+			{
+				break;
+			}
+
+			//
+			// Carrying on is what the fixed delays did, but a controller
+			// that missed its bound is worth knowing about
+			//
+			Trace(
+				TRACE_LEVEL_ERROR,
+				TRACE_INIT,
+				"Optional step %d (operation %d, %02X) failed, continuing - 0x%08lX",
+				i,
+				Steps[i].Operation,
+				Steps[i].Data[0],
+				status);
+
+			status = STATUS_SUCCESS;
+		}
+	}
+
+	*Time = Hx85xElapsed(start, frequency);
+
+	return status;
+}
+
+NTSTATUS
+Hx85xRunSequence(
+	IN HX85X_SEQUENCE* Sequences,
+	IN HX85X_SEQUENCE_ID Id,
+	IN SPB_CONTEXT* SpbContext
+)
+/*++
+
+Routine Description:
+
+	Runs one of the controller sequences and records how long it took
+
+Arguments:
+
+	Sequences - HX85X_SEQUENCE_COUNT sequences
+
+	Id - The sequence to run
+
+	SpbContext - A pointer to the current i2c context
+
+Return Value:
+
+	NTSTATUS indicating success or failure
+
+--*/
+{
+	NTSTATUS status;
+
+	status = Hx85xRunSteps(
+		SpbContext,
+		Sequences[Id].Steps,
+		Sequences[Id].Count,
+		&Sequences[Id].Time);
+
+	Trace(
+		TRACE_LEVEL_INFORMATION,
+		TRACE_INIT,
+		"%ws took %d us - 0x%08lX",
+		gSequences[Id].ValueName,
+		Sequences[Id].Time,
+		status);
+
+	return status;
+}
+
+NTSTATUS
+Hx85xWaitForReady(
+	IN SPB_CONTEXT* SpbContext,
+	IN ULONG Timeout,
+	IN BOOLEAN Sensing
+)
+/*++
+
+Routine Description:
+
+	Polls the controller until it reads back its chip ID, or with
+	Sensing set until its sleep status reports sensing, for at most
+	Timeout.
+
+Arguments:
+
+	SpbContext - A pointer to the current i2c context
+
+	Timeout - Upper bound of the wait in microseconds
+
+	Sensing - Wait for sensing instead of the chip ID
+
+Return Value:
+
+	STATUS_SUCCESS once ready, STATUS_IO_TIMEOUT when the bound passed
+
+--*/
+{
+	HX85X_SEQUENCE_STEP step = HX85X_POLL_POWERED(0);
+
+	step.Flags = 0;
+	step.Time = Timeout;
+
+	if (Sensing)
+	{
+		step.Flags = HX85X_STEP_NOT_EQUAL;
+		step.Data[0] = 0x63;
+		step.Expected = 0x00;
+	}
+
+	return Hx85xPollStep(SpbContext, &step);
+}
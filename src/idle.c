@@ -25,6 +25,63 @@
 #include <idle.h>
 #include <idle.tmh>
 
+NTSTATUS
+TchIdleInitialize(
+    IN WDFDEVICE FxDevice
+)
+/*++
+
+Routine Description:
+
+   Creates the work item idle callbacks are made from. It is reused for
+   every idle notification request and lives as long as the device.
+
+Arguments:
+
+   FxDevice - Handle to WDF Device Object
+
+Return Value:
+
+   NTSTATUS indicating success or failure
+
+--*/
+{
+    PDEVICE_EXTENSION devContext;
+    WDF_OBJECT_ATTRIBUTES workItemAttributes;
+    WDF_WORKITEM_CONFIG workitemConfig;
+    NTSTATUS status;
+
+    devContext = GetDeviceContext(FxDevice);
+
+    WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(&workItemAttributes, IDLE_WORKITEM_CONTEXT);
+    workItemAttributes.ParentObject = FxDevice;
+
+    WDF_WORKITEM_CONFIG_INIT(&workitemConfig, TchIdleIrpWorkitem);
+
+    status = WdfWorkItemCreate(
+        &workitemConfig,
+        &workItemAttributes,
+        &devContext->IdleWorkItem
+    );
+
+    if (!NT_SUCCESS(status))
+    {
+        Trace(
+            TRACE_LEVEL_ERROR,
+            TRACE_IDLE,
+            "Error creating idle work item - 0x%08lX",
+            status);
+
+        goto exit;
+    }
+
+    GetWorkItemContext(devContext->IdleWorkItem)->FxDevice = FxDevice;
+
+exit:
+
+    return status;
+}
+
 NTSTATUS
 TchProcessIdleRequest(
     IN WDFDEVICE Device,
@@ -118,53 +175,40 @@ Return Value:
         goto exit;
     }
 
+    InterlockedIncrement(&devContext->IdleStatistics.Requests);
+
+    //
+    // HIDClass has at most one idle notification outstanding. Should a
+    // second one arrive while the work item still holds the first, it
+    // is failed rather than overwriting the request the item works on.
+    //
+    if (InterlockedCompareExchange(&devContext->IdleWorkItemBusy, TRUE, FALSE) != FALSE)
     {
-        //
-        // Create a workitem for the idle callback
-        //
-        WDF_OBJECT_ATTRIBUTES workItemAttributes;
-        WDF_WORKITEM_CONFIG workitemConfig;
-        WDFWORKITEM idleWorkItem;
-        PIDLE_WORKITEM_CONTEXT idleWorkItemContext;
-
-        WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(&workItemAttributes, IDLE_WORKITEM_CONTEXT);
-        workItemAttributes.ParentObject = devContext->FxDevice;
-
-        WDF_WORKITEM_CONFIG_INIT(&workitemConfig, TchIdleIrpWorkitem);
-
-        status = WdfWorkItemCreate(
-            &workitemConfig,
-            &workItemAttributes,
-            &idleWorkItem
-        );
-
-        if (!NT_SUCCESS(status)) {
-            Trace(
-                TRACE_LEVEL_ERROR,
-                TRACE_HID,
-                "Error creating creating idle work item - 0x%08lX",
-                status);
-            goto exit;
-        }
+        InterlockedIncrement(&devContext->IdleStatistics.Rejected);
 
-        //
-        // Set the workitem context
-        //
-        idleWorkItemContext = GetWorkItemContext(idleWorkItem);
-        idleWorkItemContext->FxDevice = devContext->FxDevice;
-        idleWorkItemContext->FxRequest = Request;
+        status = STATUS_DEVICE_BUSY;
+        Trace(
+            TRACE_LEVEL_ERROR,
+            TRACE_HID,
+            "Error: Idle Notification request %p while another is in progress - 0x%08lX",
+            Request,
+            status);
+        goto exit;
+    }
 
-        //
-        // Enqueue a workitem for the idle callback
-        //
-        WdfWorkItemEnqueue(idleWorkItem);
+    devContext->IdleStatistics.RequestTime = KeQueryInterruptTime();
 
-        //
-        // Mark the request as pending so that 
-        // we can complete it when we come out of idle
-        //
-        *Pending = TRUE;
-    }
+    //
+    // Hand the request to the idle work item
+    //
+    GetWorkItemContext(devContext->IdleWorkItem)->FxRequest = Request;
+    WdfWorkItemEnqueue(devContext->IdleWorkItem);
+
+    //
+    // Mark the request as pending so that 
+    // we can complete it when we come out of idle
+    //
+    *Pending = TRUE;
 
 exit:
 
@@ -212,8 +256,13 @@ Return Value:
         Parameters.DeviceIoControl.Type3InputBuffer;
 
     //
-    // idleCallbackInfo is validated already, so invoke idle callback
+    // idleCallbackInfo is validated already, so invoke idle callback. It
+    // may take the device to D3 before returning.
     //
+    deviceContext->IdleStatistics.CallbackTime = KeQueryInterruptTime();
+    deviceContext->IdleStatistics.RequestToCallback = (ULONG)(
+        (deviceContext->IdleStatistics.CallbackTime - deviceContext->IdleStatistics.RequestTime) / 10);
+
     idleCallbackInfo->IdleCallback(idleCallbackInfo->IdleContext);
 
     //
@@ -258,9 +307,10 @@ Return Value:
     }
 
     //
-    // Delete the workitem since we're done with it
+    // The work item may take the next idle notification now
     //
-    WdfObjectDelete(IdleWorkItem);
+    idleWorkItemContext->FxRequest = NULL;
+    InterlockedExchange(&deviceContext->IdleWorkItemBusy, FALSE);
 
     return;
 }
@@ -290,6 +340,12 @@ Return Value:
     NTSTATUS status;
     WDFREQUEST request = NULL;
 
+    //
+    // A callback that did not take the device to D3 before it came back
+    // to D0 is not the cause of a later D3
+    //
+    FxDeviceContext->IdleStatistics.CallbackTime = 0;
+
     //
     // Lets try to retrieve the Idle IRP from the Idle queue
     //
@@ -326,4 +382,45 @@ Return Value:
     }
 
     return;
+}
+
+VOID
+TchIdleTrackD3Entry(
+    IN PDEVICE_EXTENSION FxDeviceContext
+)
+/*++
+
+Routine Description:
+
+    This is invoked when we leave D0. When an idle callback led to it,
+    the time from the callback to D3 is recorded.
+
+Arguments:
+
+    FxDeviceContext -  Pointer to Device Context for the device
+
+Return Value:
+
+    None.
+
+--*/
+{
+    PTOUCH_IDLE_STATISTICS statistics = &FxDeviceContext->IdleStatistics;
+
+    if (statistics->CallbackTime == 0)
+    {
+        return;
+    }
+
+    statistics->CallbackToD3 = (ULONG)((KeQueryInterruptTime() - statistics->CallbackTime) / 10);
+    statistics->CallbackTime = 0;
+
+    Trace(
+        TRACE_LEVEL_INFORMATION,
+        TRACE_IDLE,
+        "Idle request %d: %lu us to callback, %lu us from callback to D3, %d rejected",
+        statistics->Requests,
+        statistics->RequestToCallback,
+        statistics->CallbackToD3,
+        statistics->Rejected);
 }
\ No newline at end of file
@@ -145,6 +145,32 @@ exit:
 	return status;
 }
 
+NTSTATUS
+TchWaitForDevice(
+	IN SPB_CONTEXT* SpbContext,
+	IN ULONG Timeout
+)
+/*++
+
+Routine Description:
+
+	This routine waits for the controller to read back its chip ID after
+	it was taken out of reset, for at most the given time.
+
+Arguments:
+
+	SpbContext - A pointer to the current i2c context
+
+	Timeout - Upper bound of the wait in microseconds
+
+Return Value:
+
+	STATUS_SUCCESS once the controller is ready, STATUS_IO_TIMEOUT otherwise
+--*/
+{
+	return Hx85xWaitForReady(SpbContext, Timeout, FALSE);
+}
+
 NTSTATUS
 TchStopDevice(
 	IN VOID* ControllerContext,
@@ -219,10 +245,7 @@ Return Value:
 	RtlZeroMemory(context, sizeof(HX85X_CONTROLLER_CONTEXT));
 	context->FxDevice = FxDevice;
 
-	//
-	// Get Touch settings and populate context
-	//
-	TchGetTouchSettings(&context->TouchSettings);
+	Hx85xInitializeSequences(context->Sequences);
 
 	//
 	// Allocate a WDFWAITLOCK for guarding access to the
@@ -277,6 +300,7 @@ Return Value:
 
 	if (controller != NULL)
 	{
+		Hx85xFreeSequences(controller->Sequences);
 
 		if (controller->ControllerLock != NULL)
 		{
@@ -25,8 +25,444 @@
 #include <hx85x\hxinternal.h>
 #include <internal.h>
 #include <touch_power\touch_power.h>
+#include <device.h>
 #include <power.tmh>
 
+static
+NTSTATUS
+TchSetReportingMode(
+    IN PDEVICE_EXTENSION DevContext,
+    IN UCHAR Mode
+)
+{
+    NTSTATUS status;
+
+    //
+    // Serialized with the ISR, which feeds the wake gesture detector, and
+    // with the doze timer, which opens the scan windows the gesture is
+    // watched in when the doze is polled
+    //
+    WdfInterruptAcquireLock(DevContext->InterruptObject);
+
+    status = Hx85xSetReportingFlags(
+        (HX85X_CONTROLLER_CONTEXT*)DevContext->TouchContext,
+        &DevContext->I2CContext,
+        Mode,
+        NULL
+    );
+
+    TchArmDozeTimer(DevContext);
+
+    WdfInterruptReleaseLock(DevContext->InterruptObject);
+
+    return status;
+}
+
+static
+VOID
+TchDisplayRailComplete(
+    IN PVOID Context,
+    IN NTSTATUS Status
+)
+/*++
+
+Routine Description:
+
+    Called once the touch power rail toggle of a display transition
+    completed, possibly at dispatch level. The controller is configured
+    from the display state work item.
+
+Arguments:
+
+    Context - The device context
+
+    Status - Status of the rail toggle
+
+Return Value:
+
+    None.
+
+--*/
+{
+    PDEVICE_EXTENSION devContext = (PDEVICE_EXTENSION)Context;
+
+    devContext->Display.RailStatus = Status;
+    devContext->Display.RailLatency = devContext->TouchPowerContext.ToggleLatency;
+
+    WdfWorkItemEnqueue(devContext->Display.WorkItem);
+}
+
+static
+VOID
+TchStartDisplayStateTransition(
+    IN PDEVICE_EXTENSION DevContext
+)
+/*++
+
+Routine Description:
+
+    Starts a transition to the requested display state, unless one is
+    running already or the requested state is applied. Does not wait for
+    the transition.
+
+Arguments:
+
+    DevContext - The device context
+
+Return Value:
+
+    None.
+
+--*/
+{
+    PTOUCH_DISPLAY_CONTEXT display = &DevContext->Display;
+    NTSTATUS status;
+
+    if (!TchDisplayBeginTransition(display))
+    {
+        return;
+    }
+
+    status = PowerToggle(
+        &DevContext->TouchPowerContext,
+        (DWORD)display->Target,
+        TchDisplayRailComplete,
+        DevContext);
+
+    if (status != STATUS_PENDING)
+    {
+        //
+        // Nothing in flight, go on with the controller right away
+        //
+        display->RailStatus = status;
+        WdfWorkItemEnqueue(display->WorkItem);
+    }
+}
+
+static
+VOID
+TchRequestDisplayState(
+    IN PDEVICE_EXTENSION DevContext,
+    IN LONG State
+)
+/*++
+
+Routine Description:
+
+    Feeds a display state change to the display state machine:
+
+      On       cancels a pending display off and transitions right away
+      Dimmed   cancels a pending display off, the applied state is kept
+      Off      transitions once OffTimer expires, unless already pending
+               or requested
+
+    Transitions run in the background, this routine does not wait for
+    them.
+
+Arguments:
+
+    DevContext - The device context
+
+    State - TOUCH_DISPLAY_OFF, TOUCH_DISPLAY_ON or TOUCH_DISPLAY_DIMMED
+
+Return Value:
+
+    None.
+
+--*/
+{
+    PTOUCH_DISPLAY_CONTEXT display = &DevContext->Display;
+    ULONG actions;
+    KIRQL irql;
+
+    KeAcquireSpinLock(&display->Lock, &irql);
+
+    actions = TchDisplayRequest(display, State);
+
+    if (actions & TOUCH_DISPLAY_STOP_OFF_TIMER)
+    {
+        WdfTimerStop(display->OffTimer, FALSE);
+    }
+
+    if (actions & TOUCH_DISPLAY_START_OFF_TIMER)
+    {
+        WdfTimerStart(display->OffTimer, WDF_REL_TIMEOUT_IN_MS(TOUCH_DISPLAY_OFF_DEBOUNCE));
+    }
+
+    KeReleaseSpinLock(&display->Lock, irql);
+
+    if (actions & TOUCH_DISPLAY_TRANSITION)
+    {
+        TchStartDisplayStateTransition(DevContext);
+    }
+}
+
+VOID
+OnDisplayOffTimer(
+    IN WDFTIMER Timer
+)
+/*++
+
+Routine Description:
+
+    Requests display off once the display stayed off for the debounce
+    time
+
+Arguments:
+
+    Timer - The display off timer, parented to the device
+
+Return Value:
+
+    None.
+
+--*/
+{
+    PDEVICE_EXTENSION devContext = GetDeviceContext(WdfTimerGetParentObject(Timer));
+    PTOUCH_DISPLAY_CONTEXT display = &devContext->Display;
+    BOOLEAN start = FALSE;
+    KIRQL irql;
+
+    KeAcquireSpinLock(&display->Lock, &irql);
+    start = TchDisplayOffTimer(display);
+    KeReleaseSpinLock(&display->Lock, irql);
+
+    if (start)
+    {
+        TchStartDisplayStateTransition(devContext);
+    }
+}
+
+VOID
+OnDisplayStateWorkItem(
+    IN WDFWORKITEM WorkItem
+)
+/*++
+
+Routine Description:
+
+    Finishes a display transition once the touch power rail is toggled,
+    by configuring the controller reporting mode for the new state, then
+    starts the next transition if the state changed meanwhile
+
+Arguments:
+
+    WorkItem - The display state work item, parented to the device
+
+Return Value:
+
+    None.
+
+--*/
+{
+    PDEVICE_EXTENSION devContext = GetDeviceContext(WdfWorkItemGetParentObject(WorkItem));
+    PTOUCH_DISPLAY_CONTEXT display = &devContext->Display;
+    NTSTATUS status = display->RailStatus;
+
+    if (!NT_SUCCESS(status))
+    {
+        Trace(
+            TRACE_LEVEL_ERROR,
+            TRACE_POWER,
+            "Error changing touch power state - 0x%08lX",
+            status);
+    }
+    else if (display->Target == TOUCH_DISPLAY_ON)
+    {
+        status = TchSetReportingMode(devContext, HX85X_REPORTING_CONTINUOUS_MODE);
+    }
+    else if (devContext->RuntimeSettings.WakeupGestureEnabled)
+    {
+        status = TchSetReportingMode(devContext, HX85X_REPORTING_WAKEUP_GESTURE_MODE);
+    }
+
+    if (NT_SUCCESS(display->RailStatus) && !NT_SUCCESS(status))
+    {
+        Trace(
+            TRACE_LEVEL_ERROR,
+            TRACE_POWER,
+            "Error Changing Reporting Mode for F12 - 0x%08lX",
+            status);
+    }
+
+    TchDisplayEndTransition(display, status);
+
+    PowerStatsRecordTransition(
+        &devContext->PowerStats,
+        display->Applied == TOUCH_DISPLAY_ON ? TOUCH_POWER_TRANSITION_DISPLAY_ON : TOUCH_POWER_TRANSITION_DISPLAY_OFF,
+        display->Latency,
+        NT_SUCCESS(status));
+
+    PowerStatsEnterState(
+        &devContext->PowerStats,
+        display->Applied == TOUCH_DISPLAY_ON ? TOUCH_POWER_STATE_DISPLAY_ON :
+            devContext->RuntimeSettings.WakeupGestureEnabled ? TOUCH_POWER_STATE_WAKE_GESTURE :
+            TOUCH_POWER_STATE_DISPLAY_OFF);
+
+    Trace(
+        TRACE_LEVEL_INFORMATION,
+        TRACE_POWER,
+        "Display state %ld applied in %lu us, %lu us of it toggling the rail (max %lu us, %lu transitions, %lu failed, %lu cancelled, %ld skipped)",
+        display->Applied,
+        display->Latency,
+        display->RailLatency,
+        display->MaxLatency,
+        display->Transitions,
+        display->Failures,
+        display->Cancelled,
+        display->Skipped);
+
+    if (TchDisplayRelease(display))
+    {
+        TchStartDisplayStateTransition(devContext);
+    }
+}
+
+VOID
+TchRestoreReportingMode(
+    IN PDEVICE_EXTENSION DevContext
+)
+/*++
+
+Routine Description:
+
+    Re-arms the wake gesture after D0 entry when the display is off, as
+    the controller leaves wake gesture mode when put to sleep. A display
+    transition running meanwhile sets the mode itself once it ends.
+
+Arguments:
+
+    DevContext - The device context
+
+Return Value:
+
+    None.
+
+--*/
+{
+    PTOUCH_DISPLAY_CONTEXT display = &DevContext->Display;
+    NTSTATUS status;
+
+    if (!TchDisplayAcquire(display))
+    {
+        return;
+    }
+
+    if (!display->Stopping &&
+        display->Applied == TOUCH_DISPLAY_OFF &&
+        DevContext->RuntimeSettings.WakeupGestureEnabled)
+    {
+        status = TchSetReportingMode(DevContext, HX85X_REPORTING_WAKEUP_GESTURE_MODE);
+
+        if (!NT_SUCCESS(status))
+        {
+            Trace(
+                TRACE_LEVEL_ERROR,
+                TRACE_POWER,
+                "Error re-arming the wake gesture after D0 entry - 0x%08lX",
+                status);
+        }
+        else
+        {
+            Trace(
+                TRACE_LEVEL_INFORMATION,
+                TRACE_POWER,
+                "Wake gesture re-armed after D0 entry");
+        }
+    }
+
+    if (TchDisplayRelease(display))
+    {
+        TchStartDisplayStateTransition(DevContext);
+    }
+}
+
+VOID
+TchStartDisplayStateTransitions(
+    IN PDEVICE_EXTENSION DevContext
+)
+/*++
+
+Routine Description:
+
+    Prepares display state handling before the display state callback is
+    registered. The first notification always causes a transition.
+
+Arguments:
+
+    DevContext - The device context
+
+Return Value:
+
+    None.
+
+--*/
+{
+    TchDisplayReset(&DevContext->Display);
+}
+
+VOID
+TchStopDisplayStateTransitions(
+    IN PDEVICE_EXTENSION DevContext
+)
+/*++
+
+Routine Description:
+
+    Waits for a running display transition to end once the display state
+    callback is unregistered, no further transition is started. A rail
+    toggle taking too long is cancelled.
+
+Arguments:
+
+    DevContext - The device context
+
+Return Value:
+
+    None.
+
+--*/
+{
+    PTOUCH_DISPLAY_CONTEXT display = &DevContext->Display;
+    LARGE_INTEGER timeout;
+    NTSTATUS status;
+    KIRQL irql;
+
+    KeAcquireSpinLock(&display->Lock, &irql);
+    TchDisplayStop(display);
+    KeReleaseSpinLock(&display->Lock, irql);
+
+    WdfTimerStop(display->OffTimer, TRUE);
+
+    timeout.QuadPart = -10000LL * TOUCH_DISPLAY_STOP_TIMEOUT;
+
+    status = KeWaitForSingleObject(
+        &display->Idle,
+        Executive,
+        KernelMode,
+        FALSE,
+        &timeout);
+
+    if (status == STATUS_TIMEOUT)
+    {
+        Trace(
+            TRACE_LEVEL_WARNING,
+            TRACE_POWER,
+            "Display transition still running on stop, cancelling the rail toggle");
+
+        PowerCancelToggle(&DevContext->TouchPowerContext);
+
+        KeWaitForSingleObject(
+            &display->Idle,
+            Executive,
+            KernelMode,
+            FALSE,
+            NULL);
+    }
+
+    WdfWorkItemFlush(display->WorkItem);
+}
+
 NTSTATUS
 TchPowerSettingCallback(
     _In_ LPCGUID SettingGuid,
@@ -156,105 +592,32 @@ TchPowerSettingCallback(
         }
 
         DWORD DisplayState = *(DWORD*)Value;
-        DWORD GestureEnabled = 0;
 
         switch (DisplayState)
         {
-        case 0:
+        case TOUCH_DISPLAY_OFF:
             Trace(
                 TRACE_LEVEL_INFORMATION,
                 TRACE_POWER,
                 "The Display is Off");
 
-            status = PowerToggle(&devContext->TouchPowerContext, 0);
-
-            if (!NT_SUCCESS(status))
-            {
-                Trace(
-                    TRACE_LEVEL_ERROR,
-                    TRACE_POWER,
-                    "Error changing touch power state - 0x%08lX",
-                    status);
-                goto exit;
-            }
-
-            if (NT_SUCCESS(RtlReadRegistryValue(
-                (PCWSTR)L"\\Registry\\Machine\\SOFTWARE\\OEM\\Nokia\\Touch\\WakeupGesture",
-                (PCWSTR)L"Enabled",
-                REG_DWORD,
-                &GestureEnabled,
-                sizeof(DWORD))) && GestureEnabled == 1)
-            {
-                status = Hx85xSetReportingFlags(
-                    ControllerContext,
-                    SpbContext,
-                    HX85X_REPORTING_WAKEUP_GESTURE_MODE,
-                    NULL
-                );
-
-                if (!NT_SUCCESS(status))
-                {
-                    Trace(
-                        TRACE_LEVEL_ERROR,
-                        TRACE_POWER,
-                        "Error Changing Reporting Mode for F12 - 0x%08lX",
-                        status);
-                    goto exit;
-                }
-            }
-
-            if (!NT_SUCCESS(status))
-            {
-                Trace(
-                    TRACE_LEVEL_ERROR,
-                    TRACE_POWER,
-                    "Error Changing Reporting Mode for F12 - 0x%08lX",
-                    status);
-                goto exit;
-            }
-
+            TchRequestDisplayState(devContext, TOUCH_DISPLAY_OFF);
             break;
-        case 1:
+        case TOUCH_DISPLAY_ON:
             Trace(
                 TRACE_LEVEL_INFORMATION,
                 TRACE_POWER,
                 "The Display is On");
 
-            status = PowerToggle(&devContext->TouchPowerContext, 1);
-
-            if (!NT_SUCCESS(status))
-            {
-                Trace(
-                    TRACE_LEVEL_ERROR,
-                    TRACE_POWER,
-                    "Error changing touch power state - 0x%08lX",
-                    status);
-                goto exit;
-            }
-
-            status = Hx85xSetReportingFlags(
-                ControllerContext,
-                SpbContext,
-                HX85X_REPORTING_CONTINUOUS_MODE,
-                NULL
-            );
-
-            if (!NT_SUCCESS(status))
-            {
-                Trace(
-                    TRACE_LEVEL_ERROR,
-                    TRACE_POWER,
-                    "Error Changing Reporting Mode for F12 - 0x%08lX",
-                    status);
-                goto exit;
-            }
+            TchRequestDisplayState(devContext, TOUCH_DISPLAY_ON);
             break;
-        case 2:
+        case TOUCH_DISPLAY_DIMMED:
             Trace(
                 TRACE_LEVEL_INFORMATION,
                 TRACE_POWER,
                 "The Display is Dimmed");
 
+            TchRequestDisplayState(devContext, TOUCH_DISPLAY_DIMMED);
             break;
         default:
             Trace(
@@ -313,12 +676,12 @@ Return Value:
     controller->DevicePowerState = PowerDeviceD0;
 
     //
-    // Attempt to put the controller into operating mode 
+    // Attempt to put the controller into operating mode, sending only
+    // the commands it still needs
     //
-    status = Hx85xChangeSleepState(
+    status = Hx85xResumeController(
         controller,
-        SpbContext,
-        HX85X_F01_DEVICE_CONTROL_SLEEP_MODE_OPERATING);
+        SpbContext);
 
     if (!NT_SUCCESS(status))
     {
@@ -408,6 +771,9 @@ Return Value:
     ((PREPORT_CONTEXT)ReportContext)->ButtonCache.ButtonSlots[0] = 0;
     ((PREPORT_CONTEXT)ReportContext)->ButtonCache.ButtonSlots[1] = 0;
     ((PREPORT_CONTEXT)ReportContext)->ButtonCache.ButtonSlots[2] = 0;
+    TrackerReset(&((PREPORT_CONTEXT)ReportContext)->Tracker);
+    FilterReset(&((PREPORT_CONTEXT)ReportContext)->Filter);
+    PredictReset(&((PREPORT_CONTEXT)ReportContext)->Predict);
 
 
     WdfWaitLockRelease(controller->ControllerLock);
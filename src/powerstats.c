@@ -0,0 +1,225 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		powerstats.c
+
+	Abstract:
+
+		Keeps entry counts and cumulative residency of the device power
+		and display states, and counts plus a latency histogram of each
+		power transition, for diagnostics tools to read.
+
+	Environment:
+
+		Kernel mode
+
+	Revision History:
+
+--*/
+
+#include <powerstats.h>
+
+VOID
+PowerStatsInitialize(
+	OUT PTOUCH_POWER_TELEMETRY Telemetry
+)
+/*++
+
+Routine Description:
+
+	Clears all statistics and starts tracking, with no state entered
+
+Arguments:
+
+	Telemetry - The telemetry to initialize
+
+Return Value:
+
+	None.
+
+--*/
+{
+	RtlZeroMemory(Telemetry, sizeof(TOUCH_POWER_TELEMETRY));
+
+	KeInitializeSpinLock(&Telemetry->Lock);
+
+	Telemetry->Statistics.Version = TOUCH_POWER_STATISTICS_VERSION;
+	Telemetry->Statistics.Size = sizeof(TOUCH_POWER_STATISTICS);
+	Telemetry->StartTime = KeQueryInterruptTime();
+	Telemetry->DeviceState = TOUCH_POWER_STATE_COUNT;
+	Telemetry->DisplayState = TOUCH_POWER_STATE_COUNT;
+}
+
+static
+VOID
+PowerStatsLeaveState(
+	IN PTOUCH_POWER_STATISTICS Statistics,
+	IN TOUCH_POWER_STATE State,
+	IN ULONG64 EnterTime,
+	IN ULONG64 Now
+)
+{
+	if (State < TOUCH_POWER_STATE_COUNT)
+	{
+		Statistics->States[State].Residency += (Now - EnterTime) / 10;
+	}
+}
+
+VOID
+PowerStatsEnterState(
+	IN PTOUCH_POWER_TELEMETRY Telemetry,
+	IN TOUCH_POWER_STATE State
+)
+/*++
+
+Routine Description:
+
+	Ends the current state of the group State belongs to and enters
+	State. Entering the current state again only counts the entry.
+
+Arguments:
+
+	Telemetry - The telemetry
+
+	State - The state entered
+
+Return Value:
+
+	None.
+
+--*/
+{
+	TOUCH_POWER_STATE* current;
+	PULONG64 enterTime;
+	ULONG64 now;
+	KIRQL irql;
+
+	KeAcquireSpinLock(&Telemetry->Lock, &irql);
+
+	now = KeQueryInterruptTime();
+
+	if (State < TOUCH_POWER_FIRST_DISPLAY_STATE)
+	{
+		current = &Telemetry->DeviceState;
+		enterTime = &Telemetry->DeviceStateTime;
+	}
+	else
+	{
+		current = &Telemetry->DisplayState;
+		enterTime = &Telemetry->DisplayStateTime;
+	}
+
+	PowerStatsLeaveState(&Telemetry->Statistics, *current, *enterTime, now);
+
+	*current = State;
+	*enterTime = now;
+	Telemetry->Statistics.States[State].Entries++;
+
+	KeReleaseSpinLock(&Telemetry->Lock, irql);
+}
+
+VOID
+PowerStatsRecordTransition(
+	IN PTOUCH_POWER_TELEMETRY Telemetry,
+	IN TOUCH_POWER_TRANSITION Transition,
+	IN ULONG Latency,
+	IN BOOLEAN Succeeded
+)
+/*++
+
+Routine Description:
+
+	Accounts one power transition
+
+Arguments:
+
+	Telemetry - The telemetry
+
+	Transition - The kind of transition
+
+	Latency - Time the transition took in microseconds
+
+	Succeeded - FALSE when the transition failed
+
+Return Value:
+
+	None.
+
+--*/
+{
+	TOUCH_POWER_TRANSITION_STATISTICS* transition;
+	ULONG bucket = 0;
+	ULONG value = Latency >> TOUCH_POWER_HISTOGRAM_SHIFT;
+	KIRQL irql;
+
+	while (value != 0 && bucket < TOUCH_POWER_HISTOGRAM_BUCKETS - 1)
+	{
+		value >>= 1;
+		bucket++;
+	}
+
+	KeAcquireSpinLock(&Telemetry->Lock, &irql);
+
+	transition = &Telemetry->Statistics.Transitions[Transition];
+	transition->Count++;
+	transition->LastLatency = Latency;
+	transition->MaxLatency = max(transition->MaxLatency, Latency);
+	transition->TotalLatency += Latency;
+	transition->Histogram[bucket]++;
+
+	if (!Succeeded)
+	{
+		transition->Failures++;
+	}
+
+	KeReleaseSpinLock(&Telemetry->Lock, irql);
+}
+
+VOID
+PowerStatsSnapshot(
+	IN PTOUCH_POWER_TELEMETRY Telemetry,
+	IN PTOUCH_DISPLAY_CONTEXT Display,
+	OUT PTOUCH_POWER_STATISTICS Statistics
+)
+/*++
+
+Routine Description:
+
+	Copies the statistics out, with the residency of the current states
+	counted up to now and the display transitions avoided so far
+
+Arguments:
+
+	Telemetry - The telemetry
+
+	Display - The display state, which counts the avoided transitions
+
+	Statistics - Receives the statistics
+
+Return Value:
+
+	None.
+
+--*/
+{
+	ULONG64 now;
+	KIRQL irql;
+
+	KeAcquireSpinLock(&Telemetry->Lock, &irql);
+
+	now = KeQueryInterruptTime();
+
+	RtlCopyMemory(Statistics, &Telemetry->Statistics, sizeof(TOUCH_POWER_STATISTICS));
+
+	Statistics->Time = (now - Telemetry->StartTime) / 10;
+
+	PowerStatsLeaveState(Statistics, Telemetry->DeviceState, Telemetry->DeviceStateTime, now);
+	PowerStatsLeaveState(Statistics, Telemetry->DisplayState, Telemetry->DisplayStateTime, now);
+
+	KeReleaseSpinLock(&Telemetry->Lock, irql);
+
+	Statistics->DisplayOffCancelled = Display->Cancelled;
+	Statistics->DisplaySkipped = (ULONG)Display->Skipped;
+}
@@ -0,0 +1,284 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		predict.c
+
+	Abstract:
+
+		Extrapolates contact positions a short time ahead to hide part of
+		the fixed scan to display latency. All math is fixed point.
+
+	Environment:
+
+		Kernel mode
+
+	Revision History:
+
+--*/
+
+#include <predict.h>
+
+VOID
+PredictResetSlot(
+	IN PPREDICT_SLOT Slot
+)
+/*++
+
+Routine Description:
+
+	Forgets the motion history of a slot, e.g. once its contact lifted
+
+Arguments:
+
+	Slot - The slot to reset
+
+Return Value:
+
+	None.
+
+--*/
+{
+	RtlZeroMemory(Slot, sizeof(PREDICT_SLOT));
+}
+
+VOID
+PredictReset(
+	IN PPREDICT_CONTEXT Context
+)
+/*++
+
+Routine Description:
+
+	Forgets the motion history of all slots
+
+Arguments:
+
+	Context - The prediction context to reset
+
+Return Value:
+
+	None.
+
+--*/
+{
+	RtlZeroMemory(Context, sizeof(PREDICT_CONTEXT));
+}
+
+static
+LONG
+PredictVelocity(
+	IN LONG From,
+	IN LONG To,
+	IN ULONG Elapsed
+)
+{
+	return (LONG)(((LONG64)(To - From) * (1 << PREDICT_FRACTION_BITS)) / (LONG64)Elapsed);
+}
+
+static
+VOID
+PredictAxis(
+	IN LONG Velocity,
+	IN LONG PreviousVelocity,
+	IN ULONG Elapsed,
+	OUT PLONG CurrentVelocity,
+	OUT PLONG CurrentAcceleration
+)
+{
+	//
+	// On a sudden reversal neither estimate can be trusted, hold the
+	// contact still until the new direction has been confirmed
+	//
+	if ((Velocity > 0 && PreviousVelocity < 0) ||
+		(Velocity < 0 && PreviousVelocity > 0))
+	{
+		*CurrentVelocity = 0;
+		*CurrentAcceleration = 0;
+		return;
+	}
+
+	*CurrentVelocity = Velocity;
+	*CurrentAcceleration = (LONG)(((LONG64)Velocity - PreviousVelocity) * 2 / (LONG64)Elapsed);
+}
+
+VOID
+PredictAddSample(
+	IN PPREDICT_SLOT Slot,
+	IN LONG X,
+	IN LONG Y,
+	IN ULONG Time
+)
+/*++
+
+Routine Description:
+
+	Adds the position of a contact in a new frame to the slot history and
+	updates the velocity and acceleration estimates.
+
+Arguments:
+
+	Slot - The slot the contact is tracked in
+
+	X - Controller X coordinate
+
+	Y - Controller Y coordinate
+
+	Time - Scan time of the frame in 100us units
+
+Return Value:
+
+	None.
+
+--*/
+{
+	PREDICT_SAMPLE* history = Slot->History;
+	ULONG elapsed;
+	ULONG previousElapsed;
+	LONG velocityX;
+	LONG velocityY;
+	int i;
+
+	if (Slot->Count != 0)
+	{
+		elapsed = Time - history[0].Time;
+
+		//
+		// The same frame reported again, only refresh the position
+		//
+		if (elapsed == 0)
+		{
+			history[0].X = X;
+			history[0].Y = Y;
+			return;
+		}
+
+		//
+		// Too old to derive a velocity from, start over
+		//
+		if (elapsed > PREDICT_MAX_SAMPLE_GAP)
+		{
+			PredictResetSlot(Slot);
+		}
+	}
+
+	for (i = PREDICT_HISTORY_SIZE - 1; i > 0; i--)
+	{
+		history[i] = history[i - 1];
+	}
+
+	history[0].X = X;
+	history[0].Y = Y;
+	history[0].Time = Time;
+
+	if (Slot->Count < PREDICT_HISTORY_SIZE)
+	{
+		Slot->Count++;
+	}
+
+	if (Slot->Count < 2)
+	{
+		Slot->VelocityX = 0;
+		Slot->VelocityY = 0;
+		Slot->AccelerationX = 0;
+		Slot->AccelerationY = 0;
+		return;
+	}
+
+	elapsed = history[0].Time - history[1].Time;
+	velocityX = PredictVelocity(history[1].X, history[0].X, elapsed);
+	velocityY = PredictVelocity(history[1].Y, history[0].Y, elapsed);
+
+	if (Slot->Count < 3)
+	{
+		Slot->VelocityX = velocityX;
+		Slot->VelocityY = velocityY;
+		Slot->AccelerationX = 0;
+		Slot->AccelerationY = 0;
+		return;
+	}
+
+	previousElapsed = history[1].Time - history[2].Time;
+
+	PredictAxis(
+		velocityX,
+		PredictVelocity(history[2].X, history[1].X, previousElapsed),
+		elapsed + previousElapsed,
+		&Slot->VelocityX,
+		&Slot->AccelerationX);
+
+	PredictAxis(
+		velocityY,
+		PredictVelocity(history[2].Y, history[1].Y, previousElapsed),
+		elapsed + previousElapsed,
+		&Slot->VelocityY,
+		&Slot->AccelerationY);
+}
+
+static
+LONG
+PredictDisplacement(
+	IN LONG Velocity,
+	IN LONG Acceleration,
+	IN ULONG Horizon
+)
+{
+	LONG64 velocityTerm = (LONG64)Velocity * Horizon;
+	LONG64 accelerationTerm = (LONG64)Acceleration * Horizon * Horizon / 2;
+	LONG64 limit = velocityTerm < 0 ? -velocityTerm : velocityTerm;
+
+	//
+	// Acceleration may at most cancel the motion or double it, the
+	// prediction never runs past the point the contact would stop at
+	//
+	if (accelerationTerm > limit)
+	{
+		accelerationTerm = limit;
+	}
+	else if (accelerationTerm < -limit)
+	{
+		accelerationTerm = -limit;
+	}
+
+	return (LONG)((velocityTerm + accelerationTerm) / (1 << PREDICT_FRACTION_BITS));
+}
+
+VOID
+PredictPosition(
+	IN PPREDICT_SLOT Slot,
+	IN ULONG Horizon,
+	IN OUT PLONG X,
+	IN OUT PLONG Y
+)
+/*++
+
+Routine Description:
+
+	Extrapolates the newest position of a slot by the given horizon. The
+	position is left untouched until the slot has seen two samples.
+
+Arguments:
+
+	Slot - The slot the contact is tracked in
+
+	Horizon - How far to look ahead in 100us units
+
+	X - In the current X coordinate, out the predicted one
+
+	Y - In the current Y coordinate, out the predicted one
+
+Return Value:
+
+	None.
+
+--*/
+{
+	if (Slot->Count < 2 || Horizon == 0)
+	{
+		return;
+	}
+
+	*X += PredictDisplacement(Slot->VelocityX, Slot->AccelerationX, Horizon);
+	*Y += PredictDisplacement(Slot->VelocityY, Slot->AccelerationY, Horizon);
+}
@@ -24,6 +24,7 @@
 #include <hx85x\hxinternal.h>
 #include <registry.tmh>
 #include <internal.h>
+#include <snapshot.h>
 
 #define TOUCH_REG_KEY                    L"\\Registry\\Machine\\SYSTEM\\TOUCH"
 #define TOUCH_SCREEN_SETTINGS_SUB_KEY    L"Settings"
@@ -32,6 +33,7 @@
 #define TOUCH_SCREEN_SETTINGS_02_SUB_KEY L"Settings\\02"
 #define TOUCH_SCREEN_SETTINGS_03_SUB_KEY L"Settings\\03"
 #define TOUCH_SCREEN_SETTINGS_FF_SUB_KEY L"Settings\\FF"
+#define TOUCH_SCREEN_PROPERTIES_SUB_KEY  L"SCREENPROPERTIES"
 
 //
 // Default HX85X configuration values can be changed here. Please refer to the
@@ -49,9 +51,9 @@ static HX85X_CONFIGURATION gDefaultConfiguration =
         0,                                              // Report Rate (standard)
         1,                                              // Configured
         0xff,                                           // Interrupt Enable
-        HX85X_MILLISECONDS_TO_TENTH_MILLISECONDS(20),    // Doze Interval
-        10,                                             // Doze Threshold
-        HX85X_SECONDS_TO_HALF_SECONDS(2)                 // Doze Holdoff
+        HX85X_MILLISECONDS_TO_TENTH_MILLISECONDS(20),    // Doze Interval (10 ms units)
+        10,                                             // Doze Threshold (scan window, ms)
+        0                                               // Doze Holdoff (off)
     },
 
     //
@@ -59,7 +61,7 @@ static HX85X_CONFIGURATION gDefaultConfiguration =
     //
     {
         1,                                              // Reporting mode (throttle)
-        1,                                              // Abs position filter
+        0,                                              // Abs position filter (off)
         0,                                              // Rel position filter
         0,                                              // Rel ballistics
         0,                                              // Dribble
@@ -105,1823 +107,1842 @@ static HX85X_CONFIGURATION gDefaultConfiguration =
     },
 };
 
+//
+// Configuration values that may be overridden per panel, as REG_DWORD
+// values under the device key
+//
+typedef struct _TOUCH_CONTROLLER_OVERRIDE
+{
+    PCWSTR Name;
+    ULONG Offset;
+} TOUCH_CONTROLLER_OVERRIDE;
+
+static const TOUCH_CONTROLLER_OVERRIDE gControllerOverrides[] =
+{
+    { L"DozeInterval", FIELD_OFFSET(HX85X_CONFIGURATION, DeviceSettings.DozeInterval) },
+    { L"DozeThreshold", FIELD_OFFSET(HX85X_CONFIGURATION, DeviceSettings.DozeThreshold) },
+    { L"DozeHoldoff", FIELD_OFFSET(HX85X_CONFIGURATION, DeviceSettings.DozeHoldoff) },
+    { L"AbsPosFilt", FIELD_OFFSET(HX85X_CONFIGURATION, TouchSettings.AbsPosFilt) },
+};
+
+//
+// Defaults of the values kept per panel vendor
+//
+#define TOUCH_VENDOR_DEFAULT_SETTINGS                                             \
+    {                                                                             \
+        0xFF,                                   /* Vendor */                      \
+        0xFF,                                   /* Revision */                    \
+        0xFF,                                   /* ReprogramFw */                 \
+        { 0 },                                  /* ProductId */                   \
+        0x0,                                    /* IncludeHighResTest */          \
+        0x3FFF,                                 /* HighResMaxRxLimit */           \
+        0x3FFF,                                 /* HighResMaxTxLimit */           \
+        0x3FFF,                                 /* HighResMinImageLimit */        \
+        0x0,                                    /* IncludeBaselineMinMaxTest */   \
+        0x3FFF,                                 /* BaselineMinMaxMinPixelLimit */ \
+        0x3FFF,                                 /* BaselineMinMaxMaxPixelLimit */ \
+        0x0,                                    /* IncludeFullBaselineTest */     \
+        0x0,                                    /* RxAmount */                    \
+        0x0,                                    /* TxAmount */                    \
+        0x0,                                    /* RxElectrodeMaskTouch2D */      \
+        0x0,                                    /* TxElectrodeMaskTouch2D */      \
+        0x0,                                    /* RxElectrodeMaskButtons */      \
+        0x0,                                    /* TxElectrodeMaskButtons */      \
+        { 0x3FFF, 0x3FFF, 0x3FFF },             /* FullBaselineButtonMin */       \
+        { 0x3FFF, 0x3FFF, 0x3FFF },             /* FullBaselineButtonMax */       \
+        0x0,                                    /* IncludeAbsSenseRawCapTest */   \
+        0x0,                                    /* AbsSenseRawCapTxRxStart */     \
+        0x0,                                    /* AbsSenseRawCapTxRxEnd */       \
+        0x3FFF,                                 /* AbsSenseRawCapMinLimit */      \
+        0x3FFF,                                 /* AbsSenseRawCapMaxLimit */      \
+        0x0                                     /* IncludeShortTest */            \
+    }
+
 static TOUCH_SCREEN_SETTINGS gDefaultTouchSettings =
 {
-    0x1,
-    0x0,
-    0x1,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x3C,
-    0x32,
-    0x32,
-    0x32,
-    0x1,
-    0x0,
-    0xFF,
-    0xFF,
-    0xFF,
-    0xFF,
-    0xFF,
-    0xFF,
-    0xFF,
-    0xFF,
-    0xFF,
-    0xFF,
-    0xFF,
-    0xFF,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x3FFF,
-    0x3FFF,
-    0x3FFF,
-    0x0,
-    0x3FFF,
-    0x3FFF,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x3FFF,
-    0x3FFF,
-    0x3FFF,
-    0x3FFF,
-    0x3FFF,
-    0x3FFF,
-    0x0,
-    0x0,
-    0x0,
-    0x3FFF,
-    0x3FFF,
-    0x0,
-    0x0,
-    0x3FFF,
-    0x3FFF,
-    0x3FFF,
-    0x0,
-    0x3FFF,
-    0x3FFF,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x3FFF,
-    0x3FFF,
-    0x3FFF,
-    0x3FFF,
-    0x3FFF,
-    0x3FFF,
-    0x0,
-    0x0,
-    0x0,
-    0x3FFF,
-    0x3FFF,
-    0x0,
-    0x0,
-    0x3FFF,
-    0x3FFF,
-    0x3FFF,
-    0x0,
-    0x3FFF,
-    0x3FFF,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    0x3FFF,
-    0x3FFF,
-    0x3FFF,
-    0x3FFF,
-    0x3FFF,
-    0x3FFF,
-    0x0,
-    0x0,
-    0x0,
-    0x3FFF,
-    0x3FFF,
-    0x0,
-    0x0,
-    0x3FFF,
-    0x3FFF,
-    0x3FFF,
-    0x0,
-    0x3FFF,
-    0x3FFF,
-    0x0,
+    0x1,                                            // DeviceId
+    0x0,                                            // UseControllerSleep
+    0x1,                                            // UseNoSleepBit
+    0x0,                                            // ImprovedTouchSupported
+    0x0,                                            // WakeupGestureSupported
+    0x0,                                            // ChargerDetectionSupported
+    0x0,                                            // ActivePenSupported
+    0x0,                                            // ExtClockControlSupported
+    0x0,                                            // ForceDriverSupported
+    0x0,                                            // DoubleTapMaxTapTime10ms
+    0x3C,                                           // DoubleTapMaxTapDistance100um
+    0x32,                                           // DoubleTapDeadZoneWidth100um
+    0x32,                                           // DoubleTapDeadZoneHeight100um
+    0x32,                                           // ControllerType
+    0x1,                                            // VendorCount
+    0x0,                                            // ResetControllerInWakeUp
+    0x0,                                            // ForceFlash
+    {
+        TOUCH_VENDOR_DEFAULT_SETTINGS,
+        TOUCH_VENDOR_DEFAULT_SETTINGS,
+        TOUCH_VENDOR_DEFAULT_SETTINGS,
+        TOUCH_VENDOR_DEFAULT_SETTINGS
+    }
+};
+
+//
+// Registry values explaining the relationship of the touch
+// controller coordinates to the physical LCD, as well as
+// any differences between the physical LCD dimensons and
+// viewable LCD area, are required. If not provided for whatever
+// reason, we will assume everything is 480x800 and perfectly
+// aligned.
+//
+static TOUCH_SCREEN_PROPERTIES gDefaultProperties =
+{
     0x0,
     0x0,
     0x0,
+    TOUCH_DEFAULT_RESOLUTION_X,
+    TOUCH_DEFAULT_RESOLUTION_Y,
     0x0,
+    TOUCH_DEFAULT_RESOLUTION_X,
+    TOUCH_DEFAULT_RESOLUTION_Y,
     0x0,
     0x0,
-    0x3FFF,
-    0x3FFF,
-    0x3FFF,
-    0x3FFF,
-    0x3FFF,
-    0x3FFF,
     0x0,
     0x0,
+    TOUCH_DEFAULT_RESOLUTION_X,
+    TOUCH_DEFAULT_RESOLUTION_Y,
     0x0,
-    0x3FFF,
-    0x3FFF,
     0x0,
+    0x0
 };
 
-RTL_QUERY_REGISTRY_TABLE gRegistryTable[] =
+//
+// Registry value describing one member of TOUCH_SCREEN_SETTINGS or
+// TOUCH_SCREEN_PROPERTIES. Per vendor values are named after Name in
+// Settings, where %02u stands for the vendor index, and after KeyName in
+// the Settings\<nn> subkeys. %u stands for the array element index.
+//
+typedef struct _TOUCH_SETTING_DESCRIPTOR
 {
+    PCWSTR Name;
+    PCWSTR KeyName;
+    ULONG Offset;
+    ULONG Count;
+} TOUCH_SETTING_DESCRIPTOR;
+
+#define TOUCH_SETTING(_Name_, _Field_) \
+    { _Name_, NULL, FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, _Field_), 1 }
+
+#define TOUCH_VENDOR_SETTING(_Name_, _KeyName_, _Field_) \
+    { _Name_, _KeyName_, FIELD_OFFSET(TOUCH_VENDOR_SETTINGS, _Field_), \
+      sizeof(((TOUCH_VENDOR_SETTINGS*)0)->_Field_) / sizeof(UINT32) }
+
+#define TOUCH_SCREEN_PROPERTY(_Field_) \
+    { L ## #_Field_, NULL, FIELD_OFFSET(TOUCH_SCREEN_PROPERTIES, _Field_), 1 }
+
+static const TOUCH_SETTING_DESCRIPTOR gDeviceSettings[] =
+{
+    TOUCH_SETTING(L"DeviceId", DeviceId),
+    TOUCH_SETTING(L"UseControllerSleep", UseControllerSleep),
+    TOUCH_SETTING(L"UseNoSleepBit", UseNoSleepBit),
+    TOUCH_SETTING(L"ImprovedTouchSupported", ImprovedTouchSupported),
+    TOUCH_SETTING(L"WakeupGestureSupported", WakeupGestureSupported),
+    TOUCH_SETTING(L"ChargerDetectionSupported", ChargerDetectionSupported),
+    TOUCH_SETTING(L"ActivePenSupported", ActivePenSupported),
+    TOUCH_SETTING(L"ExtClockControlSupported", ExtClockControlSupported),
+    TOUCH_SETTING(L"ForceDriverSupported", ForceDriverSupported),
+    TOUCH_SETTING(L"DoubleTapMaxTapTime10ms", DoubleTapMaxTapTime10ms),
+    TOUCH_SETTING(L"DoubleTapMaxTapDistance100um", DoubleTapMaxTapDistance100um),
+    TOUCH_SETTING(L"DoubleTapDeadZoneWidth100um", DoubleTapDeadZoneWidth100um),
+    TOUCH_SETTING(L"DoubleTapDeadZoneHeight100um", DoubleTapDeadZoneHeight100um),
+    TOUCH_SETTING(L"ControllerType", ControllerType),
+    TOUCH_SETTING(L"VendorCount", VendorCount),
+    TOUCH_SETTING(L"ResetControllerInWakeUp", ResetControllerInWakeUp),
+    TOUCH_SETTING(L"ForceFlash", ForceFlash),
+};
+
+static const TOUCH_SETTING_DESCRIPTOR gVendorSettings[] =
+{
+    TOUCH_VENDOR_SETTING(L"Vendor%02u", L"Vendor", Vendor),
+    TOUCH_VENDOR_SETTING(L"Revision%02u", L"Revision", Revision),
+    TOUCH_VENDOR_SETTING(L"ReprogramFw%02u", L"ReprogramFw", ReprogramFw),
+    TOUCH_VENDOR_SETTING(L"Vendor%02uProductId%u", L"ProductId%u", ProductId),
+    TOUCH_VENDOR_SETTING(L"Vendor%02uIncludeHighResTest", L"IncludeHighResTest", IncludeHighResTest),
+    TOUCH_VENDOR_SETTING(L"Vendor%02uHighResMaxRxLimit", L"HighResMaxRxLimit", HighResMaxRxLimit),
+    TOUCH_VENDOR_SETTING(L"Vendor%02uHighResMaxTxLimit", L"HighResMaxTxLimit", HighResMaxTxLimit),
+    TOUCH_VENDOR_SETTING(L"Vendor%02uHighResMinImageLimit", L"HighResMinImageLimit", HighResMinImageLimit),
+    TOUCH_VENDOR_SETTING(L"Vendor%02uIncludeBaselineMinMaxTest", L"IncludeBaselineMinMaxTest", IncludeBaselineMinMaxTest),
+    TOUCH_VENDOR_SETTING(L"Vendor%02uBaselineMinMaxMinPixelLimit", L"BaselineMinMaxMinPixelLimit", BaselineMinMaxMinPixelLimit),
+    TOUCH_VENDOR_SETTING(L"Vendor%02uBaselineMinMaxMaxPixelLimit", L"BaselineMinMaxMaxPixelLimit", BaselineMinMaxMaxPixelLimit),
+    TOUCH_VENDOR_SETTING(L"Vendor%02uIncludeFullBaselineTest", L"IncludeFullBaselineTest", IncludeFullBaselineTest),
+    TOUCH_VENDOR_SETTING(L"Vendor%02uRxAmount", L"RxAmount", RxAmount),
+    TOUCH_VENDOR_SETTING(L"Vendor%02uTxAmount", L"TxAmount", TxAmount),
+    TOUCH_VENDOR_SETTING(L"Vendor%02uRxElectrodeMaskTouch2D", L"RxElectrodeMaskTouch2D", RxElectrodeMaskTouch2D),
+    TOUCH_VENDOR_SETTING(L"Vendor%02uTxElectrodeMaskTouch2D", L"TxElectrodeMaskTouch2D", TxElectrodeMaskTouch2D),
+    TOUCH_VENDOR_SETTING(L"Vendor%02uRxElectrodeMaskButtons", L"RxElectrodeMaskButtons", RxElectrodeMaskButtons),
+    TOUCH_VENDOR_SETTING(L"Vendor%02uTxElectrodeMaskButtons", L"TxElectrodeMaskButtons", TxElectrodeMaskButtons),
+    TOUCH_VENDOR_SETTING(L"Vendor%02uFullBaselineButton%uMin", L"FullBaselineButton%uMin", FullBaselineButtonMin),
+    TOUCH_VENDOR_SETTING(L"Vendor%02uFullBaselineButton%uMax", L"FullBaselineButton%uMax", FullBaselineButtonMax),
+    TOUCH_VENDOR_SETTING(L"Vendor%02uIncludeAbsSenseRawCapTest", L"IncludeAbsSenseRawCapTest", IncludeAbsSenseRawCapTest),
+    TOUCH_VENDOR_SETTING(L"Vendor%02uAbsSenseRawCapTxRxStart", L"AbsSenseRawCapTxRxStart", AbsSenseRawCapTxRxStart),
+    TOUCH_VENDOR_SETTING(L"Vendor%02uAbsSenseRawCapTxRxEnd", L"AbsSenseRawCapTxRxEnd", AbsSenseRawCapTxRxEnd),
+    TOUCH_VENDOR_SETTING(L"Vendor%02uAbsSenseRawCapMinLimit", L"AbsSenseRawCapMinLimit", AbsSenseRawCapMinLimit),
+    TOUCH_VENDOR_SETTING(L"Vendor%02uAbsSenseRawCapMaxLimit", L"AbsSenseRawCapMaxLimit", AbsSenseRawCapMaxLimit),
+    TOUCH_VENDOR_SETTING(L"Vendor%02uIncludeShortTest", L"IncludeShortTest", IncludeShortTest),
+};
+
+static const TOUCH_SETTING_DESCRIPTOR gScreenProperties[] =
+{
+    TOUCH_SCREEN_PROPERTY(TouchSwapAxes),
+    TOUCH_SCREEN_PROPERTY(TouchInvertXAxis),
+    TOUCH_SCREEN_PROPERTY(TouchInvertYAxis),
+    TOUCH_SCREEN_PROPERTY(TouchPhysicalWidth),
+    TOUCH_SCREEN_PROPERTY(TouchPhysicalHeight),
+    TOUCH_SCREEN_PROPERTY(TouchPhysicalButtonHeight),
+    TOUCH_SCREEN_PROPERTY(TouchPillarBoxWidthLeft),
+    TOUCH_SCREEN_PROPERTY(TouchPillarBoxWidthRight),
+    TOUCH_SCREEN_PROPERTY(TouchLetterBoxHeightTop),
+    TOUCH_SCREEN_PROPERTY(TouchLetterBoxHeightBottom),
+    TOUCH_SCREEN_PROPERTY(DisplayPhysicalWidth),
+    TOUCH_SCREEN_PROPERTY(DisplayPhysicalHeight),
+    TOUCH_SCREEN_PROPERTY(DisplayViewableWidth),
+    TOUCH_SCREEN_PROPERTY(DisplayViewableHeight),
+    TOUCH_SCREEN_PROPERTY(DisplayPillarBoxWidthLeft),
+    TOUCH_SCREEN_PROPERTY(DisplayPillarBoxWidthRight),
+    TOUCH_SCREEN_PROPERTY(DisplayLetterBoxHeightTop),
+    TOUCH_SCREEN_PROPERTY(DisplayLetterBoxHeightBottom),
+    TOUCH_SCREEN_PROPERTY(DisplayHeight10um),
+    TOUCH_SCREEN_PROPERTY(DisplayWidth10um),
+    TOUCH_SCREEN_PROPERTY(TouchHardwareLacksContinuousReporting),
+    TOUCH_SCREEN_PROPERTY(TouchPredictionHorizon),
+};
+
+//
+// Settings\<nn> subkeys, Settings\FF applies to every vendor
+//
+static const PCWSTR gVendorSettingsSubKeys[TOUCH_SETTINGS_VENDORS] =
+{
+    TOUCH_SCREEN_SETTINGS_00_SUB_KEY,
+    TOUCH_SCREEN_SETTINGS_01_SUB_KEY,
+    TOUCH_SCREEN_SETTINGS_02_SUB_KEY,
+    TOUCH_SCREEN_SETTINGS_03_SUB_KEY
+};
+
+#define TOUCH_SETTINGS_ALL_VENDORS      MAXULONG
+
+//
+// Large enough for any value read, including a full calibration mesh
+//
+#define TOUCH_SETTING_BUFFER_SIZE       2048
+
+C_ASSERT(TOUCH_SETTING_BUFFER_SIZE >=
+    sizeof(KEY_VALUE_FULL_INFORMATION) +
+    sizeof(TOUCH_CALIBRATION_MESH_VALUE) +
+    CALIBRATION_MESH_MAX_SIZE);
+
+NTSTATUS
+RtlReadRegistryValue(
+    PCWSTR registry_path,
+    PCWSTR value_name,
+    ULONG type,
+    PVOID data,
+    ULONG length
+)
+{
+    UNICODE_STRING valname;
+    UNICODE_STRING keyname;
+    OBJECT_ATTRIBUTES attribs;
+    PKEY_VALUE_PARTIAL_INFORMATION pinfo;
+    HANDLE handle;
+    NTSTATUS rc;
+    ULONG len, reslen;
+
+    RtlInitUnicodeString(&keyname, registry_path);
+    RtlInitUnicodeString(&valname, value_name);
+
+    InitializeObjectAttributes(
+        &attribs, 
+        &keyname, 
+        OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
+        NULL, 
+        NULL
+    );
+
+    rc = ZwOpenKey(
+        &handle, 
+        KEY_QUERY_VALUE, 
+        &attribs
+    );
+
+    if (!NT_SUCCESS(rc))
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"DeviceId",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, DeviceId)),
-        REG_DWORD,
-        &gDefaultTouchSettings.DeviceId,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"UseControllerSleep",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, UseControllerSleep)),
-        REG_DWORD,
-        &gDefaultTouchSettings.UseControllerSleep,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"UseNoSleepBit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, UseNoSleepBit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.UseNoSleepBit,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"ImprovedTouchSupported",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, ImprovedTouchSupported)),
-        REG_DWORD,
-        &gDefaultTouchSettings.ImprovedTouchSupported,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"WakeupGestureSupported",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, WakeupGestureSupported)),
-        REG_DWORD,
-        &gDefaultTouchSettings.WakeupGestureSupported,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"ChargerDetectionSupported",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, ChargerDetectionSupported)),
-        REG_DWORD,
-        &gDefaultTouchSettings.ChargerDetectionSupported,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"ActivePenSupported",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, ActivePenSupported)),
-        REG_DWORD,
-        &gDefaultTouchSettings.ActivePenSupported,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"ExtClockControlSupported",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, ExtClockControlSupported)),
-        REG_DWORD,
-        &gDefaultTouchSettings.ExtClockControlSupported,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"ForceDriverSupported",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, ForceDriverSupported)),
-        REG_DWORD,
-        &gDefaultTouchSettings.ForceDriverSupported,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"DoubleTapMaxTapTime10ms",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, DoubleTapMaxTapTime10ms)),
-        REG_DWORD,
-        &gDefaultTouchSettings.DoubleTapMaxTapTime10ms,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"DoubleTapMaxTapDistance100um",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, DoubleTapMaxTapDistance100um)),
-        REG_DWORD,
-        &gDefaultTouchSettings.DoubleTapMaxTapDistance100um,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"DoubleTapDeadZoneWidth100um",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, DoubleTapDeadZoneWidth100um)),
-        REG_DWORD,
-        &gDefaultTouchSettings.DoubleTapDeadZoneWidth100um,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"DoubleTapDeadZoneHeight100um",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, DoubleTapDeadZoneHeight100um)),
-        REG_DWORD,
-        &gDefaultTouchSettings.DoubleTapDeadZoneHeight100um,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"ControllerType",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, ControllerType)),
-        REG_DWORD,
-        &gDefaultTouchSettings.ControllerType,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"VendorCount",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, VendorCount)),
-        REG_DWORD,
-        &gDefaultTouchSettings.VendorCount,
-        sizeof(UINT32)
-    },
+        return rc;
+    }
+
+    len = sizeof(KEY_VALUE_PARTIAL_INFORMATION) + length;
+
+    pinfo = ExAllocatePoolWithTag(
+        NonPagedPool, 
+        len, 
+        TOUCH_POOL_TAG
+    );
+
+    if (pinfo == NULL)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"ResetControllerInWakeUp",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, ResetControllerInWakeUp)),
-        REG_DWORD,
-        &gDefaultTouchSettings.ResetControllerInWakeUp,
-        sizeof(UINT32)
-    },
+        rc = STATUS_INSUFFICIENT_RESOURCES;
+        goto exit;
+    }
+
+    rc = ZwQueryValueKey(
+        handle, 
+        &valname, 
+        KeyValuePartialInformation,
+        pinfo, 
+        len, 
+        &reslen
+    );
+
+    if ((NT_SUCCESS(rc) || rc == STATUS_BUFFER_OVERFLOW) && 
+        reslen >= (sizeof(KEY_VALUE_PARTIAL_INFORMATION) - 1) &&
+        (!type || pinfo->Type == type))
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00,
-        sizeof(UINT32)
-    },
+        reslen = pinfo->DataLength;
+        memcpy(data, pinfo->Data, min(length, reslen));
+    }
+    else
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01,
-        sizeof(UINT32)
-    },
+        reslen = 0;
+
+        if (NT_SUCCESS(rc))
+        {
+            rc = STATUS_OBJECT_TYPE_MISMATCH;
+        }
+    }
+
+    if (pinfo != NULL)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Revision00",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Revision00)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Revision00,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Revision01",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Revision01)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Revision01,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Revision02",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Revision02)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Revision02,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Revision03",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Revision03)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Revision03,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"ReprogramFw00",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, ReprogramFw00)),
-        REG_DWORD,
-        &gDefaultTouchSettings.ReprogramFw00,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"ReprogramFw01",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, ReprogramFw01)),
-        REG_DWORD,
-        &gDefaultTouchSettings.ReprogramFw01,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"ReprogramFw02",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, ReprogramFw02)),
-        REG_DWORD,
-        &gDefaultTouchSettings.ReprogramFw02,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"ReprogramFw03",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, ReprogramFw03)),
-        REG_DWORD,
-        &gDefaultTouchSettings.ReprogramFw03,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"ForceFlash",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, ForceFlash)),
-        REG_DWORD,
-        &gDefaultTouchSettings.ForceFlash,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00ProductId0",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00ProductId0)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00ProductId0,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00ProductId1",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00ProductId1)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00ProductId1,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00ProductId2",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00ProductId2)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00ProductId2,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00ProductId3",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00ProductId3)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00ProductId3,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00ProductId4",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00ProductId4)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00ProductId4,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00ProductId5",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00ProductId5)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00ProductId5,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00ProductId6",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00ProductId6)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00ProductId6,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00ProductId7",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00ProductId7)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00ProductId7,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00ProductId8",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00ProductId8)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00ProductId8,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00ProductId9",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00ProductId9)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00ProductId9,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01ProductId0",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01ProductId0)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01ProductId0,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01ProductId1",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01ProductId1)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01ProductId1,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01ProductId2",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01ProductId2)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01ProductId2,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01ProductId3",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01ProductId3)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01ProductId3,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01ProductId4",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01ProductId4)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01ProductId4,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01ProductId5",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01ProductId5)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01ProductId5,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01ProductId6",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01ProductId6)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01ProductId6,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01ProductId7",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01ProductId7)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01ProductId7,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01ProductId8",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01ProductId8)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01ProductId8,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01ProductId9",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01ProductId9)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01ProductId9,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02ProductId0",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02ProductId0)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02ProductId0,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02ProductId1",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02ProductId1)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02ProductId1,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02ProductId2",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02ProductId2)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02ProductId2,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02ProductId3",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02ProductId3)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02ProductId3,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02ProductId4",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02ProductId4)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02ProductId4,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02ProductId5",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02ProductId5)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02ProductId5,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02ProductId6",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02ProductId6)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02ProductId6,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02ProductId7",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02ProductId7)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02ProductId7,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02ProductId8",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02ProductId8)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02ProductId8,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02ProductId9",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02ProductId9)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02ProductId9,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03ProductId0",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03ProductId0)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03ProductId0,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03ProductId1",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03ProductId1)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03ProductId1,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03ProductId2",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03ProductId2)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03ProductId2,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03ProductId3",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03ProductId3)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03ProductId3,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03ProductId4",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03ProductId4)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03ProductId4,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03ProductId5",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03ProductId5)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03ProductId5,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03ProductId6",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03ProductId6)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03ProductId6,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03ProductId7",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03ProductId7)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03ProductId7,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03ProductId8",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03ProductId8)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03ProductId8,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03ProductId9",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03ProductId9)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03ProductId9,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00IncludeHighResTest",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00IncludeHighResTest)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00IncludeHighResTest,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00HighResMaxRxLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00HighResMaxRxLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00HighResMaxRxLimit,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00HighResMaxTxLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00HighResMaxTxLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00HighResMaxTxLimit,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00HighResMinImageLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00HighResMinImageLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00HighResMinImageLimit,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00IncludeBaselineMinMaxTest",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00IncludeBaselineMinMaxTest)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00IncludeBaselineMinMaxTest,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00BaselineMinMaxMinPixelLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00BaselineMinMaxMinPixelLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00BaselineMinMaxMinPixelLimit,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00BaselineMinMaxMaxPixelLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00BaselineMinMaxMaxPixelLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00BaselineMinMaxMaxPixelLimit,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00IncludeFullBaselineTest",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00IncludeFullBaselineTest)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00IncludeFullBaselineTest,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00RxAmount",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00RxAmount)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00RxAmount,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00TxAmount",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00TxAmount)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00TxAmount,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00RxElectrodeMaskTouch2D",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00RxElectrodeMaskTouch2D)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00RxElectrodeMaskTouch2D,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00TxElectrodeMaskTouch2D",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00TxElectrodeMaskTouch2D)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00TxElectrodeMaskTouch2D,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00RxElectrodeMaskButtons",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00RxElectrodeMaskButtons)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00RxElectrodeMaskButtons,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00TxElectrodeMaskButtons",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00TxElectrodeMaskButtons)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00TxElectrodeMaskButtons,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00FullBaselineButton0Min",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00FullBaselineButton0Min)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00FullBaselineButton0Min,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00FullBaselineButton1Min",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00FullBaselineButton1Min)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00FullBaselineButton1Min,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00FullBaselineButton2Min",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00FullBaselineButton2Min)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00FullBaselineButton2Min,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00FullBaselineButton0Max",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00FullBaselineButton0Max)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00FullBaselineButton0Max,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00FullBaselineButton1Max",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00FullBaselineButton1Max)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00FullBaselineButton1Max,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00FullBaselineButton2Max",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00FullBaselineButton2Max)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00FullBaselineButton2Max,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00IncludeAbsSenseRawCapTest",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00IncludeAbsSenseRawCapTest)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00IncludeAbsSenseRawCapTest,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00AbsSenseRawCapTxRxStart",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00AbsSenseRawCapTxRxStart)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00AbsSenseRawCapTxRxStart,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00AbsSenseRawCapTxRxEnd",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00AbsSenseRawCapTxRxEnd)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00AbsSenseRawCapTxRxEnd,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00AbsSenseRawCapMinLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00AbsSenseRawCapMinLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00AbsSenseRawCapMinLimit,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00AbsSenseRawCapMaxLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00AbsSenseRawCapMaxLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00AbsSenseRawCapMaxLimit,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor00IncludeShortTest",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor00IncludeShortTest)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor00IncludeShortTest,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01IncludeHighResTest",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01IncludeHighResTest)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01IncludeHighResTest,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01HighResMaxRxLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01HighResMaxRxLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01HighResMaxRxLimit,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01HighResMaxTxLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01HighResMaxTxLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01HighResMaxTxLimit,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01HighResMinImageLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01HighResMinImageLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01HighResMinImageLimit,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01IncludeBaselineMinMaxTest",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01IncludeBaselineMinMaxTest)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01IncludeBaselineMinMaxTest,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01BaselineMinMaxMinPixelLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01BaselineMinMaxMinPixelLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01BaselineMinMaxMinPixelLimit,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01BaselineMinMaxMaxPixelLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01BaselineMinMaxMaxPixelLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01BaselineMinMaxMaxPixelLimit,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01IncludeFullBaselineTest",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01IncludeFullBaselineTest)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01IncludeFullBaselineTest,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01RxAmount",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01RxAmount)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01RxAmount,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01TxAmount",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01TxAmount)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01TxAmount,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01RxElectrodeMaskTouch2D",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01RxElectrodeMaskTouch2D)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01RxElectrodeMaskTouch2D,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01TxElectrodeMaskTouch2D",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01TxElectrodeMaskTouch2D)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01TxElectrodeMaskTouch2D,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01RxElectrodeMaskButtons",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01RxElectrodeMaskButtons)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01RxElectrodeMaskButtons,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01TxElectrodeMaskButtons",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01TxElectrodeMaskButtons)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01TxElectrodeMaskButtons,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01FullBaselineButton0Min",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01FullBaselineButton0Min)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01FullBaselineButton0Min,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01FullBaselineButton1Min",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01FullBaselineButton1Min)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01FullBaselineButton1Min,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01FullBaselineButton2Min",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01FullBaselineButton2Min)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01FullBaselineButton2Min,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01FullBaselineButton0Max",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01FullBaselineButton0Max)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01FullBaselineButton0Max,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01FullBaselineButton1Max",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01FullBaselineButton1Max)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01FullBaselineButton1Max,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01FullBaselineButton2Max",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01FullBaselineButton2Max)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01FullBaselineButton2Max,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01IncludeAbsSenseRawCapTest",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01IncludeAbsSenseRawCapTest)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01IncludeAbsSenseRawCapTest,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01AbsSenseRawCapTxRxStart",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01AbsSenseRawCapTxRxStart)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01AbsSenseRawCapTxRxStart,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01AbsSenseRawCapTxRxEnd",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01AbsSenseRawCapTxRxEnd)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01AbsSenseRawCapTxRxEnd,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01AbsSenseRawCapMinLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01AbsSenseRawCapMinLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01AbsSenseRawCapMinLimit,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01AbsSenseRawCapMaxLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01AbsSenseRawCapMaxLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01AbsSenseRawCapMaxLimit,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor01IncludeShortTest",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor01IncludeShortTest)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor01IncludeShortTest,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02IncludeHighResTest",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02IncludeHighResTest)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02IncludeHighResTest,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02HighResMaxRxLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02HighResMaxRxLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02HighResMaxRxLimit,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02HighResMaxTxLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02HighResMaxTxLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02HighResMaxTxLimit,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02HighResMinImageLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02HighResMinImageLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02HighResMinImageLimit,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02IncludeBaselineMinMaxTest",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02IncludeBaselineMinMaxTest)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02IncludeBaselineMinMaxTest,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02BaselineMinMaxMinPixelLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02BaselineMinMaxMinPixelLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02BaselineMinMaxMinPixelLimit,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02BaselineMinMaxMaxPixelLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02BaselineMinMaxMaxPixelLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02BaselineMinMaxMaxPixelLimit,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02IncludeFullBaselineTest",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02IncludeFullBaselineTest)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02IncludeFullBaselineTest,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02RxAmount",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02RxAmount)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02RxAmount,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02TxAmount",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02TxAmount)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02TxAmount,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02RxElectrodeMaskTouch2D",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02RxElectrodeMaskTouch2D)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02RxElectrodeMaskTouch2D,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02TxElectrodeMaskTouch2D",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02TxElectrodeMaskTouch2D)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02TxElectrodeMaskTouch2D,
-        sizeof(UINT32)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02RxElectrodeMaskButtons",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02RxElectrodeMaskButtons)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02RxElectrodeMaskButtons,
-        sizeof(UINT32)
-    },
+        ExFreePoolWithTag(pinfo, TOUCH_POOL_TAG);
+    }
+
+exit:
+    ZwClose(handle);
+    return rc;
+}
+
+NTSTATUS
+TchRegistryGetControllerSettings(
+    IN VOID* ControllerContext,
+    IN WDFDEVICE FxDevice
+)
+/*++
+
+  Routine Description:
+
+    This routine retrieves controller wide settings
+    from the registry.
+
+  Arguments:
+
+    FxDevice - a handle to the framework device object
+    Settings - A pointer to the chip settings structure
+
+  Return Value:
+
+    NTSTATUS indicating success or failure
+
+--*/
+{
+    HX85X_CONTROLLER_CONTEXT* controller;
+    UNICODE_STRING valueName;
+    WDFKEY deviceKey;
+    ULONG value;
+    ULONG i;
+    NTSTATUS status;
+
+    controller = (HX85X_CONTROLLER_CONTEXT*)ControllerContext;
+
+    RtlCopyMemory(
+        &controller->Config,
+        &gDefaultConfiguration,
+        sizeof(HX85X_CONFIGURATION));
+
+    //
+    // Init, wake and sleep sequences may be replaced per panel
+    //
+    Hx85xLoadSequences(controller->Sequences, FxDevice);
+
+    //
+    // Doze and filtering may be tuned per panel, e.g. along with the doze
+    // sequences. Doze is only enabled by a DozeHoldoff override, it was not
+    // measured on every panel.
+    //
+    status = WdfDeviceOpenRegistryKey(
+        FxDevice,
+        PLUGPLAY_REGKEY_DEVICE,
+        KEY_READ,
+        WDF_NO_OBJECT_ATTRIBUTES,
+        &deviceKey);
+
+    if (NT_SUCCESS(status))
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02TxElectrodeMaskButtons",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02TxElectrodeMaskButtons)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02TxElectrodeMaskButtons,
-        sizeof(UINT32)
-    },
+        for (i = 0; i < ARRAYSIZE(gControllerOverrides); i++)
+        {
+            RtlInitUnicodeString(&valueName, gControllerOverrides[i].Name);
+
+            if (NT_SUCCESS(WdfRegistryQueryULong(deviceKey, &valueName, &value)))
+            {
+                *(UINT32*)((PUCHAR)&controller->Config + gControllerOverrides[i].Offset) = value;
+
+                Trace(
+                    TRACE_LEVEL_INFORMATION,
+                    TRACE_REGISTRY,
+                    "%ws overridden to %lu",
+                    gControllerOverrides[i].Name,
+                    value);
+            }
+        }
+
+        WdfRegistryClose(deviceKey);
+    }
+
+    Hx85xDozeConfigure(
+        &controller->Doze,
+        controller->Config.DeviceSettings.DozeHoldoff,
+        controller->Config.DeviceSettings.DozeInterval,
+        controller->Config.DeviceSettings.DozeThreshold,
+        controller->Sequences);
+
+    Hx85xGestureConfigure(
+        &controller->Gesture,
+        &controller->TouchSettings);
+
+    controller->ConfigGeneration++;
+
+    status = STATUS_SUCCESS;
+
+    return status;
+}
+
+//
+// Values of a key are enumerated once, each is handed to a routine that
+// stores it where it belongs
+//
+typedef
+VOID
+TOUCH_SETTING_ROUTINE(
+    IN PVOID Context,
+    IN PCUNICODE_STRING Name,
+    IN PKEY_VALUE_FULL_INFORMATION Value
+);
+
+typedef struct _TOUCH_VENDOR_KEY_CONTEXT
+{
+    PTOUCH_SCREEN_SETTINGS Settings;
+    ULONG Vendor;
+} TOUCH_VENDOR_KEY_CONTEXT, * PTOUCH_VENDOR_KEY_CONTEXT;
+
+typedef struct _TOUCH_SCREEN_KEY_CONTEXT
+{
+    PTOUCH_SCREEN_PROPERTIES Props;
+    BOOLEAN CalibrationMesh;
+} TOUCH_SCREEN_KEY_CONTEXT, * PTOUCH_SCREEN_KEY_CONTEXT;
+
+static
+BOOLEAN
+TchMatchSettingName(
+    IN PCWSTR Pattern,
+    IN PCUNICODE_STRING Name,
+    OUT PULONG Vendor,
+    OUT PULONG Element
+)
+{
+    ULONG length = Name->Length / sizeof(WCHAR);
+    PCWCH name = Name->Buffer;
+    ULONG i = 0;
+
+    *Vendor = 0;
+    *Element = 0;
+
+    while (*Pattern != L'\0')
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02FullBaselineButton0Min",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02FullBaselineButton0Min)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02FullBaselineButton0Min,
-        sizeof(UINT32)
-    },
+        if (Pattern[0] == L'%' && Pattern[1] == L'0')
+        {
+            //
+            // %02u, the vendor index
+            //
+            if (i + 2 > length ||
+                name[i] < L'0' || name[i] > L'9' ||
+                name[i + 1] < L'0' || name[i + 1] > L'9')
+            {
+                return FALSE;
+            }
+
+            *Vendor = (name[i] - L'0') * 10 + (name[i + 1] - L'0');
+            i += 2;
+            Pattern += 4;
+        }
+        else if (Pattern[0] == L'%')
+        {
+            //
+            // %u, an array element index of any number of digits. The
+            // caller checks it against the array size, larger indices
+            // only need to stop before they wrap.
+            //
+            if (i >= length || name[i] < L'0' || name[i] > L'9')
+            {
+                return FALSE;
+            }
+
+            while (i < length && name[i] >= L'0' && name[i] <= L'9')
+            {
+                if (*Element > (MAXULONG - 9) / 10)
+                {
+                    return FALSE;
+                }
+
+                *Element = *Element * 10 + (name[i] - L'0');
+                i++;
+            }
+
+            Pattern += 2;
+        }
+        else
+        {
+            //
+            // Value names are case insensitive
+            //
+            if (i >= length ||
+                RtlUpcaseUnicodeChar(name[i]) != RtlUpcaseUnicodeChar(*Pattern))
+            {
+                return FALSE;
+            }
+
+            i++;
+            Pattern++;
+        }
+    }
+
+    return (i == length);
+}
+
+static
+const TOUCH_SETTING_DESCRIPTOR*
+TchFindSetting(
+    IN const TOUCH_SETTING_DESCRIPTOR* Descriptors,
+    IN ULONG Count,
+    IN BOOLEAN VendorKey,
+    IN PCUNICODE_STRING Name,
+    OUT PULONG Vendor,
+    OUT PULONG Element
+)
+{
+    ULONG i;
+
+    for (i = 0; i < Count; i++)
+    {
+        if (TchMatchSettingName(
+                VendorKey ? Descriptors[i].KeyName : Descriptors[i].Name,
+                Name,
+                Vendor,
+                Element) &&
+            *Element < Descriptors[i].Count)
+        {
+            return &Descriptors[i];
+        }
+    }
+
+    return NULL;
+}
+
+static
+BOOLEAN
+TchStoreSetting(
+    OUT PUINT32 Field,
+    IN PCUNICODE_STRING Name,
+    IN PKEY_VALUE_FULL_INFORMATION Value
+)
+{
+    if (Value->Type != REG_DWORD || Value->DataLength != sizeof(UINT32))
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02FullBaselineButton1Min",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02FullBaselineButton1Min)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02FullBaselineButton1Min,
-        sizeof(UINT32)
-    },
+        Trace(
+            TRACE_LEVEL_WARNING,
+            TRACE_REGISTRY,
+            "Ignoring %wZ of type %d, %d bytes",
+            Name,
+            Value->Type,
+            Value->DataLength);
+
+        return FALSE;
+    }
+
+    *Field = *(UINT32 UNALIGNED*)((PUCHAR)Value + Value->DataOffset);
+
+    return TRUE;
+}
+
+static
+VOID
+TchSettingsRoutine(
+    IN PVOID Context,
+    IN PCUNICODE_STRING Name,
+    IN PKEY_VALUE_FULL_INFORMATION Value
+)
+{
+    PTOUCH_SCREEN_SETTINGS settings = (PTOUCH_SCREEN_SETTINGS) Context;
+    const TOUCH_SETTING_DESCRIPTOR* setting;
+    ULONG vendor;
+    ULONG element;
+
+    setting = TchFindSetting(
+        gDeviceSettings,
+        ARRAYSIZE(gDeviceSettings),
+        FALSE,
+        Name,
+        &vendor,
+        &element);
+
+    if (setting != NULL)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02FullBaselineButton2Min",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02FullBaselineButton2Min)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02FullBaselineButton2Min,
-        sizeof(UINT32)
-    },
+        TchStoreSetting((PUINT32)((PUCHAR)settings + setting->Offset), Name, Value);
+        return;
+    }
+
+    setting = TchFindSetting(
+        gVendorSettings,
+        ARRAYSIZE(gVendorSettings),
+        FALSE,
+        Name,
+        &vendor,
+        &element);
+
+    if (setting != NULL && vendor < TOUCH_SETTINGS_VENDORS)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02FullBaselineButton0Max",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02FullBaselineButton0Max)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02FullBaselineButton0Max,
-        sizeof(UINT32)
-    },
+        TchStoreSetting(
+            (PUINT32)((PUCHAR)&settings->Vendor[vendor] + setting->Offset) + element,
+            Name,
+            Value);
+    }
+}
+
+static
+VOID
+TchVendorSettingsRoutine(
+    IN PVOID Context,
+    IN PCUNICODE_STRING Name,
+    IN PKEY_VALUE_FULL_INFORMATION Value
+)
+{
+    PTOUCH_VENDOR_KEY_CONTEXT key = (PTOUCH_VENDOR_KEY_CONTEXT) Context;
+    const TOUCH_SETTING_DESCRIPTOR* setting;
+    ULONG vendor;
+    ULONG element;
+
+    setting = TchFindSetting(
+        gVendorSettings,
+        ARRAYSIZE(gVendorSettings),
+        TRUE,
+        Name,
+        &vendor,
+        &element);
+
+    if (setting == NULL)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02FullBaselineButton1Max",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02FullBaselineButton1Max)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02FullBaselineButton1Max,
-        sizeof(UINT32)
-    },
+        return;
+    }
+
+    for (vendor = 0; vendor < TOUCH_SETTINGS_VENDORS; vendor++)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02FullBaselineButton2Max",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02FullBaselineButton2Max)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02FullBaselineButton2Max,
-        sizeof(UINT32)
-    },
+        if (key->Vendor != TOUCH_SETTINGS_ALL_VENDORS && key->Vendor != vendor)
+        {
+            continue;
+        }
+
+        if (!TchStoreSetting(
+                (PUINT32)((PUCHAR)&key->Settings->Vendor[vendor] + setting->Offset) + element,
+                Name,
+                Value))
+        {
+            break;
+        }
+    }
+}
+
+static
+VOID
+TchScreenPropertiesRoutine(
+    IN PVOID Context,
+    IN PCUNICODE_STRING Name,
+    IN PKEY_VALUE_FULL_INFORMATION Value
+)
+{
+    PTOUCH_SCREEN_KEY_CONTEXT key = (PTOUCH_SCREEN_KEY_CONTEXT) Context;
+    const TOUCH_SETTING_DESCRIPTOR* setting;
+    ULONG vendor;
+    ULONG element;
+
+    setting = TchFindSetting(
+        gScreenProperties,
+        ARRAYSIZE(gScreenProperties),
+        FALSE,
+        Name,
+        &vendor,
+        &element);
+
+    if (setting != NULL)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02IncludeAbsSenseRawCapTest",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02IncludeAbsSenseRawCapTest)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02IncludeAbsSenseRawCapTest,
-        sizeof(UINT32)
-    },
+        TchStoreSetting((PUINT32)((PUCHAR)key->Props + setting->Offset), Name, Value);
+    }
+    else if (TchMatchSettingName(TOUCH_CALIBRATION_MESH_VALUE, Name, &vendor, &element))
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02AbsSenseRawCapTxRxStart",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02AbsSenseRawCapTxRxStart)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02AbsSenseRawCapTxRxStart,
-        sizeof(UINT32)
-    },
+        //
+        // Needs the final display size, it is read once all values are in
+        //
+        key->CalibrationMesh = TRUE;
+    }
+}
+
+static
+NTSTATUS
+TchOpenSettingKey(
+    IN HANDLE RootKey,
+    IN PCWSTR Name,
+    OUT PHANDLE Key
+)
+{
+    UNICODE_STRING keyName;
+    OBJECT_ATTRIBUTES attributes;
+
+    RtlInitUnicodeString(&keyName, Name);
+
+    InitializeObjectAttributes(
+        &attributes,
+        &keyName,
+        OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
+        RootKey,
+        NULL);
+
+    return ZwOpenKey(Key, KEY_READ, &attributes);
+}
+
+static
+ULONG
+TchEnumerateSettings(
+    IN HANDLE Key,
+    IN PKEY_VALUE_FULL_INFORMATION Buffer,
+    IN TOUCH_SETTING_ROUTINE* Routine,
+    IN PVOID Context
+)
+{
+    UNICODE_STRING name;
+    ULONG length;
+    ULONG index;
+    NTSTATUS status;
+
+    for (index = 0; ; index++)
+    {
+        status = ZwEnumerateValueKey(
+            Key,
+            index,
+            KeyValueFullInformation,
+            Buffer,
+            TOUCH_SETTING_BUFFER_SIZE,
+            &length);
+
+        if (status == STATUS_NO_MORE_ENTRIES)
+        {
+            break;
+        }
+
+        //
+        // Values too large for the buffer are none of ours, the name is
+        // not available to tell, so the skip is traced in case it was
+        //
+        if (status == STATUS_BUFFER_OVERFLOW || status == STATUS_BUFFER_TOO_SMALL)
+        {
+            Trace(
+                TRACE_LEVEL_WARNING,
+                TRACE_REGISTRY,
+                "Skipping touch registry value %lu, %lu bytes exceed %lu",
+                index,
+                length,
+                (ULONG) TOUCH_SETTING_BUFFER_SIZE);
+
+            continue;
+        }
+
+        if (!NT_SUCCESS(status))
+        {
+            Trace(
+                TRACE_LEVEL_WARNING,
+                TRACE_REGISTRY,
+                "Error enumerating touch registry values - 0x%08lX",
+                status);
+
+            break;
+        }
+
+        name.Buffer = Buffer->Name;
+        name.Length = (USHORT) Buffer->NameLength;
+        name.MaximumLength = name.Length;
+
+        Routine(Context, &name, Buffer);
+    }
+
+    return index;
+}
+
+static
+ULONG
+TchReadSettingKey(
+    IN HANDLE RootKey,
+    IN PCWSTR Name,
+    IN PKEY_VALUE_FULL_INFORMATION Buffer,
+    IN TOUCH_SETTING_ROUTINE* Routine,
+    IN PVOID Context
+)
+{
+    HANDLE key;
+    ULONG values;
+
+    //
+    // Any of the subkeys may be absent
+    //
+    if (!NT_SUCCESS(TchOpenSettingKey(RootKey, Name, &key)))
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02AbsSenseRawCapTxRxEnd",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02AbsSenseRawCapTxRxEnd)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02AbsSenseRawCapTxRxEnd,
-        sizeof(UINT32)
-    },
+        return 0;
+    }
+
+    values = TchEnumerateSettings(key, Buffer, Routine, Context);
+
+    ZwClose(key);
+
+    return values;
+}
+
+static
+VOID
+TchReadCalibrationMesh(
+    IN HANDLE Key,
+    IN PTOUCH_SCREEN_PROPERTIES Props,
+    IN PKEY_VALUE_PARTIAL_INFORMATION Buffer,
+    OUT PCALIBRATION_CONTEXT Calibration
+)
+{
+    UNICODE_STRING valueName;
+    ULONG length;
+    NTSTATUS status;
+
+    RtlInitUnicodeString(&valueName, TOUCH_CALIBRATION_MESH_VALUE);
+
+    status = ZwQueryValueKey(
+        Key,
+        &valueName,
+        KeyValuePartialInformation,
+        Buffer,
+        TOUCH_SETTING_BUFFER_SIZE,
+        &length);
+
+    if (!NT_SUCCESS(status))
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02AbsSenseRawCapMinLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02AbsSenseRawCapMinLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02AbsSenseRawCapMinLimit,
-        sizeof(UINT32)
-    },
+        Trace(
+            TRACE_LEVEL_WARNING,
+            TRACE_REGISTRY,
+            "Error retrieving calibration mesh - 0x%08lX",
+            status);
+
+        return;
+    }
+
+    if (Buffer->Type != REG_BINARY ||
+        !CalibrationConfigure(
+            Calibration,
+            Buffer->Data,
+            Buffer->DataLength,
+            Props->DisplayPhysicalWidth,
+            Props->DisplayPhysicalHeight))
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02AbsSenseRawCapMaxLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02AbsSenseRawCapMaxLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02AbsSenseRawCapMaxLimit,
-        sizeof(UINT32)
-    },
+        Trace(
+            TRACE_LEVEL_ERROR,
+            TRACE_REGISTRY,
+            "Invalid calibration mesh provided (type %d, %d bytes)",
+            Buffer->Type,
+            Buffer->DataLength);
+    }
+}
+
+static
+VOID
+TchValidateTouchRegistry(
+    IN OUT PTOUCH_SCREEN_SETTINGS Settings OPTIONAL,
+    IN OUT PTOUCH_SCREEN_PROPERTIES Props OPTIONAL
+)
+{
+    if (Settings != NULL && Settings->VendorCount > TOUCH_SETTINGS_VENDORS)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor02IncludeShortTest",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor02IncludeShortTest)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor02IncludeShortTest,
-        sizeof(UINT32)
-    },
+        Trace(
+            TRACE_LEVEL_ERROR,
+            TRACE_REGISTRY,
+            "Invalid vendor count provided (%d)",
+            Settings->VendorCount);
+
+        Settings->VendorCount = TOUCH_SETTINGS_VENDORS;
+    }
+
+    if (Props == NULL)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03IncludeHighResTest",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03IncludeHighResTest)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03IncludeHighResTest,
-        sizeof(UINT32)
-    },
+        return;
+    }
+
+    if (Props->TouchPillarBoxWidthLeft + 
+        Props->TouchPillarBoxWidthRight >=
+        Props->TouchPhysicalWidth)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03HighResMaxRxLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03HighResMaxRxLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03HighResMaxRxLimit,
-        sizeof(UINT32)
-    },
+        Trace(
+            TRACE_LEVEL_ERROR,
+            TRACE_REGISTRY,
+            "Invalid pillar box widths provided (%d,%d for %d)",
+            Props->TouchPillarBoxWidthLeft,
+            Props->TouchPillarBoxWidthRight,
+            Props->TouchPhysicalWidth);
+
+        Props->TouchPillarBoxWidthLeft = 
+            gDefaultProperties.TouchPillarBoxWidthLeft;
+        Props->TouchPillarBoxWidthRight = 
+            gDefaultProperties.TouchPillarBoxWidthRight;
+    }
+
+    if (Props->TouchLetterBoxHeightTop + 
+        Props->TouchLetterBoxHeightBottom >=
+        Props->TouchPhysicalHeight)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03HighResMaxTxLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03HighResMaxTxLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03HighResMaxTxLimit,
-        sizeof(UINT32)
-    },
+        Trace(
+            TRACE_LEVEL_ERROR,
+            TRACE_REGISTRY,
+            "Invalid letter box heights provided (%d,%d for %d)",
+            Props->TouchLetterBoxHeightTop,
+            Props->TouchLetterBoxHeightBottom,
+            Props->TouchPhysicalHeight);
+
+        Props->TouchLetterBoxHeightTop = 
+            gDefaultProperties.TouchLetterBoxHeightTop;
+        Props->TouchLetterBoxHeightBottom = 
+            gDefaultProperties.TouchLetterBoxHeightBottom;
+    }
+}
+
+VOID
+TchLoadTouchRegistry(
+    OUT PTOUCH_SCREEN_SETTINGS Settings OPTIONAL,
+    OUT PTOUCH_SCREEN_PROPERTIES Props OPTIONAL,
+    OUT PCALIBRATION_CONTEXT Calibration OPTIONAL
+)
+/*++
+
+Routine Description:
+
+    Reads the touch settings and the screen properties in one pass.
+    TOUCH_REG_KEY is opened once and the values of each subkey are
+    enumerated instead of being queried one by one. Values that are
+    missing or invalid keep their defaults.
+
+    Settings\FF applies to all vendors and Settings\<nn> to vendor nn.
+    The Vendor<nn> prefixed values in Settings take precedence.
+
+Arguments:
+
+    Settings - Optionally receives the touch settings
+
+    Props - Optionally receives the screen properties
+
+    Calibration - Optionally receives the calibration mesh, needs Props
+
+Return Value:
+
+    None.
+
+--*/
+{
+    PKEY_VALUE_FULL_INFORMATION buffer = NULL;
+    TOUCH_VENDOR_KEY_CONTEXT vendorKey;
+    TOUCH_SCREEN_KEY_CONTEXT screenKey;
+    HANDLE rootKey = NULL;
+    HANDLE screenPropertiesKey = NULL;
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER start;
+    LARGE_INTEGER end;
+    ULONG values = 0;
+    ULONG vendor;
+    NTSTATUS status;
+
+    start = KeQueryPerformanceCounter(&frequency);
+
+    screenKey.Props = Props;
+    screenKey.CalibrationMesh = FALSE;
+
+    //
+    // Start with default values
+    //
+    if (Settings != NULL)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03HighResMinImageLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03HighResMinImageLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03HighResMinImageLimit,
-        sizeof(UINT32)
-    },
+        RtlCopyMemory(Settings, &gDefaultTouchSettings, sizeof(TOUCH_SCREEN_SETTINGS));
+    }
+
+    if (Props != NULL)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03IncludeBaselineMinMaxTest",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03IncludeBaselineMinMaxTest)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03IncludeBaselineMinMaxTest,
-        sizeof(UINT32)
-    },
+        RtlCopyMemory(Props, &gDefaultProperties, sizeof(TOUCH_SCREEN_PROPERTIES));
+    }
+
+    if (Calibration != NULL)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03BaselineMinMaxMinPixelLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03BaselineMinMaxMinPixelLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03BaselineMinMaxMinPixelLimit,
-        sizeof(UINT32)
-    },
+        RtlZeroMemory(Calibration, sizeof(CALIBRATION_CONTEXT));
+    }
+
+    buffer = ExAllocatePoolWithTag(
+        PagedPool,
+        TOUCH_SETTING_BUFFER_SIZE,
+        TOUCH_POOL_TAG);
+
+    if (buffer == NULL)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03BaselineMinMaxMaxPixelLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03BaselineMinMaxMaxPixelLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03BaselineMinMaxMaxPixelLimit,
-        sizeof(UINT32)
-    },
+        status = STATUS_INSUFFICIENT_RESOURCES;
+        goto exit;
+    }
+
+    status = TchOpenSettingKey(NULL, TOUCH_REG_KEY, &rootKey);
+
+    if (!NT_SUCCESS(status))
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03IncludeFullBaselineTest",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03IncludeFullBaselineTest)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03IncludeFullBaselineTest,
-        sizeof(UINT32)
-    },
+        rootKey = NULL;
+        goto exit;
+    }
+
+    if (Settings != NULL)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03RxAmount",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03RxAmount)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03RxAmount,
-        sizeof(UINT32)
-    },
+        vendorKey.Settings = Settings;
+        vendorKey.Vendor = TOUCH_SETTINGS_ALL_VENDORS;
+
+        values += TchReadSettingKey(
+            rootKey,
+            TOUCH_SCREEN_SETTINGS_FF_SUB_KEY,
+            buffer,
+            TchVendorSettingsRoutine,
+            &vendorKey);
+
+        for (vendor = 0; vendor < TOUCH_SETTINGS_VENDORS; vendor++)
+        {
+            vendorKey.Vendor = vendor;
+
+            values += TchReadSettingKey(
+                rootKey,
+                gVendorSettingsSubKeys[vendor],
+                buffer,
+                TchVendorSettingsRoutine,
+                &vendorKey);
+        }
+
+        values += TchReadSettingKey(
+            rootKey,
+            TOUCH_SCREEN_SETTINGS_SUB_KEY,
+            buffer,
+            TchSettingsRoutine,
+            Settings);
+    }
+
+    if (Props != NULL &&
+        NT_SUCCESS(TchOpenSettingKey(
+            rootKey,
+            TOUCH_SCREEN_PROPERTIES_SUB_KEY,
+            &screenPropertiesKey)))
+    {
+        values += TchEnumerateSettings(
+            screenPropertiesKey,
+            buffer,
+            TchScreenPropertiesRoutine,
+            &screenKey);
+    }
+
+exit:
+
+    if (!NT_SUCCESS(status))
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03TxAmount",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03TxAmount)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03TxAmount,
-        sizeof(UINT32)
-    },
+        Trace(
+            TRACE_LEVEL_WARNING,
+            TRACE_REGISTRY,
+            "Error retrieving registry configuration - 0x%08lX",
+            status);
+    }
+
+    TchValidateTouchRegistry(Settings, Props);
+
+    if (screenPropertiesKey != NULL)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03RxElectrodeMaskTouch2D",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03RxElectrodeMaskTouch2D)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03RxElectrodeMaskTouch2D,
-        sizeof(UINT32)
-    },
+        if (Calibration != NULL && screenKey.CalibrationMesh)
+        {
+            TchReadCalibrationMesh(
+                screenPropertiesKey,
+                Props,
+                (PKEY_VALUE_PARTIAL_INFORMATION) buffer,
+                Calibration);
+        }
+
+        ZwClose(screenPropertiesKey);
+    }
+
+    if (rootKey != NULL)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03TxElectrodeMaskTouch2D",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03TxElectrodeMaskTouch2D)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03TxElectrodeMaskTouch2D,
-        sizeof(UINT32)
-    },
+        ZwClose(rootKey);
+    }
+
+    if (buffer != NULL)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03RxElectrodeMaskButtons",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03RxElectrodeMaskButtons)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03RxElectrodeMaskButtons,
-        sizeof(UINT32)
-    },
+        ExFreePoolWithTag(buffer, TOUCH_POOL_TAG);
+    }
+
+    end = KeQueryPerformanceCounter(NULL);
+
+    Trace(
+        TRACE_LEVEL_INFORMATION,
+        TRACE_REGISTRY,
+        "Read %lu touch registry values in %I64u us",
+        values,
+        (ULONG64)(end.QuadPart - start.QuadPart) * 1000000 / (ULONG64)frequency.QuadPart);
+
+    if (Calibration != NULL)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03TxElectrodeMaskButtons",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03TxElectrodeMaskButtons)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03TxElectrodeMaskButtons,
-        sizeof(UINT32)
-    },
+        Trace(
+            TRACE_LEVEL_INFORMATION,
+            TRACE_REGISTRY,
+            "Calibration mesh %dx%d %s",
+            Calibration->Columns,
+            Calibration->Rows,
+            Calibration->Enabled ? "enabled" : "disabled");
+    }
+}
+
+//
+// Keys whose last write time is recorded in a snapshot. A snapshot is
+// only used while none of them changed.
+//
+static const PCWSTR gSnapshotSourceKeys[] =
+{
+    TOUCH_SCREEN_SETTINGS_SUB_KEY,
+    TOUCH_SCREEN_SETTINGS_00_SUB_KEY,
+    TOUCH_SCREEN_SETTINGS_01_SUB_KEY,
+    TOUCH_SCREEN_SETTINGS_02_SUB_KEY,
+    TOUCH_SCREEN_SETTINGS_03_SUB_KEY,
+    TOUCH_SCREEN_SETTINGS_FF_SUB_KEY,
+    TOUCH_SCREEN_PROPERTIES_SUB_KEY
+};
+
+C_ASSERT(ARRAYSIZE(gSnapshotSourceKeys) == TOUCH_SNAPSHOT_SOURCES);
+
+#define TOUCH_SNAPSHOT_VALUE            L"TouchConfigurationSnapshot"
+
+//
+// Changes with every build, so a snapshot never outlives the driver that
+// took it even when the default tables below stay the same
+//
+static const CHAR gSnapshotBuildStamp[] = __DATE__ " " __TIME__;
+
+static
+ULONG
+TchSettingTableSchema(
+    IN ULONG Crc,
+    IN const TOUCH_SETTING_DESCRIPTOR* Descriptors,
+    IN ULONG Count
+)
+{
+    ULONG i;
+
+    for (i = 0; i < Count; i++)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03FullBaselineButton0Min",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03FullBaselineButton0Min)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03FullBaselineButton0Min,
-        sizeof(UINT32)
-    },
+        Crc = TchSnapshotCrc(
+            Crc,
+            Descriptors[i].Name,
+            (ULONG) wcslen(Descriptors[i].Name) * sizeof(WCHAR));
+
+        if (Descriptors[i].KeyName != NULL)
+        {
+            Crc = TchSnapshotCrc(
+                Crc,
+                Descriptors[i].KeyName,
+                (ULONG) wcslen(Descriptors[i].KeyName) * sizeof(WCHAR));
+        }
+
+        Crc = TchSnapshotCrc(Crc, &Descriptors[i].Offset, sizeof(ULONG));
+        Crc = TchSnapshotCrc(Crc, &Descriptors[i].Count, sizeof(ULONG));
+    }
+
+    return Crc;
+}
+
+static
+ULONG
+TchConfigurationSchema(
+    VOID
+)
+{
+    ULONG crc;
+
+    //
+    // The defaults and the value names decide what a read gives for an
+    // unchanged registry, the build stamp covers everything else
+    //
+    crc = TchSnapshotCrc(0, gSnapshotBuildStamp, sizeof(gSnapshotBuildStamp));
+    crc = TchSnapshotCrc(crc, &gDefaultTouchSettings, sizeof(gDefaultTouchSettings));
+    crc = TchSnapshotCrc(crc, &gDefaultProperties, sizeof(gDefaultProperties));
+    crc = TchSettingTableSchema(crc, gDeviceSettings, ARRAYSIZE(gDeviceSettings));
+    crc = TchSettingTableSchema(crc, gVendorSettings, ARRAYSIZE(gVendorSettings));
+    crc = TchSettingTableSchema(crc, gScreenProperties, ARRAYSIZE(gScreenProperties));
+
+    return crc;
+}
+
+static
+VOID
+TchQuerySnapshotSources(
+    OUT LARGE_INTEGER WriteTime[TOUCH_SNAPSHOT_SOURCES]
+)
+{
+    UCHAR buffer[sizeof(KEY_BASIC_INFORMATION) + 64];
+    PKEY_BASIC_INFORMATION info = (PKEY_BASIC_INFORMATION) buffer;
+    HANDLE rootKey;
+    HANDLE key;
+    ULONG length;
+    ULONG i;
+    NTSTATUS status;
+
+    //
+    // Absent keys are recorded as zero
+    //
+    RtlZeroMemory(WriteTime, TOUCH_SNAPSHOT_SOURCES * sizeof(LARGE_INTEGER));
+
+    if (!NT_SUCCESS(TchOpenSettingKey(NULL, TOUCH_REG_KEY, &rootKey)))
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03FullBaselineButton1Min",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03FullBaselineButton1Min)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03FullBaselineButton1Min,
-        sizeof(UINT32)
-    },
+        return;
+    }
+
+    for (i = 0; i < TOUCH_SNAPSHOT_SOURCES; i++)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03FullBaselineButton2Min",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03FullBaselineButton2Min)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03FullBaselineButton2Min,
-        sizeof(UINT32)
-    },
+        if (!NT_SUCCESS(TchOpenSettingKey(rootKey, gSnapshotSourceKeys[i], &key)))
+        {
+            continue;
+        }
+
+        //
+        // Only the fixed part is needed, a long key name does not matter
+        //
+        status = ZwQueryKey(
+            key,
+            KeyBasicInformation,
+            info,
+            sizeof(buffer),
+            &length);
+
+        if (NT_SUCCESS(status) || status == STATUS_BUFFER_OVERFLOW)
+        {
+            WriteTime[i] = info->LastWriteTime;
+        }
+
+        ZwClose(key);
+    }
+
+    ZwClose(rootKey);
+}
+
+static
+BOOLEAN
+TchReadSnapshot(
+    IN WDFKEY DeviceKey,
+    IN ULONG Schema,
+    IN const LARGE_INTEGER* SourceWriteTime,
+    OUT PTOUCH_SNAPSHOT Snapshot
+)
+{
+    DECLARE_CONST_UNICODE_STRING(valueName, TOUCH_SNAPSHOT_VALUE);
+    ULONG length = 0;
+    ULONG type = REG_NONE;
+    NTSTATUS status;
+
+    status = WdfRegistryQueryValue(
+        DeviceKey,
+        &valueName,
+        sizeof(TOUCH_SNAPSHOT),
+        Snapshot,
+        &length,
+        &type);
+
+    if (!NT_SUCCESS(status))
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03FullBaselineButton0Max",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03FullBaselineButton0Max)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03FullBaselineButton0Max,
-        sizeof(UINT32)
-    },
+        return FALSE;
+    }
+
+    switch (type != REG_BINARY ?
+        TOUCH_SNAPSHOT_CORRUPT :
+        TchCheckSnapshot(Snapshot, length, Schema, SourceWriteTime))
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03FullBaselineButton1Max",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03FullBaselineButton1Max)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03FullBaselineButton1Max,
-        sizeof(UINT32)
-    },
+    case TOUCH_SNAPSHOT_VALID:
+        return TRUE;
+
+    case TOUCH_SNAPSHOT_OTHER_SCHEMA:
+        Trace(
+            TRACE_LEVEL_INFORMATION,
+            TRACE_REGISTRY,
+            "Configuration snapshot taken by another build (schema %08lX, now %08lX)",
+            Snapshot->Schema,
+            Schema);
+
+        return FALSE;
+
+    case TOUCH_SNAPSHOT_STALE:
+        Trace(
+            TRACE_LEVEL_INFORMATION,
+            TRACE_REGISTRY,
+            "Touch registry changed since the configuration snapshot");
+
+        return FALSE;
+
+    default:
+        Trace(
+            TRACE_LEVEL_WARNING,
+            TRACE_REGISTRY,
+            "Discarding configuration snapshot (type %d, %d bytes, version %d)",
+            type,
+            length,
+            length >= FIELD_OFFSET(TOUCH_SNAPSHOT, Size) ? Snapshot->Version : 0);
+
+        return FALSE;
+    }
+}
+
+VOID
+TchLoadTouchConfiguration(
+    IN WDFDEVICE FxDevice,
+    OUT PTOUCH_SCREEN_SETTINGS Settings,
+    OUT PTOUCH_SCREEN_PROPERTIES Props,
+    OUT PCALIBRATION_CONTEXT Calibration
+)
+/*++
+
+Routine Description:
+
+    Loads the validated configuration at device start. A snapshot
+    kept under the device key is used when its version and checksum
+    match, it was taken by this build and none of the touch registry
+    keys changed since. Otherwise the registry is read in full and the snapshot
+    is rewritten.
+
+Arguments:
+
+    FxDevice - Framework device object
+
+    Settings - Receives the touch settings
+
+    Props - Receives the screen properties
+
+    Calibration - Receives the calibration mesh
+
+Return Value:
+
+    None.
+
+--*/
+{
+    LARGE_INTEGER sourceWriteTime[TOUCH_SNAPSHOT_SOURCES];
+    DECLARE_CONST_UNICODE_STRING(valueName, TOUCH_SNAPSHOT_VALUE);
+    PTOUCH_SNAPSHOT snapshot = NULL;
+    WDFKEY deviceKey = NULL;
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER start;
+    LARGE_INTEGER end;
+    ULONG schema;
+    NTSTATUS status;
+
+    start = KeQueryPerformanceCounter(&frequency);
+
+    snapshot = ExAllocatePoolWithTag(
+        PagedPool,
+        sizeof(TOUCH_SNAPSHOT),
+        TOUCH_POOL_TAG);
+
+    status = WdfDeviceOpenRegistryKey(
+        FxDevice,
+        PLUGPLAY_REGKEY_DEVICE,
+        KEY_READ | KEY_SET_VALUE,
+        WDF_NO_OBJECT_ATTRIBUTES,
+        &deviceKey);
+
+    if (!NT_SUCCESS(status))
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03FullBaselineButton2Max",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03FullBaselineButton2Max)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03FullBaselineButton2Max,
-        sizeof(UINT32)
-    },
+        deviceKey = NULL;
+    }
+
+    if (snapshot == NULL || deviceKey == NULL)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03IncludeAbsSenseRawCapTest",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03IncludeAbsSenseRawCapTest)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03IncludeAbsSenseRawCapTest,
-        sizeof(UINT32)
-    },
+        TchLoadTouchRegistry(Settings, Props, Calibration);
+        goto exit;
+    }
+
+    //
+    // Taken before a full read, so a change made while reading only
+    // costs another full read on the next start
+    //
+    TchQuerySnapshotSources(sourceWriteTime);
+    schema = TchConfigurationSchema();
+
+    if (TchReadSnapshot(deviceKey, schema, sourceWriteTime, snapshot))
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03AbsSenseRawCapTxRxStart",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03AbsSenseRawCapTxRxStart)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03AbsSenseRawCapTxRxStart,
-        sizeof(UINT32)
-    },
+        RtlCopyMemory(Settings, &snapshot->Settings, sizeof(TOUCH_SCREEN_SETTINGS));
+        RtlCopyMemory(Props, &snapshot->Props, sizeof(TOUCH_SCREEN_PROPERTIES));
+        RtlCopyMemory(Calibration, &snapshot->Calibration, sizeof(CALIBRATION_CONTEXT));
+
+        end = KeQueryPerformanceCounter(NULL);
+
+        Trace(
+            TRACE_LEVEL_INFORMATION,
+            TRACE_REGISTRY,
+            "Touch configuration loaded from snapshot in %I64u us",
+            (ULONG64)(end.QuadPart - start.QuadPart) * 1000000 / (ULONG64)frequency.QuadPart);
+
+        goto exit;
+    }
+
+    TchLoadTouchRegistry(Settings, Props, Calibration);
+
+    TchBuildSnapshot(
+        snapshot,
+        schema,
+        sourceWriteTime,
+        Settings,
+        Props,
+        Calibration);
+
+    status = WdfRegistryAssignValue(
+        deviceKey,
+        &valueName,
+        REG_BINARY,
+        sizeof(TOUCH_SNAPSHOT),
+        snapshot);
+
+    if (!NT_SUCCESS(status))
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03AbsSenseRawCapTxRxEnd",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03AbsSenseRawCapTxRxEnd)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03AbsSenseRawCapTxRxEnd,
-        sizeof(UINT32)
-    },
+        Trace(
+            TRACE_LEVEL_WARNING,
+            TRACE_REGISTRY,
+            "Error saving configuration snapshot - 0x%08lX",
+            status);
+    }
+
+exit:
+
+    if (deviceKey != NULL)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03AbsSenseRawCapMinLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03AbsSenseRawCapMinLimit)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03AbsSenseRawCapMinLimit,
-        sizeof(UINT32)
-    },
+        WdfRegistryClose(deviceKey);
+    }
+
+    if (snapshot != NULL)
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03AbsSenseRawCapMaxLimit",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03AbsSenseRawCapMaxLimit)),
+        ExFreePoolWithTag(snapshot, TOUCH_POOL_TAG);
+    }
+}
+
+static
+VOID
+TchReadRuntimeSettings(
+    IN PTOUCH_RUNTIME_SETTINGS Settings
+)
+{
+    DWORD gestureEnabled = 0;
+
+    if (!NT_SUCCESS(RtlReadRegistryValue(
+        TOUCH_WAKEUP_GESTURE_REG_KEY,
+        L"Enabled",
         REG_DWORD,
-        &gDefaultTouchSettings.Vendor03AbsSenseRawCapMaxLimit,
-        sizeof(UINT32)
-    },
+        &gestureEnabled,
+        sizeof(DWORD))))
     {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"Vendor03IncludeShortTest",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_SETTINGS, Vendor03IncludeShortTest)),
-        REG_DWORD,
-        &gDefaultTouchSettings.Vendor03IncludeShortTest,
-        sizeof(UINT32)
-    },
+        gestureEnabled = 0;
+    }
+
+    InterlockedExchange(&Settings->WakeupGestureEnabled, gestureEnabled == 1);
+
+    Trace(
+        TRACE_LEVEL_INFORMATION,
+        TRACE_REGISTRY,
+        "Wakeup gesture %s",
+        gestureEnabled == 1 ? "enabled" : "disabled");
+}
+
+static
+VOID
+TchAcquireKeyWatchLock(
+    IN PTOUCH_KEY_WATCH Watch
+)
+{
     //
-    // List Terminator
+    // A mutex leaves the IRQL at passive for the registry calls made
+    // while holding it
     //
-    {
-        NULL, 0,
-        NULL,
-        0,
-        REG_DWORD,
-        NULL,
-        0
-    }
-};
-static const ULONG gcbRegistryTable = sizeof(gRegistryTable);
-static const ULONG gcRegistryTable =
-sizeof(gRegistryTable) / sizeof(gRegistryTable[0]);
+    KeWaitForSingleObject(
+        &Watch->Lock,
+        Executive,
+        KernelMode,
+        FALSE,
+        NULL);
+}
 
+static
 NTSTATUS
-RtlReadRegistryValue(
-    PCWSTR registry_path,
-    PCWSTR value_name,
-    ULONG type,
-    PVOID data,
-    ULONG length
+TchArmKeyWatch(
+    IN PTOUCH_KEY_WATCH Watch
 )
 {
-    UNICODE_STRING valname;
-    UNICODE_STRING keyname;
-    OBJECT_ATTRIBUTES attribs;
-    PKEY_VALUE_PARTIAL_INFORMATION pinfo;
-    HANDLE handle;
-    NTSTATUS rc;
-    ULONG len, reslen;
-
-    RtlInitUnicodeString(&keyname, registry_path);
-    RtlInitUnicodeString(&valname, value_name);
+    NTSTATUS status;
 
-    InitializeObjectAttributes(
-        &attribs, 
-        &keyname, 
-        OBJ_CASE_INSENSITIVE,
-        NULL, 
-        NULL
-    );
+    KeClearEvent(&Watch->Idle);
 
-    rc = ZwOpenKey(
-        &handle, 
-        KEY_QUERY_VALUE, 
-        &attribs
-    );
+    //
+    // Completion queues Item to a system worker thread
+    //
+    status = ZwNotifyChangeKey(
+        Watch->Key,
+        NULL,
+        (PIO_APC_ROUTINE)(ULONG_PTR) &Watch->Item,
+        (PVOID)(ULONG_PTR) DelayedWorkQueue,
+        &Watch->Status,
+        Watch->Filter,
+        Watch->WatchTree,
+        NULL,
+        0,
+        TRUE);
 
-    if (!NT_SUCCESS(rc))
+    if (status != STATUS_PENDING && !NT_SUCCESS(status))
     {
-        return 0;
+        KeSetEvent(&Watch->Idle, IO_NO_INCREMENT, FALSE);
     }
 
-    len = sizeof(KEY_VALUE_PARTIAL_INFORMATION) + length;
-
-    pinfo = ExAllocatePoolWithTag(
-        NonPagedPool, 
-        len, 
-        TOUCH_POOL_TAG
-    );
+    return status;
+}
 
-    if (pinfo == NULL)
-    {
-        goto exit;
-    }
+static
+VOID
+TchKeyWatchRoutine(
+    IN PVOID Parameter
+)
+{
+    PTOUCH_KEY_WATCH watch = (PTOUCH_KEY_WATCH) Parameter;
+    NTSTATUS status;
 
-    rc = ZwQueryValueKey(
-        handle, 
-        &valname, 
-        KeyValuePartialInformation,
-        pinfo, 
-        len, 
-        &reslen
-    );
+    TchAcquireKeyWatchLock(watch);
 
-    if ((NT_SUCCESS(rc) || rc == STATUS_BUFFER_OVERFLOW) && 
-        reslen >= (sizeof(KEY_VALUE_PARTIAL_INFORMATION) - 1) &&
-        (!type || pinfo->Type == type))
+    //
+    // STATUS_NOTIFY_CLEANUP means the key was closed, the watch ends
+    //
+    if (watch->Stopping || watch->Status.Status == STATUS_NOTIFY_CLEANUP)
     {
-        reslen = pinfo->DataLength;
-        memcpy(data, pinfo->Data, min(length, reslen));
+        KeSetEvent(&watch->Idle, IO_NO_INCREMENT, FALSE);
+        KeReleaseMutex(&watch->Lock, FALSE);
+        return;
     }
-    else
+
+    //
+    // Any other failure may have dropped a change, the routine runs
+    // anyway and the watch goes on
+    //
+    if (!NT_SUCCESS(watch->Status.Status))
     {
-        reslen = 0;
+        Trace(
+            TRACE_LEVEL_ERROR,
+            TRACE_REGISTRY,
+            "Notification on %ws failed - 0x%08lX",
+            watch->KeyPath,
+            watch->Status.Status);
     }
 
-    if (pinfo != NULL)
+    //
+    // Re-arm before calling the routine, a change made meanwhile then
+    // calls it again instead of being missed. The next call waits for
+    // the lock, so calls do not overlap.
+    //
+    status = TchArmKeyWatch(watch);
+
+    if (!NT_SUCCESS(status))
     {
-        ExFreePoolWithTag(pinfo, TOUCH_POOL_TAG);
+        Trace(
+            TRACE_LEVEL_ERROR,
+            TRACE_REGISTRY,
+            "Error re-arming notification on %ws, changes will not be "
+            "picked up until restart - 0x%08lX",
+            watch->KeyPath,
+            status);
     }
 
-exit:
-    ZwClose(handle);
-    return rc;
+    watch->Routine(watch->Context);
+
+    KeReleaseMutex(&watch->Lock, FALSE);
 }
 
-NTSTATUS
-TchRegistryGetControllerSettings(
-    IN VOID* ControllerContext,
-    IN WDFDEVICE FxDevice
+VOID
+TchInitializeKeyWatch(
+    OUT PTOUCH_KEY_WATCH Watch,
+    IN PCWSTR KeyPath,
+    IN ULONG Filter,
+    IN BOOLEAN WatchTree,
+    IN PTOUCH_KEY_WATCH_ROUTINE Routine,
+    IN PVOID Context
 )
 /*++
 
-  Routine Description:
+Routine Description:
 
-    This routine retrieves controller wide settings
-    from the registry.
+    Prepares a watch on a registry key, nothing is watched until
+    TchStartKeyWatch
 
-  Arguments:
+Arguments:
 
-    FxDevice - a handle to the framework device object
-    Settings - A pointer to the chip settings structure
+    Watch - The watch to initialize
 
-  Return Value:
+    KeyPath - Absolute path of the key, must stay valid while watched
 
-    NTSTATUS indicating success or failure
+    Filter - REG_NOTIFY_CHANGE_* changes to watch for
+
+    WatchTree - Watch the subkeys as well
+
+    Routine - Called after every change, at passive level with the
+        watch lock held
+
+    Context - Passed to Routine
+
+Return Value:
+
+    None.
 
 --*/
 {
-    HX85X_CONTROLLER_CONTEXT* controller;
-    NTSTATUS status;
+    RtlZeroMemory(Watch, sizeof(TOUCH_KEY_WATCH));
 
-    UNREFERENCED_PARAMETER(FxDevice);
+    Watch->KeyPath = KeyPath;
+    Watch->Filter = Filter;
+    Watch->WatchTree = WatchTree;
+    Watch->Routine = Routine;
+    Watch->Context = Context;
 
-    controller = (HX85X_CONTROLLER_CONTEXT*)ControllerContext;
+    KeInitializeEvent(&Watch->Idle, NotificationEvent, TRUE);
+    KeInitializeMutex(&Watch->Lock, 0);
+}
 
-    RtlCopyMemory(
-        &controller->Config,
-        &gDefaultConfiguration,
-        sizeof(HX85X_CONFIGURATION));
+NTSTATUS
+TchStartKeyWatch(
+    IN PTOUCH_KEY_WATCH Watch
+)
+/*++
 
-    status = STATUS_SUCCESS;
+Routine Description:
 
-    return status;
-}
+    Opens the watched key and arms the change notification
+
+Arguments:
+
+    Watch - The initialized watch
 
-/*
- * Appends src to string dst of size siz (unlike strncat, siz is the
- * full size of dst, not space left).  At most siz-1 characters
- * will be copied.  Always NUL terminates (unless siz = siz, truncation occurred.
- * 
- * From: https://stackoverflow.com/questions/1855956/how-do-you-concatenate-two-wchar-t-together
- */
-size_t wstrlcat(wchar_t* dst, const wchar_t* src, size_t siz)
+Return Value:
+
+    NTSTATUS indicating success or failure
+
+--*/
 {
-    wchar_t* d = dst;
-    const wchar_t* s = src;
-    size_t n = siz;
-    size_t dlen;
-
-    /* Find the end of dst and adjust bytes left but don't go past end */
-    while (n-- != 0 && *d != L'\0') {
-        d++;
-    }
+    UNICODE_STRING keyName;
+    OBJECT_ATTRIBUTES attributes;
+    NTSTATUS status;
+
+    RtlInitUnicodeString(&keyName, Watch->KeyPath);
+
+    InitializeObjectAttributes(
+        &attributes,
+        &keyName,
+        OBJ_CASE_INSENSITIVE | OBJ_KERNEL_HANDLE,
+        NULL,
+        NULL);
 
-    dlen = d - dst;
-    n = siz - dlen;
+    status = ZwOpenKey(&Watch->Key, KEY_NOTIFY, &attributes);
 
-    if (n == 0) {
-        return(dlen + wcslen(s));
+    if (!NT_SUCCESS(status))
+    {
+        Watch->Key = NULL;
+        return status;
     }
 
-    while (*s != L'\0')
+    ExInitializeWorkItem(
+        &Watch->Item,
+        TchKeyWatchRoutine,
+        Watch);
+
+    Watch->Stopping = FALSE;
+
+    status = TchArmKeyWatch(Watch);
+
+    if (!NT_SUCCESS(status))
     {
-        if (n != 1)
-        {
-            *d++ = *s;
-            n--;
-        }
-        s++;
+        ZwClose(Watch->Key);
+        Watch->Key = NULL;
+        return status;
     }
 
-    *d = '\0';
-    return(dlen + (s - src));        /* count does not include NUL */
+    return STATUS_SUCCESS;
 }
 
 VOID
-TchGetTouchSettings(
-    IN PTOUCH_SCREEN_SETTINGS TouchSettings
+TchStopKeyWatch(
+    IN PTOUCH_KEY_WATCH Watch
 )
-{
-    ULONG i;
-    PRTL_QUERY_REGISTRY_TABLE regTable;
-    WCHAR regKey[120] = { 0 };
-    NTSTATUS status;
+/*++
 
-    regTable = NULL;
+Routine Description:
 
-    wstrlcat(regKey, TOUCH_REG_KEY, sizeof(TOUCH_REG_KEY));
-    regKey[sizeof(TOUCH_REG_KEY) / sizeof(WCHAR)] = L'\\';
-    RtlCopyMemory((PCHAR)regKey + sizeof(TOUCH_REG_KEY) + sizeof(WCHAR), TOUCH_SCREEN_SETTINGS_SUB_KEY, sizeof(TOUCH_SCREEN_SETTINGS_SUB_KEY) - sizeof(WCHAR));
-    regKey[(sizeof(TOUCH_REG_KEY) + sizeof(TOUCH_SCREEN_SETTINGS_SUB_KEY)) / sizeof(WCHAR)] = L'\0';
+    Stops watching and waits for a routine call in progress to finish
 
-    //
-    // Table passed to RtlQueryRegistryValues must be allocated 
-    // from NonPagedPool
-    //
-    regTable = ExAllocatePoolWithTag(
-        NonPagedPool,
-        gcbRegistryTable,
-        TOUCH_POOL_TAG);
+Arguments:
 
-    if (regTable == NULL)
-    {
-        return;
-    }
+    Watch - The watch to stop, may never have been started
 
-    RtlCopyMemory(
-        regTable,
-        gRegistryTable,
-        gcbRegistryTable);
+Return Value:
 
-    //
-    // Update offset values with base pointer
-    // 
-    for (i = 0; i < gcRegistryTable - 1; i++)
+    None.
+
+--*/
+{
+    if (Watch->Key == NULL)
     {
-        regTable[i].EntryContext = (PVOID)(
-            ((SIZE_T)regTable[i].EntryContext) +
-            ((ULONG_PTR)TouchSettings));
+        return;
     }
 
     //
-    // Start with default values
+    // Closing the key completes a pending notification with
+    // STATUS_NOTIFY_CLEANUP, the worker then signals Idle
     //
-    RtlCopyMemory(
-        TouchSettings,
-        &gDefaultTouchSettings,
-        sizeof(TOUCH_SCREEN_SETTINGS));
+    TchAcquireKeyWatchLock(Watch);
+    Watch->Stopping = TRUE;
+    ZwClose(Watch->Key);
+    Watch->Key = NULL;
+    KeReleaseMutex(&Watch->Lock, FALSE);
+
+    KeWaitForSingleObject(
+        &Watch->Idle,
+        Executive,
+        KernelMode,
+        FALSE,
+        NULL);
+}
+
+static
+VOID
+TchRuntimeSettingsNotificationRoutine(
+    IN PVOID Parameter
+)
+{
+    TchReadRuntimeSettings((PTOUCH_RUNTIME_SETTINGS) Parameter);
+}
+
+VOID
+TchInitializeRuntimeSettings(
+    IN PTOUCH_RUNTIME_SETTINGS Settings
+)
+/*++
+
+Routine Description:
+
+    Reads the runtime settings into the cache and prepares it for
+    change notification
+
+Arguments:
+
+    Settings - The runtime settings cache
+
+Return Value:
+
+    None.
+
+--*/
+{
+    RtlZeroMemory(Settings, sizeof(TOUCH_RUNTIME_SETTINGS));
 
     //
-    // Populate device context with registry overrides (or defaults)
+    // Subkeys are watched as well, WakeupGesture lives below the
+    // watched key
     //
-    status = RtlQueryRegistryValues(
-        RTL_REGISTRY_ABSOLUTE,
-        regKey,
-        regTable,
-        NULL,
-        NULL);
+    TchInitializeKeyWatch(
+        &Settings->Watch,
+        TOUCH_RUNTIME_SETTINGS_REG_KEY,
+        REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET,
+        TRUE,
+        TchRuntimeSettingsNotificationRoutine,
+        Settings);
+
+    TchReadRuntimeSettings(Settings);
+}
+
+NTSTATUS
+TchStartRuntimeSettingsNotification(
+    IN PTOUCH_RUNTIME_SETTINGS Settings
+)
+/*++
+
+Routine Description:
+
+    Starts watching TOUCH_RUNTIME_SETTINGS_REG_KEY, every change then
+    refreshes the cached runtime settings
+
+Arguments:
+
+    Settings - The initialized runtime settings cache
+
+Return Value:
+
+    NTSTATUS indicating success or failure
+
+--*/
+{
+    NTSTATUS status;
+
+    status = TchStartKeyWatch(&Settings->Watch);
 
     if (!NT_SUCCESS(status))
     {
         Trace(
             TRACE_LEVEL_WARNING,
             TRACE_REGISTRY,
-            "Error retrieving registry configuration - 0x%08lX",
+            "Runtime settings will not be refreshed - 0x%08lX",
             status);
-    }
 
-    if (regTable != NULL)
-    {
-        ExFreePoolWithTag(regTable, TOUCH_POOL_TAG);
+        return status;
     }
-}
\ No newline at end of file
+
+    //
+    // Catch a change made between the initial read and arming
+    //
+    TchReadRuntimeSettings(Settings);
+
+    return STATUS_SUCCESS;
+}
+
+VOID
+TchStopRuntimeSettingsNotification(
+    IN PTOUCH_RUNTIME_SETTINGS Settings
+)
+/*++
+
+Routine Description:
+
+    Stops watching the runtime settings and waits for a refresh in
+    progress to finish
+
+Arguments:
+
+    Settings - The runtime settings cache
+
+Return Value:
+
+    None.
+
+--*/
+{
+    TchStopKeyWatch(&Settings->Watch);
+}
@@ -143,6 +143,8 @@ ReportPen(
 {
 	NTSTATUS status;
 	HID_INPUT_REPORT HidReport;
+	const TOUCH_SCREEN* screen;
+	LONG ticket;
 	RtlZeroMemory(&HidReport, sizeof(HID_INPUT_REPORT));
 
 	USHORT ScratchX = (USHORT)X;
@@ -151,10 +153,19 @@ ReportPen(
 	//
 	// Perform per-platform x/y adjustments to controller coordinates
 	//
-	TchTranslateToDisplayCoordinates(
+	screen = TchAcquireScreen(&ReportContext->Screen, &ticket);
+
+	TchTransformToDisplayCoordinates(
 		&ScratchX,
 		&ScratchY,
-		&ReportContext->Props);
+		&screen->Transform);
+
+	CalibrationApply(
+		&screen->Calibration,
+		&ScratchX,
+		&ScratchY);
+
+	TchReleaseScreen(&ReportContext->Screen, ticket);
 
 	HidReport.ReportID = REPORTID_STYLUS;
 
@@ -310,10 +321,210 @@ Return Value:
 	}
 
 	//
-	// Get current scan time (in 100us units)
+	// Scan time of the frame (in 100us units), taken when the controller
+	// signaled it rather than once the SPB read has finished
+	//
+	Cache->ScanTime = Data->Timestamp / 1000;
+}
+
+VOID
+ReportTrackObjects(
+	IN PREPORT_CONTEXT ReportContext,
+	IN OBJECT_INFO* Frame,
+	OUT PUCHAR Ids
+)
+/*++
+
+Routine Description:
+
+	Assigns a stable contact ID to every slot reported in this frame, see
+	TrackerUpdate. The controller slot index is not used as ID since the
+	firmware may reshuffle slots between frames.
+
+Arguments:
+
+	ReportContext - Report context holding the cache and tracker state
+	Frame - Copy of the cached slots
+	Ids - Receives the contact ID of each slot
+
+Return Value:
+
+	None.
+
+--*/
+{
+	TRACKER_POINT points[MAX_TOUCHES];
+	int i;
+
+	for (i = 0; i < MAX_TOUCHES; i++)
+	{
+		points[i].X = Frame[i].x;
+		points[i].Y = Frame[i].y;
+	}
+
+	//
+	// Slots lifted in this frame are still flagged dirty until the next
+	// cache update
+	//
+	TrackerUpdate(
+		&ReportContext->Tracker,
+		ReportContext->Cache.SlotValid,
+		ReportContext->Cache.SlotDirty,
+		points,
+		Ids);
+}
+
+VOID
+ReportFilterObjects(
+	IN PREPORT_CONTEXT ReportContext,
+	IN OUT OBJECT_INFO* Frame,
+	IN PUCHAR Ids
+)
+/*++
+
+Routine Description:
+
+	Runs the adaptive position filter over every down contact of the
+	frame. Lifted contacts keep their last measured position and their
+	filter state is dropped.
+
+Arguments:
+
+	ReportContext - Report context holding the cache and filter state
+	Frame - Copy of the cached slots, positions are updated in place
+	Ids - Contact ID of each slot, filter state is kept per contact
+
+Return Value:
+
+	None.
+
+--*/
+{
+	OBJECT_CACHE* cache = &ReportContext->Cache;
+	LONG x, y;
+	int i;
+
+	if (!ReportContext->Filter.Enabled)
+	{
+		return;
+	}
+
+	for (i = 0; i < MAX_TOUCHES; i++)
+	{
+		if (!(ReportContext->Tracker.IdMask & (1 << i)))
+		{
+			FilterResetSlot(&ReportContext->Filter.Slot[i]);
+		}
+	}
+
+	for (i = 0; i < MAX_TOUCHES; i++)
+	{
+		if (!(cache->SlotValid & (1 << i)))
+		{
+			continue;
+		}
+
+		x = Frame[i].x;
+		y = Frame[i].y;
+
+		FilterPosition(
+			&ReportContext->Filter,
+			&ReportContext->Filter.Slot[Ids[i]],
+			(ULONG)cache->ScanTime,
+			&x,
+			&y);
+
+		Frame[i].x = x;
+		Frame[i].y = y;
+	}
+}
+
+VOID
+ReportPredictObjects(
+	IN PREPORT_CONTEXT ReportContext,
+	IN const TOUCH_SCREEN* Screen,
+	IN OUT OBJECT_INFO* Frame,
+	IN PUCHAR Ids
+)
+/*++
+
+Routine Description:
+
+	Feeds the frame into the motion predictor and moves every down
+	contact ahead by the configured horizon. Lifted contacts are reported
+	at their last measured position and their history is dropped.
+
+Arguments:
+
+	ReportContext - Report context holding the cache and predictor state
+	Screen - Screen state the frame is reported with
+	Frame - Copy of the cached slots, positions are updated in place
+	Ids - Contact ID of each slot, history is kept per contact
+
+Return Value:
+
+	None.
+
+--*/
+{
+	OBJECT_CACHE* cache = &ReportContext->Cache;
+	ULONG horizon;
+	ULONG maxX;
+	ULONG maxY;
+	LONG x, y;
+	int i;
+
+	if (Screen->Props.TouchPredictionHorizon == 0)
+	{
+		return;
+	}
+
+	//
+	// Horizon in 100us units, like the scan time
+	//
+	horizon = min(Screen->Props.TouchPredictionHorizon, PREDICT_MAX_HORIZON_MS) * 10;
+
 	//
-	ULONG64 QpcTimeStamp;
-	Cache->ScanTime = KeQueryInterruptTimePrecise(&QpcTimeStamp) / 1000;
+	// Keep predictions inside the controller coordinate space
+	//
+	maxX = Screen->Props.TouchSwapAxes ?
+		Screen->Props.TouchPhysicalHeight : Screen->Props.TouchPhysicalWidth;
+	maxY = Screen->Props.TouchSwapAxes ?
+		Screen->Props.TouchPhysicalWidth : Screen->Props.TouchPhysicalHeight;
+
+	for (i = 0; i < MAX_TOUCHES; i++)
+	{
+		if (!(ReportContext->Tracker.IdMask & (1 << i)))
+		{
+			PredictResetSlot(&ReportContext->Predict.Slot[i]);
+		}
+	}
+
+	for (i = 0; i < MAX_TOUCHES; i++)
+	{
+		if (!(cache->SlotValid & (1 << i)))
+		{
+			continue;
+		}
+
+		x = Frame[i].x;
+		y = Frame[i].y;
+
+		PredictAddSample(
+			&ReportContext->Predict.Slot[Ids[i]],
+			x,
+			y,
+			(ULONG)cache->ScanTime);
+
+		PredictPosition(
+			&ReportContext->Predict.Slot[Ids[i]],
+			horizon,
+			&x,
+			&y);
+
+		Frame[i].x = max(0, min(x, (LONG)maxX - 1));
+		Frame[i].y = max(0, min(y, (LONG)maxY - 1));
+	}
 }
 
 NTSTATUS
@@ -350,8 +561,20 @@ Return Value:
 	int TouchesReported = 0;
 	int currentFingerIndex;
 	int fingersToReport = 0;
-	USHORT SctatchX = 0, ScratchY = 0;
 	BOOLEAN HasPen = FALSE;
+	OBJECT_INFO Frame[MAX_TOUCHES];
+	UCHAR Ids[MAX_TOUCHES];
+	USHORT DisplayX[MAX_TOUCHES];
+	USHORT DisplayY[MAX_TOUCHES];
+	const TOUCH_SCREEN* screen;
+	LONG ticket;
+	int i;
+
+	//
+	// The whole frame is reported with one screen state, even if the
+	// properties are reloaded meanwhile
+	//
+	screen = TchAcquireScreen(&ReportContext->Screen, &ticket);
 
 	//
 	// Process the new touch data by updating our cached state
@@ -360,6 +583,16 @@ Return Value:
 		&data,
 		&ReportContext->Cache);
 
+	//
+	// Positions to report are derived from a copy of the cache, so that
+	// processing stages never feed back into the measured data
+	//
+	RtlCopyMemory(Frame, ReportContext->Cache.Slot, sizeof(Frame));
+
+	ReportTrackObjects(ReportContext, Frame, Ids);
+	ReportFilterObjects(ReportContext, Frame, Ids);
+	ReportPredictObjects(ReportContext, screen, Frame, Ids);
+
 	//
 	// If no touches are present return that no data needed to be reported
 	//
@@ -369,6 +602,30 @@ Return Value:
 		goto exit;
 	}
 
+	//
+	// Perform per-platform x/y adjustments to controller coordinates, for
+	// all down contacts at once in report order
+	//
+	for (i = 0; i < ReportContext->Cache.DownCount; i++)
+	{
+		DisplayX[i] = (USHORT)Frame[ReportContext->Cache.DownOrder[i]].x;
+		DisplayY[i] = (USHORT)Frame[ReportContext->Cache.DownOrder[i]].y;
+	}
+
+	TchTransformFrameToDisplayCoordinates(
+		DisplayX,
+		DisplayY,
+		(ULONG)ReportContext->Cache.DownCount,
+		&screen->Transform);
+
+	for (i = 0; i < ReportContext->Cache.DownCount; i++)
+	{
+		CalibrationApply(
+			&screen->Calibration,
+			&DisplayX[i],
+			&DisplayY[i]);
+	}
+
 	while (TouchesReported != ReportContext->Cache.DownCount)
 	{
 		//
@@ -385,7 +642,11 @@ Return Value:
 		//
 		// There are only 16-bits for ScanTime, truncate it
 		//
-		//HidReport->ScanTime = Cache->ScanTime & 0xFFFF;
+		HidReport.TouchReport.ScanTime = (USHORT)(ReportContext->Cache.ScanTime & 0xFFFF);
+
+#ifdef _TIMESTAMP_
+		HidReport.TimeStamp.QuadPart = (LONGLONG)data.Timestamp;
+#endif
 
 		//
 		// Report the count
@@ -411,7 +672,7 @@ Return Value:
 		{
 			int currentlyReporting = ReportContext->Cache.DownOrder[TouchesReported];
 
-			OBJECT_INFO info = ReportContext->Cache.Slot[currentlyReporting];
+			OBJECT_INFO info = Frame[currentlyReporting];
 
 			if (info.status == OBJECT_STATE_PEN_PRESENT_WITH_ERASER ||
 				info.status == OBJECT_STATE_PEN_PRESENT_WITH_TIP)
@@ -443,23 +704,13 @@ Return Value:
 				}
 			}
 
-			HidReport.TouchReport.Contacts[currentFingerIndex].ContactID = (UCHAR)currentlyReporting;
-			SctatchX = (USHORT)info.x;
-			ScratchY = (USHORT)info.y;
+			HidReport.TouchReport.Contacts[currentFingerIndex].ContactID = Ids[currentlyReporting];
 			HidReport.TouchReport.Contacts[currentFingerIndex].Confidence = 1;
 
-			//
-			// Perform per-platform x/y adjustments to controller coordinates
-			//
-			TchTranslateToDisplayCoordinates(
-				&SctatchX,
-				&ScratchY,
-				&ReportContext->Props);
-
 			if (info.status == OBJECT_STATE_FINGER_PRESENT_WITH_ACCURATE_POS)
 			{
-				HidReport.TouchReport.Contacts[currentFingerIndex].X = SctatchX;
-				HidReport.TouchReport.Contacts[currentFingerIndex].Y = ScratchY;
+				HidReport.TouchReport.Contacts[currentFingerIndex].X = DisplayX[TouchesReported];
+				HidReport.TouchReport.Contacts[currentFingerIndex].Y = DisplayY[TouchesReported];
 				HidReport.TouchReport.Contacts[currentFingerIndex].TipSwitch = FINGER_STATUS;
 			}
 
@@ -510,6 +761,8 @@ Return Value:
 	}
 
 exit:
+	TchReleaseScreen(&ReportContext->Screen, ticket);
+
 	return status;
 }
 
@@ -536,6 +789,11 @@ TchContinuousObjectInterruptServicingEvtTimerFunc(
 		goto exit;
       }
 
+	//
+	// The repeated frame is synthesized now, stamp it accordingly
+	//
+	objectData.Timestamp = KeQueryInterruptTime();
+
 	status = ReportObjectsInternal(
 		cachedReportContext,
 		objectData);
@@ -654,7 +912,15 @@ ReportObjects(
 	IN DETECTED_OBJECTS data
 )
 {
-	if (ReportContext->Props.TouchHardwareLacksContinuousReporting)
+	const TOUCH_SCREEN* screen;
+	LONG ticket;
+	BOOLEAN continuous;
+
+	screen = TchAcquireScreen(&ReportContext->Screen, &ticket);
+	continuous = screen->Props.TouchHardwareLacksContinuousReporting != 0;
+	TchReleaseScreen(&ReportContext->Screen, ticket);
+
+	if (continuous)
       {
             return ReportObjectsContinuous(
 		      ReportContext,
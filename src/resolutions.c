@@ -9,9 +9,9 @@
 
     Abstract:
 
-        This module retrieves platform-specific configuration
-        parameters from the registry, and translates touch
-        controller pixel units to display pixel units.
+        This module translates touch controller pixel units to
+        display pixel units, and publishes the screen state built
+        from the platform-specific configuration in the registry.
 
     Environment:
 
@@ -24,226 +24,19 @@
 #include <wdm.h>
 #include <controller.h>
 #include <resolutions.h>
-#include <resolutions.tmh>
 
 //
-// Registry values explaining the relationship of the touch
-// controller coordinates to the physical LCD, as well as
-// any differences between the physical LCD dimensons and
-// viewable LCD area, are required. If not provided for whatever
-// reason, we will assume everything is 480x800 and perfectly
-// aligned.
+// Frames are transformed four contacts at a time with SSE2 or NEON
 //
+#if defined(_M_AMD64)
+#include <emmintrin.h>
+#define TOUCH_TRANSFORM_VECTOR __m128i
+#elif defined(_M_ARM64)
+#include <arm_neon.h>
+#define TOUCH_TRANSFORM_VECTOR uint32x4_t
+#endif
 
-TOUCH_SCREEN_PROPERTIES gDefaultProperties =
-{
-    0x0,
-    0x0,
-    0x0,
-    TOUCH_DEFAULT_RESOLUTION_X,
-    TOUCH_DEFAULT_RESOLUTION_Y,
-    0x0,
-    TOUCH_DEFAULT_RESOLUTION_X,
-    TOUCH_DEFAULT_RESOLUTION_Y,
-    0x0,
-    0x0,
-    0x0,
-    0x0,
-    TOUCH_DEFAULT_RESOLUTION_X,
-    TOUCH_DEFAULT_RESOLUTION_Y,
-    0x0,
-    0x0,
-    0x0
-};
-
-
-RTL_QUERY_REGISTRY_TABLE gResParamsRegTable[] =
-{
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"TouchSwapAxes",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_PROPERTIES, TouchSwapAxes)),
-        REG_DWORD,
-        &gDefaultProperties.TouchSwapAxes,
-        sizeof(ULONG)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"TouchInvertXAxis",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_PROPERTIES, TouchInvertXAxis)),
-        REG_DWORD,
-        &gDefaultProperties.TouchInvertXAxis,
-        sizeof(ULONG)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"TouchInvertYAxis",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_PROPERTIES, TouchInvertYAxis)),
-        REG_DWORD,
-        &gDefaultProperties.TouchInvertYAxis,
-        sizeof(ULONG)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"TouchPhysicalWidth",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_PROPERTIES, TouchPhysicalWidth)),
-        REG_DWORD,
-        &gDefaultProperties.TouchPhysicalWidth,
-        sizeof(ULONG)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"TouchPhysicalHeight",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_PROPERTIES, TouchPhysicalHeight)),
-        REG_DWORD,
-        &gDefaultProperties.TouchPhysicalHeight,
-        sizeof(ULONG)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"TouchPhysicalButtonHeight",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_PROPERTIES, TouchPhysicalButtonHeight)),
-        REG_DWORD,
-        &gDefaultProperties.TouchPhysicalButtonHeight,
-        sizeof(ULONG)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"TouchPillarBoxWidthLeft",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_PROPERTIES, TouchPillarBoxWidthLeft)),
-        REG_DWORD,
-        &gDefaultProperties.TouchPillarBoxWidthLeft,
-        sizeof(ULONG)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"TouchPillarBoxWidthRight",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_PROPERTIES, TouchPillarBoxWidthRight)),
-        REG_DWORD,
-        &gDefaultProperties.TouchPillarBoxWidthRight,
-        sizeof(ULONG)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"TouchLetterBoxHeightTop",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_PROPERTIES, TouchLetterBoxHeightTop)),
-        REG_DWORD,
-        &gDefaultProperties.TouchLetterBoxHeightTop,
-        sizeof(ULONG)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"TouchLetterBoxHeightBottom",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_PROPERTIES, TouchLetterBoxHeightBottom)),
-        REG_DWORD,
-        &gDefaultProperties.TouchLetterBoxHeightBottom,
-        sizeof(ULONG)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"DisplayPhysicalWidth",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_PROPERTIES, DisplayPhysicalWidth)),
-        REG_DWORD,
-        &gDefaultProperties.DisplayPhysicalWidth,
-        sizeof(ULONG)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"DisplayPhysicalHeight",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_PROPERTIES, DisplayPhysicalHeight)),
-        REG_DWORD,
-        &gDefaultProperties.DisplayPhysicalHeight,
-        sizeof(ULONG)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"DisplayViewableWidth",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_PROPERTIES, DisplayViewableWidth)),
-        REG_DWORD,
-        &gDefaultProperties.DisplayViewableWidth,
-        sizeof(ULONG)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"DisplayViewableHeight",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_PROPERTIES, DisplayViewableHeight)),
-        REG_DWORD,
-        &gDefaultProperties.DisplayViewableHeight,
-        sizeof(ULONG)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"DisplayPillarBoxWidthLeft",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_PROPERTIES, DisplayPillarBoxWidthLeft)),
-        REG_DWORD,
-        &gDefaultProperties.DisplayPillarBoxWidthLeft,
-        sizeof(ULONG)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"DisplayPillarBoxWidthRight",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_PROPERTIES, DisplayPillarBoxWidthRight)),
-        REG_DWORD,
-        &gDefaultProperties.DisplayPillarBoxWidthRight,
-        sizeof(ULONG)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"DisplayLetterBoxHeightTop",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_PROPERTIES, DisplayLetterBoxHeightTop)),
-        REG_DWORD,
-        &gDefaultProperties.DisplayLetterBoxHeightTop,
-        sizeof(ULONG)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"DisplayLetterBoxHeightBottom",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_PROPERTIES, DisplayLetterBoxHeightBottom)),
-        REG_DWORD,
-        &gDefaultProperties.DisplayLetterBoxHeightBottom,
-        sizeof(ULONG)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"DisplayHeight10um",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_PROPERTIES, DisplayHeight10um)),
-        REG_DWORD,
-        &gDefaultProperties.DisplayHeight10um,
-        sizeof(ULONG)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"DisplayWidth10um",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_PROPERTIES, DisplayWidth10um)),
-        REG_DWORD,
-        &gDefaultProperties.DisplayWidth10um,
-        sizeof(ULONG)
-    },
-    {
-        NULL, RTL_QUERY_REGISTRY_DIRECT,
-        L"TouchHardwareLacksContinuousReporting",
-        (PVOID)(FIELD_OFFSET(TOUCH_SCREEN_PROPERTIES, TouchHardwareLacksContinuousReporting)),
-        REG_DWORD,
-        &gDefaultProperties.TouchHardwareLacksContinuousReporting,
-        sizeof(ULONG)
-    },
-    //
-    // List Terminator - set to NULL to indicate end of table
-    //
-    {
-        NULL, 0,
-        NULL,
-        0,
-        REG_DWORD,
-        NULL,
-        0
-    }
-};
-
-static const ULONG gcbRegistryTable = sizeof(gResParamsRegTable);
-static const ULONG gcRegistryTable = 
-    sizeof(gResParamsRegTable) / sizeof(gResParamsRegTable[0]);
-
+#include <resolutions.tmh>
 
 VOID
 TchTranslateToDisplayCoordinates(
@@ -404,132 +197,780 @@ TchTranslateToDisplayCoordinates(
     *PY = (USHORT) Y;
 }
 
+static
 VOID
-TchGetScreenProperties(
-    IN PTOUCH_SCREEN_PROPERTIES Props
+TchTranslateKernel(
+    IN OUT PUSHORT X,
+    IN OUT PUSHORT Y,
+    IN const TOUCH_TRANSFORM* Transform
+    )
+{
+    TchTranslateToDisplayCoordinates(
+        X,
+        Y,
+        (PTOUCH_SCREEN_PROPERTIES)&Transform->Props);
+}
+
+FORCEINLINE
+ULONG
+TchTransformAxis(
+    IN ULONG Value,
+    IN const TOUCH_TRANSFORM_AXIS* Axis,
+    IN BOOLEAN Invert
+    )
+{
+    //
+    // Invert and touch box clipping folded into one clamp and one offset
+    //
+    if (Invert)
+    {
+        Value = Axis->TouchOffset - min(Value, Axis->TouchClip);
+    }
+    else
+    {
+        Value = max(Value, Axis->TouchClip) + Axis->TouchOffset;
+    }
+
+    Value = min(Value, Axis->TouchLimit);
+
+    //
+    // Scale by reciprocal multiplication
+    //
+    Value = (ULONG)((Value * Axis->ScaleMultiplier) >> Axis->ScaleShift);
+
+    //
+    // Display box clipping
+    //
+    Value = max(Value, Axis->DisplayClip) + Axis->DisplayOffset;
+
+    return min(Value, Axis->DisplayLimit);
+}
+
+#define TOUCH_TRANSFORM_KERNEL(_Name_, _Swap_, _InvertX_, _InvertY_)        \
+    static                                                                  \
+    VOID                                                                    \
+    _Name_(                                                                 \
+        IN OUT PUSHORT X,                                                   \
+        IN OUT PUSHORT Y,                                                   \
+        IN const TOUCH_TRANSFORM* Transform                                 \
+        )                                                                   \
+    {                                                                       \
+        ULONG x = (_Swap_) ? *Y : *X;                                       \
+        ULONG y = (_Swap_) ? *X : *Y;                                       \
+                                                                            \
+        *X = (USHORT) TchTransformAxis(x, &Transform->X, (_InvertX_));      \
+        *Y = (USHORT) TchTransformAxis(y, &Transform->Y, (_InvertY_));      \
+    }
+
+TOUCH_TRANSFORM_KERNEL(TchTransformKernel000, FALSE, FALSE, FALSE)
+TOUCH_TRANSFORM_KERNEL(TchTransformKernel001, FALSE, FALSE, TRUE)
+TOUCH_TRANSFORM_KERNEL(TchTransformKernel010, FALSE, TRUE, FALSE)
+TOUCH_TRANSFORM_KERNEL(TchTransformKernel011, FALSE, TRUE, TRUE)
+TOUCH_TRANSFORM_KERNEL(TchTransformKernel100, TRUE, FALSE, FALSE)
+TOUCH_TRANSFORM_KERNEL(TchTransformKernel101, TRUE, FALSE, TRUE)
+TOUCH_TRANSFORM_KERNEL(TchTransformKernel110, TRUE, TRUE, FALSE)
+TOUCH_TRANSFORM_KERNEL(TchTransformKernel111, TRUE, TRUE, TRUE)
+
+//
+// Indexed by swap, invert X, invert Y
+//
+static const PTOUCH_TRANSFORM_KERNEL gTransformKernels[8] =
+{
+    TchTransformKernel000,
+    TchTransformKernel001,
+    TchTransformKernel010,
+    TchTransformKernel011,
+    TchTransformKernel100,
+    TchTransformKernel101,
+    TchTransformKernel110,
+    TchTransformKernel111
+};
+
+static
+BOOLEAN
+TchCompileAxis(
+    IN ULONG TouchSize,
+    IN ULONG TouchBoxLow,
+    IN ULONG TouchBoxHigh,
+    IN ULONG Divisor,
+    IN ULONG DisplaySize,
+    IN ULONG DisplayBoxLow,
+    IN ULONG DisplayBoxHigh,
+    IN BOOLEAN Invert,
+    OUT TOUCH_TRANSFORM_AXIS* Axis
     )
 /*++
  
   Routine Description:
 
-    This routine retrieves coordinate translation settings
-    from the registry.
+    Folds the constants of one axis, TouchSize * DisplaySize / Divisor
+    being the scale. Returns FALSE if the folded form would not match the
+    reference translation for every input.
+
+--*/
+{
+    ULONG64 range;
+    ULONG shift;
+
+    //
+    // The clip stages rely on the boxes fitting into the axis, the scale
+    // on the reference product not wrapping (its input is at most
+    // TouchSize, the display box is added on top) and on a non zero divisor
+    //
+    if (TouchSize == 0 || TouchBoxLow >= TouchSize || TouchBoxHigh > TouchSize ||
+        DisplayBoxHigh > DisplaySize || Divisor == 0 ||
+        (ULONG64)TouchSize * DisplaySize + DisplaySize > MAXULONG)
+    {
+        return FALSE;
+    }
+
+    if (Invert)
+    {
+        Axis->TouchClip = TouchSize - 1u - TouchBoxLow;
+        Axis->TouchOffset = TouchSize - 1u - TouchBoxLow + TouchBoxHigh;
+    }
+    else
+    {
+        Axis->TouchClip = TouchBoxLow;
+        Axis->TouchOffset = TouchBoxHigh - TouchBoxLow;
+    }
+
+    Axis->TouchLimit = TouchSize;
+
+    //
+    // floor(n / Divisor) == (n * ceil(2^shift / Divisor)) >> shift holds
+    // for every n up to range / Divisor as long as range <= 2^shift
+    //
+    range = (ULONG64)TouchSize * DisplaySize * Divisor;
+
+    for (shift = 0; shift < 63 && ((ULONG64)1 << shift) < range; shift++)
+    {
+    }
+
+    if (shift > 62)
+    {
+        return FALSE;
+    }
+
+    Axis->ScaleMultiplier = (((ULONG64)1 << shift) + Divisor - 1) / Divisor;
+
+    if (Axis->ScaleMultiplier > MAXULONG64 / ((ULONG64)TouchSize * DisplaySize + 1))
+    {
+        return FALSE;
+    }
+
+    Axis->ScaleMultiplier *= DisplaySize;
+    Axis->ScaleShift = shift;
+
+    Axis->DisplayClip = DisplayBoxLow;
+    Axis->DisplayOffset = DisplayBoxHigh - DisplayBoxLow;
+    Axis->DisplayLimit = DisplaySize;
+
+    return TRUE;
+}
+
+VOID
+TchCompileTransform(
+    IN PTOUCH_SCREEN_PROPERTIES Props,
+    OUT PTOUCH_TRANSFORM Transform
+    )
+/*++
+ 
+  Routine Description:
+
+    This routine compiles the screen properties into a transform that
+    gives the same results as TchTranslateToDisplayCoordinates, without
+    branches or divisions per coordinate.
 
   Arguments:
 
-    Props - receives the Props
+    Props - pointer to screen information
+    Transform - receives the compiled transform
 
   Return Value:
 
-    None. On failure, defaults are returned.
+    None.
 
 --*/
 {
-    ULONG i;
-    PRTL_QUERY_REGISTRY_TABLE regTable;
-    NTSTATUS status;
+    BOOLEAN swap = Props->TouchSwapAxes != 0;
+    BOOLEAN invertX = Props->TouchInvertXAxis != 0;
+    BOOLEAN invertY = Props->TouchInvertYAxis != 0;
 
-    regTable = NULL;
+    RtlZeroMemory(Transform, sizeof(TOUCH_TRANSFORM));
+    RtlCopyMemory(&Transform->Props, Props, sizeof(TOUCH_SCREEN_PROPERTIES));
 
+    if (Props->TouchPhysicalButtonHeight < Props->TouchPhysicalHeight &&
+        TchCompileAxis(
+            Props->TouchPhysicalWidth,
+            Props->TouchPillarBoxWidthLeft,
+            Props->TouchPillarBoxWidthRight,
+            Props->TouchPhysicalWidth,
+            Props->DisplayPhysicalWidth,
+            Props->DisplayPillarBoxWidthLeft,
+            Props->DisplayPillarBoxWidthRight,
+            invertX,
+            &Transform->X) &&
+        TchCompileAxis(
+            Props->TouchPhysicalHeight,
+            Props->TouchLetterBoxHeightTop,
+            Props->TouchLetterBoxHeightBottom,
+            Props->TouchPhysicalHeight - Props->TouchPhysicalButtonHeight,
+            Props->DisplayPhysicalHeight,
+            Props->DisplayLetterBoxHeightTop,
+            Props->DisplayLetterBoxHeightBottom,
+            invertY,
+            &Transform->Y))
+    {
+        Transform->Kernel = gTransformKernels[(swap << 2) | (invertX << 1) | invertY];
+    }
+    else
+    {
+        Trace(
+            TRACE_LEVEL_WARNING,
+            TRACE_REGISTRY,
+            "Screen properties can not be folded, using reference translation");
+
+        Transform->Kernel = TchTranslateKernel;
+    }
+}
+
+VOID
+TchTransformToDisplayCoordinates(
+    IN OUT PUSHORT X,
+    IN OUT PUSHORT Y,
+    IN const TOUCH_TRANSFORM* Transform
+    )
+/*++
+ 
+  Routine Description:
+
+    This routine translates touch coordinates to display pixels using a
+    transform compiled by TchCompileTransform.
+
+  Arguments:
+
+    X - pointer to the pre-processed X coordinate
+    Y - pointer the pre-processed Y coordinate
+    Transform - pointer to the compiled transform
+
+  Return Value:
+
+    None. The X/Y values will be modified by this function.
+
+--*/
+{
+    Transform->Kernel(X, Y, Transform);
+}
+
+#if defined(_M_AMD64)
+
+FORCEINLINE
+__m128i
+TchMinVector(
+    IN __m128i A,
+    IN __m128i B
+    )
+{
     //
-    // Table passed to RtlQueryRegistryValues must be allocated 
-    // from NonPagedPoolNx
+    // SSE2 only compares signed lanes, flip the sign bits for unsigned order
     //
-    regTable = ExAllocatePoolWithTag(
-        NonPagedPoolNx,
-        gcbRegistryTable,
-        TOUCH_POOL_TAG);
+    __m128i bias = _mm_set1_epi32((int)0x80000000);
+    __m128i greater = _mm_cmpgt_epi32(_mm_xor_si128(A, bias), _mm_xor_si128(B, bias));
 
-    if (regTable == NULL)
-    {
-        return;
-    }
+    return _mm_or_si128(_mm_and_si128(greater, B), _mm_andnot_si128(greater, A));
+}
 
-    RtlCopyMemory(
-        regTable,
-        gResParamsRegTable,
-        gcbRegistryTable);
+FORCEINLINE
+__m128i
+TchMaxVector(
+    IN __m128i A,
+    IN __m128i B
+    )
+{
+    __m128i bias = _mm_set1_epi32((int)0x80000000);
+    __m128i greater = _mm_cmpgt_epi32(_mm_xor_si128(A, bias), _mm_xor_si128(B, bias));
+
+    return _mm_or_si128(_mm_and_si128(greater, A), _mm_andnot_si128(greater, B));
+}
+
+FORCEINLINE
+__m128i
+TchScaleVector(
+    IN __m128i Value,
+    IN const TOUCH_TRANSFORM_AXIS* Axis
+    )
+{
+    __m128i low = _mm_set1_epi32((int)(ULONG)Axis->ScaleMultiplier);
+    __m128i high = _mm_set1_epi32((int)(ULONG)(Axis->ScaleMultiplier >> 32));
+    __m128i shift = _mm_cvtsi32_si128((int)Axis->ScaleShift);
+    __m128i even = Value;
+    __m128i odd = _mm_srli_epi64(Value, 32);
 
     //
-    // Update offset values with base pointer
-    // 
-    for (i=0; i < gcRegistryTable-1; i++)
+    // 32x64 bit products of the even and odd lanes, the compiled transform
+    // guarantees they fit in 64 bits
+    //
+    even = _mm_add_epi64(
+        _mm_mul_epu32(even, low),
+        _mm_slli_epi64(_mm_mul_epu32(even, high), 32));
+    odd = _mm_add_epi64(
+        _mm_mul_epu32(odd, low),
+        _mm_slli_epi64(_mm_mul_epu32(odd, high), 32));
+
+    even = _mm_srl_epi64(even, shift);
+    odd = _mm_srl_epi64(odd, shift);
+
+    return _mm_or_si128(
+        _mm_and_si128(even, _mm_set_epi32(0, -1, 0, -1)),
+        _mm_slli_epi64(odd, 32));
+}
+
+FORCEINLINE
+__m128i
+TchTransformAxisVector(
+    IN __m128i Value,
+    IN const TOUCH_TRANSFORM_AXIS* Axis,
+    IN BOOLEAN Invert
+    )
+{
+    __m128i touchClip = _mm_set1_epi32((int)Axis->TouchClip);
+    __m128i touchOffset = _mm_set1_epi32((int)Axis->TouchOffset);
+
+    if (Invert)
     {
-        regTable[i].EntryContext = (PVOID) (
-            ((SIZE_T) regTable[i].EntryContext) +
-            ((ULONG_PTR) Props));
+        Value = _mm_sub_epi32(touchOffset, TchMinVector(Value, touchClip));
     }
+    else
+    {
+        Value = _mm_add_epi32(TchMaxVector(Value, touchClip), touchOffset);
+    }
+
+    Value = TchMinVector(Value, _mm_set1_epi32((int)Axis->TouchLimit));
+    Value = TchScaleVector(Value, Axis);
+    Value = _mm_add_epi32(
+        TchMaxVector(Value, _mm_set1_epi32((int)Axis->DisplayClip)),
+        _mm_set1_epi32((int)Axis->DisplayOffset));
+
+    return TchMinVector(Value, _mm_set1_epi32((int)Axis->DisplayLimit));
+}
+
+FORCEINLINE
+__m128i
+TchLoadVector(
+    IN const USHORT* Source
+    )
+{
+    return _mm_unpacklo_epi16(
+        _mm_loadl_epi64((const __m128i*)Source),
+        _mm_setzero_si128());
+}
 
+FORCEINLINE
+VOID
+TchStoreVector(
+    OUT PUSHORT Destination,
+    IN __m128i Value
+    )
+{
     //
-    // Start with default values
+    // Keep the low 16 bits of each lane, sign extended so the saturating
+    // pack leaves them as they are
     //
-    RtlCopyMemory(
-        Props,
-        &gDefaultProperties,
-        sizeof(TOUCH_SCREEN_PROPERTIES));
+    Value = _mm_srai_epi32(_mm_slli_epi32(Value, 16), 16);
+
+    _mm_storel_epi64((__m128i*)Destination, _mm_packs_epi32(Value, Value));
+}
+
+#elif defined(_M_ARM64)
+
+FORCEINLINE
+uint32x4_t
+TchScaleVector(
+    IN uint32x4_t Value,
+    IN const TOUCH_TRANSFORM_AXIS* Axis
+    )
+{
+    uint32x2_t low = vdup_n_u32((ULONG)Axis->ScaleMultiplier);
+    uint32x2_t high = vdup_n_u32((ULONG)(Axis->ScaleMultiplier >> 32));
+    int64x2_t shift = vdupq_n_s64(-(LONG64)Axis->ScaleShift);
+    uint64x2_t first;
+    uint64x2_t second;
 
     //
-    // Populate device context with registry overrides (or defaults)
+    // 32x64 bit products, the compiled transform guarantees they fit in
+    // 64 bits
     //
-    status = RtlQueryRegistryValues(
-        RTL_REGISTRY_ABSOLUTE,
-        TOUCH_SCREEN_PROPERTIES_REG_KEY,
-        regTable,
-        NULL,
-        NULL);
+    first = vaddq_u64(
+        vmull_u32(vget_low_u32(Value), low),
+        vshlq_n_u64(vmull_u32(vget_low_u32(Value), high), 32));
+    second = vaddq_u64(
+        vmull_u32(vget_high_u32(Value), low),
+        vshlq_n_u64(vmull_u32(vget_high_u32(Value), high), 32));
 
-    if (!NT_SUCCESS(status))
+    first = vshlq_u64(first, shift);
+    second = vshlq_u64(second, shift);
+
+    return vcombine_u32(vmovn_u64(first), vmovn_u64(second));
+}
+
+FORCEINLINE
+uint32x4_t
+TchTransformAxisVector(
+    IN uint32x4_t Value,
+    IN const TOUCH_TRANSFORM_AXIS* Axis,
+    IN BOOLEAN Invert
+    )
+{
+    uint32x4_t touchClip = vdupq_n_u32(Axis->TouchClip);
+    uint32x4_t touchOffset = vdupq_n_u32(Axis->TouchOffset);
+
+    if (Invert)
     {
-        Trace(
-            TRACE_LEVEL_WARNING,
-            TRACE_REGISTRY,
-            "Error retrieving registry configuration - 0x%08lX",
-            status);
+        Value = vsubq_u32(touchOffset, vminq_u32(Value, touchClip));
+    }
+    else
+    {
+        Value = vaddq_u32(vmaxq_u32(Value, touchClip), touchOffset);
     }
 
+    Value = vminq_u32(Value, vdupq_n_u32(Axis->TouchLimit));
+    Value = TchScaleVector(Value, Axis);
+    Value = vaddq_u32(
+        vmaxq_u32(Value, vdupq_n_u32(Axis->DisplayClip)),
+        vdupq_n_u32(Axis->DisplayOffset));
+
+    return vminq_u32(Value, vdupq_n_u32(Axis->DisplayLimit));
+}
+
+FORCEINLINE
+uint32x4_t
+TchLoadVector(
+    IN const USHORT* Source
+    )
+{
+    return vmovl_u16(vld1_u16(Source));
+}
+
+FORCEINLINE
+VOID
+TchStoreVector(
+    OUT PUSHORT Destination,
+    IN uint32x4_t Value
+    )
+{
+    vst1_u16(Destination, vmovn_u32(Value));
+}
+
+#endif
+
+VOID
+TchTransformFrameToDisplayCoordinates(
+    IN OUT PUSHORT X,
+    IN OUT PUSHORT Y,
+    IN ULONG Count,
+    IN const TOUCH_TRANSFORM* Transform
+    )
+/*++
+ 
+  Routine Description:
+
+    This routine translates the touch coordinates of a whole frame to
+    display pixels using a transform compiled by TchCompileTransform.
+    Coordinates are processed four at a time where the platform has
+    vector support, the rest goes through the scalar kernel.
+
+  Arguments:
+
+    X - array of Count pre-processed X coordinates
+    Y - array of Count pre-processed Y coordinates
+    Count - number of contacts in the frame
+    Transform - pointer to the compiled transform
+
+  Return Value:
+
+    None. The X/Y values will be modified by this function.
+
+--*/
+{
+    ULONG i = 0;
+
+#if defined(TOUCH_TRANSFORM_VECTOR)
+    BOOLEAN swap = Transform->Props.TouchSwapAxes != 0;
+    BOOLEAN invertX = Transform->Props.TouchInvertXAxis != 0;
+    BOOLEAN invertY = Transform->Props.TouchInvertYAxis != 0;
+    TOUCH_TRANSFORM_VECTOR x;
+    TOUCH_TRANSFORM_VECTOR y;
+
     //
-    // Sanity check values provided from the registry
+    // The reference translation has no vector form
     //
+    if (Transform->Kernel != TchTranslateKernel)
+    {
+        for (; i + 4 <= Count; i += 4)
+        {
+            x = TchLoadVector(&X[i]);
+            y = TchLoadVector(&Y[i]);
+
+            if (swap)
+            {
+                TOUCH_TRANSFORM_VECTOR temp = y;
+                y = x;
+                x = temp;
+            }
+
+            TchStoreVector(&X[i], TchTransformAxisVector(x, &Transform->X, invertX));
+            TchStoreVector(&Y[i], TchTransformAxisVector(y, &Transform->Y, invertY));
+        }
+    }
+#endif
 
-    if (Props->TouchPillarBoxWidthLeft + 
-        Props->TouchPillarBoxWidthRight >=
-        Props->TouchPhysicalWidth)
+    for (; i < Count; i++)
     {
-        Trace(
-            TRACE_LEVEL_ERROR,
-            TRACE_REGISTRY,
-            "Invalid pillar box widths provided (%d,%d for %d)",
-            Props->TouchPillarBoxWidthLeft,
-            Props->TouchPillarBoxWidthRight,
-            Props->TouchPhysicalWidth);
+        Transform->Kernel(&X[i], &Y[i], Transform);
+    }
+}
 
-        Props->TouchPillarBoxWidthLeft = 
-            gDefaultProperties.TouchPillarBoxWidthLeft;
-        Props->TouchPillarBoxWidthRight = 
-            gDefaultProperties.TouchPillarBoxWidthRight;
+static
+VOID
+TchLoadScreen(
+    OUT PTOUCH_SCREEN Screen
+    )
+{
+    TchLoadTouchRegistry(NULL, &Screen->Props, &Screen->Calibration);
+    TchCompileTransform(&Screen->Props, &Screen->Transform);
+}
 
-    }
+static
+VOID
+TchScreenNotificationRoutine(
+    IN PVOID Parameter
+    )
+{
+    TchReloadScreen((PTOUCH_SCREEN_CONTEXT) Parameter);
+}
+
+VOID
+TchInitializeScreen(
+    IN PTOUCH_SCREEN_CONTEXT Context,
+    IN WDFDEVICE FxDevice,
+    OUT PTOUCH_SCREEN_SETTINGS Settings
+    )
+/*++
+ 
+  Routine Description:
+
+    This routine loads the screen properties and everything
+    derived from them, and publishes the result. The touch
+    settings are loaded along with them.
+
+  Arguments:
+
+    Context - pointer to the screen context
+    FxDevice - a handle to the framework device object
+    Settings - receives the touch settings
+
+  Return Value:
+
+    None. On failure, defaults are published.
+
+--*/
+{
+    RtlZeroMemory(Context, sizeof(TOUCH_SCREEN_CONTEXT));
+
+    TchInitializeKeyWatch(
+        &Context->Watch,
+        TOUCH_SCREEN_PROPERTIES_REG_KEY,
+        REG_NOTIFY_CHANGE_LAST_SET,
+        FALSE,
+        TchScreenNotificationRoutine,
+        Context);
+
+    TchLoadTouchConfiguration(
+        FxDevice,
+        Settings,
+        &Context->Buffer[0].Props,
+        &Context->Buffer[0].Calibration);
+
+    //
+    // The transform holds a kernel pointer, it is never part of the
+    // snapshot and always compiled here
+    //
+    TchCompileTransform(&Context->Buffer[0].Props, &Context->Buffer[0].Transform);
+    Context->Current = &Context->Buffer[0];
+}
+
+const TOUCH_SCREEN*
+TchAcquireScreen(
+    IN PTOUCH_SCREEN_CONTEXT Context,
+    OUT PLONG Ticket
+    )
+/*++
+ 
+  Routine Description:
+
+    This routine returns the published screen state. It never
+    blocks, the state stays valid until TchReleaseScreen.
+
+  Arguments:
+
+    Context - pointer to the screen context
+    Ticket - receives the value to pass to TchReleaseScreen
+
+  Return Value:
+
+    The screen state.
+
+--*/
+{
+    *Ticket = Context->Epoch & 1;
+
+    //
+    // The interlocked increment orders the read of Current after it
+    //
+    InterlockedIncrement(&Context->Readers[*Ticket]);
 
-    if (Props->TouchLetterBoxHeightTop + 
-        Props->TouchLetterBoxHeightBottom >=
-        Props->TouchPhysicalHeight)
+    return Context->Current;
+}
+
+VOID
+TchReleaseScreen(
+    IN PTOUCH_SCREEN_CONTEXT Context,
+    IN LONG Ticket
+    )
+{
+    InterlockedDecrement(&Context->Readers[Ticket]);
+}
+
+static
+VOID
+TchSynchronizeScreen(
+    IN PTOUCH_SCREEN_CONTEXT Context
+    )
+{
+    LARGE_INTEGER interval;
+    LONG epoch;
+    int i;
+
+    interval.QuadPart = -10000; // 1ms
+
+    //
+    // A reader may have sampled the epoch just before a flip and counted
+    // itself in just after the wait, so both epochs are drained
+    //
+    for (i = 0; i < 2; i++)
     {
-        Trace(
-            TRACE_LEVEL_ERROR,
-            TRACE_REGISTRY,
-            "Invalid letter box heights provided (%d,%d for %d)",
-            Props->TouchLetterBoxHeightTop,
-            Props->TouchLetterBoxHeightBottom,
-            Props->TouchPhysicalHeight);
+        epoch = InterlockedIncrement(&Context->Epoch) - 1;
 
-        Props->TouchLetterBoxHeightTop = 
-            gDefaultProperties.TouchLetterBoxHeightTop;
-        Props->TouchLetterBoxHeightBottom = 
-            gDefaultProperties.TouchLetterBoxHeightBottom;
+        while (Context->Readers[epoch & 1] != 0)
+        {
+            KeDelayExecutionThread(KernelMode, FALSE, &interval);
+        }
     }
+}
+
+VOID
+TchReloadScreen(
+    IN PTOUCH_SCREEN_CONTEXT Context
+    )
+/*++
+ 
+  Routine Description:
+
+    This routine reloads the screen properties, rebuilds the
+    state derived from them and publishes it. Reports in flight
+    finish with the previous state. Calls must be serialized.
+
+    The HID descriptor keeps the display size it was built
+    with, changing that still requires a device restart.
+
+  Arguments:
+
+    Context - pointer to the screen context
+
+  Return Value:
+
+    None.
+
+--*/
+{
+    PTOUCH_SCREEN next;
+
+    next = (Context->Current == &Context->Buffer[0]) ?
+        &Context->Buffer[1] : &Context->Buffer[0];
+
+    TchLoadScreen(next);
+
+    InterlockedExchangePointer((PVOID volatile*) &Context->Current, next);
+
+    //
+    // The buffer swapped out is where the next reload is built
+    //
+    TchSynchronizeScreen(Context);
 
-    if (regTable != NULL)
+    Trace(
+        TRACE_LEVEL_INFORMATION,
+        TRACE_REGISTRY,
+        "Screen properties reloaded");
+}
+
+NTSTATUS
+TchStartScreenNotification(
+    IN PTOUCH_SCREEN_CONTEXT Context
+    )
+/*++
+ 
+  Routine Description:
+
+    This routine starts watching TOUCH_SCREEN_PROPERTIES_REG_KEY,
+    every change then reloads the screen state.
+
+  Arguments:
+
+    Context - pointer to an initialized screen context
+
+  Return Value:
+
+    NTSTATUS indicating success or failure
+
+--*/
+{
+    NTSTATUS status;
+
+    status = TchStartKeyWatch(&Context->Watch);
+
+    if (!NT_SUCCESS(status))
     {
-        ExFreePoolWithTag(regTable, TOUCH_POOL_TAG);
+        Trace(
+            TRACE_LEVEL_WARNING,
+            TRACE_REGISTRY,
+            "Screen properties will not be reloaded - 0x%08lX",
+            status);
     }
-}
\ No newline at end of file
+
+    return status;
+}
+
+VOID
+TchStopScreenNotification(
+    IN PTOUCH_SCREEN_CONTEXT Context
+    )
+/*++
+ 
+  Routine Description:
+
+    This routine stops watching the screen properties and waits
+    for a reload in progress to finish.
+
+  Arguments:
+
+    Context - pointer to the screen context
+
+  Return Value:
+
+    None.
+
+--*/
+{
+    TchStopKeyWatch(&Context->Watch);
+}
@@ -28,6 +28,7 @@
 #include <initguid.h>
 #include <devguid.h>
 #include <selftest\enoselftest.h>
+#include <selftest\readvector.h>
 #include <enoselftest.tmh>
 
 VOID
@@ -68,6 +69,7 @@ Return Value:
     NTSTATUS status = STATUS_INVALID_PARAMETER;
     BOOLEAN* requestedDiagnosticMode;
     UCHAR* requestedPage;
+    TOUCH_POWER_STATISTICS* powerStatistics;
 
 
     devContext = GetDeviceContext(WdfPdoGetParent(WdfIoQueueGetDevice(Queue)));
@@ -260,6 +262,41 @@ Return Value:
         break;
     }
 
+    case IOCTL_TOUCH_ENOSELFTEST_POWER_STATISTICS:
+    {
+        //
+        // Validate parameters and memory
+        //
+        status = WdfRequestRetrieveOutputBuffer(
+            Request,
+            sizeof(TOUCH_POWER_STATISTICS),
+            (PVOID)&powerStatistics,
+            NULL);
+
+        if (!NT_SUCCESS(status))
+        {
+            status = STATUS_BUFFER_TOO_SMALL;
+            goto exit;
+        }
+
+        PowerStatsSnapshot(&devContext->PowerStats, &devContext->Display, powerStatistics);
+
+        WdfRequestSetInformation(Request, sizeof(*powerStatistics));
+
+        break;
+    }
+
+    case IOCTL_TOUCH_ENOSELFTEST_READ_VECTOR:
+    {
+        status = TchSelfTestReadVector(
+            &devContext->I2CContext,
+            Request,
+            OutputBufferLength,
+            InputBufferLength);
+
+        break;
+    }
+
     default:
     {
         status = STATUS_NOT_IMPLEMENTED;
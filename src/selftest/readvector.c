@@ -0,0 +1,222 @@
+/*++
+    Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+    Module Name:
+
+        readvector.c
+
+    Abstract:
+
+        Implements the vectored register read shared by the self-test
+        interfaces. Tools sampling many registers get them all in one
+        request, read back to back without other bus traffic in between.
+
+    Environment:
+
+        Kernel mode
+
+    Revision History:
+
+--*/
+
+#include <internal.h>
+#include <controller.h>
+#include <spb.h>
+#include <selftest\readvector.h>
+#include <readvector.tmh>
+
+NTSTATUS
+TchSelfTestReadVector(
+    IN SPB_CONTEXT* SpbContext,
+    IN WDFREQUEST Request,
+    IN size_t OutputBufferLength,
+    IN size_t InputBufferLength
+    )
+/*++
+
+Routine Description:
+
+    Serves a vectored read request. Takes a TOUCH_TEST_READ_VECTOR and
+    returns a TOUCH_TEST_READ_VECTOR_RESULT. The request succeeds once
+    the vector is valid and the output fits, whether the reads did or
+    not, their status is reported per entry.
+
+Arguments:
+
+    SpbContext - A pointer to the current i2c context
+    Request - Framework request object handle
+    OutputBufferLength - self-explanatory
+    InputBufferLength - self-explanatory
+
+Return Value:
+
+    NTSTATUS indicating success or failure
+
+--*/
+{
+    TOUCH_TEST_READ_VECTOR* vectorIn = NULL;
+    TOUCH_TEST_READ_VECTOR_RESULT* resultOut = NULL;
+    SPB_READ_ENTRY* entries = NULL;
+    PUCHAR addresses;
+    size_t headerLength;
+    size_t length;
+    ULONG count;
+    ULONG offset;
+    ULONG i;
+    NTSTATUS status;
+
+    //
+    // Validate parameters and memory
+    //
+    if (InputBufferLength < FIELD_OFFSET(TOUCH_TEST_READ_VECTOR, Entries))
+    {
+        status = STATUS_INVALID_PARAMETER;
+        goto exit;
+    }
+
+    status = WdfRequestRetrieveInputBuffer(
+        Request,
+        FIELD_OFFSET(TOUCH_TEST_READ_VECTOR, Entries),
+        (PVOID) &vectorIn,
+        NULL);
+
+    if (!NT_SUCCESS(status))
+    {
+        status = STATUS_INVALID_PARAMETER;
+        goto exit;
+    }
+
+    count = vectorIn->Count;
+
+    if ((count < 1) ||
+        (count > TOUCH_TEST_READ_VECTOR_MAX_ENTRIES) ||
+        (InputBufferLength != FIELD_OFFSET(TOUCH_TEST_READ_VECTOR, Entries) +
+            count * sizeof(TOUCH_TEST_READ_ENTRY)))
+    {
+        status = STATUS_INVALID_PARAMETER;
+        goto exit;
+    }
+
+    headerLength = FIELD_OFFSET(TOUCH_TEST_READ_VECTOR_RESULT, Results) +
+        count * sizeof(TOUCH_TEST_READ_RESULT);
+
+    if (headerLength > OutputBufferLength)
+    {
+        status = STATUS_BUFFER_TOO_SMALL;
+        goto exit;
+    }
+
+    //
+    // Input and output share memory, so the entries and the addresses
+    // they point to are copied out before anything is read
+    //
+    entries = ExAllocatePoolWithTag(
+        NonPagedPoolNx,
+        count * (sizeof(SPB_READ_ENTRY) + sizeof(UCHAR)),
+        TOUCH_POOL_TAG);
+
+    if (entries == NULL)
+    {
+        status = STATUS_INSUFFICIENT_RESOURCES;
+        goto exit;
+    }
+
+    addresses = (PUCHAR)(entries + count);
+    length = headerLength;
+
+    for (i = 0; i < count; i++)
+    {
+        TOUCH_TEST_READ_ENTRY* entryIn = &vectorIn->Entries[i];
+
+        if ((entryIn->AddressLength != sizeof(entryIn->Address)) ||
+            (entryIn->RequestedTransferLength < 1) ||
+            ((entryIn->Flags & ~TOUCH_TEST_READ_VALID_FLAGS) != 0))
+        {
+            status = STATUS_INVALID_PARAMETER;
+            goto exit;
+        }
+
+        if (entryIn->RequestedTransferLength > OutputBufferLength - length)
+        {
+            status = STATUS_BUFFER_TOO_SMALL;
+            goto exit;
+        }
+
+        addresses[i] = entryIn->Address;
+
+        entries[i].Command = &addresses[i];
+        entries[i].CommandLength = sizeof(UCHAR);
+        entries[i].Data = NULL;
+        entries[i].Length = entryIn->RequestedTransferLength;
+        entries[i].StopOnError = (entryIn->Flags & TOUCH_TEST_READ_FLAG_STOP_ON_ERROR) != 0;
+        entries[i].Status = STATUS_SUCCESS;
+
+        length += entryIn->RequestedTransferLength;
+    }
+
+    status = WdfRequestRetrieveOutputBuffer(
+        Request,
+        length,
+        (PVOID) &resultOut,
+        NULL);
+
+    if (!NT_SUCCESS(status))
+    {
+        status = STATUS_BUFFER_TOO_SMALL;
+        goto exit;
+    }
+
+    offset = (ULONG)headerLength;
+
+    for (i = 0; i < count; i++)
+    {
+        entries[i].Data = (PUCHAR)resultOut + offset;
+        offset += entries[i].Length;
+    }
+
+    //
+    // Perform reads, all under one acquisition of the bus
+    //
+    (VOID) SpbReadVectorSynchronously(
+        SpbContext,
+        entries,
+        count);
+
+    offset = (ULONG)headerLength;
+
+    for (i = 0; i < count; i++)
+    {
+        if (!NT_SUCCESS(entries[i].Status))
+        {
+            RtlZeroMemory(entries[i].Data, entries[i].Length);
+        }
+
+        resultOut->Results[i].Status = entries[i].Status;
+        resultOut->Results[i].TransferLength = entries[i].Length;
+        resultOut->Results[i].Offset = offset;
+
+        offset += entries[i].Length;
+    }
+
+    resultOut->Count = count;
+    resultOut->Size = (ULONG)length;
+
+    Trace(
+        TRACE_LEVEL_VERBOSE,
+        TRACE_SPB,
+        "Vectored read of %lu entries, %lu bytes returned",
+        count,
+        (ULONG)length);
+
+    WdfRequestSetInformation(Request, length);
+
+exit:
+    if (entries != NULL)
+    {
+        ExFreePoolWithTag(
+            entries,
+            TOUCH_POOL_TAG);
+    }
+
+    return status;
+}
@@ -0,0 +1,184 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		snapshot.c
+
+	Abstract:
+
+		Builds and checks the validated configuration snapshot. Reading
+		and writing it under the device key is left to registry.c.
+
+	Environment:
+
+		Kernel mode
+
+	Revision History:
+
+--*/
+
+#include <snapshot.h>
+
+ULONG
+TchSnapshotCrc(
+	IN ULONG Crc,
+	IN const VOID* Data,
+	IN ULONG Length
+)
+/*++
+
+Routine Description:
+
+	Continues a CRC-32 over more data
+
+Arguments:
+
+	Crc - CRC of the data so far, 0 to start
+
+	Data - The data to add
+
+	Length - Length of Data in bytes
+
+Return Value:
+
+	CRC of the data so far followed by Data
+
+--*/
+{
+	const UCHAR* data = (const UCHAR*)Data;
+	ULONG crc = ~Crc;
+	ULONG bit;
+
+	while (Length-- != 0)
+	{
+		crc ^= *data++;
+
+		for (bit = 0; bit < 8; bit++)
+		{
+			crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+		}
+	}
+
+	return ~crc;
+}
+
+static
+ULONG
+TchSnapshotChecksum(
+	IN const TOUCH_SNAPSHOT* Snapshot
+)
+{
+	return TchSnapshotCrc(
+		0,
+		&Snapshot->Schema,
+		sizeof(TOUCH_SNAPSHOT) - FIELD_OFFSET(TOUCH_SNAPSHOT, Schema));
+}
+
+VOID
+TchBuildSnapshot(
+	OUT PTOUCH_SNAPSHOT Snapshot,
+	IN ULONG Schema,
+	IN const LARGE_INTEGER* SourceWriteTime,
+	IN const TOUCH_SCREEN_SETTINGS* Settings,
+	IN const TOUCH_SCREEN_PROPERTIES* Props,
+	IN const CALIBRATION_CONTEXT* Calibration
+)
+/*++
+
+Routine Description:
+
+	Fills in a snapshot of a configuration read in full
+
+Arguments:
+
+	Snapshot - Receives the snapshot
+
+	Schema - Identifies the running build, see TOUCH_SNAPSHOT
+
+	SourceWriteTime - TOUCH_SNAPSHOT_SOURCES last write times of the
+		touch registry keys, taken before reading them
+
+	Settings - The touch settings read
+
+	Props - The screen properties read
+
+	Calibration - The calibration mesh read
+
+Return Value:
+
+	None.
+
+--*/
+{
+	//
+	// Padding is zeroed so identical configurations give identical blobs
+	//
+	RtlZeroMemory(Snapshot, sizeof(TOUCH_SNAPSHOT));
+
+	Snapshot->Signature = TOUCH_SNAPSHOT_SIGNATURE;
+	Snapshot->Version = TOUCH_SNAPSHOT_VERSION;
+	Snapshot->Size = sizeof(TOUCH_SNAPSHOT);
+	Snapshot->Schema = Schema;
+	RtlCopyMemory(Snapshot->SourceWriteTime, SourceWriteTime, sizeof(Snapshot->SourceWriteTime));
+	RtlCopyMemory(&Snapshot->Settings, Settings, sizeof(TOUCH_SCREEN_SETTINGS));
+	RtlCopyMemory(&Snapshot->Props, Props, sizeof(TOUCH_SCREEN_PROPERTIES));
+	RtlCopyMemory(&Snapshot->Calibration, Calibration, sizeof(CALIBRATION_CONTEXT));
+	Snapshot->Checksum = TchSnapshotChecksum(Snapshot);
+}
+
+TOUCH_SNAPSHOT_CHECK
+TchCheckSnapshot(
+	IN const TOUCH_SNAPSHOT* Snapshot,
+	IN ULONG Length,
+	IN ULONG Schema,
+	IN const LARGE_INTEGER* SourceWriteTime
+)
+/*++
+
+Routine Description:
+
+	Checks whether a stored snapshot may be used instead of reading the
+	touch registry
+
+Arguments:
+
+	Snapshot - The snapshot as read, sizeof(TOUCH_SNAPSHOT) bytes
+
+	Length - Number of bytes actually read
+
+	Schema - Identifies the running build, see TOUCH_SNAPSHOT
+
+	SourceWriteTime - Current last write times of the touch registry
+		keys
+
+Return Value:
+
+	TOUCH_SNAPSHOT_VALID when it may be used, otherwise why not
+
+--*/
+{
+	if (Length != sizeof(TOUCH_SNAPSHOT) ||
+		Snapshot->Signature != TOUCH_SNAPSHOT_SIGNATURE ||
+		Snapshot->Version != TOUCH_SNAPSHOT_VERSION ||
+		Snapshot->Size != sizeof(TOUCH_SNAPSHOT) ||
+		Snapshot->Checksum != TchSnapshotChecksum(Snapshot))
+	{
+		return TOUCH_SNAPSHOT_CORRUPT;
+	}
+
+	if (Snapshot->Schema != Schema)
+	{
+		return TOUCH_SNAPSHOT_OTHER_SCHEMA;
+	}
+
+	if (RtlCompareMemory(
+			Snapshot->SourceWriteTime,
+			SourceWriteTime,
+			sizeof(Snapshot->SourceWriteTime)) != sizeof(Snapshot->SourceWriteTime))
+	{
+		return TOUCH_SNAPSHOT_STALE;
+	}
+
+	return TOUCH_SNAPSHOT_VALID;
+}
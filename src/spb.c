@@ -184,7 +184,7 @@ SpbWriteDataSynchronously(
 }
 
 NTSTATUS
-SpbReadDataSynchronously(
+SpbDoReadDataSynchronously(
     IN SPB_CONTEXT* SpbContext,
     _In_reads_bytes_(CommandLength) PUCHAR Command,
     IN ULONG CommandLength,
@@ -217,8 +217,6 @@ SpbReadDataSynchronously(
     NTSTATUS status;
     ULONG_PTR bytesRead;
 
-    WdfWaitLockAcquire(SpbContext->SpbLock, NULL);
-
     memory = NULL;
     status = STATUS_INVALID_PARAMETER;
     bytesRead = 0;
@@ -290,6 +288,15 @@ SpbReadDataSynchronously(
     if (!NT_SUCCESS(status) ||
         bytesRead != Length)
     {
+        //
+        // A short read leaves the caller's buffer untouched, it must not
+        // be taken for data
+        //
+        if (NT_SUCCESS(status))
+        {
+            status = STATUS_DEVICE_PROTOCOL_ERROR;
+        }
+
         Trace(
             TRACE_LEVEL_ERROR,
             TRACE_SPB,
@@ -309,6 +316,114 @@ exit:
         WdfObjectDelete(memory);
     }
 
+    return status;
+}
+
+NTSTATUS
+SpbReadDataSynchronously(
+    IN SPB_CONTEXT* SpbContext,
+    _In_reads_bytes_(CommandLength) PUCHAR Command,
+    IN ULONG CommandLength,
+    _In_reads_bytes_(Length) PVOID Data,
+    IN ULONG Length
+)
+/*++
+
+  Routine Description:
+
+    This routine abstracts creating and sending an I/O
+    request (I2C Read) to the Spb I/O target and utilizes
+    a helper routine to do work inside of locked code.
+
+  Arguments:
+
+    SpbContext - Pointer to the current device context
+    Command    - The I2C register address to read from
+    Data       - A buffer to receive the data at at the above address
+    Length     - The amount of data to be read from the above address
+
+  Return Value:
+
+    NTSTATUS Status indicating success or failure
+
+--*/
+{
+    NTSTATUS status;
+
+    WdfWaitLockAcquire(SpbContext->SpbLock, NULL);
+
+    status = SpbDoReadDataSynchronously(
+        SpbContext,
+        Command,
+        CommandLength,
+        Data,
+        Length);
+
+    WdfWaitLockRelease(SpbContext->SpbLock);
+
+    return status;
+}
+
+NTSTATUS
+SpbReadVectorSynchronously(
+    IN SPB_CONTEXT* SpbContext,
+    IN OUT SPB_READ_ENTRY* Entries,
+    IN ULONG Count
+)
+/*++
+
+  Routine Description:
+
+    Performs several I2C reads back to back, holding the Spb lock across
+    all of them so no other transfer is interleaved. Each entry receives
+    its own status. Once an entry flagged StopOnError fails, the entries
+    after it are not read and get STATUS_REQUEST_ABORTED.
+
+  Arguments:
+
+    SpbContext - Pointer to the current device context
+    Entries    - The reads to perform, in order
+    Count      - The number of entries
+
+  Return Value:
+
+    NTSTATUS of the first entry that failed, STATUS_SUCCESS when all
+    succeeded
+
+--*/
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    BOOLEAN aborted = FALSE;
+    ULONG i;
+
+    WdfWaitLockAcquire(SpbContext->SpbLock, NULL);
+
+    for (i = 0; i < Count; i++)
+    {
+        if (aborted)
+        {
+            Entries[i].Status = STATUS_REQUEST_ABORTED;
+            continue;
+        }
+
+        Entries[i].Status = SpbDoReadDataSynchronously(
+            SpbContext,
+            Entries[i].Command,
+            Entries[i].CommandLength,
+            Entries[i].Data,
+            Entries[i].Length);
+
+        if (!NT_SUCCESS(Entries[i].Status))
+        {
+            if (NT_SUCCESS(status))
+            {
+                status = Entries[i].Status;
+            }
+
+            aborted = Entries[i].StopOnError;
+        }
+    }
+
     WdfWaitLockRelease(SpbContext->SpbLock);
 
     return status;
@@ -3,6 +3,7 @@
 #include <internal.h>
 #include <touch_power\public.h>
 #include <touch_power\touch_power.h>
+#include <wdmguid.h>
 #include <touch_power.tmh>
 
 #ifdef ALLOC_PRAGMA
@@ -12,16 +13,37 @@
 NTSTATUS
 PowerToggle(
     TOUCH_POWER_CONTEXT* deviceContext,
-    DWORD State
+    DWORD State,
+    PTOUCH_POWER_TOGGLE_COMPLETE Complete,
+    PVOID Context
 )
+/*++
+
+Routine Description:
+
+    Sends IOCTL_TOUCH_POWER_TOGGLE without waiting for it, using the
+    request and payload allocated up front
+
+Arguments:
+
+    deviceContext - Touch power context
+
+    State - Requested rail state
+
+    Complete - Called once the toggle completed, only when
+        STATUS_PENDING is returned
+
+    Context - Passed to Complete
+
+Return Value:
+
+    STATUS_PENDING when the toggle was sent, STATUS_SUCCESS when there is
+    no touch power driver to toggle, an error otherwise
+
+--*/
 {
     NTSTATUS status = STATUS_SUCCESS;
-    PUCHAR buffer;
-    WDFMEMORY memory;
-    WDF_MEMORY_DESCRIPTOR memoryDescriptor;
-    ULONG_PTR bytesReturned = 0;
-
-    memory = NULL;
+    WDF_REQUEST_REUSE_PARAMS reuseParams;
 
     Trace(
         TRACE_LEVEL_INFORMATION,
@@ -29,64 +51,120 @@ PowerToggle(
         "PowerToggle: Entry"
     );
 
-    if (!deviceContext->TouchPowerOpen)
+    //
+    // The target may be released by an interface removal at any time,
+    // it is kept until the request was sent
+    //
+    if (!ExAcquireRundownProtection(&deviceContext->TargetRundown))
     {
         Trace(
             TRACE_LEVEL_INFORMATION,
             TRACE_POWER,
-            "PowerToggle: Touch power is not open"
+            "PowerToggle: Touch power is being released"
         );
 
         goto exit;
     }
 
-    status = WdfMemoryCreate(
-        WDF_NO_OBJECT_ATTRIBUTES,
-        NonPagedPool,
-        TOUCH_POWER_POOL_TAG,
-        sizeof(DWORD),
-        &memory,
-        &buffer);
+    if (!deviceContext->TouchPowerOpen ||
+        deviceContext->ToggleRequest == NULL ||
+        deviceContext->ToggleMemory == NULL)
+    {
+        Trace(
+            TRACE_LEVEL_INFORMATION,
+            TRACE_POWER,
+            "PowerToggle: Touch power is not open"
+        );
+
+        goto unprotect;
+    }
+
+    if (InterlockedCompareExchange(&deviceContext->ToggleBusy, TRUE, FALSE) != FALSE)
+    {
+        Trace(
+            TRACE_LEVEL_ERROR,
+            TRACE_POWER,
+            "PowerToggle: A toggle is already in flight"
+        );
+
+        status = STATUS_DEVICE_BUSY;
+        goto unprotect;
+    }
+
+    WDF_REQUEST_REUSE_PARAMS_INIT(
+        &reuseParams,
+        WDF_REQUEST_REUSE_NO_FLAGS,
+        STATUS_SUCCESS);
+
+    status = WdfRequestReuse(deviceContext->ToggleRequest, &reuseParams);
 
     if (!NT_SUCCESS(status))
     {
         Trace(
             TRACE_LEVEL_ERROR,
             TRACE_POWER,
-            "Error allocating memory for touch power ioctl send - 0x%08lX",
+            "Error reusing touch power request - 0x%08lX",
             status);
-        goto exit;
+        goto release;
     }
 
-    WDF_MEMORY_DESCRIPTOR_INIT_HANDLE(
-        &memoryDescriptor,
-        memory,
-        NULL);
-
     //
-    // Copy desired state into the buffer
+    // The payload is not touched again until the toggle completed
     //
-    RtlCopyMemory(buffer, &State, sizeof(DWORD));
+    *deviceContext->ToggleBuffer = State;
 
-    status = WdfIoTargetSendIoctlSynchronously(
+    status = WdfIoTargetFormatRequestForIoctl(
         deviceContext->TouchPowerIOTarget,
-        WDF_NO_HANDLE,
+        deviceContext->ToggleRequest,
         (ULONG)IOCTL_TOUCH_POWER_TOGGLE,
-        &memoryDescriptor,
+        deviceContext->ToggleMemory,
         NULL,
         NULL,
-        &bytesReturned);
+        NULL);
 
     if (!NT_SUCCESS(status))
     {
+        Trace(
+            TRACE_LEVEL_ERROR,
+            TRACE_POWER,
+            "Error formatting touch power ioctl - 0x%08lX",
+            status);
+        goto release;
+    }
+
+    WdfRequestSetCompletionRoutine(
+        deviceContext->ToggleRequest,
+        PowerToggleCompletion,
+        deviceContext);
+
+    deviceContext->ToggleComplete = Complete;
+    deviceContext->ToggleContext = Context;
+    deviceContext->ToggleTime = KeQueryInterruptTime();
+
+    if (!WdfRequestSend(
+        deviceContext->ToggleRequest,
+        deviceContext->TouchPowerIOTarget,
+        WDF_NO_SEND_OPTIONS))
+    {
+        status = WdfRequestGetStatus(deviceContext->ToggleRequest);
+
         Trace(
             TRACE_LEVEL_ERROR,
             TRACE_SPB,
             "Error sending ioctl to touch power - 0x%08lX",
             status);
-        goto exit;
+        goto release;
     }
 
+    status = STATUS_PENDING;
+    goto unprotect;
+
+release:
+    InterlockedExchange(&deviceContext->ToggleBusy, FALSE);
+
+unprotect:
+    ExReleaseRundownProtection(&deviceContext->TargetRundown);
+
 exit:
     Trace(
         TRACE_LEVEL_INFORMATION,
@@ -94,12 +172,160 @@ exit:
         "PowerToggle: Exit"
     );
 
-    if (NULL != memory)
+    return status;
+}
+
+VOID
+PowerToggleCompletion(
+    IN WDFREQUEST Request,
+    IN WDFIOTARGET Target,
+    IN PWDF_REQUEST_COMPLETION_PARAMS Params,
+    IN WDFCONTEXT Context
+)
+/*++
+
+Routine Description:
+
+    Completion routine of the toggle request. Records the toggle latency
+    and passes the result on to the caller of PowerToggle.
+
+Arguments:
+
+    Request - The toggle request
+
+    Target - The touch power I/O target
+
+    Params - Completion parameters
+
+    Context - Touch power context
+
+Return Value:
+
+    None.
+
+--*/
+{
+    TOUCH_POWER_CONTEXT* deviceContext = (TOUCH_POWER_CONTEXT*)Context;
+    PTOUCH_POWER_TOGGLE_COMPLETE complete = deviceContext->ToggleComplete;
+    PVOID completeContext = deviceContext->ToggleContext;
+    NTSTATUS status = Params->IoStatus.Status;
+
+    UNREFERENCED_PARAMETER(Request);
+    UNREFERENCED_PARAMETER(Target);
+
+    deviceContext->ToggleLatency = (ULONG)((KeQueryInterruptTime() - deviceContext->ToggleTime) / 10);
+
+    if (!NT_SUCCESS(status))
     {
-        WdfObjectDelete(memory);
+        Trace(
+            TRACE_LEVEL_ERROR,
+            TRACE_POWER,
+            "Touch power ioctl failed - 0x%08lX",
+            status);
     }
 
-    return status;
+    //
+    // Released first, so the caller may toggle again from Complete
+    //
+    InterlockedExchange(&deviceContext->ToggleBusy, FALSE);
+
+    if (complete != NULL)
+    {
+        complete(completeContext, status);
+    }
+}
+
+VOID
+PowerCancelToggle(
+    TOUCH_POWER_CONTEXT* deviceContext
+)
+/*++
+
+Routine Description:
+
+    Attempts to cancel a toggle in flight, its completion routine still
+    runs
+
+Arguments:
+
+    deviceContext - Touch power context
+
+Return Value:
+
+    None.
+
+--*/
+{
+    //
+    // Once the target is being released, the release cancels the toggle
+    //
+    if (!ExAcquireRundownProtection(&deviceContext->TargetRundown))
+    {
+        return;
+    }
+
+    if (deviceContext->ToggleRequest != NULL &&
+        deviceContext->ToggleBusy)
+    {
+        (VOID)WdfRequestCancelSentRequest(deviceContext->ToggleRequest);
+    }
+
+    ExReleaseRundownProtection(&deviceContext->TargetRundown);
+}
+
+static
+VOID
+PowerReleaseTarget(
+    TOUCH_POWER_CONTEXT* deviceContext
+)
+/*++
+
+Routine Description:
+
+    Closes and deletes the touch power I/O target, and with it the toggle
+    request parented to it. Toggles past their open check are waited for,
+    a toggle in flight is then cancelled and completes before the target
+    is gone.
+
+Arguments:
+
+    deviceContext - Touch power context
+
+Return Value:
+
+    None.
+
+--*/
+{
+    PAGED_CODE();
+
+    deviceContext->TouchPowerOpen = FALSE;
+
+    //
+    // No toggle may use the target or its request from here on, and one
+    // that already checked them has sent its request once this returns
+    //
+    ExWaitForRundownProtectionRelease(&deviceContext->TargetRundown);
+
+    if (deviceContext->TouchPowerIOTarget != NULL)
+    {
+        if (deviceContext->ToggleRequest != NULL &&
+            deviceContext->ToggleBusy)
+        {
+            (VOID)WdfRequestCancelSentRequest(deviceContext->ToggleRequest);
+        }
+
+        WdfIoTargetClose(deviceContext->TouchPowerIOTarget);
+        WdfObjectDelete(deviceContext->TouchPowerIOTarget);
+
+        deviceContext->TouchPowerIOTarget = NULL;
+        deviceContext->ToggleRequest = NULL;
+    }
+
+    //
+    // Toggles see the target closed until the next arrival opens it
+    //
+    ExReInitializeRundownProtection(&deviceContext->TargetRundown);
 }
 
 NTSTATUS
@@ -112,6 +338,7 @@ PowerIoRegPnPNotification(
     PDEVICE_INTERFACE_CHANGE_NOTIFICATION NotificationStruct = (PDEVICE_INTERFACE_CHANGE_NOTIFICATION)NotificationStructure;
 
     WDF_IO_TARGET_OPEN_PARAMS openParams;
+    WDF_OBJECT_ATTRIBUTES attributes;
 
     PAGED_CODE();
 
@@ -132,49 +359,102 @@ PowerIoRegPnPNotification(
         return STATUS_UNSUCCESSFUL;
     }
 
-    if (IsEqualGUID(&NotificationStruct->InterfaceClassGuid, &GUID_TOUCH_POWER_INTERFACE))
+    if (!IsEqualGUID(&NotificationStruct->InterfaceClassGuid, &GUID_TOUCH_POWER_INTERFACE))
+    {
+        goto exit;
+    }
+
+    if (IsEqualGUID(&NotificationStruct->Event, &GUID_DEVICE_INTERFACE_REMOVAL))
+    {
+        PowerReleaseTarget(&deviceContext->TouchPowerContext);
+        goto exit;
+    }
+
+    if (!IsEqualGUID(&NotificationStruct->Event, &GUID_DEVICE_INTERFACE_ARRIVAL))
+    {
+        goto exit;
+    }
+
+    //
+    // The target already open is kept, a second arrival does not leave
+    // another target and request behind
+    //
+    if (deviceContext->TouchPowerContext.TouchPowerOpen)
     {
-        status = WdfIoTargetCreate(
-            deviceContext->FxDevice,
-            WDF_NO_OBJECT_ATTRIBUTES,
-            &deviceContext->TouchPowerContext.TouchPowerIOTarget
+        Trace(
+            TRACE_LEVEL_INFORMATION,
+            TRACE_POWER,
+            "PowerIoRegPnPNotification: Touch power is already open"
         );
 
-        if (!NT_SUCCESS(status))
-        {
-            Trace(
-                TRACE_LEVEL_ERROR,
-                TRACE_POWER,
-                "PowerIoRegPnPNotification: Creating IO Target to Touch Power driver failed"
-            );
+        goto exit;
+    }
 
-            deviceContext->TouchPowerContext.TouchPowerOpen = FALSE;
-            goto exit;
-        }
+    //
+    // Left over from an arrival that failed part way
+    //
+    PowerReleaseTarget(&deviceContext->TouchPowerContext);
 
-        WDF_IO_TARGET_OPEN_PARAMS_INIT_OPEN_BY_NAME(&openParams, NotificationStruct->SymbolicLinkName, STANDARD_RIGHTS_ALL);
+    status = WdfIoTargetCreate(
+        deviceContext->FxDevice,
+        WDF_NO_OBJECT_ATTRIBUTES,
+        &deviceContext->TouchPowerContext.TouchPowerIOTarget
+    );
 
-        status = WdfIoTargetOpen(deviceContext->TouchPowerContext.TouchPowerIOTarget, &openParams);
-        if (!NT_SUCCESS(status))
-        {
-            Trace(
-                TRACE_LEVEL_ERROR,
-                TRACE_POWER,
-                "PowerIoRegPnPNotification: Opening IO Target to Touch Power driver failed"
-            );
+    if (!NT_SUCCESS(status))
+    {
+        Trace(
+            TRACE_LEVEL_ERROR,
+            TRACE_POWER,
+            "PowerIoRegPnPNotification: Creating IO Target to Touch Power driver failed"
+        );
 
-            deviceContext->TouchPowerContext.TouchPowerOpen = FALSE;
-            goto exit;
-        }
+        deviceContext->TouchPowerContext.TouchPowerIOTarget = NULL;
+        goto exit;
+    }
 
-        deviceContext->TouchPowerContext.TouchPowerOpen = TRUE;
+    WDF_IO_TARGET_OPEN_PARAMS_INIT_OPEN_BY_NAME(&openParams, NotificationStruct->SymbolicLinkName, STANDARD_RIGHTS_ALL);
+
+    status = WdfIoTargetOpen(deviceContext->TouchPowerContext.TouchPowerIOTarget, &openParams);
+    if (!NT_SUCCESS(status))
+    {
+        Trace(
+            TRACE_LEVEL_ERROR,
+            TRACE_POWER,
+            "PowerIoRegPnPNotification: Opening IO Target to Touch Power driver failed"
+        );
+
+        PowerReleaseTarget(&deviceContext->TouchPowerContext);
+        goto exit;
     }
-    else
+
+    //
+    // The toggle request is sized for this target's stack and goes
+    // away with it
+    //
+    WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+    attributes.ParentObject = deviceContext->TouchPowerContext.TouchPowerIOTarget;
+
+    status = WdfRequestCreate(
+        &attributes,
+        deviceContext->TouchPowerContext.TouchPowerIOTarget,
+        &deviceContext->TouchPowerContext.ToggleRequest);
+
+    if (!NT_SUCCESS(status))
     {
-        WdfIoTargetClose(deviceContext->TouchPowerContext.TouchPowerIOTarget);
-        deviceContext->TouchPowerContext.TouchPowerOpen = FALSE;
+        Trace(
+            TRACE_LEVEL_ERROR,
+            TRACE_POWER,
+            "PowerIoRegPnPNotification: Creating touch power request failed"
+        );
+
+        deviceContext->TouchPowerContext.ToggleRequest = NULL;
+        PowerReleaseTarget(&deviceContext->TouchPowerContext);
+        goto exit;
     }
 
+    deviceContext->TouchPowerContext.TouchPowerOpen = TRUE;
+
 exit:
     Trace(
         TRACE_LEVEL_INFORMATION,
@@ -192,6 +472,7 @@ PowerInitialize(
 {
     NTSTATUS status = STATUS_SUCCESS;
     PDEVICE_EXTENSION deviceContext = (PDEVICE_EXTENSION)GetDeviceContext(Device);
+    WDF_OBJECT_ATTRIBUTES attributes;
 
     Trace(
         TRACE_LEVEL_INFORMATION,
@@ -199,6 +480,36 @@ PowerInitialize(
         "PowerInitialize: Entry"
     );
 
+    //
+    // The toggle payload lives as long as the device, so no allocation
+    // is made on display state changes
+    //
+    if (deviceContext->TouchPowerContext.ToggleMemory == NULL)
+    {
+        WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+        attributes.ParentObject = Device;
+
+        status = WdfMemoryCreate(
+            &attributes,
+            NonPagedPool,
+            TOUCH_POWER_POOL_TAG,
+            sizeof(DWORD),
+            &deviceContext->TouchPowerContext.ToggleMemory,
+            (PVOID*)&deviceContext->TouchPowerContext.ToggleBuffer);
+
+        if (!NT_SUCCESS(status))
+        {
+            Trace(
+                TRACE_LEVEL_ERROR,
+                TRACE_POWER,
+                "Error allocating memory for touch power ioctl send - 0x%08lX",
+                status);
+
+            deviceContext->TouchPowerContext.ToggleMemory = NULL;
+            goto exit;
+        }
+    }
+
     status = IoRegisterPlugPlayNotification(
         EventCategoryDeviceInterfaceChange,
         PNPNOTIFY_DEVICE_INTERFACE_INCLUDE_EXISTING_INTERFACES,
@@ -237,11 +548,10 @@ PowerDeInitialize(
         "PowerDeInitialize: Entry"
     );
 
-    if (deviceContext->TouchPowerContext.TouchPowerOpen == TRUE)
-    {
-        WdfIoTargetClose(deviceContext->TouchPowerContext.TouchPowerIOTarget);
-    }
-
+    //
+    // Unregistered first, no notification may recreate the target once
+    // it is released
+    //
     if (deviceContext->TouchPowerContext.TouchPowerNotify)
     {
         status = IoUnregisterPlugPlayNotificationEx(deviceContext->TouchPowerContext.TouchPowerNotify);
@@ -249,8 +559,12 @@ PowerDeInitialize(
         {
             goto exit;
         }
+
+        deviceContext->TouchPowerContext.TouchPowerNotify = NULL;
     }
 
+    PowerReleaseTarget(&deviceContext->TouchPowerContext);
+
 exit:
     Trace(
         TRACE_LEVEL_INFORMATION,
@@ -0,0 +1,339 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		tracker.c
+
+	Abstract:
+
+		Assigns stable contact IDs across frames. The points of a new frame
+		are matched to the contacts of the previous one by minimum total
+		squared distance, so a firmware reshuffling its slots (e.g. after
+		two fingers crossed) does not make contacts jump between IDs.
+
+	Environment:
+
+		Kernel mode
+
+	Revision History:
+
+--*/
+
+#include <tracker.h>
+
+//
+// Cost of pairings that must never be chosen
+//
+#define TRACKER_FORBIDDEN_COST     ((LONG64)1 << 40)
+
+VOID
+TrackerReset(
+	IN PTRACKER_CONTEXT Context
+)
+/*++
+
+Routine Description:
+
+	Forgets all tracked contacts and releases their IDs
+
+Arguments:
+
+	Context - The tracker context to reset
+
+Return Value:
+
+	None.
+
+--*/
+{
+	RtlZeroMemory(Context, sizeof(TRACKER_CONTEXT));
+}
+
+static
+UCHAR
+TrackerAllocateId(
+	IN OUT PULONG IdMask
+)
+{
+	UCHAR id;
+
+	for (id = 0; id < TRACKER_MAX_SLOTS; id++)
+	{
+		if (!(*IdMask & (1u << id)))
+		{
+			*IdMask |= (1u << id);
+			break;
+		}
+	}
+
+	return id;
+}
+
+static
+VOID
+TrackerSolve(
+	IN ULONG Size,
+	IN LONG64 Cost[TRACKER_MAX_CONTACTS][TRACKER_MAX_CONTACTS],
+	OUT ULONG* RowOfColumn
+)
+/*++
+
+Routine Description:
+
+	Minimum cost assignment of a square cost matrix (Hungarian method with
+	potentials). Runs in O(Size^3) with Size bounded by TRACKER_MAX_CONTACTS.
+
+Arguments:
+
+	Size - Dimension of the cost matrix
+
+	Cost - Cost[Row][Column]
+
+	RowOfColumn - Receives the row assigned to each column
+
+Return Value:
+
+	None.
+
+--*/
+{
+	LONG64 u[TRACKER_MAX_CONTACTS + 1] = { 0 };
+	LONG64 v[TRACKER_MAX_CONTACTS + 1] = { 0 };
+	LONG64 minimum[TRACKER_MAX_CONTACTS + 1];
+	ULONG row[TRACKER_MAX_CONTACTS + 1] = { 0 };
+	ULONG way[TRACKER_MAX_CONTACTS + 1] = { 0 };
+	BOOLEAN used[TRACKER_MAX_CONTACTS + 1];
+	LONG64 delta;
+	LONG64 current;
+	ULONG i, j, i0, j0, j1;
+
+	//
+	// Indices are one based below, column 0 is the augmenting root
+	//
+	for (i = 1; i <= Size; i++)
+	{
+		row[0] = i;
+		j0 = 0;
+
+		for (j = 0; j <= Size; j++)
+		{
+			minimum[j] = MAXLONG64;
+			used[j] = FALSE;
+		}
+
+		do
+		{
+			used[j0] = TRUE;
+			i0 = row[j0];
+			delta = MAXLONG64;
+			j1 = 0;
+
+			for (j = 1; j <= Size; j++)
+			{
+				if (used[j])
+				{
+					continue;
+				}
+
+				current = Cost[i0 - 1][j - 1] - u[i0] - v[j];
+
+				if (current < minimum[j])
+				{
+					minimum[j] = current;
+					way[j] = j0;
+				}
+
+				if (minimum[j] < delta)
+				{
+					delta = minimum[j];
+					j1 = j;
+				}
+			}
+
+			for (j = 0; j <= Size; j++)
+			{
+				if (used[j])
+				{
+					u[row[j]] += delta;
+					v[j] -= delta;
+				}
+				else
+				{
+					minimum[j] -= delta;
+				}
+			}
+
+			j0 = j1;
+		} while (row[j0] != 0);
+
+		do
+		{
+			j1 = way[j0];
+			row[j0] = row[j1];
+			j0 = j1;
+		} while (j0 != 0);
+	}
+
+	for (j = 1; j <= Size; j++)
+	{
+		RowOfColumn[j - 1] = row[j] - 1;
+	}
+}
+
+VOID
+TrackerUpdate(
+	IN PTRACKER_CONTEXT Context,
+	IN ULONG PresentMask,
+	IN ULONG LiftedMask,
+	IN const TRACKER_POINT* Points,
+	OUT PUCHAR Ids
+)
+/*++
+
+Routine Description:
+
+	Assigns contact IDs to the points of a new frame.
+
+	Every contact of the previous frame either continues as a present
+	point or ends as a lifted one, points left over are new contacts.
+	Lifted points carry their last position, so they pair up with the
+	contact they belonged to. New contacts get the lowest free ID; IDs of
+	contacts lifting in this frame are only released for the next one.
+
+Arguments:
+
+	Context - The tracker context
+
+	PresentMask - Controller slots with a contact down in this frame
+
+	LiftedMask - Controller slots whose contact lifted in this frame
+
+	Points - Position of each controller slot
+
+	Ids - Receives the contact ID of each present or lifted slot
+
+Return Value:
+
+	None.
+
+--*/
+{
+	LONG64 cost[TRACKER_MAX_CONTACTS][TRACKER_MAX_CONTACTS];
+	ULONG rowOfColumn[TRACKER_MAX_CONTACTS];
+	UCHAR columns[TRACKER_MAX_SLOTS];
+	ULONG columnCount = 0;
+	ULONG size;
+	ULONG idMask = Context->IdMask;
+	ULONG slotMask = PresentMask | LiftedMask;
+	LONG64 dx, dy;
+	ULONG i, j;
+
+	for (i = 0; i < TRACKER_MAX_SLOTS; i++)
+	{
+		Ids[i] = 0;
+
+		if (slotMask & (1u << i))
+		{
+			columns[columnCount++] = (UCHAR)i;
+		}
+	}
+
+	size = max(Context->Count, columnCount);
+
+	if (size <= TRACKER_MAX_CONTACTS)
+	{
+		//
+		// Rows are the previous contacts, padded with new ones. Columns are
+		// the points of this frame, padded with contacts that vanished
+		// without a lift. The number of padded pairings is fixed, so their
+		// cost does not bias the result.
+		//
+		for (i = 0; i < size; i++)
+		{
+			for (j = 0; j < size; j++)
+			{
+				if (i >= Context->Count || j >= columnCount)
+				{
+					cost[i][j] = 0;
+
+					//
+					// A lifted point always belonged to a previous contact
+					//
+					if (i >= Context->Count && j < columnCount &&
+						(LiftedMask & (1u << columns[j])))
+					{
+						cost[i][j] = TRACKER_FORBIDDEN_COST;
+					}
+
+					continue;
+				}
+
+				dx = (LONG64)Points[columns[j]].X - Context->Contacts[i].X;
+				dy = (LONG64)Points[columns[j]].Y - Context->Contacts[i].Y;
+				cost[i][j] = dx * dx + dy * dy;
+			}
+		}
+
+		TrackerSolve(size, cost, rowOfColumn);
+
+		for (j = 0; j < columnCount; j++)
+		{
+			if (rowOfColumn[j] < Context->Count)
+			{
+				Ids[columns[j]] = Context->Contacts[rowOfColumn[j]].Id;
+			}
+			else
+			{
+				Ids[columns[j]] = TrackerAllocateId(&idMask);
+			}
+		}
+	}
+	else
+	{
+		//
+		// Too many points to match by position, trust the controller slots
+		//
+		for (j = 0; j < columnCount; j++)
+		{
+			for (i = 0; i < Context->Count; i++)
+			{
+				if (Context->Contacts[i].Slot == columns[j])
+				{
+					break;
+				}
+			}
+
+			if (i < Context->Count)
+			{
+				Ids[columns[j]] = Context->Contacts[i].Id;
+			}
+			else
+			{
+				Ids[columns[j]] = TrackerAllocateId(&idMask);
+			}
+		}
+	}
+
+	//
+	// Contacts still down are matched against the next frame
+	//
+	Context->Count = 0;
+	Context->IdMask = 0;
+
+	for (j = 0; j < columnCount; j++)
+	{
+		if (!(PresentMask & (1u << columns[j])))
+		{
+			continue;
+		}
+
+		Context->Contacts[Context->Count].X = Points[columns[j]].X;
+		Context->Contacts[Context->Count].Y = Points[columns[j]].Y;
+		Context->Contacts[Context->Count].Id = Ids[columns[j]];
+		Context->Contacts[Context->Count].Slot = columns[j];
+		Context->Count++;
+
+		Context->IdMask |= (1u << Ids[columns[j]]);
+	}
+}
@@ -0,0 +1,60 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		hosttest.h
+
+	Abstract:
+
+		Checks shared by the host tests. A test is an executable that
+		returns non zero when a check failed.
+
+	Environment:
+
+		User mode, host tests only
+
+	Revision History:
+
+--*/
+
+#pragma once
+
+#include <stdio.h>
+#include <shim.h>
+
+static int gFailures;
+
+#define CHECK(e) \
+	do { \
+		if (!(e)) \
+		{ \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #e); \
+			gFailures++; \
+		} \
+	} while (0)
+
+#define CHECK_EQUAL(a, b) \
+	do { \
+		long long _a = (long long)(a); \
+		long long _b = (long long)(b); \
+		if (_a != _b) \
+		{ \
+			fprintf(stderr, "%s:%d: %s == %s failed, %lld != %lld\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+			gFailures++; \
+		} \
+	} while (0)
+
+#define CHECK_NEAR(a, b, tolerance) \
+	do { \
+		long long _a = (long long)(a); \
+		long long _b = (long long)(b); \
+		if (_a - _b > (tolerance) || _b - _a > (tolerance)) \
+		{ \
+			fprintf(stderr, "%s:%d: %s ~ %s failed, %lld vs %lld\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+			gFailures++; \
+		} \
+	} while (0)
+
+#define TEST_RESULT() \
+	(printf("%s\n", gFailures == 0 ? "passed" : "FAILED"), gFailures != 0)
@@ -0,0 +1,84 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		fakespb.c
+
+	Abstract:
+
+		SPB calls of the driver served by a test supplied controller
+		model, see shim.h
+
+	Environment:
+
+		User mode, host tests only
+
+	Revision History:
+
+--*/
+
+#include <wdm.h>
+#include <wdf.h>
+#include <spb.h>
+#include <shim.h>
+
+SHIM_SPB ShimSpb;
+
+VOID
+ShimResetSpb(
+	VOID
+)
+{
+	RtlZeroMemory(&ShimSpb, sizeof(ShimSpb));
+}
+
+NTSTATUS
+SpbReadDataSynchronously(
+	_In_ SPB_CONTEXT* SpbContext,
+	_In_reads_bytes_(CommandLength) PUCHAR Command,
+	_In_ ULONG CommandLength,
+	_In_reads_bytes_(Length) PVOID Data,
+	_In_ ULONG Length
+)
+{
+	UNREFERENCED_PARAMETER(SpbContext);
+
+	ShimInterruptTime += ShimSpb.TransferTime;
+	ShimSpb.Reads++;
+
+	if (ShimSpb.Handler == NULL)
+	{
+		RtlZeroMemory(Data, Length);
+		return STATUS_SUCCESS;
+	}
+
+	return ShimSpb.Handler(ShimSpb.Context, Command, CommandLength, Data, Length);
+}
+
+NTSTATUS
+SpbWriteDataSynchronously(
+	IN SPB_CONTEXT* SpbContext,
+	IN PUCHAR Command,
+	IN ULONG CommandLength,
+	IN PVOID Data,
+	IN ULONG Length
+)
+{
+	UNREFERENCED_PARAMETER(SpbContext);
+	UNREFERENCED_PARAMETER(Data);
+	UNREFERENCED_PARAMETER(Length);
+
+	ShimInterruptTime += ShimSpb.TransferTime;
+	ShimSpb.Writes++;
+
+	RtlZeroMemory(ShimSpb.LastWrite, sizeof(ShimSpb.LastWrite));
+	RtlCopyMemory(ShimSpb.LastWrite, Command, min(CommandLength, sizeof(ShimSpb.LastWrite)));
+
+	if (ShimSpb.Handler == NULL)
+	{
+		return STATUS_SUCCESS;
+	}
+
+	return ShimSpb.Handler(ShimSpb.Context, Command, CommandLength, NULL, 0);
+}
@@ -0,0 +1,367 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		shim.c
+
+	Abstract:
+
+		User mode implementation of the kernel and framework calls made
+		by the modules under test: a fake clock, pool allocation on the
+		heap and a device key held in memory.
+
+	Environment:
+
+		User mode, host tests only
+
+	Revision History:
+
+--*/
+
+#include <wdm.h>
+#include <wdf.h>
+#include <shim.h>
+
+ULONG64 ShimInterruptTime = 0;
+ULONG64 ShimTimerResolution = 10000;
+LONG ShimPoolAllocations = 0;
+
+#define SHIM_MAX_VALUES 16
+
+static struct
+{
+	PCWSTR Name;
+	ULONG Type;
+	const VOID* Data;
+	ULONG Length;
+} gShimValues[SHIM_MAX_VALUES];
+
+static ULONG gShimValueCount;
+
+VOID
+RtlInitUnicodeString(
+	OUT PUNICODE_STRING Destination,
+	IN PCWSTR Source
+)
+{
+	USHORT length = 0;
+
+	while (Source != NULL && Source[length] != 0)
+	{
+		length++;
+	}
+
+	Destination->Buffer = (PWSTR)Source;
+	Destination->Length = (USHORT)(length * sizeof(WCHAR));
+	Destination->MaximumLength = (USHORT)(Destination->Length + sizeof(WCHAR));
+}
+
+PVOID
+ExAllocatePoolWithTag(
+	IN POOL_TYPE PoolType,
+	IN SIZE_T NumberOfBytes,
+	IN ULONG Tag
+)
+{
+	UNREFERENCED_PARAMETER(PoolType);
+	UNREFERENCED_PARAMETER(Tag);
+
+	ShimPoolAllocations++;
+
+	return malloc(NumberOfBytes);
+}
+
+VOID
+ExFreePoolWithTag(
+	IN PVOID P,
+	IN ULONG Tag
+)
+{
+	UNREFERENCED_PARAMETER(Tag);
+
+	ShimPoolAllocations--;
+
+	free(P);
+}
+
+ULONG64
+KeQueryInterruptTime(
+	VOID
+)
+{
+	return ShimInterruptTime;
+}
+
+LARGE_INTEGER
+KeQueryPerformanceCounter(
+	OUT PLARGE_INTEGER PerformanceFrequency OPTIONAL
+)
+{
+	LARGE_INTEGER counter;
+
+	if (PerformanceFrequency != NULL)
+	{
+		PerformanceFrequency->QuadPart = 10000000;
+	}
+
+	counter.QuadPart = (LONGLONG)ShimInterruptTime;
+
+	return counter;
+}
+
+VOID
+KeStallExecutionProcessor(
+	IN ULONG MicroSeconds
+)
+{
+	ShimInterruptTime += (ULONG64)MicroSeconds * 10;
+}
+
+NTSTATUS
+KeDelayExecutionThread(
+	IN KPROCESSOR_MODE WaitMode,
+	IN BOOLEAN Alertable,
+	IN PLARGE_INTEGER Interval
+)
+{
+	ULONG64 delay;
+
+	UNREFERENCED_PARAMETER(WaitMode);
+	UNREFERENCED_PARAMETER(Alertable);
+
+	//
+	// Relative waits only. The timer expires on a tick, so the wait is
+	// at least one tick and rounded up to whole ticks.
+	//
+	delay = (ULONG64)(-Interval->QuadPart);
+	delay = max(delay, 1);
+	delay = (delay + ShimTimerResolution - 1) / ShimTimerResolution * ShimTimerResolution;
+
+	ShimInterruptTime += delay;
+
+	return STATUS_SUCCESS;
+}
+
+NTSTATUS
+ZwOpenKey(
+	OUT PHANDLE KeyHandle,
+	IN ULONG DesiredAccess,
+	IN POBJECT_ATTRIBUTES ObjectAttributes
+)
+{
+	UNREFERENCED_PARAMETER(DesiredAccess);
+	UNREFERENCED_PARAMETER(ObjectAttributes);
+
+	*KeyHandle = NULL;
+
+	return STATUS_OBJECT_NAME_NOT_FOUND;
+}
+
+NTSTATUS
+ZwClose(
+	IN HANDLE Handle
+)
+{
+	UNREFERENCED_PARAMETER(Handle);
+
+	return STATUS_SUCCESS;
+}
+
+NTSTATUS
+ZwNotifyChangeKey(
+	IN HANDLE KeyHandle,
+	IN HANDLE Event OPTIONAL,
+	IN PIO_APC_ROUTINE ApcRoutine OPTIONAL,
+	IN PVOID ApcContext OPTIONAL,
+	OUT PIO_STATUS_BLOCK IoStatusBlock,
+	IN ULONG CompletionFilter,
+	IN BOOLEAN WatchTree,
+	OUT PVOID Buffer OPTIONAL,
+	IN ULONG BufferSize,
+	IN BOOLEAN Asynchronous
+)
+{
+	UNREFERENCED_PARAMETER(KeyHandle);
+	UNREFERENCED_PARAMETER(Event);
+	UNREFERENCED_PARAMETER(ApcRoutine);
+	UNREFERENCED_PARAMETER(ApcContext);
+	UNREFERENCED_PARAMETER(CompletionFilter);
+	UNREFERENCED_PARAMETER(WatchTree);
+	UNREFERENCED_PARAMETER(Buffer);
+	UNREFERENCED_PARAMETER(BufferSize);
+	UNREFERENCED_PARAMETER(Asynchronous);
+
+	IoStatusBlock->Status = STATUS_PENDING;
+
+	return STATUS_PENDING;
+}
+
+static
+BOOLEAN
+ShimStringEquals(
+	IN PCWSTR Left,
+	IN PCWSTR Right
+)
+{
+	while (*Left != 0 && *Left == *Right)
+	{
+		Left++;
+		Right++;
+	}
+
+	return *Left == *Right;
+}
+
+static
+BOOLEAN
+ShimNameEquals(
+	IN PCWSTR Name,
+	IN PCUNICODE_STRING ValueName
+)
+{
+	USHORT i;
+
+	for (i = 0; i < ValueName->Length / sizeof(WCHAR); i++)
+	{
+		if (Name[i] != ValueName->Buffer[i])
+		{
+			return FALSE;
+		}
+	}
+
+	return Name[i] == 0;
+}
+
+VOID
+ShimSetDeviceValue(
+	IN PCWSTR Name,
+	IN ULONG Type,
+	IN const VOID* Data,
+	IN ULONG Length
+)
+{
+	ULONG i;
+
+	for (i = 0; i < gShimValueCount; i++)
+	{
+		if (ShimStringEquals(gShimValues[i].Name, Name))
+		{
+			break;
+		}
+	}
+
+	if (i == gShimValueCount)
+	{
+		if (gShimValueCount == SHIM_MAX_VALUES)
+		{
+			abort();
+		}
+
+		gShimValueCount++;
+	}
+
+	gShimValues[i].Name = Name;
+	gShimValues[i].Type = Type;
+	gShimValues[i].Data = Data;
+	gShimValues[i].Length = Length;
+}
+
+VOID
+ShimClearDeviceValues(
+	VOID
+)
+{
+	gShimValueCount = 0;
+}
+
+NTSTATUS
+WdfDeviceOpenRegistryKey(
+	IN WDFDEVICE Device,
+	IN ULONG DeviceInstanceKeyType,
+	IN ACCESS_MASK DesiredAccess,
+	IN PWDF_OBJECT_ATTRIBUTES KeyAttributes OPTIONAL,
+	OUT WDFKEY* Key
+)
+{
+	UNREFERENCED_PARAMETER(Device);
+	UNREFERENCED_PARAMETER(DeviceInstanceKeyType);
+	UNREFERENCED_PARAMETER(DesiredAccess);
+	UNREFERENCED_PARAMETER(KeyAttributes);
+
+	*Key = (WDFKEY)&gShimValues;
+
+	return STATUS_SUCCESS;
+}
+
+NTSTATUS
+WdfRegistryQueryValue(
+	IN WDFKEY Key,
+	IN PCUNICODE_STRING ValueName,
+	IN ULONG ValueLength,
+	OUT PVOID Value OPTIONAL,
+	OUT PULONG ValueLengthQueried OPTIONAL,
+	OUT PULONG ValueType OPTIONAL
+)
+{
+	ULONG i;
+
+	UNREFERENCED_PARAMETER(Key);
+
+	for (i = 0; i < gShimValueCount; i++)
+	{
+		if (!ShimNameEquals(gShimValues[i].Name, ValueName))
+		{
+			continue;
+		}
+
+		if (ValueLengthQueried != NULL)
+		{
+			*ValueLengthQueried = gShimValues[i].Length;
+		}
+
+		if (ValueType != NULL)
+		{
+			*ValueType = gShimValues[i].Type;
+		}
+
+		if (Value == NULL || ValueLength < gShimValues[i].Length)
+		{
+			return STATUS_BUFFER_OVERFLOW;
+		}
+
+		RtlCopyMemory(Value, gShimValues[i].Data, gShimValues[i].Length);
+
+		return STATUS_SUCCESS;
+	}
+
+	return STATUS_OBJECT_NAME_NOT_FOUND;
+}
+
+NTSTATUS
+WdfRegistryQueryULong(
+	IN WDFKEY Key,
+	IN PCUNICODE_STRING ValueName,
+	OUT PULONG Value
+)
+{
+	ULONG type;
+	NTSTATUS status;
+
+	status = WdfRegistryQueryValue(Key, ValueName, sizeof(ULONG), Value, NULL, &type);
+
+	if (NT_SUCCESS(status) && type != REG_DWORD)
+	{
+		status = STATUS_OBJECT_TYPE_MISMATCH;
+	}
+
+	return status;
+}
+
+VOID
+WdfRegistryClose(
+	IN WDFKEY Key
+)
+{
+	UNREFERENCED_PARAMETER(Key);
+}
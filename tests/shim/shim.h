@@ -0,0 +1,76 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		shim.h
+
+	Abstract:
+
+		Controls of the user mode shim for the host tests: the device
+		key contents and a scripted controller behind the SPB calls
+
+	Environment:
+
+		User mode, host tests only
+
+	Revision History:
+
+--*/
+
+#pragma once
+
+#include <wdm.h>
+#include <wdf.h>
+
+//
+// Pool blocks allocated and not freed yet
+//
+extern LONG ShimPoolAllocations;
+
+//
+// Device key. Data is referenced, not copied.
+//
+VOID
+ShimSetDeviceValue(
+	IN PCWSTR Name,
+	IN ULONG Type,
+	IN const VOID* Data,
+	IN ULONG Length
+);
+
+VOID
+ShimClearDeviceValues(
+	VOID
+);
+
+//
+// Controller behind SpbReadDataSynchronously and SpbWriteDataSynchronously.
+// Each transfer advances the clock by TransferTime (100 ns units). Reads
+// go to Read, which is also told about writes with Data NULL. Without a
+// handler reads return zeroes.
+//
+typedef NTSTATUS (*PSHIM_SPB_HANDLER)(
+	IN PVOID Context,
+	IN const UCHAR* Command,
+	IN ULONG CommandLength,
+	OUT PUCHAR Data OPTIONAL,
+	IN ULONG Length
+	);
+
+typedef struct _SHIM_SPB
+{
+	PSHIM_SPB_HANDLER Handler;
+	PVOID Context;
+	ULONG64 TransferTime;
+	ULONG Writes;
+	ULONG Reads;
+	UCHAR LastWrite[8];
+} SHIM_SPB;
+
+extern SHIM_SPB ShimSpb;
+
+VOID
+ShimResetSpb(
+	VOID
+);
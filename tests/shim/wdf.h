@@ -0,0 +1,99 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		wdf.h
+
+	Abstract:
+
+		User mode stand-in for the framework headers. Objects are opaque
+		handles, the few framework calls the tested modules make are
+		implemented in shim.c.
+
+	Environment:
+
+		User mode, host tests only
+
+	Revision History:
+
+--*/
+
+#pragma once
+
+#include <wdm.h>
+
+#define WDF_DECLARE_HANDLE(h) typedef struct h##__* h
+
+typedef struct WDFOBJECT__* WDFOBJECT;
+WDF_DECLARE_HANDLE(WDFDRIVER);
+WDF_DECLARE_HANDLE(WDFDEVICE);
+WDF_DECLARE_HANDLE(WDFQUEUE);
+WDF_DECLARE_HANDLE(WDFREQUEST);
+WDF_DECLARE_HANDLE(WDFIOTARGET);
+WDF_DECLARE_HANDLE(WDFMEMORY);
+WDF_DECLARE_HANDLE(WDFWAITLOCK);
+WDF_DECLARE_HANDLE(WDFSPINLOCK);
+WDF_DECLARE_HANDLE(WDFKEY);
+WDF_DECLARE_HANDLE(WDFTIMER);
+WDF_DECLARE_HANDLE(WDFWORKITEM);
+WDF_DECLARE_HANDLE(WDFINTERRUPT);
+WDF_DECLARE_HANDLE(WDFFILEOBJECT);
+WDF_DECLARE_HANDLE(WDFCMRESLIST);
+WDF_DECLARE_HANDLE(WDFSTRING);
+
+typedef struct _WDF_OBJECT_ATTRIBUTES* PWDF_OBJECT_ATTRIBUTES;
+
+#define WDF_NO_OBJECT_ATTRIBUTES ((PWDF_OBJECT_ATTRIBUTES)NULL)
+#define WDF_NO_HANDLE NULL
+
+#define PLUGPLAY_REGKEY_DEVICE 1
+#define PLUGPLAY_REGKEY_DRIVER 2
+
+typedef ULONG ACCESS_MASK;
+
+typedef enum _WDF_POWER_DEVICE_STATE
+{
+	WdfPowerDeviceInvalid = 0,
+	WdfPowerDeviceD0,
+	WdfPowerDeviceD1,
+	WdfPowerDeviceD2,
+	WdfPowerDeviceD3,
+	WdfPowerDeviceD3Final,
+	WdfPowerDevicePrepareForHibernation,
+	WdfPowerDeviceMaximum
+} WDF_POWER_DEVICE_STATE;
+
+//
+// Registry, backed by the value table of shim.c
+//
+NTSTATUS
+WdfDeviceOpenRegistryKey(
+	IN WDFDEVICE Device,
+	IN ULONG DeviceInstanceKeyType,
+	IN ACCESS_MASK DesiredAccess,
+	IN PWDF_OBJECT_ATTRIBUTES KeyAttributes OPTIONAL,
+	OUT WDFKEY* Key
+);
+
+NTSTATUS
+WdfRegistryQueryValue(
+	IN WDFKEY Key,
+	IN PCUNICODE_STRING ValueName,
+	IN ULONG ValueLength,
+	OUT PVOID Value OPTIONAL,
+	OUT PULONG ValueLengthQueried OPTIONAL,
+	OUT PULONG ValueType OPTIONAL
+);
+
+NTSTATUS
+WdfRegistryQueryULong(
+	IN WDFKEY Key,
+	IN PCUNICODE_STRING ValueName,
+	OUT PULONG Value
+);
+
+VOID
+WdfRegistryClose(
+	IN WDFKEY Key
+);
@@ -0,0 +1,457 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		wdm.h
+
+	Abstract:
+
+		User mode stand-in for the kernel headers, enough for the driver
+		modules built by the host tests. Types keep their Windows sizes,
+		ULONG is 32 bits on every host. Time is a fake clock the tests
+		drive, see shim.c.
+
+	Environment:
+
+		User mode, host tests only
+
+	Revision History:
+
+--*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+//
+// Annotations
+//
+#define IN
+#define OUT
+#define OPTIONAL
+#define _In_
+#define _In_opt_
+#define _Out_
+#define _Inout_
+#define _Inout_opt_
+#define _In_reads_bytes_(x)
+#define _Out_writes_bytes_(x)
+#define _Function_class_(x)
+#define _IRQL_requires_(x)
+#define _IRQL_requires_max_(x)
+#define _Use_decl_annotations_
+#define NTAPI
+#define FORCEINLINE static inline
+#define DECLSPEC_ALIGN(x)
+#define ANYSIZE_ARRAY 1
+
+//
+// Types
+//
+typedef void VOID;
+typedef void* PVOID;
+typedef const void* PCVOID;
+typedef char CHAR;
+typedef CHAR* PCHAR;
+typedef uint8_t UCHAR;
+typedef UCHAR* PUCHAR;
+typedef UCHAR BYTE;
+typedef UCHAR BOOLEAN;
+typedef BOOLEAN* PBOOLEAN;
+typedef int16_t SHORT;
+typedef SHORT* PSHORT;
+typedef uint16_t USHORT;
+typedef USHORT* PUSHORT;
+typedef int32_t LONG;
+typedef LONG* PLONG;
+typedef uint32_t ULONG;
+typedef ULONG* PULONG;
+typedef int INT;
+typedef unsigned int UINT;
+typedef int32_t INT32;
+typedef uint32_t UINT32;
+typedef UINT32* PUINT32;
+typedef uint32_t DWORD;
+typedef DWORD* PDWORD;
+typedef int64_t LONG64;
+typedef int64_t LONGLONG;
+typedef uint64_t ULONG64;
+typedef ULONG64* PULONG64;
+typedef uint64_t ULONGLONG;
+typedef uintptr_t ULONG_PTR;
+typedef size_t SIZE_T;
+typedef LONG NTSTATUS;
+typedef PVOID HANDLE;
+typedef HANDLE* PHANDLE;
+//
+// Built with 16 bit wchar_t, so L"" literals are WCHAR strings
+//
+typedef wchar_t WCHAR;
+typedef WCHAR* PWCHAR;
+typedef WCHAR* PWSTR;
+typedef const WCHAR* PCWSTR;
+typedef UCHAR KIRQL;
+typedef ULONG_PTR KSPIN_LOCK;
+typedef KSPIN_LOCK* PKSPIN_LOCK;
+typedef UCHAR KPROCESSOR_MODE;
+
+typedef union _LARGE_INTEGER
+{
+	struct
+	{
+		ULONG LowPart;
+		LONG HighPart;
+	} u;
+	LONGLONG QuadPart;
+} LARGE_INTEGER, * PLARGE_INTEGER;
+
+typedef struct _GUID
+{
+	ULONG Data1;
+	USHORT Data2;
+	USHORT Data3;
+	UCHAR Data4[8];
+} GUID, * LPGUID;
+typedef const GUID* LPCGUID;
+
+typedef struct _UNICODE_STRING
+{
+	USHORT Length;
+	USHORT MaximumLength;
+	PWSTR Buffer;
+} UNICODE_STRING, * PUNICODE_STRING;
+typedef const UNICODE_STRING* PCUNICODE_STRING;
+
+typedef struct _LIST_ENTRY
+{
+	struct _LIST_ENTRY* Flink;
+	struct _LIST_ENTRY* Blink;
+} LIST_ENTRY, * PLIST_ENTRY;
+
+typedef struct _KEVENT { LONG State; } KEVENT, * PKEVENT;
+typedef struct _KMUTEX { LONG State; } KMUTEX, * PKMUTEX;
+
+typedef VOID WORKER_THREAD_ROUTINE(PVOID Parameter);
+typedef WORKER_THREAD_ROUTINE* PWORKER_THREAD_ROUTINE;
+
+typedef struct _WORK_QUEUE_ITEM
+{
+	LIST_ENTRY List;
+	PWORKER_THREAD_ROUTINE WorkerRoutine;
+	PVOID Parameter;
+} WORK_QUEUE_ITEM, * PWORK_QUEUE_ITEM;
+
+typedef struct _IO_STATUS_BLOCK
+{
+	NTSTATUS Status;
+	ULONG_PTR Information;
+} IO_STATUS_BLOCK, * PIO_STATUS_BLOCK;
+
+typedef VOID (*PIO_APC_ROUTINE)(PVOID ApcContext, PIO_STATUS_BLOCK IoStatusBlock, ULONG Reserved);
+
+typedef struct _OBJECT_ATTRIBUTES
+{
+	ULONG Length;
+	HANDLE RootDirectory;
+	PUNICODE_STRING ObjectName;
+	ULONG Attributes;
+	PVOID SecurityDescriptor;
+	PVOID SecurityQualityOfService;
+} OBJECT_ATTRIBUTES, * POBJECT_ATTRIBUTES;
+
+typedef enum _POOL_TYPE
+{
+	NonPagedPool = 0,
+	PagedPool = 1,
+	NonPagedPoolNx = 512
+} POOL_TYPE;
+
+typedef enum _DEVICE_POWER_STATE
+{
+	PowerDeviceUnspecified = 0,
+	PowerDeviceD0,
+	PowerDeviceD1,
+	PowerDeviceD2,
+	PowerDeviceD3,
+	PowerDeviceMaximum
+} DEVICE_POWER_STATE, * PDEVICE_POWER_STATE;
+
+typedef enum _EVENT_TYPE
+{
+	NotificationEvent,
+	SynchronizationEvent
+} EVENT_TYPE;
+
+typedef enum _KWAIT_REASON
+{
+	Executive = 0
+} KWAIT_REASON;
+
+typedef enum _WORK_QUEUE_TYPE
+{
+	CriticalWorkQueue,
+	DelayedWorkQueue
+} WORK_QUEUE_TYPE;
+
+//
+// Constants
+//
+#define TRUE  1
+#define FALSE 0
+#define KernelMode 0
+#define MAXUCHAR  0xFF
+#define MAXUSHORT 0xFFFF
+#define MAXULONG  0xFFFFFFFFUL
+#define MAXLONG   0x7FFFFFFFL
+#define MAXLONG64 0x7FFFFFFFFFFFFFFFLL
+#define MAXULONG64 0xFFFFFFFFFFFFFFFFULL
+
+#define STATUS_SUCCESS                  ((NTSTATUS)0x00000000L)
+#define STATUS_PENDING                  ((NTSTATUS)0x00000103L)
+#define STATUS_NOTIFY_CLEANUP           ((NTSTATUS)0x0000010BL)
+#define STATUS_NOTIFY_ENUM_DIR          ((NTSTATUS)0x0000010CL)
+#define STATUS_BUFFER_OVERFLOW          ((NTSTATUS)0x80000005L)
+#define STATUS_NO_MORE_ENTRIES          ((NTSTATUS)0x8000001AL)
+#define STATUS_UNSUCCESSFUL             ((NTSTATUS)0xC0000001L)
+#define STATUS_NOT_IMPLEMENTED          ((NTSTATUS)0xC0000002L)
+#define STATUS_INVALID_PARAMETER        ((NTSTATUS)0xC000000DL)
+#define STATUS_INSUFFICIENT_RESOURCES   ((NTSTATUS)0xC000009AL)
+#define STATUS_OBJECT_NAME_NOT_FOUND    ((NTSTATUS)0xC0000034L)
+#define STATUS_OBJECT_TYPE_MISMATCH     ((NTSTATUS)0xC0000024L)
+#define STATUS_BUFFER_TOO_SMALL         ((NTSTATUS)0xC0000023L)
+#define STATUS_NOT_SUPPORTED            ((NTSTATUS)0xC00000BBL)
+#define STATUS_IO_TIMEOUT               ((NTSTATUS)0xC00000B5L)
+#define STATUS_DEVICE_DATA_ERROR        ((NTSTATUS)0xC000009CL)
+#define STATUS_DEVICE_PROTOCOL_ERROR    ((NTSTATUS)0xC0000186L)
+#define STATUS_DEVICE_NOT_READY         ((NTSTATUS)0xC00000A3L)
+#define STATUS_REQUEST_ABORTED          ((NTSTATUS)0xC0000240L)
+#define STATUS_REVISION_MISMATCH        ((NTSTATUS)0xC0000059L)
+#define STATUS_INVALID_DEVICE_STATE     ((NTSTATUS)0xC0000184L)
+
+#define NT_SUCCESS(Status) (((NTSTATUS)(Status)) >= 0)
+
+#define REG_NONE      0
+#define REG_SZ        1
+#define REG_BINARY    3
+#define REG_DWORD     4
+#define REG_MULTI_SZ  7
+
+#define KEY_READ      0x20019
+#define KEY_NOTIFY    0x0010
+#define REG_NOTIFY_CHANGE_LAST_SET 0x00000004L
+
+#define OBJ_CASE_INSENSITIVE 0x00000040L
+#define OBJ_KERNEL_HANDLE    0x00000200L
+#define IO_NO_INCREMENT      0
+
+#define DPFLTR_IHVDRIVER_ID 77
+#define DPFLTR_ERROR_LEVEL  0
+
+#define TRACE_LEVEL_NONE        0
+#define TRACE_LEVEL_CRITICAL    1
+#define TRACE_LEVEL_FATAL       1
+#define TRACE_LEVEL_ERROR       2
+#define TRACE_LEVEL_WARNING     3
+#define TRACE_LEVEL_INFORMATION 4
+#define TRACE_LEVEL_VERBOSE     5
+
+//
+// Macros
+//
+#ifndef min
+#define min(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+
+#define FIELD_OFFSET(type, field) ((LONG)offsetof(type, field))
+#define RTL_FIELD_SIZE(type, field) (sizeof(((type*)0)->field))
+#define ARRAYSIZE(a) (sizeof(a) / sizeof((a)[0]))
+#define RTL_NUMBER_OF(a) ARRAYSIZE(a)
+#define C_ASSERT(e) _Static_assert(e, #e)
+#define UNREFERENCED_PARAMETER(p) ((void)(p))
+#define ASSERT(e) ((void)0)
+#define NT_ASSERT(e) ((void)0)
+#define PAGED_CODE()
+
+#define RtlZeroMemory(d, n) memset((d), 0, (n))
+#define RtlFillMemory(d, n, v) memset((d), (v), (n))
+#define RtlCopyMemory(d, s, n) memcpy((d), (s), (n))
+#define RtlMoveMemory(d, s, n) memmove((d), (s), (n))
+#define RtlCompareMemory(a, b, n) ((SIZE_T)(memcmp((a), (b), (n)) == 0 ? (n) : 0))
+
+//
+// Traces are dropped. A macro, so the trailing comma Trace leaves when a
+// message has no arguments is accepted.
+//
+#define DbgPrintEx(...) ((void)0)
+
+//
+// Runtime, see shim.c
+//
+VOID
+RtlInitUnicodeString(
+	OUT PUNICODE_STRING Destination,
+	IN PCWSTR Source
+);
+
+PVOID
+ExAllocatePoolWithTag(
+	IN POOL_TYPE PoolType,
+	IN SIZE_T NumberOfBytes,
+	IN ULONG Tag
+);
+
+VOID
+ExFreePoolWithTag(
+	IN PVOID P,
+	IN ULONG Tag
+);
+
+ULONG64
+KeQueryInterruptTime(
+	VOID
+);
+
+LARGE_INTEGER
+KeQueryPerformanceCounter(
+	OUT PLARGE_INTEGER PerformanceFrequency OPTIONAL
+);
+
+VOID
+KeStallExecutionProcessor(
+	IN ULONG MicroSeconds
+);
+
+NTSTATUS
+KeDelayExecutionThread(
+	IN KPROCESSOR_MODE WaitMode,
+	IN BOOLEAN Alertable,
+	IN PLARGE_INTEGER Interval
+);
+
+#define InitializeObjectAttributes(a, n, attr, root, sd) \
+	((a)->Length = sizeof(OBJECT_ATTRIBUTES), (a)->RootDirectory = (root), \
+	 (a)->ObjectName = (n), (a)->Attributes = (attr), (a)->SecurityDescriptor = (sd), \
+	 (a)->SecurityQualityOfService = NULL)
+
+#define ExInitializeWorkItem(item, routine, parameter) \
+	((item)->WorkerRoutine = (routine), (item)->Parameter = (parameter))
+
+//
+// Objects never block: events and mutexes only keep their state, work
+// items run right away. Registry keys under \Registry are not found.
+//
+#define KeInitializeEvent(e, type, state) ((e)->State = (state))
+#define KeSetEvent(e, increment, wait) ((void)((e)->State = 1))
+#define KeClearEvent(e) ((e)->State = 0)
+#define KeReadStateEvent(e) ((e)->State)
+#define KeInitializeMutex(m, level) ((m)->State = 1)
+#define KeReleaseMutex(m, wait) ((void)((m)->State = 1))
+#define KeWaitForSingleObject(o, reason, mode, alertable, timeout) shimWait(o)
+#define ExQueueWorkItem(item, type) ((item)->WorkerRoutine((item)->Parameter))
+
+NTSTATUS
+ZwOpenKey(
+	OUT PHANDLE KeyHandle,
+	IN ULONG DesiredAccess,
+	IN POBJECT_ATTRIBUTES ObjectAttributes
+);
+
+NTSTATUS
+ZwClose(
+	IN HANDLE Handle
+);
+
+NTSTATUS
+ZwNotifyChangeKey(
+	IN HANDLE KeyHandle,
+	IN HANDLE Event OPTIONAL,
+	IN PIO_APC_ROUTINE ApcRoutine OPTIONAL,
+	IN PVOID ApcContext OPTIONAL,
+	OUT PIO_STATUS_BLOCK IoStatusBlock,
+	IN ULONG CompletionFilter,
+	IN BOOLEAN WatchTree,
+	OUT PVOID Buffer OPTIONAL,
+	IN ULONG BufferSize,
+	IN BOOLEAN Asynchronous
+);
+
+#define KeInitializeSpinLock(l) (*(l) = 0)
+#define KeAcquireSpinLock(l, irql) (*(irql) = 0)
+#define KeReleaseSpinLock(l, irql) ((void)(irql))
+
+#define InterlockedIncrement(p) (++*(p))
+#define InterlockedDecrement(p) (--*(p))
+#define InterlockedExchange(p, v) shimExchange((p), (v))
+#define InterlockedCompareExchange(p, v, c) shimCompareExchange((p), (v), (c))
+#define InterlockedExchangePointer(p, v) shimExchangePointer((PVOID*)(p), (v))
+
+FORCEINLINE
+NTSTATUS
+shimWait(
+	PVOID Object
+)
+{
+	UNREFERENCED_PARAMETER(Object);
+
+	return STATUS_SUCCESS;
+}
+
+FORCEINLINE
+LONG
+shimExchange(
+	volatile LONG* Target,
+	LONG Value
+)
+{
+	LONG old = *Target;
+
+	*Target = Value;
+
+	return old;
+}
+
+FORCEINLINE
+LONG
+shimCompareExchange(
+	volatile LONG* Target,
+	LONG Value,
+	LONG Comparand
+)
+{
+	LONG old = *Target;
+
+	if (old == Comparand)
+	{
+		*Target = Value;
+	}
+
+	return old;
+}
+
+FORCEINLINE
+PVOID
+shimExchangePointer(
+	PVOID volatile* Target,
+	PVOID Value
+)
+{
+	PVOID old = *Target;
+
+	*Target = Value;
+
+	return old;
+}
+
+//
+// Fake clock controls, in interrupt time units (100 ns). Sleeps are
+// rounded up to the timer resolution like the kernel does.
+//
+extern ULONG64 ShimInterruptTime;
+extern ULONG64 ShimTimerResolution;
@@ -0,0 +1,189 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		test_calibration.c
+
+	Abstract:
+
+		Tests validation of calibration meshes and the interpolation of
+		their offsets
+
+	Environment:
+
+		User mode, host tests only
+
+	Revision History:
+
+--*/
+
+#include <hosttest.h>
+#include <calibration.h>
+
+#define WIDTH  1440
+#define HEIGHT 2560
+
+static UCHAR gMesh[CALIBRATION_MESH_MAX_SIZE];
+
+static
+ULONG
+BuildMesh(
+	USHORT Columns,
+	USHORT Rows,
+	SHORT X,
+	SHORT Y
+)
+{
+	CALIBRATION_MESH_HEADER header = { Columns, Rows };
+	CALIBRATION_NODE node = { X, Y };
+	ULONG i;
+
+	RtlCopyMemory(gMesh, &header, sizeof(header));
+
+	for (i = 0; i < (ULONG)Columns * Rows; i++)
+	{
+		RtlCopyMemory(gMesh + sizeof(header) + i * sizeof(node), &node, sizeof(node));
+	}
+
+	return sizeof(header) + (ULONG)Columns * Rows * sizeof(node);
+}
+
+static
+VOID
+SetNode(
+	ULONG Columns,
+	ULONG Column,
+	ULONG Row,
+	SHORT X,
+	SHORT Y
+)
+{
+	CALIBRATION_NODE node = { X, Y };
+
+	RtlCopyMemory(
+		gMesh + sizeof(CALIBRATION_MESH_HEADER) + (Row * Columns + Column) * sizeof(node),
+		&node,
+		sizeof(node));
+}
+
+static
+VOID
+TestValidation(
+	VOID
+)
+{
+	CALIBRATION_CONTEXT context;
+	ULONG length;
+
+	CHECK(!CalibrationConfigure(&context, NULL, 0, WIDTH, HEIGHT));
+
+	length = BuildMesh(1, 3, 0, 0);
+	CHECK(!CalibrationConfigure(&context, gMesh, length, WIDTH, HEIGHT));
+
+	length = BuildMesh(CALIBRATION_MAX_NODES + 1, 3, 0, 0);
+	CHECK(!CalibrationConfigure(&context, gMesh, length, WIDTH, HEIGHT));
+
+	length = BuildMesh(3, 3, 0, 0);
+	CHECK(!CalibrationConfigure(&context, gMesh, length - 1, WIDTH, HEIGHT));
+	CHECK(!CalibrationConfigure(&context, gMesh, length, 0, HEIGHT));
+	CHECK(!context.Enabled);
+
+	CHECK(CalibrationConfigure(&context, gMesh, length, WIDTH, HEIGHT));
+	CHECK(context.Enabled);
+}
+
+static
+VOID
+TestUniformOffset(
+	VOID
+)
+{
+	CALIBRATION_CONTEXT context;
+	USHORT x, y;
+
+	//
+	// 3 pixels right and 2 up everywhere, Q4
+	//
+	CHECK(CalibrationConfigure(&context, gMesh, BuildMesh(5, 9, 3 << 4, -(2 << 4)), WIDTH, HEIGHT));
+
+	x = 700;
+	y = 1200;
+	CalibrationApply(&context, &x, &y);
+	CHECK_EQUAL(x, 703);
+	CHECK_EQUAL(y, 1198);
+
+	//
+	// Results stay on the display
+	//
+	x = WIDTH;
+	y = 0;
+	CalibrationApply(&context, &x, &y);
+	CHECK_EQUAL(x, WIDTH);
+	CHECK_EQUAL(y, 0);
+}
+
+static
+VOID
+TestInterpolation(
+	VOID
+)
+{
+	CALIBRATION_CONTEXT context;
+	ULONG length;
+	USHORT x, y;
+
+	//
+	// 2x2 mesh, only the right column moves by 8 pixels
+	//
+	length = BuildMesh(2, 2, 0, 0);
+	SetNode(2, 1, 0, 8 << 4, 0);
+	SetNode(2, 1, 1, 8 << 4, 0);
+
+	CHECK(CalibrationConfigure(&context, gMesh, length, WIDTH, HEIGHT));
+
+	x = 0;
+	y = 100;
+	CalibrationApply(&context, &x, &y);
+	CHECK_EQUAL(x, 0);
+
+	x = WIDTH / 2;
+	y = 100;
+	CalibrationApply(&context, &x, &y);
+	CHECK_NEAR(x, WIDTH / 2 + 4, 1);
+	CHECK_EQUAL(y, 100);
+
+	x = WIDTH - 8;
+	y = HEIGHT;
+	CalibrationApply(&context, &x, &y);
+	CHECK_EQUAL(x, WIDTH);
+}
+
+static
+VOID
+TestDisabled(
+	VOID
+)
+{
+	CALIBRATION_CONTEXT context;
+	USHORT x = 12, y = 34;
+
+	CalibrationConfigure(&context, NULL, 0, WIDTH, HEIGHT);
+	CalibrationApply(&context, &x, &y);
+
+	CHECK_EQUAL(x, 12);
+	CHECK_EQUAL(y, 34);
+}
+
+int
+main(
+	VOID
+)
+{
+	TestValidation();
+	TestUniformOffset();
+	TestInterpolation();
+	TestDisabled();
+
+	return TEST_RESULT();
+}
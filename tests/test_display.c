@@ -0,0 +1,552 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		test_display.c
+
+	Abstract:
+
+		Feeds random display off, on and dimmed sequences to the display
+		state machine, with off timer firings, rail completions and work
+		items run in between, and checks that a superseded display off
+		never reaches the rail, that the applied state settles on the
+		last requested one and that the cancelled and skipped counters
+		match the transitions avoided.
+
+	Environment:
+
+		User mode, host tests only
+
+	Revision History:
+
+--*/
+
+#include <hosttest.h>
+#include <display.h>
+
+static ULONG gSeed = 1;
+
+static
+ULONG
+Random(
+	ULONG Limit
+)
+{
+	gSeed = gSeed * 1103515245 + 12345;
+
+	return ((gSeed >> 8) % Limit);
+}
+
+//
+// Simulated device around the state machine, using the off timer, the
+// rail and the work item the way power.c does. Requested, OffPending,
+// Cancelled and Skipped are what the state machine is expected to have.
+//
+typedef struct _DEVICE
+{
+	TOUCH_DISPLAY_CONTEXT Display;
+
+	BOOLEAN TimerArmed;
+	BOOLEAN TimerFiring;
+	BOOLEAN RailInFlight;
+	BOOLEAN WorkQueued;
+	BOOLEAN Running;
+	NTSTATUS RailStatus;
+
+	LONG Requested;
+	BOOLEAN OffPending;
+	ULONG Cancelled;
+	ULONG Skipped;
+
+	ULONG Requests;
+	ULONG Toggles;
+	ULONG OffToggles;
+} DEVICE;
+
+static
+VOID
+Initialize(
+	OUT DEVICE* Device
+)
+{
+	RtlZeroMemory(Device, sizeof(DEVICE));
+
+	KeInitializeEvent(&Device->Display.Idle, NotificationEvent, TRUE);
+	KeInitializeSpinLock(&Device->Display.Lock);
+	TchDisplayReset(&Device->Display);
+
+	Device->Requested = TOUCH_DISPLAY_UNKNOWN;
+}
+
+//
+// Stands in for PowerToggle: the rail only ever sees the state last
+// requested, so a display off that was superseded never gets here
+//
+static
+VOID
+ToggleRail(
+	IN OUT DEVICE* Device,
+	IN LONG State
+)
+{
+	CHECK_EQUAL(State, Device->Requested);
+	CHECK(State != TOUCH_DISPLAY_OFF || !Device->OffPending);
+
+	Device->Toggles++;
+
+	if (State == TOUCH_DISPLAY_OFF)
+	{
+		Device->OffToggles++;
+	}
+
+	//
+	// Without touch power, or when the send failed, the toggle does not
+	// pend and the work item is queued right away
+	//
+	switch (Random(4))
+	{
+	case 0:
+		Device->RailStatus = STATUS_SUCCESS;
+		Device->WorkQueued = TRUE;
+		break;
+	case 1:
+		Device->RailStatus = STATUS_UNSUCCESSFUL;
+		Device->WorkQueued = TRUE;
+		break;
+	default:
+		Device->RailInFlight = TRUE;
+		break;
+	}
+}
+
+static
+VOID
+StartTransition(
+	IN OUT DEVICE* Device
+)
+{
+	PTOUCH_DISPLAY_CONTEXT display = &Device->Display;
+	BOOLEAN expected = FALSE;
+
+	//
+	// A transition running picks the request up when it ends, else a
+	// state found applied is skipped
+	//
+	if (!Device->Running)
+	{
+		if (Device->Requested == display->Applied)
+		{
+			Device->Skipped++;
+		}
+		else
+		{
+			expected = TRUE;
+		}
+	}
+
+	CHECK_EQUAL(TchDisplayBeginTransition(display), expected);
+
+	if (!expected)
+	{
+		return;
+	}
+
+	CHECK_EQUAL(KeReadStateEvent(&display->Idle), 0);
+
+	Device->Running = TRUE;
+	ToggleRail(Device, display->Target);
+}
+
+static
+VOID
+Request(
+	IN OUT DEVICE* Device,
+	IN LONG State
+)
+{
+	PTOUCH_DISPLAY_CONTEXT display = &Device->Display;
+	ULONG actions;
+
+	Device->Requests++;
+
+	if (State != TOUCH_DISPLAY_OFF && Device->OffPending)
+	{
+		Device->OffPending = FALSE;
+		Device->Cancelled++;
+	}
+
+	actions = TchDisplayRequest(display, State);
+
+	if (actions & TOUCH_DISPLAY_STOP_OFF_TIMER)
+	{
+		CHECK(Device->TimerArmed);
+
+		//
+		// The timer may have been firing already, it then still runs
+		//
+		Device->TimerArmed = FALSE;
+		Device->TimerFiring = Random(4) == 0;
+	}
+
+	if (State == TOUCH_DISPLAY_OFF && !Device->OffPending && Device->Requested != TOUCH_DISPLAY_OFF)
+	{
+		Device->OffPending = TRUE;
+		CHECK(actions & TOUCH_DISPLAY_START_OFF_TIMER);
+		Device->TimerArmed = TRUE;
+	}
+	else
+	{
+		CHECK(!(actions & TOUCH_DISPLAY_START_OFF_TIMER));
+	}
+
+	if (State == TOUCH_DISPLAY_ON)
+	{
+		Device->Requested = TOUCH_DISPLAY_ON;
+		CHECK(actions & TOUCH_DISPLAY_TRANSITION);
+		StartTransition(Device);
+	}
+	else
+	{
+		CHECK(!(actions & TOUCH_DISPLAY_TRANSITION));
+	}
+}
+
+static
+VOID
+FireTimer(
+	IN OUT DEVICE* Device
+)
+{
+	BOOLEAN start = TchDisplayOffTimer(&Device->Display);
+
+	//
+	// A timer stopped while firing finds its display off cancelled,
+	// unless another display off was requested meanwhile
+	//
+	CHECK_EQUAL(start, Device->OffPending);
+
+	if (start)
+	{
+		Device->OffPending = FALSE;
+		Device->TimerArmed = FALSE;
+		Device->Requested = TOUCH_DISPLAY_OFF;
+		StartTransition(Device);
+	}
+}
+
+static
+VOID
+CompleteRail(
+	IN OUT DEVICE* Device
+)
+{
+	Device->RailInFlight = FALSE;
+	Device->RailStatus = Random(8) == 0 ? STATUS_IO_TIMEOUT : STATUS_SUCCESS;
+	Device->WorkQueued = TRUE;
+}
+
+static
+VOID
+RunWorkItem(
+	IN OUT DEVICE* Device
+)
+{
+	PTOUCH_DISPLAY_CONTEXT display = &Device->Display;
+	ULONG transitions = display->Transitions;
+	ULONG failures = display->Failures;
+
+	Device->WorkQueued = FALSE;
+
+	TchDisplayEndTransition(display, Device->RailStatus);
+
+	CHECK_EQUAL(display->Applied, display->Target);
+	CHECK_EQUAL(display->Transitions, transitions + 1);
+	CHECK_EQUAL(display->Failures, failures + (NT_SUCCESS(Device->RailStatus) ? 0 : 1));
+
+	Device->Running = FALSE;
+
+	if (TchDisplayRelease(display))
+	{
+		CHECK(display->Requested != display->Applied);
+		StartTransition(Device);
+	}
+}
+
+//
+// Runs whatever is due until nothing is left to run
+//
+static
+VOID
+Settle(
+	IN OUT DEVICE* Device
+)
+{
+	for (;;)
+	{
+		if (Device->TimerFiring)
+		{
+			Device->TimerFiring = FALSE;
+			FireTimer(Device);
+		}
+		else if (Device->TimerArmed)
+		{
+			FireTimer(Device);
+		}
+		else if (Device->RailInFlight)
+		{
+			CompleteRail(Device);
+		}
+		else if (Device->WorkQueued)
+		{
+			RunWorkItem(Device);
+		}
+		else
+		{
+			break;
+		}
+	}
+}
+
+static
+VOID
+Check(
+	IN DEVICE* Device
+)
+{
+	PTOUCH_DISPLAY_CONTEXT display = &Device->Display;
+
+	CHECK_EQUAL(display->Requested, Device->Requested);
+	CHECK_EQUAL(display->OffPending, Device->OffPending);
+	CHECK_EQUAL(display->Cancelled, Device->Cancelled);
+	CHECK_EQUAL(display->Skipped, Device->Skipped);
+	CHECK_EQUAL(display->Transitions + (Device->Running ? 1 : 0), Device->Toggles);
+}
+
+static
+VOID
+TestDebounce(
+	VOID
+)
+{
+	DEVICE device;
+
+	Initialize(&device);
+
+	Request(&device, TOUCH_DISPLAY_ON);
+	Settle(&device);
+	CHECK_EQUAL(device.Display.Applied, TOUCH_DISPLAY_ON);
+
+	//
+	// Off and back on within the debounce time never reaches the rail
+	//
+	Request(&device, TOUCH_DISPLAY_OFF);
+	Request(&device, TOUCH_DISPLAY_ON);
+	Settle(&device);
+
+	CHECK_EQUAL(device.Display.Applied, TOUCH_DISPLAY_ON);
+	CHECK_EQUAL(device.Display.Cancelled, 1);
+	CHECK_EQUAL(device.Display.Skipped, 1);
+	CHECK_EQUAL(device.OffToggles, 0);
+
+	//
+	// Nor does off and dimmed
+	//
+	Request(&device, TOUCH_DISPLAY_OFF);
+	Request(&device, TOUCH_DISPLAY_DIMMED);
+	Settle(&device);
+
+	CHECK_EQUAL(device.Display.Applied, TOUCH_DISPLAY_ON);
+	CHECK_EQUAL(device.Display.Cancelled, 2);
+	CHECK_EQUAL(device.OffToggles, 0);
+
+	//
+	// Off held through the debounce time is applied, dimmed after it
+	// keeps it
+	//
+	Request(&device, TOUCH_DISPLAY_OFF);
+	FireTimer(&device);
+	Request(&device, TOUCH_DISPLAY_DIMMED);
+	Settle(&device);
+
+	CHECK_EQUAL(device.Display.Applied, TOUCH_DISPLAY_OFF);
+	CHECK_EQUAL(device.OffToggles, 1);
+	CHECK_EQUAL(device.Toggles, 2);
+
+	Check(&device);
+}
+
+static
+VOID
+TestSuperseded(
+	VOID
+)
+{
+	DEVICE device;
+
+	Initialize(&device);
+
+	//
+	// Off expires while the transition to on still toggles the rail, and
+	// on comes back before it ended: the off is never applied
+	//
+	Request(&device, TOUCH_DISPLAY_ON);
+	CHECK(device.RailInFlight || device.WorkQueued);
+
+	Request(&device, TOUCH_DISPLAY_OFF);
+	FireTimer(&device);
+	Request(&device, TOUCH_DISPLAY_ON);
+	Settle(&device);
+
+	CHECK_EQUAL(device.Display.Applied, TOUCH_DISPLAY_ON);
+	CHECK_EQUAL(device.Display.Transitions, 1);
+	CHECK_EQUAL(device.OffToggles, 0);
+
+	Check(&device);
+}
+
+static
+VOID
+TestStop(
+	VOID
+)
+{
+	DEVICE device;
+	KIRQL irql;
+
+	Initialize(&device);
+
+	Request(&device, TOUCH_DISPLAY_ON);
+	Settle(&device);
+	Request(&device, TOUCH_DISPLAY_OFF);
+
+	//
+	// A display off still debouncing is dropped on stop, and nothing is
+	// started or skipped afterwards
+	//
+	KeAcquireSpinLock(&device.Display.Lock, &irql);
+	TchDisplayStop(&device.Display);
+	KeReleaseSpinLock(&device.Display.Lock, irql);
+
+	CHECK(!TchDisplayOffTimer(&device.Display));
+	CHECK_EQUAL(TchDisplayRequest(&device.Display, TOUCH_DISPLAY_ON) & TOUCH_DISPLAY_TRANSITION, TOUCH_DISPLAY_TRANSITION);
+	CHECK(!TchDisplayBeginTransition(&device.Display));
+
+	CHECK_EQUAL(device.Display.Applied, TOUCH_DISPLAY_ON);
+	CHECK_EQUAL(device.Display.Skipped, 0);
+	CHECK_EQUAL(device.Display.Busy, FALSE);
+	CHECK_EQUAL(KeReadStateEvent(&device.Display.Idle), 1);
+}
+
+//
+// Random display state changes with timer firings, rail completions and
+// work items in between
+//
+static
+VOID
+TestRandom(
+	VOID
+)
+{
+	static const LONG states[] = { TOUCH_DISPLAY_OFF, TOUCH_DISPLAY_ON, TOUCH_DISPLAY_DIMMED };
+	const ULONG sequences = 20000;
+	DEVICE device;
+	LONG last;
+	ULONG requests = 0;
+	ULONG toggles = 0;
+	ULONG cancelled = 0;
+	ULONG skipped = 0;
+	ULONG i;
+	ULONG j;
+	ULONG events;
+
+	for (i = 0; i < sequences; i++)
+	{
+		Initialize(&device);
+
+		last = TOUCH_DISPLAY_UNKNOWN;
+		events = 1 + Random(40);
+
+		for (j = 0; j < events; j++)
+		{
+			switch (Random(7))
+			{
+			case 0:
+			case 1:
+			case 2:
+				Request(&device, states[Random(ARRAYSIZE(states))]);
+				break;
+			case 3:
+				if (device.TimerArmed || device.TimerFiring)
+				{
+					device.TimerFiring = FALSE;
+					FireTimer(&device);
+				}
+				break;
+			case 4:
+				if (device.RailInFlight)
+				{
+					CompleteRail(&device);
+				}
+				break;
+			default:
+				if (device.WorkQueued)
+				{
+					RunWorkItem(&device);
+				}
+				break;
+			}
+
+			Check(&device);
+		}
+
+		//
+		// The state last requested, a display off that was held or an on
+		//
+		if (Random(2) == 0)
+		{
+			last = states[Random(2)];
+			Request(&device, last);
+		}
+
+		Settle(&device);
+		Check(&device);
+
+		CHECK_EQUAL(device.Display.Applied, device.Requested);
+		CHECK_EQUAL(device.Display.Busy, FALSE);
+		CHECK_EQUAL(KeReadStateEvent(&device.Display.Idle), 1);
+
+		if (last != TOUCH_DISPLAY_UNKNOWN)
+		{
+			CHECK_EQUAL(device.Display.Applied, last);
+		}
+
+		requests += device.Requests;
+		toggles += device.Toggles;
+		cancelled += device.Display.Cancelled;
+		skipped += device.Display.Skipped;
+	}
+
+	printf("%lu sequences, %lu requests: %lu transitions, %lu display off cancelled, %lu skipped\n",
+		(unsigned long)sequences,
+		(unsigned long)requests,
+		(unsigned long)toggles,
+		(unsigned long)cancelled,
+		(unsigned long)skipped);
+
+	CHECK(cancelled > 0);
+	CHECK(skipped > 0);
+}
+
+int
+main(
+	VOID
+)
+{
+	TestDebounce();
+	TestSuperseded();
+	TestStop();
+	TestRandom();
+
+	return TEST_RESULT();
+}
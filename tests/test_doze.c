@@ -0,0 +1,429 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		test_doze.c
+
+	Abstract:
+
+		Runs the doze governor against a simulated controller that scans
+		frames while sensing: the holdoff, polled scan windows, doze
+		sequences, and the frames scanned while idle against the latency
+		of the first touch.
+
+	Environment:
+
+		User mode, host tests only
+
+	Revision History:
+
+--*/
+
+#include <hosttest.h>
+#include <hx85x/hxdoze.h>
+
+//
+// Full scan rate of the simulated controller, 120 Hz, and the time from
+// sense on to its first frame. Times in 100ns units.
+//
+#define FULL_RATE_PERIOD    83333
+#define SENSE_ON_TIME       20000
+
+//
+// Simulated controller. It scans a frame every Period while sensing, the
+// first SenseOnTime after sense on. Command 0xE0 sets the period in 10 ms
+// units as a doze sequence would, 0 restores the full rate.
+//
+typedef struct _CONTROLLER
+{
+	BOOLEAN Sensing;
+	ULONG64 SensingAt;
+	ULONG64 NextScan;
+	ULONG64 Period;
+	ULONG RateChanges;
+} CONTROLLER;
+
+static CONTROLLER gController;
+static SPB_CONTEXT gSpb;
+
+static
+NTSTATUS
+ControllerTransfer(
+	PVOID Context,
+	const UCHAR* Command,
+	ULONG CommandLength,
+	PUCHAR Data,
+	ULONG Length
+)
+{
+	CONTROLLER* controller = Context;
+	ULONG64 now = KeQueryInterruptTime();
+
+	if (Data == NULL)
+	{
+		switch (Command[0])
+		{
+		case 0x82:
+			controller->Sensing = FALSE;
+			break;
+
+		case 0x83:
+			if (!controller->Sensing)
+			{
+				controller->Sensing = TRUE;
+				controller->SensingAt = now + SENSE_ON_TIME;
+				controller->NextScan = controller->SensingAt;
+			}
+			break;
+
+		case 0xE0:
+			controller->Period = (CommandLength > 1 && Command[1] != 0) ?
+				Command[1] * 100000ULL : FULL_RATE_PERIOD;
+			controller->RateChanges++;
+			break;
+		}
+
+		return STATUS_SUCCESS;
+	}
+
+	RtlZeroMemory(Data, Length);
+
+	if (Command[0] == 0x63)
+	{
+		Data[0] = (controller->Sensing && now >= controller->SensingAt) ? 0x03 : 0x00;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+static
+VOID
+ResetController(
+	VOID
+)
+{
+	RtlZeroMemory(&gController, sizeof(gController));
+	gController.Sensing = TRUE;
+	gController.Period = FULL_RATE_PERIOD;
+	gController.NextScan = KeQueryInterruptTime() + FULL_RATE_PERIOD;
+
+	ShimResetSpb();
+	ShimSpb.Handler = ControllerTransfer;
+	ShimSpb.Context = &gController;
+	ShimSpb.TransferTime = 500;
+}
+
+typedef struct _SIMULATION
+{
+	ULONG64 IdleFrames;
+	ULONG64 Latency;
+} SIMULATION;
+
+static
+VOID
+Arm(
+	IN OUT HX85X_DOZE* Doze,
+	IN OUT PULONG64 TimerDue
+)
+{
+	ULONG timeout = Hx85xDozeArm(Doze);
+
+	if (timeout != 0)
+	{
+		*TimerDue = KeQueryInterruptTime() + timeout * 10000ULL;
+	}
+}
+
+//
+// The last contact lifts now and the next goes down TouchAfter later. The
+// doze timer is run when due, frames when scanned, until the first frame
+// with the contact was handed to the governor.
+//
+static
+VOID
+Simulate(
+	IN OUT HX85X_DOZE* Doze,
+	IN HX85X_SEQUENCE* Sequences,
+	IN ULONG64 TouchAfter,
+	OUT SIMULATION* Result
+)
+{
+	DETECTED_OBJECTS data;
+	ULONG64 touchTime;
+	ULONG64 timerDue = 0;
+	ULONG64 scan;
+
+	ResetController();
+	RtlZeroMemory(Result, sizeof(SIMULATION));
+
+	Hx85xDozeStart(Doze, KeQueryInterruptTime());
+	Arm(Doze, &timerDue);
+
+	touchTime = KeQueryInterruptTime() + TouchAfter;
+
+	for (;;)
+	{
+		scan = gController.Sensing ? gController.NextScan : MAXULONG64;
+
+		if (timerDue != 0 && timerDue <= scan)
+		{
+			ShimInterruptTime = max(ShimInterruptTime, timerDue);
+			timerDue = 0;
+
+			CHECK_EQUAL(Hx85xDozeTimer(Doze, Sequences, &gSpb, KeQueryInterruptTime(), FALSE), STATUS_SUCCESS);
+			Arm(Doze, &timerDue);
+
+			continue;
+		}
+
+		CHECK(scan != MAXULONG64);
+
+		if (scan == MAXULONG64)
+		{
+			return;
+		}
+
+		gController.NextScan = scan + gController.Period;
+
+		if (scan < touchTime)
+		{
+			//
+			// Frames without contact raise no interrupt
+			//
+			Result->IdleFrames++;
+			continue;
+		}
+
+		ShimInterruptTime = max(ShimInterruptTime, scan);
+
+		RtlZeroMemory(&data, sizeof(data));
+		data.States[0] = OBJECT_STATE_FINGER_PRESENT_WITH_ACCURATE_POS;
+		data.Timestamp = scan;
+
+		CHECK_EQUAL(Hx85xDozeTrackFrame(Doze, Sequences, &gSpb, &data), STATUS_SUCCESS);
+		Arm(Doze, &timerDue);
+
+		Result->Latency = scan - touchTime;
+		break;
+	}
+
+	//
+	// Back at full rate with the contact down
+	//
+	CHECK(!Doze->Dozing);
+	CHECK(Doze->Sensing);
+	CHECK(gController.Sensing);
+	CHECK_EQUAL(gController.Period, FULL_RATE_PERIOD);
+	CHECK_EQUAL(Doze->Entries, Doze->Exits);
+}
+
+static const HX85X_SEQUENCE_STEP gDozeEnter[] =
+{
+	{ HX85X_STEP_WRITE, 0, 2, 0, { 0xE0, 2 }, 0, { 0 }, 0 },
+};
+
+static const HX85X_SEQUENCE_STEP gDozeExit[] =
+{
+	{ HX85X_STEP_WRITE, 0, 2, 0, { 0xE0, 0 }, 0, { 0 }, 0 },
+};
+
+static
+VOID
+InitializeSequences(
+	OUT HX85X_SEQUENCE* Sequences,
+	IN BOOLEAN Doze
+)
+{
+	Hx85xInitializeSequences(Sequences);
+
+	if (Doze)
+	{
+		Sequences[HX85X_SEQUENCE_DOZE_ENTER].Steps = gDozeEnter;
+		Sequences[HX85X_SEQUENCE_DOZE_ENTER].Count = ARRAYSIZE(gDozeEnter);
+		Sequences[HX85X_SEQUENCE_DOZE_EXIT].Steps = gDozeExit;
+		Sequences[HX85X_SEQUENCE_DOZE_EXIT].Count = ARRAYSIZE(gDozeExit);
+	}
+}
+
+static
+VOID
+TestConfigure(
+	VOID
+)
+{
+	HX85X_SEQUENCE sequences[HX85X_SEQUENCE_COUNT];
+	HX85X_DOZE doze;
+
+	//
+	// Without doze sequences the governor polls, unless the interval or
+	// the holdoff is 0
+	//
+	InitializeSequences(sequences, FALSE);
+
+	Hx85xDozeConfigure(&doze, 4, 2, 10, sequences);
+	CHECK(doze.Polled);
+	CHECK_EQUAL(doze.Holdoff, 2000);
+	CHECK_EQUAL(doze.Interval, 20);
+	CHECK_EQUAL(doze.Window, 10);
+
+	Hx85xDozeConfigure(&doze, 4, 0, 10, sequences);
+	CHECK_EQUAL(doze.Holdoff, 0);
+
+	Hx85xDozeConfigure(&doze, 0, 2, 10, sequences);
+	CHECK_EQUAL(doze.Holdoff, 0);
+
+	InitializeSequences(sequences, TRUE);
+
+	Hx85xDozeConfigure(&doze, 4, 0, 0, sequences);
+	CHECK(!doze.Polled);
+	CHECK_EQUAL(doze.Holdoff, 2000);
+}
+
+static
+VOID
+TestHoldoff(
+	VOID
+)
+{
+	HX85X_SEQUENCE sequences[HX85X_SEQUENCE_COUNT];
+	HX85X_DOZE doze;
+	SIMULATION result;
+
+	InitializeSequences(sequences, FALSE);
+	Hx85xDozeConfigure(&doze, 2, 2, 10, sequences);
+
+	//
+	// A touch within the holdoff finds the controller at full rate
+	//
+	Simulate(&doze, sequences, 9000000, &result);
+
+	CHECK_EQUAL(doze.Entries, 0);
+	CHECK(result.Latency <= FULL_RATE_PERIOD);
+	CHECK_NEAR(result.IdleFrames, 9000000 / FULL_RATE_PERIOD, 1);
+
+	//
+	// One after it wakes the controller from doze
+	//
+	Simulate(&doze, sequences, 11000000, &result);
+
+	CHECK_EQUAL(doze.Entries, 1);
+	CHECK_EQUAL(doze.Exits, 1);
+	CHECK(doze.Scans > 0);
+}
+
+//
+// Frames scanned per idle minute against the first touch latency, for the
+// governor off, polled at several intervals and with doze sequences. The
+// touch goes down a minute after the last lift, at offsets spread over
+// 110 ms.
+//
+static
+VOID
+TestEnergyAgainstLatency(
+	VOID
+)
+{
+	static const struct
+	{
+		const char* Name;
+		BOOLEAN Sequences;
+		ULONG Holdoff;
+		ULONG Interval;
+		ULONG Threshold;
+	} configs[] =
+	{
+		{ "off", FALSE, 0, 2, 10 },
+		{ "polled 20ms", FALSE, 2, 2, 10 },
+		{ "polled 50ms", FALSE, 2, 5, 10 },
+		{ "polled 100ms", FALSE, 2, 10, 10 },
+		{ "polled 200ms", FALSE, 2, 20, 10 },
+		{ "sequences", TRUE, 2, 2, 10 },
+	};
+	const ULONG trials = 16;
+	HX85X_SEQUENCE sequences[HX85X_SEQUENCE_COUNT];
+	HX85X_DOZE doze;
+	SIMULATION result;
+	ULONG64 frames[ARRAYSIZE(configs)];
+	ULONG64 latency;
+	ULONG64 maxLatency;
+	ULONG64 bound;
+	ULONG i;
+	ULONG j;
+
+	printf("%-14s %14s %14s %14s\n", "doze", "frames/min", "mean lat ms", "max lat ms");
+
+	for (i = 0; i < ARRAYSIZE(configs); i++)
+	{
+		InitializeSequences(sequences, configs[i].Sequences);
+		Hx85xDozeConfigure(&doze, configs[i].Holdoff, configs[i].Interval, configs[i].Threshold, sequences);
+
+		frames[i] = 0;
+		latency = 0;
+		maxLatency = 0;
+
+		for (j = 0; j < trials; j++)
+		{
+			Simulate(&doze, sequences, 600000000 + j * 73000ULL, &result);
+
+			frames[i] += result.IdleFrames;
+			latency += result.Latency;
+			maxLatency = max(maxLatency, result.Latency);
+		}
+
+		frames[i] /= trials;
+
+		printf("%-14s %14llu %14.1f %14.1f\n",
+			configs[i].Name,
+			(unsigned long long)frames[i],
+			latency / (trials * 10000.0),
+			maxLatency / 10000.0);
+
+		//
+		// A touch is seen within a doze scan period, plus the sense on
+		// time and a frame when polled, plus a clock tick of slack
+		//
+		if (configs[i].Holdoff == 0)
+		{
+			bound = FULL_RATE_PERIOD;
+		}
+		else if (configs[i].Sequences)
+		{
+			bound = gDozeEnter[0].Data[1] * 100000ULL + 10000;
+		}
+		else
+		{
+			bound = configs[i].Interval * 100000ULL + SENSE_ON_TIME + FULL_RATE_PERIOD + 10000;
+		}
+
+		CHECK(maxLatency <= bound);
+
+		if (i != 0)
+		{
+			CHECK(frames[i] < frames[0]);
+		}
+	}
+
+	//
+	// The governor off scans at full rate throughout, longer intervals
+	// scan less
+	//
+	CHECK_NEAR(frames[0], (600000000 + (trials - 1) * 73000ULL / 2) / FULL_RATE_PERIOD, 2);
+
+	for (i = 2; i < ARRAYSIZE(configs) - 1; i++)
+	{
+		CHECK(frames[i] < frames[i - 1]);
+	}
+}
+
+int
+main(
+	VOID
+)
+{
+	TestConfigure();
+	TestHoldoff();
+	TestEnergyAgainstLatency();
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,229 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		test_filter.c
+
+	Abstract:
+
+		Tests the position filter and replays a resting and a moving
+		contact with noise through it, reporting the remaining jitter and
+		the lag by strength, and the cost per filtered contact.
+
+	Environment:
+
+		User mode, host tests only
+
+	Revision History:
+
+--*/
+
+#include <math.h>
+#include <time.h>
+#include <hosttest.h>
+#include <filter.h>
+
+//
+// 120 Hz scan, in 100us units
+//
+#define FRAME_TIME 83
+
+static
+LONG
+Noise(
+	PULONG Seed
+)
+{
+	*Seed = *Seed * 1103515245 + 12345;
+
+	return (LONG)((*Seed >> 16) % 9) - 4;
+}
+
+static
+VOID
+Replay(
+	ULONG Strength,
+	double* Jitter,
+	double* Lag
+)
+{
+	FILTER_CONTEXT context;
+	ULONG seed = 1;
+	double jitter = 0;
+	double lag = 0;
+	ULONG i;
+	LONG x, y;
+
+	//
+	// A finger resting at (500, 500), +-4 pixels of noise
+	//
+	FilterConfigure(&context, Strength);
+
+	for (i = 0; i < 240; i++)
+	{
+		x = 500 + Noise(&seed);
+		y = 500 + Noise(&seed);
+		FilterPosition(&context, &context.Slot[0], i * FRAME_TIME, &x, &y);
+
+		if (i >= 60)
+		{
+			jitter += hypot(x - 500, y - 500);
+		}
+	}
+
+	//
+	// Then a swipe at 2400 pixels per second, 20 per frame
+	//
+	FilterConfigure(&context, Strength);
+
+	for (i = 0; i < 60; i++)
+	{
+		x = 100 + 20 * (LONG)i + Noise(&seed);
+		y = 500 + Noise(&seed);
+		FilterPosition(&context, &context.Slot[0], i * FRAME_TIME, &x, &y);
+
+		if (i >= 10)
+		{
+			lag += (100 + 20 * (LONG)i) - x;
+		}
+	}
+
+	*Jitter = jitter / 180;
+	*Lag = lag / 50;
+}
+
+static
+VOID
+TestDisabled(
+	VOID
+)
+{
+	FILTER_CONTEXT context;
+	LONG x = 10, y = 20;
+
+	FilterConfigure(&context, 0);
+	CHECK(!context.Enabled);
+
+	FilterPosition(&context, &context.Slot[0], 0, &x, &y);
+	x = 30;
+	y = 40;
+	FilterPosition(&context, &context.Slot[0], FRAME_TIME, &x, &y);
+
+	CHECK_EQUAL(x, 30);
+	CHECK_EQUAL(y, 40);
+}
+
+static
+VOID
+TestFirstSampleAndGap(
+	VOID
+)
+{
+	FILTER_CONTEXT context;
+	LONG x = 100, y = 200;
+
+	FilterConfigure(&context, 1);
+
+	FilterPosition(&context, &context.Slot[0], 1000, &x, &y);
+	CHECK_EQUAL(x, 100);
+	CHECK_EQUAL(y, 200);
+
+	//
+	// A step within the gap is smoothed, after the gap it passes
+	//
+	x = 110;
+	y = 200;
+	FilterPosition(&context, &context.Slot[0], 1000 + FRAME_TIME, &x, &y);
+	CHECK(x > 100 && x < 110);
+
+	x = 300;
+	y = 300;
+	FilterPosition(&context, &context.Slot[0], 2000 + FILTER_MAX_SAMPLE_GAP, &x, &y);
+	CHECK_EQUAL(x, 300);
+	CHECK_EQUAL(y, 300);
+
+	//
+	// The same frame again keeps the filtered position
+	//
+	x = 320;
+	y = 300;
+	FilterPosition(&context, &context.Slot[0], 2000 + FILTER_MAX_SAMPLE_GAP, &x, &y);
+	CHECK_EQUAL(x, 300);
+}
+
+static
+VOID
+TestJitterAndLag(
+	VOID
+)
+{
+	static const ULONG strengths[] = { 0, 1, 2, 4, 8 };
+	double jitter[ARRAYSIZE(strengths)];
+	double lag[ARRAYSIZE(strengths)];
+	ULONG i;
+
+	printf("%-8s %10s %10s\n", "strength", "jitter px", "lag px");
+
+	for (i = 0; i < ARRAYSIZE(strengths); i++)
+	{
+		Replay(strengths[i], &jitter[i], &lag[i]);
+		printf("%-8lu %10.2f %10.2f\n", (unsigned long)strengths[i], jitter[i], lag[i]);
+	}
+
+	//
+	// Filtering reduces jitter more the stronger it is, and the speed
+	// term keeps the lag of a swipe to a few pixels
+	//
+	for (i = 1; i < ARRAYSIZE(strengths); i++)
+	{
+		CHECK(jitter[i] < jitter[i - 1]);
+		CHECK(lag[i] < 20);
+	}
+}
+
+static
+VOID
+Benchmark(
+	VOID
+)
+{
+	FILTER_CONTEXT context;
+	ULONG seed = 1;
+	ULONG frames = 200000;
+	ULONG i, slot;
+	LONG x, y;
+	clock_t start;
+	double elapsed;
+
+	FilterConfigure(&context, 2);
+
+	start = clock();
+
+	for (i = 0; i < frames; i++)
+	{
+		for (slot = 0; slot < 10; slot++)
+		{
+			x = 100 * (LONG)slot + (LONG)i % 1000 + Noise(&seed);
+			y = 1000 + Noise(&seed);
+			FilterPosition(&context, &context.Slot[slot], i * FRAME_TIME, &x, &y);
+		}
+	}
+
+	elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	printf("%.1f ns per contact\n", elapsed * 1e9 / (frames * 10.0));
+}
+
+int
+main(
+	VOID
+)
+{
+	TestDisabled();
+	TestFirstSampleAndGap();
+	TestJitterAndLag();
+	Benchmark();
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,485 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		test_gesture.c
+
+	Abstract:
+
+		Feeds synthetic tap sequences to the double tap detector, at full
+		rate and through polled doze scan windows of a simulated
+		controller, and measures the frames scanned per hour while armed
+		and idle.
+
+	Environment:
+
+		User mode, host tests only
+
+	Revision History:
+
+--*/
+
+#include <hosttest.h>
+#include <hx85x/hxgesture.h>
+
+//
+// Full scan rate of the simulated controller, 120 Hz, and the time from
+// sense on to its first frame. Times in 100ns units.
+//
+#define FULL_RATE_PERIOD    83333
+#define SENSE_ON_TIME       20000
+
+//
+// A 1440x2560 panel of 62x110 mm
+//
+#define PANEL_WIDTH         1440
+#define PANEL_HEIGHT        2560
+
+//
+// Contacts down from Down to Up, in milliseconds from the start
+//
+typedef struct _SEGMENT
+{
+	ULONG Down;
+	ULONG Up;
+	LONG X;
+	LONG Y;
+	ULONG Fingers;
+} SEGMENT;
+
+//
+// Simulated controller. It scans a frame every FULL_RATE_PERIOD while
+// sensing, and raises an interrupt for frames with contacts and for the
+// first frame after they lifted.
+//
+typedef struct _CONTROLLER
+{
+	BOOLEAN Sensing;
+	ULONG64 SensingAt;
+	ULONG64 NextScan;
+	BOOLEAN Contact;
+	ULONG64 Scans;
+} CONTROLLER;
+
+static CONTROLLER gController;
+static SPB_CONTEXT gSpb;
+static TOUCH_SCREEN_PROPERTIES gProps;
+
+static
+NTSTATUS
+ControllerTransfer(
+	PVOID Context,
+	const UCHAR* Command,
+	ULONG CommandLength,
+	PUCHAR Data,
+	ULONG Length
+)
+{
+	CONTROLLER* controller = Context;
+	ULONG64 now = KeQueryInterruptTime();
+
+	UNREFERENCED_PARAMETER(CommandLength);
+
+	if (Data == NULL)
+	{
+		if (Command[0] == 0x82)
+		{
+			controller->Sensing = FALSE;
+			controller->Contact = FALSE;
+		}
+		else if (Command[0] == 0x83 && !controller->Sensing)
+		{
+			controller->Sensing = TRUE;
+			controller->SensingAt = now + SENSE_ON_TIME;
+			controller->NextScan = controller->SensingAt;
+		}
+
+		return STATUS_SUCCESS;
+	}
+
+	RtlZeroMemory(Data, Length);
+
+	if (Command[0] == 0x63)
+	{
+		Data[0] = (controller->Sensing && now >= controller->SensingAt) ? 0x03 : 0x00;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+static
+VOID
+Configure(
+	OUT HX85X_GESTURE* Gesture,
+	OUT HX85X_DOZE* Doze,
+	OUT HX85X_SEQUENCE* Sequences,
+	IN ULONG Interval
+)
+{
+	TOUCH_SCREEN_SETTINGS settings;
+
+	RtlZeroMemory(&settings, sizeof(settings));
+	settings.DoubleTapMaxTapTime10ms = 40;
+	settings.DoubleTapMaxTapDistance100um = 100;
+	settings.DoubleTapDeadZoneWidth100um = 30;
+	settings.DoubleTapDeadZoneHeight100um = 30;
+
+	RtlZeroMemory(&gProps, sizeof(gProps));
+	gProps.TouchPhysicalWidth = PANEL_WIDTH;
+	gProps.TouchPhysicalHeight = PANEL_HEIGHT;
+	gProps.DisplayWidth10um = 6200;
+	gProps.DisplayHeight10um = 11000;
+
+	//
+	// Without doze sequences, polled every Interval (10 ms units), or at
+	// full rate with an interval of 0. The holdoff is left at its default
+	// of 0, the gesture polls whether or not idle doze is enabled.
+	//
+	Hx85xInitializeSequences(Sequences);
+	Hx85xDozeConfigure(Doze, 0, Interval, 10, Sequences);
+	Hx85xGestureConfigure(Gesture, &settings);
+}
+
+static
+VOID
+Arm(
+	IN OUT HX85X_DOZE* Doze,
+	IN OUT PULONG64 TimerDue
+)
+{
+	ULONG timeout = Hx85xDozeArm(Doze);
+
+	if (timeout != 0)
+	{
+		*TimerDue = KeQueryInterruptTime() + timeout * 10000ULL;
+	}
+}
+
+//
+// Arms the detector with the display going off now and runs the
+// controller for Duration milliseconds with the contacts of Segments.
+// Frames the controller interrupts for are handed to the detector, as
+// the interrupt path does while it is armed.
+//
+static
+ULONG
+Run(
+	IN OUT HX85X_GESTURE* Gesture,
+	IN OUT HX85X_DOZE* Doze,
+	IN HX85X_SEQUENCE* Sequences,
+	IN const SEGMENT* Segments,
+	IN ULONG Count,
+	IN ULONG Duration
+)
+{
+	DETECTED_OBJECTS data;
+	ULONG64 start;
+	ULONG64 end;
+	ULONG64 timerDue = 0;
+	ULONG64 scan;
+	ULONG64 ms;
+	ULONG matches = 0;
+	ULONG i;
+	ULONG j;
+	ULONG k;
+
+	RtlZeroMemory(&gController, sizeof(gController));
+	gController.Sensing = TRUE;
+	gController.NextScan = KeQueryInterruptTime() + FULL_RATE_PERIOD;
+
+	ShimResetSpb();
+	ShimSpb.Handler = ControllerTransfer;
+	ShimSpb.Context = &gController;
+	ShimSpb.TransferTime = 500;
+
+	start = KeQueryInterruptTime();
+	end = start + Duration * 10000ULL;
+
+	CHECK_EQUAL(Hx85xGestureStart(Gesture, Doze, Sequences, &gSpb, start), STATUS_SUCCESS);
+	Arm(Doze, &timerDue);
+
+	for (;;)
+	{
+		scan = gController.Sensing ? gController.NextScan : MAXULONG64;
+
+		if (timerDue != 0 && timerDue <= scan)
+		{
+			if (timerDue >= end)
+			{
+				break;
+			}
+
+			ShimInterruptTime = max(ShimInterruptTime, timerDue);
+			timerDue = 0;
+
+			CHECK_EQUAL(
+				Hx85xDozeTimer(
+					Doze,
+					Sequences,
+					&gSpb,
+					KeQueryInterruptTime(),
+					Hx85xGestureHoldScan(Gesture, KeQueryInterruptTime())),
+				STATUS_SUCCESS);
+
+			Arm(Doze, &timerDue);
+
+			continue;
+		}
+
+		if (scan >= end)
+		{
+			break;
+		}
+
+		gController.NextScan = scan + FULL_RATE_PERIOD;
+		gController.Scans++;
+
+		RtlZeroMemory(&data, sizeof(data));
+		data.Timestamp = scan;
+		ms = (scan - start) / 10000;
+		k = 0;
+
+		for (i = 0; i < Count; i++)
+		{
+			if (ms >= Segments[i].Down && ms < Segments[i].Up)
+			{
+				for (j = 0; j < Segments[i].Fingers; j++, k++)
+				{
+					data.States[k] = OBJECT_STATE_FINGER_PRESENT_WITH_ACCURATE_POS;
+					data.Positions[k].X = Segments[i].X + j * 200;
+					data.Positions[k].Y = Segments[i].Y;
+				}
+			}
+		}
+
+		if (k == 0 && !gController.Contact)
+		{
+			continue;
+		}
+
+		gController.Contact = k != 0;
+
+		ShimInterruptTime = max(ShimInterruptTime, scan);
+
+		if (Hx85xGestureTrackFrame(Gesture, &gProps, &data))
+		{
+			matches++;
+		}
+	}
+
+	ShimInterruptTime = max(ShimInterruptTime, end);
+
+	CHECK_EQUAL(Hx85xGestureStop(Gesture, Doze, Sequences, &gSpb, KeQueryInterruptTime()), STATUS_SUCCESS);
+
+	//
+	// Sensing at full rate again with the display on
+	//
+	CHECK(!Doze->Dozing);
+	CHECK(gController.Sensing);
+
+	return matches;
+}
+
+static
+ULONG
+RunAtFullRate(
+	IN const SEGMENT* Segments,
+	IN ULONG Count
+)
+{
+	HX85X_SEQUENCE sequences[HX85X_SEQUENCE_COUNT];
+	HX85X_GESTURE gesture;
+	HX85X_DOZE doze;
+
+	Configure(&gesture, &doze, sequences, 0);
+
+	return Run(&gesture, &doze, sequences, Segments, Count, Segments[Count - 1].Up + 1000);
+}
+
+static
+VOID
+TestDoubleTap(
+	VOID
+)
+{
+	static const SEGMENT taps[] =
+	{
+		{ 100, 180, 720, 1280, 1 },
+		{ 300, 380, 740, 1290, 1 },
+	};
+	static const SEGMENT twice[] =
+	{
+		{ 100, 180, 720, 1280, 1 },
+		{ 300, 380, 740, 1290, 1 },
+		{ 1500, 1560, 400, 600, 1 },
+		{ 1700, 1760, 410, 610, 1 },
+	};
+
+	CHECK_EQUAL(RunAtFullRate(taps, ARRAYSIZE(taps)), 1);
+	CHECK_EQUAL(RunAtFullRate(twice, ARRAYSIZE(twice)), 2);
+}
+
+static
+VOID
+TestRejected(
+	VOID
+)
+{
+	//
+	// First tap held too long
+	//
+	static const SEGMENT held[] =
+	{
+		{ 100, 600, 720, 1280, 1 },
+		{ 700, 780, 720, 1280, 1 },
+	};
+
+	//
+	// Second tap too late
+	//
+	static const SEGMENT late[] =
+	{
+		{ 100, 180, 720, 1280, 1 },
+		{ 700, 780, 720, 1280, 1 },
+	};
+
+	//
+	// Second tap 17 mm from the first
+	//
+	static const SEGMENT far[] =
+	{
+		{ 100, 180, 720, 1280, 1 },
+		{ 300, 380, 1120, 1280, 1 },
+	};
+
+	//
+	// Two fingers
+	//
+	static const SEGMENT fingers[] =
+	{
+		{ 100, 180, 720, 1280, 2 },
+		{ 300, 380, 720, 1280, 2 },
+	};
+
+	//
+	// Within 3 mm of the left edge
+	//
+	static const SEGMENT edge[] =
+	{
+		{ 100, 180, 20, 1280, 1 },
+		{ 300, 380, 20, 1280, 1 },
+	};
+
+	//
+	// A late second tap starts the next double tap
+	//
+	static const SEGMENT restart[] =
+	{
+		{ 100, 180, 720, 1280, 1 },
+		{ 700, 780, 720, 1280, 1 },
+		{ 900, 980, 720, 1280, 1 },
+	};
+
+	CHECK_EQUAL(RunAtFullRate(held, ARRAYSIZE(held)), 0);
+	CHECK_EQUAL(RunAtFullRate(late, ARRAYSIZE(late)), 0);
+	CHECK_EQUAL(RunAtFullRate(far, ARRAYSIZE(far)), 0);
+	CHECK_EQUAL(RunAtFullRate(fingers, ARRAYSIZE(fingers)), 0);
+	CHECK_EQUAL(RunAtFullRate(edge, ARRAYSIZE(edge)), 0);
+	CHECK_EQUAL(RunAtFullRate(restart, ARRAYSIZE(restart)), 1);
+}
+
+//
+// Double taps at offsets spread over 200 ms, detected through polled doze
+// scan windows at several intervals, and the frames scanned and processed
+// per hour while armed without contact
+//
+static
+VOID
+TestPolled(
+	VOID
+)
+{
+	static const ULONG intervals[] = { 0, 2, 5, 10, 20 };
+	const ULONG trials = 20;
+	HX85X_SEQUENCE sequences[HX85X_SEQUENCE_COUNT];
+	HX85X_GESTURE gesture;
+	HX85X_DOZE doze;
+	SEGMENT taps[2];
+	ULONG64 scans;
+	ULONG64 frames;
+	ULONG detected;
+	ULONG i;
+	ULONG j;
+
+	printf("%10s %10s %16s %16s\n", "interval", "detected", "scanned/hour", "processed/hour");
+
+	for (i = 0; i < ARRAYSIZE(intervals); i++)
+	{
+		detected = 0;
+
+		for (j = 0; j < trials; j++)
+		{
+			taps[0].Down = 5000 + j * 10;
+			taps[0].Up = taps[0].Down + 80;
+			taps[1].Down = taps[0].Up + 120;
+			taps[1].Up = taps[1].Down + 80;
+			taps[0].X = taps[1].X = 720;
+			taps[0].Y = taps[1].Y = 1280;
+			taps[0].Fingers = taps[1].Fingers = 1;
+
+			Configure(&gesture, &doze, sequences, intervals[i]);
+			detected += Run(&gesture, &doze, sequences, taps, ARRAYSIZE(taps), taps[1].Up + 1000);
+		}
+
+		//
+		// Ten idle minutes
+		//
+		Configure(&gesture, &doze, sequences, intervals[i]);
+		Run(&gesture, &doze, sequences, NULL, 0, 600000);
+
+		scans = gController.Scans * 6;
+		frames = gesture.Frames * 6;
+
+		printf("%7lu ms %7lu/%lu %16llu %16llu\n",
+			(unsigned long)intervals[i] * 10,
+			(unsigned long)detected,
+			(unsigned long)trials,
+			(unsigned long long)scans,
+			(unsigned long long)frames);
+
+		//
+		// Nothing is processed without contact, polling scans less than
+		// the full rate. At the default 20 ms every double tap is seen.
+		//
+		CHECK_EQUAL(frames, 0);
+
+		if (intervals[i] == 0)
+		{
+			CHECK_NEAR(scans, 3600ULL * 10000000 / FULL_RATE_PERIOD, 6);
+			CHECK_EQUAL(detected, trials);
+		}
+		else
+		{
+			CHECK(scans < 3600ULL * 10000000 / FULL_RATE_PERIOD);
+			CHECK(doze.Scans > 0);
+		}
+
+		if (intervals[i] == 2)
+		{
+			CHECK_EQUAL(detected, trials);
+		}
+	}
+}
+
+int
+main(
+	VOID
+)
+{
+	TestDoubleTap();
+	TestRejected();
+	TestPolled();
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,157 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		test_meshfit.c
+
+	Abstract:
+
+		Fits a mesh to a synthetic distortion with tools/meshfit.c and
+		checks that the driver, given the encoded value, moves measured
+		positions back onto their targets
+
+	Environment:
+
+		User mode, host tests only
+
+	Revision History:
+
+--*/
+
+#include <math.h>
+#include <hosttest.h>
+#include <calibration.h>
+#include <meshfit.h>
+
+#define WIDTH   720
+#define HEIGHT  1280
+#define COLUMNS 9
+#define ROWS    13
+
+static MESHFIT_SAMPLE gSamples[32 * 32];
+static short gOffsets[CALIBRATION_MAX_NODES * CALIBRATION_MAX_NODES * 2];
+static UCHAR gMesh[CALIBRATION_MESH_MAX_SIZE];
+
+static
+VOID
+Distort(
+	double X,
+	double Y,
+	double* MeasuredX,
+	double* MeasuredY
+)
+{
+	//
+	// Bowed towards the middle, sheared and pulled off at the bottom
+	//
+	*MeasuredX = X + 6 * sin(3.14159265 * X / WIDTH) + 4 * Y / HEIGHT;
+	*MeasuredY = Y - 8 * (Y / HEIGHT) * (Y / HEIGHT) + 3 * cos(3.14159265 * X / WIDTH);
+}
+
+static
+double
+Residual(
+	const CALIBRATION_CONTEXT* Context,
+	ULONG Count
+)
+{
+	double sum = 0;
+	USHORT x, y;
+	ULONG i;
+
+	for (i = 0; i < Count; i++)
+	{
+		x = (USHORT)floor(gSamples[i].MeasuredX + 0.5);
+		y = (USHORT)floor(gSamples[i].MeasuredY + 0.5);
+
+		if (Context != NULL)
+		{
+			CalibrationApply(Context, &x, &y);
+		}
+
+		sum += (x - gSamples[i].TargetX) * (x - gSamples[i].TargetX) +
+			(y - gSamples[i].TargetY) * (y - gSamples[i].TargetY);
+	}
+
+	return sqrt(sum / Count);
+}
+
+static
+VOID
+TestFit(
+	VOID
+)
+{
+	CALIBRATION_CONTEXT context;
+	ULONG count = 0;
+	ULONG i, j;
+	size_t length;
+	double before, after;
+
+	//
+	// Targets in a 20x30 grid, kept off the very edges like a
+	// calibration screen would
+	//
+	for (j = 0; j < 30; j++)
+	{
+		for (i = 0; i < 20; i++)
+		{
+			gSamples[count].TargetX = 10 + i * (WIDTH - 20) / 19.0;
+			gSamples[count].TargetY = 10 + j * (HEIGHT - 20) / 29.0;
+
+			Distort(
+				gSamples[count].TargetX,
+				gSamples[count].TargetY,
+				&gSamples[count].MeasuredX,
+				&gSamples[count].MeasuredY);
+
+			count++;
+		}
+	}
+
+	CHECK_EQUAL(MeshFit(gSamples, count, WIDTH, HEIGHT, COLUMNS, ROWS, 0.5, gOffsets), 0);
+
+	length = MeshFitEncode(gOffsets, COLUMNS, ROWS, gMesh, sizeof(gMesh));
+
+	CHECK_EQUAL(length, sizeof(CALIBRATION_MESH_HEADER) + COLUMNS * ROWS * sizeof(CALIBRATION_NODE));
+	CHECK(CalibrationConfigure(&context, gMesh, (ULONG)length, WIDTH, HEIGHT));
+
+	before = Residual(NULL, count);
+	after = Residual(&context, count);
+
+	printf("rms error %.2f px before, %.2f px after\n", before, after);
+
+	CHECK(after < 1.0);
+	CHECK(after < before / 4);
+}
+
+static
+VOID
+TestInvalid(
+	VOID
+)
+{
+	CHECK(MeshFit(gSamples, 0, WIDTH, HEIGHT, 1, ROWS, 0.5, gOffsets) != 0);
+	CHECK(MeshFit(gSamples, 0, WIDTH, HEIGHT, COLUMNS, CALIBRATION_MAX_NODES + 1, 0.5, gOffsets) != 0);
+	CHECK(MeshFit(gSamples, 0, 0, HEIGHT, COLUMNS, ROWS, 0.5, gOffsets) != 0);
+	CHECK_EQUAL(MeshFitEncode(gOffsets, COLUMNS, ROWS, gMesh, 8), 0);
+
+	//
+	// Without samples the mesh stays flat
+	//
+	CHECK_EQUAL(MeshFit(gSamples, 0, WIDTH, HEIGHT, 3, 3, 0.5, gOffsets), 0);
+	CHECK_EQUAL(gOffsets[0], 0);
+	CHECK_EQUAL(gOffsets[17], 0);
+}
+
+int
+main(
+	VOID
+)
+{
+	TestFit();
+	TestInvalid();
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,285 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		test_predict.c
+
+	Abstract:
+
+		Tests the contact position predictor and evaluates it: synthetic
+		traces are replayed at the scan rate and the error of the
+		predicted position against the true future one is reported by
+		horizon, next to the error of not predicting at all.
+
+	Environment:
+
+		User mode, host tests only
+
+	Revision History:
+
+--*/
+
+#include <math.h>
+#include <hosttest.h>
+#include <predict.h>
+
+//
+// 120 Hz scan, in 100us units
+//
+#define FRAME_TIME 83
+
+typedef VOID (*TRACE_FUNCTION)(ULONG Time, PLONG X, PLONG Y);
+
+static
+VOID
+TraceLine(
+	ULONG Time,
+	PLONG X,
+	PLONG Y
+)
+{
+	*X = 100 + (LONG)(Time * 3 / 20);
+	*Y = 2000 - (LONG)(Time / 10);
+}
+
+static
+VOID
+TraceFling(
+	ULONG Time,
+	PLONG X,
+	PLONG Y
+)
+{
+	double t = Time / 10000.0;
+
+	//
+	// Decelerating from 4000 to 0 px/s over half a second
+	//
+	t = t > 0.5 ? 0.5 : t;
+
+	*X = 200;
+	*Y = 2400 - (LONG)(4000 * t - 4000 * t * t);
+}
+
+static
+VOID
+TraceCircle(
+	ULONG Time,
+	PLONG X,
+	PLONG Y
+)
+{
+	double angle = Time / 10000.0 * 2 * 3.14159265358979;
+
+	*X = 720 + (LONG)(300 * cos(angle));
+	*Y = 1280 + (LONG)(300 * sin(angle));
+}
+
+static
+VOID
+Evaluate(
+	const char* Name,
+	TRACE_FUNCTION Trace,
+	ULONG Duration,
+	ULONG Horizon,
+	double* PredictedError,
+	double* HeldError
+)
+{
+	PREDICT_SLOT slot;
+	double predicted = 0;
+	double held = 0;
+	ULONG frames = 0;
+	ULONG time;
+	LONG x, y, futureX, futureY, px, py;
+
+	UNREFERENCED_PARAMETER(Name);
+
+	PredictResetSlot(&slot);
+
+	for (time = 0; time + Horizon <= Duration; time += FRAME_TIME)
+	{
+		Trace(time, &x, &y);
+		Trace(time + Horizon, &futureX, &futureY);
+
+		PredictAddSample(&slot, x, y, time);
+
+		px = x;
+		py = y;
+		PredictPosition(&slot, Horizon, &px, &py);
+
+		predicted += hypot(px - futureX, py - futureY);
+		held += hypot(x - futureX, y - futureY);
+		frames++;
+	}
+
+	*PredictedError = predicted / frames;
+	*HeldError = held / frames;
+}
+
+static
+VOID
+TestSingleSample(
+	VOID
+)
+{
+	PREDICT_SLOT slot;
+	LONG x = 10, y = 20;
+
+	PredictResetSlot(&slot);
+	PredictAddSample(&slot, 10, 20, 1000);
+	PredictPosition(&slot, 160, &x, &y);
+
+	CHECK_EQUAL(x, 10);
+	CHECK_EQUAL(y, 20);
+}
+
+static
+VOID
+TestConstantVelocity(
+	VOID
+)
+{
+	PREDICT_SLOT slot;
+	ULONG i;
+	LONG x, y;
+
+	PredictResetSlot(&slot);
+
+	for (i = 0; i < 5; i++)
+	{
+		PredictAddSample(&slot, 100 + 10 * i, 500 - 5 * i, 1000 + FRAME_TIME * i);
+	}
+
+	x = 140;
+	y = 480;
+	PredictPosition(&slot, FRAME_TIME, &x, &y);
+
+	CHECK_NEAR(x, 150, 1);
+	CHECK_NEAR(y, 475, 1);
+
+	x = 140;
+	y = 480;
+	PredictPosition(&slot, 0, &x, &y);
+
+	CHECK_EQUAL(x, 140);
+	CHECK_EQUAL(y, 480);
+}
+
+static
+VOID
+TestReversal(
+	VOID
+)
+{
+	PREDICT_SLOT slot;
+	LONG x = 100, y = 100;
+
+	PredictResetSlot(&slot);
+	PredictAddSample(&slot, 100, 100, 0);
+	PredictAddSample(&slot, 130, 100, FRAME_TIME);
+	PredictAddSample(&slot, 100, 100, 2 * FRAME_TIME);
+
+	PredictPosition(&slot, 2 * FRAME_TIME, &x, &y);
+
+	CHECK_EQUAL(slot.VelocityX, 0);
+	CHECK_EQUAL(x, 100);
+	CHECK_EQUAL(y, 100);
+}
+
+static
+VOID
+TestGapAndRepeat(
+	VOID
+)
+{
+	PREDICT_SLOT slot;
+	LONG x, y;
+
+	PredictResetSlot(&slot);
+	PredictAddSample(&slot, 0, 0, 0);
+	PredictAddSample(&slot, 10, 0, FRAME_TIME);
+
+	//
+	// The same frame again only refreshes the position
+	//
+	PredictAddSample(&slot, 12, 0, FRAME_TIME);
+
+	CHECK_EQUAL(slot.Count, 2);
+	CHECK_EQUAL(slot.History[0].X, 12);
+
+	//
+	// A gap longer than the limit starts over
+	//
+	PredictAddSample(&slot, 500, 0, FRAME_TIME + PREDICT_MAX_SAMPLE_GAP + 1);
+
+	CHECK_EQUAL(slot.Count, 1);
+
+	x = 500;
+	y = 0;
+	PredictPosition(&slot, FRAME_TIME, &x, &y);
+
+	CHECK_EQUAL(x, 500);
+}
+
+static
+VOID
+TestHorizons(
+	VOID
+)
+{
+	static const struct
+	{
+		const char* Name;
+		TRACE_FUNCTION Trace;
+	} traces[] =
+	{
+		{ "line", TraceLine },
+		{ "fling", TraceFling },
+		{ "circle", TraceCircle },
+	};
+	static const ULONG horizons[] = { 0, 40, 80, 160, 250, 330, 500 };
+	double predicted;
+	double held;
+	ULONG i, j;
+
+	printf("%-8s %8s %12s %12s\n", "trace", "horizon", "predicted px", "held px");
+
+	for (i = 0; i < ARRAYSIZE(traces); i++)
+	{
+		for (j = 0; j < ARRAYSIZE(horizons); j++)
+		{
+			Evaluate(traces[i].Name, traces[i].Trace, 10000, horizons[j], &predicted, &held);
+
+			printf("%-8s %6.1fms %12.2f %12.2f\n",
+				traces[i].Name,
+				horizons[j] / 10.0,
+				predicted,
+				held);
+
+			//
+			// Up to the usual scan to display latency prediction must
+			// beat showing the last position
+			//
+			if (horizons[j] != 0 && horizons[j] <= 250)
+			{
+				CHECK(predicted < held);
+			}
+		}
+	}
+}
+
+int
+main(
+	VOID
+)
+{
+	TestSingleSample();
+	TestConstantVelocity();
+	TestReversal();
+	TestGapAndRepeat();
+	TestHorizons();
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,376 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		test_sequence.c
+
+	Abstract:
+
+		Runs the controller sequences against a simulated controller: step
+		semantics, polling bounds, sequences replaced from configuration,
+		and the time from power on to sensing.
+
+	Environment:
+
+		User mode, host tests only
+
+	Revision History:
+
+--*/
+
+#include <hosttest.h>
+#include <hx85x/hxsequence.h>
+
+//
+// Simulated controller. It does not answer for PowerOnTime after the IC
+// power on command, then reads back its chip ID, and reports sensing
+// SenseOnTime after sense on. Times in 100ns units.
+//
+typedef struct _CONTROLLER
+{
+	ULONG64 PowerOnTime;
+	ULONG64 SenseOnTime;
+	ULONG64 PoweredAt;
+	ULONG64 SensingAt;
+	BOOLEAN Powered;
+	BOOLEAN Sensing;
+	UCHAR Commands[32];
+	ULONG CommandCount;
+	UCHAR FailCommand;
+} CONTROLLER;
+
+static CONTROLLER gController;
+static SPB_CONTEXT gSpb;
+
+static
+NTSTATUS
+ControllerTransfer(
+	PVOID Context,
+	const UCHAR* Command,
+	ULONG CommandLength,
+	PUCHAR Data,
+	ULONG Length
+)
+{
+	CONTROLLER* controller = Context;
+	ULONG64 now = KeQueryInterruptTime();
+
+	UNREFERENCED_PARAMETER(CommandLength);
+
+	if (controller->Powered && now < controller->PoweredAt)
+	{
+		return STATUS_DEVICE_PROTOCOL_ERROR;
+	}
+
+	if (Data == NULL)
+	{
+		if (Command[0] == controller->FailCommand)
+		{
+			return STATUS_DEVICE_PROTOCOL_ERROR;
+		}
+
+		if (controller->CommandCount < ARRAYSIZE(controller->Commands))
+		{
+			controller->Commands[controller->CommandCount++] = Command[0];
+		}
+
+		switch (Command[0])
+		{
+		case 0x81:
+			controller->Powered = TRUE;
+			controller->PoweredAt = now + controller->PowerOnTime;
+			break;
+
+		case 0x82:
+			controller->Sensing = FALSE;
+			break;
+
+		case 0x83:
+			controller->Sensing = TRUE;
+			controller->SensingAt = now + controller->SenseOnTime;
+			break;
+		}
+
+		return STATUS_SUCCESS;
+	}
+
+	RtlZeroMemory(Data, Length);
+
+	if (Command[0] == 0x31)
+	{
+		Data[0] = 0x85;
+		Data[1] = 0x26;
+	}
+	else if (Command[0] == 0x63)
+	{
+		Data[0] = (controller->Sensing && now >= controller->SensingAt) ? 0x03 : 0x00;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+static
+VOID
+ResetController(
+	ULONG64 PowerOnTime,
+	ULONG64 SenseOnTime
+)
+{
+	RtlZeroMemory(&gController, sizeof(gController));
+	gController.PowerOnTime = PowerOnTime;
+	gController.SenseOnTime = SenseOnTime;
+
+	ShimResetSpb();
+	ShimSpb.Handler = ControllerTransfer;
+	ShimSpb.Context = &gController;
+	ShimSpb.TransferTime = 500;
+}
+
+static
+VOID
+TestInitSequence(
+	VOID
+)
+{
+	static const UCHAR expected[] = { 0x81, 0x35, 0x36, 0xDD };
+	HX85X_SEQUENCE sequences[HX85X_SEQUENCE_COUNT];
+	NTSTATUS status;
+	ULONG i;
+
+	ResetController(0, 0);
+	Hx85xInitializeSequences(sequences);
+
+	status = Hx85xRunSequence(sequences, HX85X_SEQUENCE_INIT_8526, &gSpb);
+
+	CHECK_EQUAL(status, STATUS_SUCCESS);
+	CHECK_EQUAL(gController.CommandCount, ARRAYSIZE(expected));
+
+	for (i = 0; i < ARRAYSIZE(expected); i++)
+	{
+		CHECK_EQUAL(gController.Commands[i], expected[i]);
+	}
+
+	//
+	// Doze has no default
+	//
+	CHECK_EQUAL(sequences[HX85X_SEQUENCE_DOZE_ENTER].Count, 0);
+}
+
+static
+VOID
+TestFailingStep(
+	VOID
+)
+{
+	static const HX85X_SEQUENCE_STEP steps[] =
+	{
+		{ HX85X_STEP_WRITE, HX85X_STEP_OPTIONAL, 1, 0, { 0x10 }, 0, { 0 }, 0 },
+		{ HX85X_STEP_WRITE, 0, 1, 0, { 0x11 }, 0, { 0 }, 0 },
+		{ HX85X_STEP_WRITE, 0, 1, 0, { 0x12 }, 0, { 0 }, 0 },
+		{ HX85X_STEP_WRITE, 0, 1, 0, { 0x13 }, 0, { 0 }, 0 },
+	};
+	NTSTATUS status;
+	ULONG time;
+
+	//
+	// An optional step may fail, a required one ends the run
+	//
+	ResetController(0, 0);
+	gController.FailCommand = 0x10;
+
+	status = Hx85xRunSteps(&gSpb, steps, ARRAYSIZE(steps), &time);
+
+	CHECK_EQUAL(status, STATUS_SUCCESS);
+	CHECK_EQUAL(gController.CommandCount, 3);
+
+	ResetController(0, 0);
+	gController.FailCommand = 0x12;
+
+	status = Hx85xRunSteps(&gSpb, steps, ARRAYSIZE(steps), &time);
+
+	CHECK_EQUAL(status, STATUS_DEVICE_PROTOCOL_ERROR);
+	CHECK_EQUAL(gController.CommandCount, 2);
+	CHECK_EQUAL(gController.Commands[1], 0x11);
+}
+
+static
+VOID
+TestWaitForReady(
+	VOID
+)
+{
+	ULONG64 start;
+	NTSTATUS status;
+
+	//
+	// Sensing 3 ms after sense on
+	//
+	ResetController(0, 30000);
+	SpbWriteDataSynchronously(&gSpb, (PUCHAR)"\x83", 1, NULL, 0);
+
+	start = KeQueryInterruptTime();
+	status = Hx85xWaitForReady(&gSpb, 10000, TRUE);
+
+	CHECK_EQUAL(status, STATUS_SUCCESS);
+	CHECK(KeQueryInterruptTime() - start >= 30000 - 500);
+	CHECK(KeQueryInterruptTime() - start < 100000);
+
+	//
+	// Never sensing, the wait ends at its bound
+	//
+	ResetController(0, 0);
+
+	start = KeQueryInterruptTime();
+	status = Hx85xWaitForReady(&gSpb, 5000, TRUE);
+
+	CHECK_EQUAL(status, STATUS_IO_TIMEOUT);
+	CHECK(KeQueryInterruptTime() - start >= 50000);
+}
+
+static
+VOID
+TestPowerOnBound(
+	VOID
+)
+{
+	HX85X_SEQUENCE sequences[HX85X_SEQUENCE_COUNT];
+	ULONG64 start;
+	NTSTATUS status;
+
+	Hx85xInitializeSequences(sequences);
+
+	//
+	// Sleeps of the old fixed delays lasted at least a clock tick, a
+	// controller taking that long still comes up
+	//
+	ResetController(HX85X_IC_POWER_ON_TIME * 10ULL - 20000, 0);
+
+	status = Hx85xRunSequence(sequences, HX85X_SEQUENCE_INIT_8526, &gSpb);
+
+	CHECK_EQUAL(status, STATUS_SUCCESS);
+	CHECK_EQUAL(gController.CommandCount, 4);
+
+	//
+	// One that does not power on within the bound fails the init at the
+	// next command, after the bound and not before
+	//
+	ResetController(HX85X_IC_POWER_ON_TIME * 10ULL * 2, 0);
+
+	start = KeQueryInterruptTime();
+	status = Hx85xRunSequence(sequences, HX85X_SEQUENCE_INIT_8526, &gSpb);
+
+	CHECK_EQUAL(status, STATUS_DEVICE_PROTOCOL_ERROR);
+	CHECK_EQUAL(gController.CommandCount, 1);
+	CHECK(KeQueryInterruptTime() - start >= HX85X_IC_POWER_ON_TIME * 10ULL);
+
+	//
+	// The command settles have nothing to poll and wait their time
+	//
+	ResetController(0, 0);
+
+	status = Hx85xRunSequence(sequences, HX85X_SEQUENCE_INIT_8526, &gSpb);
+
+	CHECK_EQUAL(status, STATUS_SUCCESS);
+	CHECK(sequences[HX85X_SEQUENCE_INIT_8526].Time >= 3 * HX85X_COMMAND_SETTLE_TIME);
+}
+
+static
+VOID
+TestConfiguration(
+	VOID
+)
+{
+	static const HX85X_SEQUENCE_STEP wake[] =
+	{
+		{ HX85X_STEP_WRITE, 0, 1, 0, { 0x83 }, 0, { 0 }, 0 },
+		{ HX85X_STEP_DELAY, 0, 0, 0, { 0 }, 0, { 0 }, 2000 },
+	};
+	static const HX85X_SEQUENCE_STEP invalid[] =
+	{
+		{ 9, 0, 1, 0, { 0x83 }, 0, { 0 }, 0 },
+	};
+	HX85X_SEQUENCE sequences[HX85X_SEQUENCE_COUNT];
+	const HX85X_SEQUENCE_STEP* defaultSleep;
+
+	Hx85xInitializeSequences(sequences);
+	defaultSleep = sequences[HX85X_SEQUENCE_SLEEP].Steps;
+
+	ShimClearDeviceValues();
+	ShimSetDeviceValue(L"WakeSequence", REG_BINARY, wake, sizeof(wake));
+	ShimSetDeviceValue(L"SleepSequence", REG_BINARY, invalid, sizeof(invalid));
+	ShimSetDeviceValue(L"DozeEnterSequence", REG_BINARY, wake, sizeof(wake) - 1);
+
+	Hx85xLoadSequences(sequences, NULL);
+
+	CHECK_EQUAL(sequences[HX85X_SEQUENCE_WAKE].Count, 2);
+	CHECK(sequences[HX85X_SEQUENCE_WAKE].Override != NULL);
+	CHECK(sequences[HX85X_SEQUENCE_SLEEP].Steps == defaultSleep);
+	CHECK_EQUAL(sequences[HX85X_SEQUENCE_DOZE_ENTER].Count, 0);
+
+	ResetController(0, 0);
+	CHECK_EQUAL(Hx85xRunSequence(sequences, HX85X_SEQUENCE_WAKE, &gSpb), STATUS_SUCCESS);
+	CHECK(sequences[HX85X_SEQUENCE_WAKE].Time >= 2000);
+
+	Hx85xFreeSequences(sequences);
+
+	CHECK(sequences[HX85X_SEQUENCE_WAKE].Override == NULL);
+	CHECK_EQUAL(ShimPoolAllocations, 0);
+
+	ShimClearDeviceValues();
+}
+
+static
+VOID
+TestTimeToSensing(
+	VOID
+)
+{
+	static const ULONG powerOn[] = { 0, 50, 100, 1000, 5000, 12000 };
+	HX85X_SEQUENCE sequences[HX85X_SEQUENCE_COUNT];
+	ULONG64 start;
+	NTSTATUS status;
+	ULONG i;
+
+	Hx85xInitializeSequences(sequences);
+
+	printf("%-12s %10s %10s %10s\n", "power on us", "init us", "wake us", "total us");
+
+	for (i = 0; i < ARRAYSIZE(powerOn); i++)
+	{
+		ResetController(powerOn[i] * 10ULL, 20000);
+
+		start = KeQueryInterruptTime();
+
+		status = Hx85xRunSequence(sequences, HX85X_SEQUENCE_INIT_8526, &gSpb);
+		CHECK_EQUAL(status, STATUS_SUCCESS);
+
+		status = Hx85xRunSequence(sequences, HX85X_SEQUENCE_WAKE, &gSpb);
+		CHECK_EQUAL(status, STATUS_SUCCESS);
+
+		status = Hx85xWaitForReady(&gSpb, 100000, TRUE);
+		CHECK_EQUAL(status, STATUS_SUCCESS);
+
+		printf("%-12lu %10lu %10lu %10lu%s\n",
+			(unsigned long)powerOn[i],
+			(unsigned long)sequences[HX85X_SEQUENCE_INIT_8526].Time,
+			(unsigned long)sequences[HX85X_SEQUENCE_WAKE].Time,
+			(unsigned long)((KeQueryInterruptTime() - start) / 10),
+			NT_SUCCESS(status) ? "" : " not sensing");
+	}
+}
+
+int
+main(
+	VOID
+)
+{
+	TestInitSequence();
+	TestFailingStep();
+	TestWaitForReady();
+	TestPowerOnBound();
+	TestConfiguration();
+	TestTimeToSensing();
+
+	return TEST_RESULT();
+}
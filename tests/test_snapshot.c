@@ -0,0 +1,186 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		test_snapshot.c
+
+	Abstract:
+
+		Tests that a configuration snapshot survives the round trip
+		through its stored form, and that snapshots of another build,
+		of a changed registry or damaged ones are rejected
+
+	Environment:
+
+		User mode, host tests only
+
+	Revision History:
+
+--*/
+
+#include <hosttest.h>
+#include <snapshot.h>
+
+#define SCHEMA 0x5A5A1234
+
+static TOUCH_SCREEN_SETTINGS gSettings;
+static TOUCH_SCREEN_PROPERTIES gProps;
+static CALIBRATION_CONTEXT gCalibration;
+static LARGE_INTEGER gWriteTime[TOUCH_SNAPSHOT_SOURCES];
+
+static
+VOID
+FillConfiguration(
+	VOID
+)
+{
+	ULONG i;
+
+	memset(&gSettings, 0x11, sizeof(gSettings));
+	gSettings.DeviceId = 0x8526;
+	gSettings.VendorCount = 2;
+
+	memset(&gProps, 0, sizeof(gProps));
+	gProps.TouchPhysicalWidth = 1440;
+	gProps.TouchPhysicalHeight = 2560;
+	gProps.TouchInvertYAxis = 1;
+
+	memset(&gCalibration, 0, sizeof(gCalibration));
+	gCalibration.Enabled = TRUE;
+	gCalibration.Columns = 3;
+	gCalibration.Rows = 5;
+	gCalibration.Node[7].X = -12;
+	gCalibration.Node[7].Y = 40;
+
+	for (i = 0; i < TOUCH_SNAPSHOT_SOURCES; i++)
+	{
+		gWriteTime[i].QuadPart = 132000000000000000LL + i * 977;
+	}
+}
+
+//
+// Stored the way the registry hands it back, with garbage beyond what
+// was written
+//
+static
+ULONG
+Store(
+	IN const TOUCH_SNAPSHOT* Snapshot,
+	OUT PTOUCH_SNAPSHOT Stored
+)
+{
+	memset(Stored, 0xCD, sizeof(TOUCH_SNAPSHOT));
+	memcpy(Stored, Snapshot, sizeof(TOUCH_SNAPSHOT));
+
+	return sizeof(TOUCH_SNAPSHOT);
+}
+
+static
+VOID
+TestCrc(
+	VOID
+)
+{
+	static const CHAR check[] = "123456789";
+
+	//
+	// The standard CRC-32 check value, also when continued in pieces
+	//
+	CHECK_EQUAL(TchSnapshotCrc(0, check, 9), 0xCBF43926);
+	CHECK_EQUAL(TchSnapshotCrc(TchSnapshotCrc(0, check, 4), check + 4, 5), 0xCBF43926);
+}
+
+static
+VOID
+TestRoundTrip(
+	VOID
+)
+{
+	static TOUCH_SNAPSHOT snapshot;
+	static TOUCH_SNAPSHOT again;
+	static TOUCH_SNAPSHOT stored;
+	ULONG length;
+
+	FillConfiguration();
+
+	TchBuildSnapshot(&snapshot, SCHEMA, gWriteTime, &gSettings, &gProps, &gCalibration);
+	length = Store(&snapshot, &stored);
+
+	CHECK_EQUAL(TchCheckSnapshot(&stored, length, SCHEMA, gWriteTime), TOUCH_SNAPSHOT_VALID);
+	CHECK(memcmp(&stored.Settings, &gSettings, sizeof(gSettings)) == 0);
+	CHECK(memcmp(&stored.Props, &gProps, sizeof(gProps)) == 0);
+	CHECK(memcmp(&stored.Calibration, &gCalibration, sizeof(gCalibration)) == 0);
+
+	//
+	// Identical configurations give identical blobs, whatever the
+	// buffer held before
+	//
+	memset(&again, 0xEE, sizeof(again));
+	TchBuildSnapshot(&again, SCHEMA, gWriteTime, &gSettings, &gProps, &gCalibration);
+	CHECK(memcmp(&again, &snapshot, sizeof(snapshot)) == 0);
+}
+
+static
+VOID
+TestRejected(
+	VOID
+)
+{
+	static TOUCH_SNAPSHOT snapshot;
+	static TOUCH_SNAPSHOT stored;
+	LARGE_INTEGER writeTime[TOUCH_SNAPSHOT_SOURCES];
+	ULONG length;
+	ULONG offset;
+
+	FillConfiguration();
+	TchBuildSnapshot(&snapshot, SCHEMA, gWriteTime, &gSettings, &gProps, &gCalibration);
+
+	//
+	// Another build
+	//
+	length = Store(&snapshot, &stored);
+	CHECK_EQUAL(TchCheckSnapshot(&stored, length, SCHEMA + 1, gWriteTime), TOUCH_SNAPSHOT_OTHER_SCHEMA);
+
+	//
+	// A touch registry key written since
+	//
+	memcpy(writeTime, gWriteTime, sizeof(writeTime));
+	writeTime[TOUCH_SNAPSHOT_SOURCES - 1].QuadPart++;
+	CHECK_EQUAL(TchCheckSnapshot(&stored, length, SCHEMA, writeTime), TOUCH_SNAPSHOT_STALE);
+
+	//
+	// Truncated or longer values
+	//
+	CHECK_EQUAL(TchCheckSnapshot(&stored, length - 1, SCHEMA, gWriteTime), TOUCH_SNAPSHOT_CORRUPT);
+	CHECK_EQUAL(TchCheckSnapshot(&stored, length + 4, SCHEMA, gWriteTime), TOUCH_SNAPSHOT_CORRUPT);
+
+	//
+	// A layout of another version
+	//
+	stored.Version = TOUCH_SNAPSHOT_VERSION - 1;
+	CHECK_EQUAL(TchCheckSnapshot(&stored, length, SCHEMA, gWriteTime), TOUCH_SNAPSHOT_CORRUPT);
+
+	//
+	// Any damaged byte after the checksum, the schema included
+	//
+	for (offset = FIELD_OFFSET(TOUCH_SNAPSHOT, Schema); offset < sizeof(TOUCH_SNAPSHOT); offset += 61)
+	{
+		length = Store(&snapshot, &stored);
+		((PUCHAR)&stored)[offset] ^= 0x10;
+
+		CHECK_EQUAL(TchCheckSnapshot(&stored, length, SCHEMA, gWriteTime), TOUCH_SNAPSHOT_CORRUPT);
+	}
+}
+
+int
+main(
+	VOID
+)
+{
+	TestCrc();
+	TestRoundTrip();
+	TestRejected();
+
+	return TEST_RESULT();
+}
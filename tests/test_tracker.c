@@ -0,0 +1,204 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		test_tracker.c
+
+	Abstract:
+
+		Tests contact ID assignment: IDs follow positions when the
+		controller shuffles its slots, new contacts take the lowest free
+		ID and IDs of lifted contacts are reused only in the next frame.
+
+	Environment:
+
+		User mode, host tests only
+
+	Revision History:
+
+--*/
+
+#include <time.h>
+#include <hosttest.h>
+#include <tracker.h>
+
+static TRACKER_POINT gPoints[TRACKER_MAX_SLOTS];
+static UCHAR gIds[TRACKER_MAX_SLOTS];
+
+static
+VOID
+SetPoint(
+	ULONG Slot,
+	LONG X,
+	LONG Y
+)
+{
+	gPoints[Slot].X = X;
+	gPoints[Slot].Y = Y;
+}
+
+static
+VOID
+TestNewContacts(
+	VOID
+)
+{
+	TRACKER_CONTEXT context;
+
+	TrackerReset(&context);
+
+	SetPoint(3, 100, 100);
+	SetPoint(7, 900, 900);
+	TrackerUpdate(&context, (1u << 3) | (1u << 7), 0, gPoints, gIds);
+
+	CHECK_EQUAL(gIds[3], 0);
+	CHECK_EQUAL(gIds[7], 1);
+	CHECK_EQUAL(context.Count, 2);
+}
+
+static
+VOID
+TestSlotSwap(
+	VOID
+)
+{
+	TRACKER_CONTEXT context;
+
+	TrackerReset(&context);
+
+	SetPoint(0, 100, 100);
+	SetPoint(1, 900, 900);
+	TrackerUpdate(&context, 0x3, 0, gPoints, gIds);
+
+	CHECK_EQUAL(gIds[0], 0);
+	CHECK_EQUAL(gIds[1], 1);
+
+	//
+	// The controller swaps the slots of the two fingers
+	//
+	SetPoint(0, 905, 895);
+	SetPoint(1, 105, 102);
+	TrackerUpdate(&context, 0x3, 0, gPoints, gIds);
+
+	CHECK_EQUAL(gIds[0], 1);
+	CHECK_EQUAL(gIds[1], 0);
+}
+
+static
+VOID
+TestLiftAndReuse(
+	VOID
+)
+{
+	TRACKER_CONTEXT context;
+
+	TrackerReset(&context);
+
+	SetPoint(0, 100, 100);
+	SetPoint(1, 500, 500);
+	TrackerUpdate(&context, 0x3, 0, gPoints, gIds);
+
+	//
+	// The first finger lifts while a third one lands, the lifting
+	// contact keeps its ID for this frame
+	//
+	SetPoint(0, 101, 101);
+	SetPoint(2, 1000, 100);
+	TrackerUpdate(&context, (1u << 1) | (1u << 2), 1u << 0, gPoints, gIds);
+
+	CHECK_EQUAL(gIds[0], 0);
+	CHECK_EQUAL(gIds[1], 1);
+	CHECK_EQUAL(gIds[2], 2);
+
+	//
+	// Next frame the released ID is handed out again
+	//
+	SetPoint(3, 200, 1800);
+	TrackerUpdate(&context, (1u << 1) | (1u << 2) | (1u << 3), 0, gPoints, gIds);
+
+	CHECK_EQUAL(gIds[1], 1);
+	CHECK_EQUAL(gIds[2], 2);
+	CHECK_EQUAL(gIds[3], 0);
+}
+
+static
+VOID
+TestManyContacts(
+	VOID
+)
+{
+	TRACKER_CONTEXT context;
+	ULONG mask = 0;
+	ULONG i;
+
+	TrackerReset(&context);
+
+	//
+	// More contacts than are matched by position keep their slots
+	//
+	for (i = 0; i < TRACKER_MAX_CONTACTS + 2; i++)
+	{
+		SetPoint(i, 100 * (LONG)i, 100);
+		mask |= 1u << i;
+	}
+
+	TrackerUpdate(&context, mask, 0, gPoints, gIds);
+	TrackerUpdate(&context, mask, 0, gPoints, gIds);
+
+	for (i = 0; i < TRACKER_MAX_CONTACTS + 2; i++)
+	{
+		CHECK_EQUAL(gIds[i], i);
+	}
+}
+
+static
+VOID
+Benchmark(
+	VOID
+)
+{
+	static const ULONG contacts[] = { 2, 5, 10 };
+	TRACKER_CONTEXT context;
+	ULONG frames = 100000;
+	ULONG i, j, f;
+	clock_t start;
+	double elapsed;
+
+	for (i = 0; i < ARRAYSIZE(contacts); i++)
+	{
+		TrackerReset(&context);
+
+		start = clock();
+
+		for (f = 0; f < frames; f++)
+		{
+			for (j = 0; j < contacts[i]; j++)
+			{
+				SetPoint(j, 150 * (LONG)j + (LONG)(f % 100), 1000 - (LONG)(f % 100));
+			}
+
+			TrackerUpdate(&context, (1u << contacts[i]) - 1, 0, gPoints, gIds);
+		}
+
+		elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+		printf("%2lu contacts: %.1f ns per frame\n",
+			(unsigned long)contacts[i],
+			elapsed * 1e9 / frames);
+	}
+}
+
+int
+main(
+	VOID
+)
+{
+	TestNewContacts();
+	TestSlotSwap();
+	TestLiftAndReuse();
+	TestManyContacts();
+	Benchmark();
+
+	return TEST_RESULT();
+}
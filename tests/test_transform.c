@@ -0,0 +1,503 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		test_transform.c
+
+	Abstract:
+
+		Checks bit for bit that the compiled transform, scalar and per
+		frame, gives the results of TchTranslateToDisplayCoordinates. The
+		shipped properties are checked over every pair of 12 bit inputs,
+		every 16 bit input of each axis for a set of edge cases, and
+		random properties over every 12 bit input. Prints the cost per
+		frame of both forms as well.
+
+	Environment:
+
+		User mode, host tests only
+
+	Revision History:
+
+--*/
+
+#include <time.h>
+#include <hosttest.h>
+#include <controller.h>
+#include <resolutions.h>
+
+static ULONG gSeed = 1;
+static ULONG gFolded;
+static ULONG gReference;
+
+//
+// Screen loading is not tested here
+//
+VOID
+TchLoadTouchRegistry(
+	OUT PTOUCH_SCREEN_SETTINGS Settings OPTIONAL,
+	OUT PTOUCH_SCREEN_PROPERTIES Props OPTIONAL,
+	OUT PCALIBRATION_CONTEXT Calibration OPTIONAL
+)
+{
+	UNREFERENCED_PARAMETER(Settings);
+	UNREFERENCED_PARAMETER(Props);
+	UNREFERENCED_PARAMETER(Calibration);
+}
+
+VOID
+TchLoadTouchConfiguration(
+	IN WDFDEVICE FxDevice,
+	OUT PTOUCH_SCREEN_SETTINGS Settings,
+	OUT PTOUCH_SCREEN_PROPERTIES Props,
+	OUT PCALIBRATION_CONTEXT Calibration
+)
+{
+	UNREFERENCED_PARAMETER(FxDevice);
+	UNREFERENCED_PARAMETER(Settings);
+	UNREFERENCED_PARAMETER(Props);
+	UNREFERENCED_PARAMETER(Calibration);
+}
+
+//
+// Nor is the properties key watch
+//
+VOID
+TchInitializeKeyWatch(
+	OUT PTOUCH_KEY_WATCH Watch,
+	IN PCWSTR KeyPath,
+	IN ULONG Filter,
+	IN BOOLEAN WatchTree,
+	IN PTOUCH_KEY_WATCH_ROUTINE Routine,
+	IN PVOID Context
+)
+{
+	UNREFERENCED_PARAMETER(KeyPath);
+	UNREFERENCED_PARAMETER(Filter);
+	UNREFERENCED_PARAMETER(WatchTree);
+	UNREFERENCED_PARAMETER(Routine);
+	UNREFERENCED_PARAMETER(Context);
+
+	RtlZeroMemory(Watch, sizeof(TOUCH_KEY_WATCH));
+}
+
+NTSTATUS
+TchStartKeyWatch(
+	IN PTOUCH_KEY_WATCH Watch
+)
+{
+	UNREFERENCED_PARAMETER(Watch);
+
+	return STATUS_NOT_SUPPORTED;
+}
+
+VOID
+TchStopKeyWatch(
+	IN PTOUCH_KEY_WATCH Watch
+)
+{
+	UNREFERENCED_PARAMETER(Watch);
+}
+
+static
+ULONG
+Random(
+	ULONG Limit
+)
+{
+	gSeed = gSeed * 1103515245 + 12345;
+
+	return ((gSeed >> 8) % Limit);
+}
+
+static
+BOOLEAN
+Compare(
+	const char* Name,
+	TOUCH_SCREEN_PROPERTIES* Props,
+	const TOUCH_TRANSFORM* Transform,
+	const USHORT* InX,
+	const USHORT* InY,
+	ULONG Count
+)
+{
+	static USHORT frameX[65536];
+	static USHORT frameY[65536];
+	USHORT referenceX, referenceY;
+	USHORT x, y;
+	ULONG i;
+
+	RtlCopyMemory(frameX, InX, Count * sizeof(USHORT));
+	RtlCopyMemory(frameY, InY, Count * sizeof(USHORT));
+
+	TchTransformFrameToDisplayCoordinates(frameX, frameY, Count, Transform);
+
+	for (i = 0; i < Count; i++)
+	{
+		referenceX = x = InX[i];
+		referenceY = y = InY[i];
+
+		TchTranslateToDisplayCoordinates(&referenceX, &referenceY, Props);
+		TchTransformToDisplayCoordinates(&x, &y, Transform);
+
+		if (x != referenceX || y != referenceY ||
+			frameX[i] != referenceX || frameY[i] != referenceY)
+		{
+			fprintf(stderr,
+				"%s: (%u, %u) gives (%u, %u), scalar (%u, %u), frame (%u, %u)\n",
+				Name,
+				InX[i],
+				InY[i],
+				referenceX,
+				referenceY,
+				x,
+				y,
+				frameX[i],
+				frameY[i]);
+
+			gFailures++;
+
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static
+VOID
+CheckAxes(
+	const char* Name,
+	TOUCH_SCREEN_PROPERTIES* Props,
+	ULONG Range
+)
+{
+	static USHORT x[65536];
+	static USHORT y[65536];
+	TOUCH_TRANSFORM transform;
+	ULONG i;
+
+	TchCompileTransform(Props, &transform);
+
+	//
+	// Each output axis depends on one input axis only, so two sweeps
+	// running in opposite directions cover every input of both
+	//
+	for (i = 0; i < Range; i++)
+	{
+		x[i] = (USHORT)i;
+		y[i] = (USHORT)(Range - 1 - i);
+	}
+
+	if (Compare(Name, Props, &transform, x, y, Range))
+	{
+		Compare(Name, Props, &transform, y, x, Range);
+	}
+}
+
+static
+BOOLEAN
+IsFolded(
+	TOUCH_SCREEN_PROPERTIES* Props
+)
+{
+	TOUCH_SCREEN_PROPERTIES empty;
+	TOUCH_TRANSFORM transform;
+	TOUCH_TRANSFORM reference;
+
+	TchCompileTransform(Props, &transform);
+
+	//
+	// Empty properties never fold, they give the reference kernel
+	//
+	RtlZeroMemory(&empty, sizeof(empty));
+	TchCompileTransform(&empty, &reference);
+
+	return transform.Kernel != reference.Kernel;
+}
+
+static
+VOID
+InitializeProps(
+	TOUCH_SCREEN_PROPERTIES* Props,
+	ULONG TouchWidth,
+	ULONG TouchHeight,
+	ULONG DisplayWidth,
+	ULONG DisplayHeight
+)
+{
+	RtlZeroMemory(Props, sizeof(TOUCH_SCREEN_PROPERTIES));
+
+	Props->TouchPhysicalWidth = TouchWidth;
+	Props->TouchPhysicalHeight = TouchHeight;
+	Props->DisplayPhysicalWidth = DisplayWidth;
+	Props->DisplayPhysicalHeight = DisplayHeight;
+	Props->DisplayViewableWidth = DisplayWidth;
+	Props->DisplayViewableHeight = DisplayHeight;
+}
+
+static
+VOID
+TestFullGrid(
+	VOID
+)
+{
+	static USHORT x[4096];
+	static USHORT y[4096];
+	TOUCH_SCREEN_PROPERTIES props;
+	TOUCH_TRANSFORM transform;
+	ULONG orientation;
+	ULONG row, i;
+
+	//
+	// The device resolution, in every orientation, over every pair of
+	// 12 bit coordinates
+	//
+	for (orientation = 0; orientation < 8; orientation++)
+	{
+		InitializeProps(
+			&props,
+			TOUCH_DEVICE_RESOLUTION_X,
+			TOUCH_DEVICE_RESOLUTION_Y,
+			TOUCH_DEVICE_RESOLUTION_X,
+			TOUCH_DEVICE_RESOLUTION_Y);
+
+		props.TouchSwapAxes = (orientation >> 2) & 1;
+		props.TouchInvertXAxis = (orientation >> 1) & 1;
+		props.TouchInvertYAxis = orientation & 1;
+
+		if (props.TouchSwapAxes)
+		{
+			props.TouchPhysicalWidth = TOUCH_DEVICE_RESOLUTION_Y;
+			props.TouchPhysicalHeight = TOUCH_DEVICE_RESOLUTION_X;
+			props.DisplayPhysicalWidth = TOUCH_DEVICE_RESOLUTION_Y;
+			props.DisplayPhysicalHeight = TOUCH_DEVICE_RESOLUTION_X;
+		}
+
+		TchCompileTransform(&props, &transform);
+		CHECK(IsFolded(&props));
+
+		for (row = 0; row < 4096; row++)
+		{
+			for (i = 0; i < 4096; i++)
+			{
+				x[i] = (USHORT)i;
+				y[i] = (USHORT)row;
+			}
+
+			if (!Compare("device", &props, &transform, x, y, 4096))
+			{
+				break;
+			}
+		}
+	}
+}
+
+static
+VOID
+TestEdgeCases(
+	VOID
+)
+{
+	TOUCH_SCREEN_PROPERTIES props;
+
+	//
+	// Scaled down with a button row and boxes on every side
+	//
+	InitializeProps(&props, 1440, 2760, 720, 1280);
+	props.TouchPhysicalButtonHeight = 200;
+	props.TouchPillarBoxWidthLeft = 10;
+	props.TouchPillarBoxWidthRight = 12;
+	props.TouchLetterBoxHeightTop = 7;
+	props.TouchLetterBoxHeightBottom = 3;
+	props.DisplayPillarBoxWidthLeft = 5;
+	props.DisplayPillarBoxWidthRight = 4;
+	props.DisplayLetterBoxHeightTop = 9;
+	props.DisplayLetterBoxHeightBottom = 11;
+	CHECK(IsFolded(&props));
+	CheckAxes("boxes", &props, 65536);
+
+	props.TouchInvertXAxis = 1;
+	props.TouchInvertYAxis = 1;
+	CheckAxes("boxes inverted", &props, 65536);
+
+	//
+	// Scaled up by a factor that is not a power of two
+	//
+	InitializeProps(&props, 480, 800, 1440, 2560);
+	CHECK(IsFolded(&props));
+	CheckAxes("scaled up", &props, 65536);
+
+	//
+	// One pixel axes
+	//
+	InitializeProps(&props, 1, 1, 1, 1);
+	CheckAxes("one pixel", &props, 65536);
+
+	//
+	// The largest axes
+	//
+	InitializeProps(&props, 65535, 65535, 65535, 65535);
+	CheckAxes("largest", &props, 65536);
+
+	//
+	// Boxes as wide as the axis do not fold
+	//
+	InitializeProps(&props, 1440, 2560, 1440, 2560);
+	props.TouchPillarBoxWidthLeft = 1440;
+	CHECK(!IsFolded(&props));
+	CheckAxes("box as wide as axis", &props, 65536);
+
+	//
+	// The shipped default properties
+	//
+	InitializeProps(&props, TOUCH_DEFAULT_RESOLUTION_X, TOUCH_DEFAULT_RESOLUTION_Y, 0, 0);
+	props.TouchPillarBoxWidthLeft = TOUCH_DEFAULT_RESOLUTION_X;
+	props.TouchPillarBoxWidthRight = TOUCH_DEFAULT_RESOLUTION_Y;
+	props.DisplayViewableWidth = TOUCH_DEFAULT_RESOLUTION_X;
+	props.DisplayViewableHeight = TOUCH_DEFAULT_RESOLUTION_Y;
+	CheckAxes("defaults", &props, 65536);
+}
+
+static
+ULONG
+RandomBox(
+	ULONG Size
+)
+{
+	switch (Random(4))
+	{
+	case 0:
+		return Random(Size / 2 + 1);
+	case 1:
+		return Random(Size + 2);
+	default:
+		return 0;
+	}
+}
+
+static
+VOID
+TestRandom(
+	VOID
+)
+{
+	TOUCH_SCREEN_PROPERTIES props;
+	char name[32];
+	ULONG i;
+
+	for (i = 0; i < 5000; i++)
+	{
+		InitializeProps(
+			&props,
+			1 + Random(4096),
+			2 + Random(4095),
+			1 + Random(4096),
+			1 + Random(4096));
+
+		props.TouchSwapAxes = Random(2);
+		props.TouchInvertXAxis = Random(2);
+		props.TouchInvertYAxis = Random(2);
+		props.TouchPhysicalButtonHeight = Random(2) ? Random(props.TouchPhysicalHeight / 4 + 1) : 0;
+		props.TouchPillarBoxWidthLeft = RandomBox(props.TouchPhysicalWidth);
+		props.TouchPillarBoxWidthRight = RandomBox(props.TouchPhysicalWidth);
+		props.TouchLetterBoxHeightTop = RandomBox(props.TouchPhysicalHeight);
+		props.TouchLetterBoxHeightBottom = RandomBox(props.TouchPhysicalHeight);
+		props.DisplayPillarBoxWidthLeft = RandomBox(props.DisplayPhysicalWidth);
+		props.DisplayPillarBoxWidthRight = RandomBox(props.DisplayPhysicalWidth);
+		props.DisplayLetterBoxHeightTop = RandomBox(props.DisplayPhysicalHeight);
+		props.DisplayLetterBoxHeightBottom = RandomBox(props.DisplayPhysicalHeight);
+
+		if (IsFolded(&props))
+		{
+			gFolded++;
+		}
+		else
+		{
+			gReference++;
+		}
+
+		snprintf(name, sizeof(name), "random %lu", (unsigned long)i);
+		CheckAxes(name, &props, 4096);
+	}
+
+	printf("%lu random properties folded, %lu use the reference\n",
+		(unsigned long)gFolded,
+		(unsigned long)gReference);
+
+	CHECK(gFolded > gReference);
+}
+
+static
+VOID
+Benchmark(
+	VOID
+)
+{
+	static const ULONG contacts[] = { 2, 5, 10, 32 };
+	TOUCH_SCREEN_PROPERTIES props;
+	TOUCH_TRANSFORM transform;
+	USHORT x[32], y[32];
+	ULONG frames = 200000;
+	ULONG i, j, f;
+	clock_t start;
+	double reference, frame;
+
+	InitializeProps(&props, 1440, 2760, 720, 1280);
+	props.TouchPhysicalButtonHeight = 200;
+	props.TouchInvertYAxis = 1;
+	TchCompileTransform(&props, &transform);
+
+	printf("%-8s %14s %14s\n", "contacts", "reference ns", "compiled ns");
+
+	for (i = 0; i < ARRAYSIZE(contacts); i++)
+	{
+		start = clock();
+
+		for (f = 0; f < frames; f++)
+		{
+			for (j = 0; j < contacts[i]; j++)
+			{
+				x[j] = (USHORT)(f + 37 * j);
+				y[j] = (USHORT)(f * 3 + 11 * j);
+				TchTranslateToDisplayCoordinates(&x[j], &y[j], &props);
+			}
+		}
+
+		reference = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+		start = clock();
+
+		for (f = 0; f < frames; f++)
+		{
+			for (j = 0; j < contacts[i]; j++)
+			{
+				x[j] = (USHORT)(f + 37 * j);
+				y[j] = (USHORT)(f * 3 + 11 * j);
+			}
+
+			TchTransformFrameToDisplayCoordinates(x, y, contacts[i], &transform);
+		}
+
+		frame = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+		printf("%-8lu %14.1f %14.1f\n",
+			(unsigned long)contacts[i],
+			reference * 1e9 / frames,
+			frame * 1e9 / frames);
+	}
+}
+
+int
+main(
+	VOID
+)
+{
+	TestFullGrid();
+	TestEdgeCases();
+	TestRandom();
+	Benchmark();
+
+	return TEST_RESULT();
+}
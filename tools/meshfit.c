@@ -0,0 +1,429 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		meshfit.c
+
+	Abstract:
+
+		Produces the TouchCalibrationMesh value from measurements.
+
+		With the value absent, touch targets are shown at known display
+		pixels and the positions the driver reports for them are
+		recorded, one sample per line:
+
+			targetX targetY measuredX measuredY
+
+		The driver interpolates node offsets bilinearly at the measured
+		position, so the offsets are fitted by least squares to move
+		each measured position onto its target. A smoothness term ties
+		every node to its neighbours, which fills nodes without samples
+		and keeps noise from bending the mesh.
+
+			meshfit width height columns rows [smoothing] < samples > mesh.reg
+
+		The output is a .reg file setting the value under the screen
+		properties key. The residual error before and after the fit goes
+		to stderr.
+
+	Environment:
+
+		User mode, host tool
+
+	Revision History:
+
+--*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "meshfit.h"
+
+//
+// See calibration.h
+//
+#define MESHFIT_MIN_NODES       2
+#define MESHFIT_MAX_NODES       17
+#define MESHFIT_OFFSET_BITS     4
+#define MESHFIT_MAX_SAMPLES     65536
+
+static
+void
+MeshFitLocate(
+	double Value,
+	unsigned Size,
+	unsigned Nodes,
+	unsigned* Cell,
+	double* Weight
+)
+{
+	double position = Value * (Nodes - 1) / Size;
+	unsigned cell;
+
+	//
+	// Same cells as CalibrationLocate, the far edge belongs to the last
+	//
+	position = position < 0 ? 0 : position;
+	cell = (unsigned)position;
+	cell = cell > Nodes - 2 ? Nodes - 2 : cell;
+
+	*Cell = cell;
+	*Weight = position - cell > 1 ? 1 : position - cell;
+}
+
+static
+void
+MeshFitWeights(
+	double X,
+	double Y,
+	unsigned Width,
+	unsigned Height,
+	unsigned Columns,
+	unsigned Rows,
+	unsigned Node[4],
+	double Weight[4]
+)
+{
+	unsigned column, row;
+	double u, v;
+
+	MeshFitLocate(X, Width, Columns, &column, &u);
+	MeshFitLocate(Y, Height, Rows, &row, &v);
+
+	Node[0] = row * Columns + column;
+	Node[1] = Node[0] + 1;
+	Node[2] = Node[0] + Columns;
+	Node[3] = Node[2] + 1;
+
+	Weight[0] = (1 - u) * (1 - v);
+	Weight[1] = u * (1 - v);
+	Weight[2] = (1 - u) * v;
+	Weight[3] = u * v;
+}
+
+static
+int
+MeshFitSolve(
+	double* Matrix,
+	double* Right,
+	unsigned Size
+)
+{
+	unsigned i, j, k;
+	double factor;
+
+	//
+	// Normal equations are symmetric positive definite, Cholesky would do,
+	// plain elimination keeps it short
+	//
+	for (i = 0; i < Size; i++)
+	{
+		if (fabs(Matrix[i * Size + i]) < 1e-12)
+		{
+			return -1;
+		}
+
+		for (j = i + 1; j < Size; j++)
+		{
+			factor = Matrix[j * Size + i] / Matrix[i * Size + i];
+
+			if (factor == 0)
+			{
+				continue;
+			}
+
+			for (k = i; k < Size; k++)
+			{
+				Matrix[j * Size + k] -= factor * Matrix[i * Size + k];
+			}
+
+			Right[j * 2] -= factor * Right[i * 2];
+			Right[j * 2 + 1] -= factor * Right[i * 2 + 1];
+		}
+	}
+
+	for (i = Size; i-- > 0;)
+	{
+		for (k = i + 1; k < Size; k++)
+		{
+			Right[i * 2] -= Matrix[i * Size + k] * Right[k * 2];
+			Right[i * 2 + 1] -= Matrix[i * Size + k] * Right[k * 2 + 1];
+		}
+
+		Right[i * 2] /= Matrix[i * Size + i];
+		Right[i * 2 + 1] /= Matrix[i * Size + i];
+	}
+
+	return 0;
+}
+
+static
+void
+MeshFitCouple(
+	double* Matrix,
+	unsigned Size,
+	unsigned A,
+	unsigned B,
+	double Strength
+)
+{
+	Matrix[A * Size + A] += Strength;
+	Matrix[B * Size + B] += Strength;
+	Matrix[A * Size + B] -= Strength;
+	Matrix[B * Size + A] -= Strength;
+}
+
+int
+MeshFit(
+	const MESHFIT_SAMPLE* Samples,
+	unsigned Count,
+	unsigned Width,
+	unsigned Height,
+	unsigned Columns,
+	unsigned Rows,
+	double Smoothing,
+	short* Offsets
+)
+{
+	unsigned size = Columns * Rows;
+	unsigned node[4];
+	double weight[4];
+	double* matrix;
+	double* right;
+	double value;
+	unsigned i, j, k;
+	int result;
+
+	if (Columns < MESHFIT_MIN_NODES || Columns > MESHFIT_MAX_NODES ||
+		Rows < MESHFIT_MIN_NODES || Rows > MESHFIT_MAX_NODES ||
+		Width == 0 || Height == 0 || Smoothing <= 0)
+	{
+		return -1;
+	}
+
+	matrix = calloc((size_t)size * size, sizeof(double));
+	right = calloc((size_t)size * 2, sizeof(double));
+
+	if (matrix == NULL || right == NULL)
+	{
+		free(matrix);
+		free(right);
+		return -1;
+	}
+
+	for (i = 0; i < Count; i++)
+	{
+		MeshFitWeights(
+			Samples[i].MeasuredX,
+			Samples[i].MeasuredY,
+			Width,
+			Height,
+			Columns,
+			Rows,
+			node,
+			weight);
+
+		for (j = 0; j < 4; j++)
+		{
+			for (k = 0; k < 4; k++)
+			{
+				matrix[node[j] * size + node[k]] += weight[j] * weight[k];
+			}
+
+			right[node[j] * 2] += weight[j] * (Samples[i].TargetX - Samples[i].MeasuredX);
+			right[node[j] * 2 + 1] += weight[j] * (Samples[i].TargetY - Samples[i].MeasuredY);
+		}
+	}
+
+	for (j = 0; j < Rows; j++)
+	{
+		for (i = 0; i < Columns; i++)
+		{
+			if (i + 1 < Columns)
+			{
+				MeshFitCouple(matrix, size, j * Columns + i, j * Columns + i + 1, Smoothing);
+			}
+
+			if (j + 1 < Rows)
+			{
+				MeshFitCouple(matrix, size, j * Columns + i, (j + 1) * Columns + i, Smoothing);
+			}
+		}
+	}
+
+	//
+	// Without samples the smoothness term alone is singular, a tiny pull
+	// towards no offset settles it
+	//
+	for (i = 0; i < size; i++)
+	{
+		matrix[i * size + i] += Smoothing * 1e-6;
+	}
+
+	result = MeshFitSolve(matrix, right, size);
+
+	for (i = 0; result == 0 && i < size * 2; i++)
+	{
+		value = floor(right[i] * (1 << MESHFIT_OFFSET_BITS) + 0.5);
+		value = value > 32767 ? 32767 : value < -32768 ? -32768 : value;
+		Offsets[i] = (short)value;
+	}
+
+	free(matrix);
+	free(right);
+
+	return result;
+}
+
+size_t
+MeshFitEncode(
+	const short* Offsets,
+	unsigned Columns,
+	unsigned Rows,
+	unsigned char* Buffer,
+	size_t Length
+)
+{
+	size_t size = 4 + (size_t)Columns * Rows * 4;
+	size_t i;
+
+	if (Length < size)
+	{
+		return 0;
+	}
+
+	//
+	// Little endian USHORT Columns, Rows, then SHORT X, Y per node
+	//
+	Buffer[0] = (unsigned char)Columns;
+	Buffer[1] = (unsigned char)(Columns >> 8);
+	Buffer[2] = (unsigned char)Rows;
+	Buffer[3] = (unsigned char)(Rows >> 8);
+
+	for (i = 0; i < (size_t)Columns * Rows * 2; i++)
+	{
+		Buffer[4 + i * 2] = (unsigned char)((unsigned short)Offsets[i]);
+		Buffer[5 + i * 2] = (unsigned char)((unsigned short)Offsets[i] >> 8);
+	}
+
+	return size;
+}
+
+#ifndef MESHFIT_NO_MAIN
+
+static
+double
+MeshFitResidual(
+	const MESHFIT_SAMPLE* Samples,
+	unsigned Count,
+	unsigned Width,
+	unsigned Height,
+	unsigned Columns,
+	unsigned Rows,
+	const short* Offsets
+)
+{
+	unsigned node[4];
+	double weight[4];
+	double sum = 0;
+	double x, y;
+	unsigned i, j;
+
+	for (i = 0; i < Count; i++)
+	{
+		x = Samples[i].MeasuredX;
+		y = Samples[i].MeasuredY;
+
+		if (Offsets != NULL)
+		{
+			MeshFitWeights(x, y, Width, Height, Columns, Rows, node, weight);
+
+			for (j = 0; j < 4; j++)
+			{
+				x += weight[j] * Offsets[node[j] * 2] / (1 << MESHFIT_OFFSET_BITS);
+				y += weight[j] * Offsets[node[j] * 2 + 1] / (1 << MESHFIT_OFFSET_BITS);
+			}
+		}
+
+		sum += (x - Samples[i].TargetX) * (x - Samples[i].TargetX) +
+			(y - Samples[i].TargetY) * (y - Samples[i].TargetY);
+	}
+
+	return Count != 0 ? sqrt(sum / Count) : 0;
+}
+
+int
+main(
+	int argc,
+	char** argv
+)
+{
+	static MESHFIT_SAMPLE samples[MESHFIT_MAX_SAMPLES];
+	static short offsets[MESHFIT_MAX_NODES * MESHFIT_MAX_NODES * 2];
+	static unsigned char mesh[4 + sizeof(offsets)];
+	unsigned width, height, columns, rows;
+	double smoothing = 0.5;
+	unsigned count = 0;
+	char line[256];
+	size_t size;
+	size_t i;
+
+	if (argc < 5)
+	{
+		fprintf(stderr, "usage: %s width height columns rows [smoothing] < samples > mesh.reg\n", argv[0]);
+		return 2;
+	}
+
+	width = (unsigned)strtoul(argv[1], NULL, 0);
+	height = (unsigned)strtoul(argv[2], NULL, 0);
+	columns = (unsigned)strtoul(argv[3], NULL, 0);
+	rows = (unsigned)strtoul(argv[4], NULL, 0);
+
+	if (argc > 5)
+	{
+		smoothing = strtod(argv[5], NULL);
+	}
+
+	while (count < MESHFIT_MAX_SAMPLES && fgets(line, sizeof(line), stdin) != NULL)
+	{
+		if (line[0] == '#' ||
+			sscanf(line, "%lf %lf %lf %lf",
+				&samples[count].TargetX,
+				&samples[count].TargetY,
+				&samples[count].MeasuredX,
+				&samples[count].MeasuredY) != 4)
+		{
+			continue;
+		}
+
+		count++;
+	}
+
+	if (MeshFit(samples, count, width, height, columns, rows, smoothing, offsets) != 0)
+	{
+		fprintf(stderr, "no mesh fits these parameters\n");
+		return 1;
+	}
+
+	fprintf(stderr, "%u samples, rms error %.2f px before, %.2f px after\n",
+		count,
+		MeshFitResidual(samples, count, width, height, columns, rows, NULL),
+		MeshFitResidual(samples, count, width, height, columns, rows, offsets));
+
+	size = MeshFitEncode(offsets, columns, rows, mesh, sizeof(mesh));
+
+	printf("Windows Registry Editor Version 5.00\n\n");
+	printf("[HKEY_LOCAL_MACHINE\\System\\TOUCH\\SCREENPROPERTIES]\n");
+	printf("\"TouchCalibrationMesh\"=hex:");
+
+	for (i = 0; i < size; i++)
+	{
+		printf("%02x%s", mesh[i], i + 1 == size ? "\n" : (i % 24 == 23 ? ",\\\n  " : ","));
+	}
+
+	return 0;
+}
+
+#endif
@@ -0,0 +1,64 @@
+/*++
+	Copyright (c) LumiaWoA authors. All Rights Reserved.
+
+	Module Name:
+
+		meshfit.h
+
+	Abstract:
+
+		Fits a calibration mesh, see calibration.h, to pairs of target
+		and measured display coordinates
+
+	Environment:
+
+		User mode, host tool
+
+	Revision History:
+
+--*/
+
+#pragma once
+
+#include <stddef.h>
+
+typedef struct _MESHFIT_SAMPLE
+{
+	//
+	// Where the finger was, and where the driver reported it with the
+	// mesh off, in display pixels
+	//
+	double TargetX;
+	double TargetY;
+	double MeasuredX;
+	double MeasuredY;
+} MESHFIT_SAMPLE;
+
+//
+// Offsets receives Columns * Rows node offsets, X then Y per node, in Q4
+// display pixels. Returns 0 on success.
+//
+int
+MeshFit(
+	const MESHFIT_SAMPLE* Samples,
+	unsigned Count,
+	unsigned Width,
+	unsigned Height,
+	unsigned Columns,
+	unsigned Rows,
+	double Smoothing,
+	short* Offsets
+);
+
+//
+// Lays the mesh out as the TouchCalibrationMesh value. Returns the size,
+// or 0 when Length is too small.
+//
+size_t
+MeshFitEncode(
+	const short* Offsets,
+	unsigned Columns,
+	unsigned Rows,
+	unsigned char* Buffer,
+	size_t Length
+);